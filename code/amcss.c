@@ -130,7 +130,8 @@ static void test_stepper(mps_addr_t object, mps_fmt_t fmt, mps_pool_t pool,
 
 /* test -- the body of the test */
 
-static void test(mps_pool_class_t pool_class, size_t roots_count)
+static void test(mps_pool_class_t pool_class, size_t roots_count,
+                 mps_bool_t software_barrier)
 {
   mps_fmt_t format;
   mps_chain_t chain;
@@ -143,12 +144,18 @@ static void test(mps_pool_class_t pool_class, size_t roots_count)
   mps_addr_t busy_init;
   mps_pool_t pool;
   int described = 0;
+  mps_wb_t wb = software_barrier ? mps_arena_wb(arena) : NULL;
 
   die(dylan_fmt(&format, arena), "fmt_create");
   die(mps_chain_create(&chain, arena, genCOUNT, testChain), "chain_create");
 
-  die(mps_pool_create(&pool, arena, pool_class, format, chain),
-      "pool_create(amc)");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    MPS_ARGS_ADD(args, MPS_KEY_SOFTWARE_BARRIER, software_barrier);
+    die(mps_pool_create_k(&pool, arena, pool_class, args),
+        "pool_create(amc)");
+  } MPS_ARGS_END(args);
 
   die(mps_ap_create(&ap, pool, mps_rank_exact()), "BufferCreate");
   die(mps_ap_create(&busy_ap, pool, mps_rank_exact()), "BufferCreate 2");
@@ -265,8 +272,8 @@ static void test(mps_pool_class_t pool_class, size_t roots_count)
         cdie(dylan_check(exactRoots[i]), "dying root check");
       exactRoots[i] = make(roots_count);
       if (exactRoots[(exactRootsCOUNT-1) - i] != objNULL)
-        dylan_write(exactRoots[(exactRootsCOUNT-1) - i],
-                    exactRoots, exactRootsCOUNT);
+        dylan_write_wb(wb, exactRoots[(exactRootsCOUNT-1) - i],
+                       exactRoots, exactRootsCOUNT);
     } else {
       i = (r >> 1) % ambigRootsCOUNT;
       ambigRoots[(ambigRootsCOUNT-1) - i] = make(roots_count);
@@ -318,8 +325,9 @@ int main(int argc, char *argv[])
   mps_message_type_enable(arena, mps_message_type_gc());
   mps_message_type_enable(arena, mps_message_type_gc_start());
   die(mps_thread_reg(&thread, arena), "thread_reg");
-  test(mps_class_amc(), exactRootsCOUNT);
-  test(mps_class_amcz(), 0);
+  test(mps_class_amc(), exactRootsCOUNT, FALSE);
+  test(mps_class_amcz(), 0, FALSE);
+  test(mps_class_amc(), exactRootsCOUNT, TRUE);
   mps_thread_dereg(thread);
   report();
   mps_arena_destroy(arena);
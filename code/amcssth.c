@@ -8,6 +8,13 @@
  * runs mps_arena_formatted_objects_walk(). This checks that walking
  * works while the other threads continue to allocate in the
  * background.
+ *
+ * The AMC pool is tested a second time in background mode, with a
+ * collector thread that does the incremental work by calling
+ * mps_arena_step(), which also returns the excess spare memory that
+ * frees leave in background mode, and commits spare memory ahead of
+ * allocation.  The arena discards spare memory instead of unmapping
+ * it, and faults pages in when it maps them.
  */
 
 #include "fmtdy.h"
@@ -51,6 +58,7 @@ static mps_word_t collections;
 static mps_arena_t arena;
 static mps_root_t exactRoot, ambigRoot;
 static unsigned long objs = 0;
+static volatile int collectorStop;
 
 
 /* make -- create one new object */
@@ -122,9 +130,13 @@ static void *kid_thread(void *arg)
   void *marker = &marker;
   mps_thr_t thread1, thread2;
   mps_root_t reg_root;
-  mps_ap_t ap;
+  mps_ap_t ap, ap2;
   closure_t cl = arg;
 
+  /* A thread must be registered to have an allocation point. */
+  cdie(mps_ap_for_thread(&ap, cl->pool) == MPS_RES_FAIL,
+       "ap_for_thread before thread_reg");
+
   /* Register the thread twice to check this is supported -- see
    * <design/thread-manager#.req.register.multi>
    */
@@ -133,11 +145,14 @@ static void *kid_thread(void *arg)
   die(mps_root_create_thread(&reg_root, arena, thread1, marker),
       "root_create");
 
-  die(mps_ap_create(&ap, cl->pool, mps_rank_exact()), "BufferCreate(fooey)");
+  /* Use a per-thread allocation point, which is released when the
+     thread is deregistered, and destroyed with the pool. */
+  die(mps_ap_for_thread(&ap, cl->pool), "ap_for_thread");
+  die(mps_ap_for_thread(&ap2, cl->pool), "ap_for_thread 2");
+  cdie(ap == ap2, "ap_for_thread returns the same ap");
   while(mps_collections(arena) < collectionsCOUNT) {
     churn(ap, cl->roots_count);
   }
-  mps_ap_destroy(ap);
 
   mps_root_destroy(reg_root);
   mps_thread_dereg(thread2);
@@ -147,9 +162,23 @@ static void *kid_thread(void *arg)
 }
 
 
+/* collector_thread -- do incremental work in background mode */
+
+static void *collector_thread(void *arg)
+{
+  testlib_unused(arg);
+  while (!collectorStop) {
+    if (!mps_arena_step(arena, 0.001, 0.0))
+      testthr_yield();
+  }
+  return NULL;
+}
+
+
 /* test -- the body of the test */
 
-static void test_pool(const char *name, mps_pool_t pool, size_t roots_count)
+static void test_pool(const char *name, mps_pool_t pool, size_t roots_count,
+                      mps_bool_t background)
 {
   size_t i;
   mps_word_t rampSwitch;
@@ -158,6 +187,7 @@ static void test_pool(const char *name, mps_pool_t pool, size_t roots_count)
   mps_ap_t ap, busy_ap;
   mps_addr_t busy_init;
   testthr_t kids[10];
+  testthr_t collector;
   closure_s cl;
   int walked = FALSE, ramped = FALSE;
 
@@ -167,6 +197,13 @@ static void test_pool(const char *name, mps_pool_t pool, size_t roots_count)
   cl.roots_count = roots_count;
   collections = 0;
 
+  if (background) {
+    mps_arena_background_set(arena, TRUE);
+    Insist(mps_arena_background(arena));
+    collectorStop = FALSE;
+    testthr_create(&collector, collector_thread, NULL);
+  }
+
   for (i = 0; i < NELEMS(kids); ++i)
     testthr_create(&kids[i], kid_thread, &cl);
 
@@ -266,6 +303,15 @@ static void test_pool(const char *name, mps_pool_t pool, size_t roots_count)
 
   for (i = 0; i < NELEMS(kids); ++i)
     testthr_join(&kids[i], NULL);
+
+  if (background) {
+    collectorStop = TRUE;
+    testthr_join(&collector, NULL);
+    mps_arena_background_set(arena, FALSE);
+    /* Leaving background mode returns any remaining excess. */
+    Insist(mps_arena_spare_committed(arena)
+           <= mps_arena_committed(arena) * mps_arena_spare(arena));
+  }
 }
 
 static void test_arena(void)
@@ -281,6 +327,9 @@ static void test_arena(void)
   MPS_ARGS_BEGIN(args) {
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_GRAIN_SIZE, rnd_grain(testArenaSIZE));
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SPARE_DISCARD, TRUE);
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_PREFAULT, TRUE);
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_COMMIT_AHEAD, testArenaSIZE / 8);
     die(mps_arena_create_k(&arena, mps_arena_class_vm(), args), "arena_create");
   } MPS_ARGS_END(args);
   mps_message_type_enable(arena, mps_message_type_gc());
@@ -312,8 +361,9 @@ static void test_arena(void)
   die(mps_pool_create(&amcz_pool, arena, mps_class_amcz(), format, chain),
       "pool_create(amcz)");
 
-  test_pool("AMC", amc_pool, exactRootsCOUNT);
-  test_pool("AMCZ", amcz_pool, 0);
+  test_pool("AMC", amc_pool, exactRootsCOUNT, FALSE);
+  test_pool("AMCZ", amcz_pool, 0, FALSE);
+  test_pool("AMC background", amc_pool, exactRootsCOUNT, TRUE);
 
   mps_arena_park(arena);
   mps_pool_destroy(amc_pool);
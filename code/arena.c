@@ -8,6 +8,7 @@
 #include "tract.h"
 #include "poolmvff.h"
 #include "mpm.h"
+#include "btree.h"
 #include "cbs.h"
 #include "bt.h"
 #include "poolmfs.h"
@@ -19,7 +20,7 @@ SRCID(arena, "$Id$");
 
 #define ArenaControlPool(arena) MVFFPool(&(arena)->controlPoolStruct)
 #define ArenaCBSBlockPool(arena) MFSPool(&(arena)->freeCBSBlockPoolStruct)
-#define ArenaFreeLand(arena) CBSLand(&(arena)->freeLandStruct)
+#define ArenaFreeLand(arena) TreeLandLand(&(arena)->freeLandStruct)
 
 
 /* ArenaGrainSizeCheck -- check that size is a valid arena grain size */
@@ -45,6 +46,15 @@ static void arenaFreeLandFinish(Arena arena);
 static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args);
 static void ArenaAbsFinish(Inst inst);
 static Res ArenaAbsDescribe(Inst inst, mps_lib_FILE *stream, Count depth);
+static void arenaCardsReset(Arena arena);
+
+/* arenaCardDummy -- card table marked by MPS_WRITE_BARRIER before the
+ * arena has a card table.  See .cards.dummy. */
+
+static unsigned char arenaCardDummyCards[1];
+static mps_wb_cards_s arenaCardDummy = {
+  0, 0, WB_CARD_SHIFT, arenaCardDummyCards
+};
 
 
 static void ArenaNoFree(Addr base, Size size, Pool pool)
@@ -124,6 +134,7 @@ DEFINE_CLASS(Arena, AbstractArena, klass)
   klass->create = ArenaNoCreate;
   klass->destroy = ArenaNoDestroy;
   klass->purgeSpare = ArenaNoPurgeSpare;
+  klass->fillSpare = ArenaNoFillSpare;
   klass->extend = ArenaNoExtend;
   klass->grow = ArenaNoGrow;
   klass->free = ArenaNoFree;
@@ -148,6 +159,7 @@ Bool ArenaClassCheck(ArenaClass klass)
   CHECKL(FUNCHECK(klass->create));
   CHECKL(FUNCHECK(klass->destroy));
   CHECKL(FUNCHECK(klass->purgeSpare));
+  CHECKL(FUNCHECK(klass->fillSpare));
   CHECKL(FUNCHECK(klass->extend));
   CHECKL(FUNCHECK(klass->grow));
   CHECKL(FUNCHECK(klass->free));
@@ -193,6 +205,9 @@ Bool ArenaCheck(Arena arena)
   CHECKL(0.0 <= arena->spare);
   CHECKL(arena->spare <= 1.0);
   CHECKL(0.0 <= arena->pauseTime);
+  CHECKL(BoolCheck(arena->background));
+  CHECKL(BoolCheck(arena->purgeDeferred));
+  /* no check for arena->lastPurge (Clock) */
 
   CHECKL(arena->zoneShift == ZoneShiftUNSET
          || ShiftCheck(arena->zoneShift));
@@ -224,6 +239,12 @@ Bool ArenaCheck(Arena arena)
     CHECKD(Land, ArenaFreeLand(arena));
 
   CHECKL(BoolCheck(arena->zoned));
+  CHECKL(BoolCheck(arena->softDirty));
+  CHECKL(BoolCheck(arena->hasCards));
+  CHECKL(arena->wbStruct._table != NULL);
+  CHECKL(arena->hasCards == (arena->wbStruct._table != &arenaCardDummy));
+  CHECKL(arena->hasCards == (arena->cardTables != NULL));
+  CHECKL(arena->wbStruct._table->_shift == WB_CARD_SHIFT);
 
   return TRUE;
 }
@@ -235,9 +256,11 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
 {
   Res res;
   Bool zoned = ARENA_DEFAULT_ZONED;
+  Bool softDirty = ARENA_DEFAULT_SOFT_DIRTY;
   Size commitLimit = ARENA_DEFAULT_COMMIT_LIMIT;
   double spare = ARENA_SPARE_DEFAULT;
   double pauseTime = ARENA_DEFAULT_PAUSE_TIME;
+  Size commitAhead = ARENA_DEFAULT_COMMIT_AHEAD;
   mps_arg_s arg;
 
   AVER(arena != NULL);
@@ -245,6 +268,8 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
 
   if (ArgPick(&arg, args, MPS_KEY_ARENA_ZONED))
     zoned = arg.val.b;
+  if (ArgPick(&arg, args, MPS_KEY_ARENA_SOFT_DIRTY))
+    softDirty = arg.val.b;
   if (ArgPick(&arg, args, MPS_KEY_COMMIT_LIMIT))
     commitLimit = arg.val.size;
   /* MPS_KEY_SPARE_COMMIT_LIMIT is deprecated */
@@ -258,6 +283,8 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
     spare = arg.val.d;
   if (ArgPick(&arg, args, MPS_KEY_PAUSE_TIME))
     pauseTime = arg.val.d;
+  if (ArgPick(&arg, args, MPS_KEY_ARENA_COMMIT_AHEAD))
+    commitAhead = arg.val.size;
 
   /* Superclass init */
   InstInit(CouldBeA(Inst, arena));
@@ -267,7 +294,11 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
   arena->commitLimit = commitLimit;
   arena->spareCommitted = (Size)0;
   arena->spare = spare;
+  arena->purgeDeferred = FALSE;
+  arena->lastPurge = ClockNow();
+  arena->commitAhead = commitAhead;
   arena->pauseTime = pauseTime;
+  arena->background = FALSE;
   arena->grainSize = grainSize;
   /* zoneShift must be overridden by arena class init */
   arena->zoneShift = ZoneShiftUNSET;
@@ -277,10 +308,13 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
   arena->hasFreeLand = FALSE;
   arena->freeZones = ZoneSetUNIV;
   arena->zoned = zoned;
+  arena->softDirty = FALSE;
+  arenaCardsReset(arena);
 
   arena->primary = NULL;
   RingInit(ArenaChunkRing(arena));
   arena->chunkTree = TreeEMPTY;
+  ChunkMapInit(arena);
   arena->chunkSerial = (Serial)0;
 
   LocusInit(arena);
@@ -300,7 +334,7 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
    * where the free land is used: see arenaFreeLandInsertExtend. */
 
   MPS_ARGS_BEGIN(piArgs) {
-    MPS_ARGS_ADD(piArgs, MPS_KEY_MFS_UNIT_SIZE, sizeof(CBSZonedBlockStruct));
+    MPS_ARGS_ADD(piArgs, MPS_KEY_MFS_UNIT_SIZE, TreeLandZonedBlockSize);
     MPS_ARGS_ADD(piArgs, MPS_KEY_EXTEND_BY, ArenaGrainSize(arena));
     MPS_ARGS_ADD(piArgs, MFSExtendSelf, FALSE);
     res = PoolInit(ArenaCBSBlockPool(arena), arena, PoolClassMFS(), piArgs);
@@ -310,6 +344,13 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
     goto failMFSInit;
 
   EventLabelPointer(ArenaCBSBlockPool(arena), EventInternString("CBSBlock"));
+
+  /* If soft-dirty tracking is unavailable, fall back to the
+     protection-based write barrier: see
+     <design/write-barrier#.soft-dirty.fallback>. */
+  if (softDirty && ProtDirtyInit() == ResOK)
+    arena->softDirty = TRUE;
+
   return ResOK;
 
 failMFSInit:
@@ -329,6 +370,9 @@ failGlobalsInit:
  * exist on all platforms. */
 
 ARG_DEFINE_KEY(VMW3_TOP_DOWN, Bool);
+ARG_DEFINE_KEY(ARENA_HUGE_PAGES, Bool);
+ARG_DEFINE_KEY(ARENA_SPARE_DISCARD, Bool);
+ARG_DEFINE_KEY(ARENA_PREFAULT, Bool);
 
 
 /* ArenaCreate -- create the arena and call initializers */
@@ -336,9 +380,11 @@ ARG_DEFINE_KEY(VMW3_TOP_DOWN, Bool);
 ARG_DEFINE_KEY(ARENA_GRAIN_SIZE, Size);
 ARG_DEFINE_KEY(ARENA_SIZE, Size);
 ARG_DEFINE_KEY(ARENA_ZONED, Bool);
+ARG_DEFINE_KEY(ARENA_SOFT_DIRTY, Bool);
 ARG_DEFINE_KEY(COMMIT_LIMIT, Size);
 ARG_DEFINE_KEY(SPARE_COMMIT_LIMIT, Size);
 ARG_DEFINE_KEY(PAUSE_TIME, double);
+ARG_DEFINE_KEY(ARENA_COMMIT_AHEAD, Size);
 
 static Res arenaFreeLandInit(Arena arena)
 {
@@ -351,7 +397,7 @@ static Res arenaFreeLandInit(Arena arena)
   /* Initialise the free land. */
   MPS_ARGS_BEGIN(liArgs) {
     MPS_ARGS_ADD(liArgs, CBSBlockPool, ArenaCBSBlockPool(arena));
-    res = LandInit(ArenaFreeLand(arena), CLASS(CBSZoned), arena,
+    res = LandInit(ArenaFreeLand(arena), TreeLandZonedClass(), arena,
                    ArenaGrainSize(arena), arena, liArgs);
   } MPS_ARGS_END(liArgs);
   AVER(res == ResOK); /* no allocation, no failure expected */
@@ -441,6 +487,8 @@ static void ArenaAbsFinish(Inst inst)
 {
   Arena arena = MustBeA(AbstractArena, inst);
   AVERC(Arena, arena);
+  if (arena->softDirty)
+    ProtDirtyFinish();
   PoolFinish(ArenaCBSBlockPool(arena));
   arena->sig = SigInvalid;
   NextMethod(Inst, AbstractArena, finish)(inst);
@@ -470,9 +518,9 @@ static void arenaFreeLandFinish(Arena arena)
   AVER(arena->hasFreeLand);
 
   /* We're about to free the memory occupied by the free land, which
-     contains a CBS.  We want to make sure that LandFinish doesn't try
-     to check the CBS, so nuke it here.  TODO: LandReset? */
-  arena->freeLandStruct.splayTreeStruct.root = TreeEMPTY;
+     contains a CBS or B-tree.  We want to make sure that LandFinish
+     doesn't try to check the tree, so nuke it here.  TODO: LandReset? */
+  TreeLandForget(&arena->freeLandStruct);
 
   /* The CBS block pool can't free its own memory via ArenaFree because
    * that would use the free land. */
@@ -489,6 +537,7 @@ void ArenaDestroy(Arena arena)
 
   GlobalsPrepareToDestroy(ArenaGlobals(arena));
 
+  ArenaCardsFinish(arena);
   ControlFinish(arena);
 
   /* We must tear down the free land before the chunks, because pages
@@ -564,6 +613,9 @@ static Res ArenaAbsDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
                "commitLimit      $W\n", (WriteFW)arena->commitLimit,
                "spareCommitted   $W\n", (WriteFW)arena->spareCommitted,
                "spare            $D\n", (WriteFD)arena->spare,
+               "purgeDeferred    $S\n", WriteFYesNo(arena->purgeDeferred),
+               "commitAhead      $W\n", (WriteFW)arena->commitAhead,
+               "background       $S\n", WriteFYesNo(arena->background),
                "zoneShift        $U\n", (WriteFU)arena->zoneShift,
                "grainSize        $W\n", (WriteFW)arena->grainSize,
                "lastTract        $P\n", (WriteFP)arena->lastTract,
@@ -572,6 +624,8 @@ static Res ArenaAbsDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
                "hasFreeLand      $S\n", WriteFYesNo(arena->hasFreeLand),
                "freeZones        $B\n", (WriteFB)arena->freeZones,
                "zoned            $S\n", WriteFYesNo(arena->zoned),
+               "softDirty        $S\n", WriteFYesNo(arena->softDirty),
+               "hasCards         $S\n", WriteFYesNo(arena->hasCards),
                NULL);
   if (res != ResOK)
     return res;
@@ -732,9 +786,209 @@ Res ControlDescribe(Arena arena, mps_lib_FILE *stream, Count depth)
 }
 
 
-/* ArenaChunkInsert -- insert chunk into arena's chunk tree and ring,
- * update the total reserved address space, and set the primary chunk
- * if not already set.
+/* Software write barrier card table
+ *
+ * .cards: Pools created with MPS_KEY_SOFTWARE_BARRIER don't protect
+ * their segments against writes.  Instead, the client stores
+ * references into them using MPS_WRITE_BARRIER (see <code/mps.h#wb>),
+ * which marks the card containing the address written in a table
+ * shared by all such pools in the arena.  See
+ * <design/write-barrier#.software.cards>.
+ *
+ * .cards.span: The table has one card for each 2^WB_CARD_SHIFT bytes
+ * of the address range spanned by the arena's chunks, indexed by
+ * offset from the base of the range, so cards never alias.  A store
+ * outside the range, for instance into a chunk added since the table
+ * was made, marks the overflow card after the last card, which makes
+ * every segment dirty at the next harvest.
+ *
+ * .cards.grow: When the table no longer spans the chunks, a new one
+ * at least twice as big is made and published in the arena's mps_wb_s
+ * with a single pointer store.  A table is never changed after it is
+ * published (except for its cards), so a thread always sees a
+ * consistent table.  A thread may still hold a pointer to an old
+ * table, so old tables are kept on the arena's list of tables until
+ * the arena is destroyed, and are harvested and cleared along with
+ * the current one.  Doubling bounds their total size by that of the
+ * current table.  Tables are only made when the mutator is held by
+ * TraceStart, or when the first pool that needs one is created.
+ *
+ * .cards.dummy: Until a table is allocated, the arena's mps_wb_s
+ * points at a static dummy table with no cards, so that
+ * MPS_WRITE_BARRIER can be used safely before any pool has asked for
+ * the software barrier.  Every store marks its overflow card.  Marks
+ * in the dummy are never read: no object in a pool with the software
+ * barrier can exist until that pool has been created, after the real
+ * table.
+ */
+
+static void arenaCardsReset(Arena arena)
+{
+  arena->hasCards = FALSE;
+  arena->wbStruct._table = &arenaCardDummy;
+  arena->cardTables = NULL;
+}
+
+
+/* arenaCardsSpan -- does a table span the arena's chunks? */
+
+static Bool arenaCardsSpan(mps_wb_cards_s *wbCards, Word base, Word last)
+{
+  return base >= wbCards->_base
+    && ((last - wbCards->_base) >> wbCards->_shift) < wbCards->_count;
+}
+
+
+/* arenaCardsGrow -- make a card table that spans the chunks
+ *
+ * See .cards.grow.
+ */
+
+static Res arenaCardsGrow(Arena arena)
+{
+  Ring node, next;
+  Word base = ~(Word)0, last = 0, count, maxCount;
+  Shift shift = WB_CARD_SHIFT;
+  CardTable table;
+  Size size;
+  void *p;
+  Res res;
+
+  RING_FOR(node, ArenaChunkRing(arena), next) {
+    Chunk chunk = RING_ELT(Chunk, arenaRing, node);
+    if ((Word)chunk->base < base)
+      base = (Word)chunk->base;
+    if ((Word)chunk->limit - 1 > last)
+      last = (Word)chunk->limit - 1;
+  }
+  AVER(base <= last);
+
+  if (arena->hasCards && arenaCardsSpan(arena->wbStruct._table, base, last))
+    return ResOK;
+
+  base = (base >> shift) << shift;
+  count = ((last - base) >> shift) + 1;
+  maxCount = (~(Word)0 - base) >> shift;
+  if (arena->hasCards && count < arena->wbStruct._table->_count * 2
+      && arena->wbStruct._table->_count * 2 <= maxCount)
+    count = arena->wbStruct._table->_count * 2;
+
+  size = sizeof(CardTableStruct) + count + 1;
+  res = ControlAlloc(&p, arena, size);
+  if (res != ResOK)
+    return res;
+  table = p;
+  table->wbCards._base = base;
+  table->wbCards._count = count;
+  table->wbCards._shift = shift;
+  table->wbCards._cards = (unsigned char *)&table[1];
+  (void)mps_lib_memset(table->wbCards._cards, 0, count + 1);
+  table->older = arena->cardTables;
+  table->size = size;
+
+  arena->cardTables = table;
+  arena->wbStruct._table = &table->wbCards;
+  arena->hasCards = TRUE;
+  return ResOK;
+}
+
+
+/* ArenaCardsInit -- allocate the card table */
+
+Res ArenaCardsInit(Arena arena)
+{
+  Res res;
+
+  AVERT(Arena, arena);
+  AVER(!arena->hasCards);
+
+  res = arenaCardsGrow(arena);
+  if (res != ResOK)
+    return res;
+
+  AVERT(Arena, arena);
+  return ResOK;
+}
+
+
+/* ArenaCardsFinish -- free the card tables, if any */
+
+void ArenaCardsFinish(Arena arena)
+{
+  CardTable table;
+
+  AVERT(Arena, arena);
+  table = arena->cardTables;
+  while (table != NULL) {
+    CardTable older = table->older;
+    ControlFree(arena, table, table->size);
+    table = older;
+  }
+  arenaCardsReset(arena);
+}
+
+
+/* ArenaCardsDirty -- has any card in the range been marked?
+ *
+ * The range is checked in every table, since a thread may have marked
+ * an old one (see .cards.grow).
+ */
+
+Bool ArenaCardsDirty(Arena arena, Addr base, Addr limit)
+{
+  CardTable table;
+
+  AVERT_CRITICAL(Arena, arena);
+  AVER_CRITICAL(arena->hasCards);
+  AVER_CRITICAL(base < limit);
+
+  for (table = arena->cardTables; table != NULL; table = table->older) {
+    mps_wb_cards_s *wbCards = &table->wbCards;
+    Word card, cardLimit;
+
+    if (wbCards->_cards[wbCards->_count] != 0)
+      return TRUE;
+
+    /* Cards outside the table are only marked on the overflow card. */
+    if ((Word)limit <= wbCards->_base)
+      continue;
+    card = (Word)base < wbCards->_base ? 0
+      : ((Word)base - wbCards->_base) >> wbCards->_shift;
+    cardLimit = (((Word)limit - 1 - wbCards->_base) >> wbCards->_shift) + 1;
+    if (cardLimit > wbCards->_count)
+      cardLimit = wbCards->_count;
+    for (; card < cardLimit; ++card)
+      if (wbCards->_cards[card] != 0)
+        return TRUE;
+  }
+  return FALSE;
+}
+
+
+/* ArenaCardsClear -- mark every card clean
+ *
+ * Called by TraceStart with the mutator held, after harvesting the
+ * cards, so this is also where the table grows to span any new
+ * chunks.  If that fails, stores into them mark the overflow card.
+ */
+
+void ArenaCardsClear(Arena arena)
+{
+  CardTable table;
+
+  AVERT(Arena, arena);
+  AVER(arena->hasCards);
+
+  for (table = arena->cardTables; table != NULL; table = table->older)
+    (void)mps_lib_memset(table->wbCards._cards, 0,
+                         table->wbCards._count + 1);
+  (void)arenaCardsGrow(arena);
+}
+
+
+/* ArenaChunkInsert -- insert chunk into arena's chunk tree, ring and
+ * map, update the total reserved address space, and set the primary
+ * chunk if not already set.
  */
 
 void ArenaChunkInsert(Arena arena, Chunk chunk)
@@ -753,6 +1007,7 @@ void ArenaChunkInsert(Arena arena, Chunk chunk)
   TreeBalance(&updatedTree);
   arena->chunkTree = updatedTree;
   RingAppend(ArenaChunkRing(arena), &chunk->arenaRing);
+  ChunkMapInsert(arena, chunk);
 
   arena->reserved += ChunkReserved(chunk);
 
@@ -764,8 +1019,8 @@ void ArenaChunkInsert(Arena arena, Chunk chunk)
 
 
 /* ArenaChunkRemoved -- chunk was removed from the arena and is being
- * finished, so update the total reserved address space, and unset the
- * primary chunk if necessary.
+ * finished, so remove it from the chunk map, update the total reserved
+ * address space, and unset the primary chunk if necessary.
  */
 
 void ArenaChunkRemoved(Arena arena, Chunk chunk)
@@ -775,6 +1030,8 @@ void ArenaChunkRemoved(Arena arena, Chunk chunk)
   AVERT(Arena, arena);
   AVERT(Chunk, chunk);
 
+  ChunkMapRemove(arena, chunk);
+
   size = ChunkReserved(chunk);
   AVER(arena->reserved >= size);
   arena->reserved -= size;
@@ -1157,8 +1414,10 @@ void ArenaFree(Addr base, Size size, Pool pool)
   Method(Arena, arena, free)(RangeBase(&range), RangeSize(&range), pool);
 
 done:
-  /* Freeing memory might create spare pages, but not more than this. */
-  AVER(arena->spareCommitted <= ArenaSpareCommitLimit(arena));
+  /* Freeing memory might create spare pages, but not more than this,
+     unless purging has been deferred. */
+  AVER(ArenaPurgeDeferred(arena)
+       || arena->spareCommitted <= ArenaSpareCommitLimit(arena));
 
   EVENT4(ArenaFree, arena, base, size, pool);
 }
@@ -1188,6 +1447,111 @@ double ArenaSpare(Arena arena)
   return arena->spare;
 }
 
+/* ArenaDeferPurge -- stop returning spare memory on each free
+ *
+ * Until ArenaPurge is called, ArenaFree may leave more spare
+ * committed memory than the spare commit limit, so that a burst of
+ * frees (such as reclaiming the condemned set) costs one purge at the
+ * end instead of one per free.  See <design/arena#.spare.defer>.
+ */
+
+void ArenaDeferPurge(Arena arena)
+{
+  AVERT(Arena, arena);
+  AVER(!arena->purgeDeferred);
+  arena->purgeDeferred = TRUE;
+}
+
+
+/* ArenaPurge -- return excess spare memory deferred by ArenaDeferPurge */
+
+void ArenaPurge(Arena arena)
+{
+  AVERT(Arena, arena);
+  AVER(arena->purgeDeferred);
+
+  arena->purgeDeferred = FALSE;
+
+  /* In background mode, leave the excess to ArenaPurgeStep. */
+  if (arena->background)
+    return;
+
+  /* Purging spare memory can cause page descriptors to be unmapped,
+     causing ArenaCommitted and hence the limit to fall, so loop. */
+  while (arena->spareCommitted > ArenaSpareCommitLimit(arena)) {
+    Size excess = arena->spareCommitted - ArenaSpareCommitLimit(arena);
+    if (Method(Arena, arena, purgeSpare)(arena, excess) == 0)
+      break;
+  }
+}
+
+
+/* ArenaPurgeStep -- return some excess spare memory in background mode
+ *
+ * In background mode, frees don't purge spare committed memory in
+ * excess of the spare commit limit.  Instead, each step returns a
+ * share of the excess in proportion to the time since the last
+ * purge, so that the excess decays over ARENA_SPARE_DECAY_TIME.
+ * Returns TRUE if any memory was purged.  See
+ * <design/arena#.spare.decay>.
+ */
+
+Bool ArenaPurgeStep(Arena arena, Clock now)
+{
+  Size spareMax, excess, size;
+  double elapsed;
+
+  AVERT(Arena, arena);
+  AVER(arena->background);
+
+  spareMax = ArenaSpareCommitLimit(arena);
+  if (arena->spareCommitted <= spareMax) {
+    arena->lastPurge = now;
+    return FALSE;
+  }
+  excess = arena->spareCommitted - spareMax;
+  elapsed = (double)(now - arena->lastPurge) / (double)ClocksPerSec();
+  if (elapsed >= ARENA_SPARE_DECAY_TIME)
+    size = excess;
+  else
+    size = (Size)((double)excess * elapsed / ARENA_SPARE_DECAY_TIME);
+  /* Let the share accumulate until it's worth a system call. */
+  if (size < ArenaGrainSize(arena))
+    return FALSE;
+  arena->lastPurge = now;
+  return Method(Arena, arena, purgeSpare)(arena, size) > 0;
+}
+
+
+/* ArenaCommitAheadStep -- keep spare memory ready in background mode
+ *
+ * Commit free memory as spare, so that the arena has commitAhead
+ * bytes of spare committed memory ready for allocation (but no more
+ * than the spare commit limit, or ArenaPurgeStep would only return
+ * it).  Returns TRUE if any memory was committed.  See
+ * <design/arena#.spare.ahead>.
+ */
+
+Bool ArenaCommitAheadStep(Arena arena)
+{
+  Size want, spareMax, size;
+
+  AVERT(Arena, arena);
+  AVER(arena->background);
+
+  want = arena->commitAhead;
+  spareMax = ArenaSpareCommitLimit(arena);
+  if (want > spareMax)
+    want = spareMax;
+  if (arena->spareCommitted >= want)
+    return FALSE;
+  size = want - arena->spareCommitted;
+  if (size > ARENA_COMMIT_AHEAD_STEP)
+    size = ARENA_COMMIT_AHEAD_STEP;
+  return Method(Arena, arena, fillSpare)(arena, size) > 0;
+}
+
+
 void ArenaSetSpare(Arena arena, double spare)
 {
   Size spareMax;
@@ -1220,6 +1584,30 @@ void ArenaSetPauseTime(Arena arena, double pauseTime)
   EVENT2(PauseTimeSet, arena, pauseTime);
 }
 
+Bool ArenaBackground(Arena arena)
+{
+  AVERT(Arena, arena);
+  return arena->background;
+}
+
+void ArenaSetBackground(Arena arena, Bool background)
+{
+  AVERT(Arena, arena);
+  AVERT(Bool, background);
+  arena->background = background;
+  arena->lastPurge = ClockNow();
+
+  /* Return any excess left for ArenaPurgeStep, unless a purge is
+     already deferred. */
+  if (!ArenaPurgeDeferred(arena)) {
+    while (arena->spareCommitted > ArenaSpareCommitLimit(arena)) {
+      Size excess = arena->spareCommitted - ArenaSpareCommitLimit(arena);
+      if (Method(Arena, arena, purgeSpare)(arena, excess) == 0)
+        break;
+    }
+  }
+}
+
 /* Used by arenas which don't use spare committed memory */
 Size ArenaNoPurgeSpare(Arena arena, Size size)
 {
@@ -1228,6 +1616,13 @@ Size ArenaNoPurgeSpare(Arena arena, Size size)
   return 0;
 }
 
+Size ArenaNoFillSpare(Arena arena, Size size)
+{
+  AVERT(Arena, arena);
+  UNUSED(size);
+  return 0;
+}
+
 
 Res ArenaNoGrow(Arena arena, LocusPref pref, Size size)
 {
@@ -837,13 +837,117 @@ static void pageDescUnmap(VMChunk vmChunk, Index basePI, Index limitPI)
 }
 
 
+/* vmChunkHugeGrains -- number of grains in a huge page
+ *
+ * Returns 1 if the chunk's VM doesn't use huge pages, or if its grains
+ * are at least as big as huge pages.  <design/arenavm#.huge>.
+ */
+
+static Count vmChunkHugeGrains(VMChunk vmChunk)
+{
+  Chunk chunk = VMChunk2Chunk(vmChunk);
+  Size hugePageSize = VMHugePageSize(VMChunkVM(vmChunk));
+  if (hugePageSize <= ChunkPageSize(chunk))
+    return 1;
+  return ChunkSizeToPages(chunk, hugePageSize);
+}
+
+
+/* vmChunkHugeSpare -- is no page in the same huge page allocated?
+ *
+ * The chunk overhead counts as allocated.
+ */
+
+static Bool vmChunkHugeSpare(VMChunk vmChunk, Index pi)
+{
+  Chunk chunk = VMChunk2Chunk(vmChunk);
+  Count hugeGrains = vmChunkHugeGrains(vmChunk);
+  Index basePI, limitPI;
+
+  basePI = IndexAlignDown(pi, hugeGrains);
+  limitPI = basePI + hugeGrains;
+  if (basePI < chunk->allocBase)
+    return FALSE;
+  if (limitPI > chunk->pages)
+    limitPI = chunk->pages;
+  return BTIsResRange(chunk->allocTable, basePI, limitPI);
+}
+
+
+/* pagesHugeExtend -- extend a range of pages to map to huge pages
+ *
+ * .huge.commit: If the chunk uses huge pages, extend the range of pages
+ * about to be mapped, through unmapped pages, out to the boundaries
+ * of the huge pages that contain it, so that the operating system can
+ * back it with whole huge pages.  The caller makes the extra pages
+ * spare.  The range is not extended if this would exceed the commit
+ * limit or the spare commit limit, since the extra pages would only
+ * be purged again.
+ */
+
+static void pagesHugeExtend(Index *basePIIO, Index *limitPIIO,
+                            VMArena vmArena, VMChunk vmChunk)
+{
+  Arena arena = MustBeA(AbstractArena, vmArena);
+  Chunk chunk = VMChunk2Chunk(vmChunk);
+  Count hugeGrains = vmChunkHugeGrains(vmChunk);
+  Index basePI = *basePIIO, limitPI = *limitPIIO;
+  Index lowPI, highPI;
+  Size size, extra;
+
+  if (hugeGrains == 1)
+    return;
+
+  lowPI = IndexAlignDown(basePI, hugeGrains);
+  if (lowPI < chunk->allocBase)
+    lowPI = chunk->allocBase;
+  while (basePI > lowPI && !BTGet(vmChunk->pages.mapped, basePI - 1))
+    --basePI;
+
+  highPI = IndexAlignUp(limitPI, hugeGrains);
+  if (highPI > chunk->pages)
+    highPI = chunk->pages;
+  while (limitPI < highPI && !BTGet(vmChunk->pages.mapped, limitPI))
+    ++limitPI;
+
+  size = ChunkPagesToSize(chunk, limitPI - basePI);
+  extra = size - ChunkPagesToSize(chunk, *limitPIIO - *basePIIO);
+  if (arena->commitLimit < arena->committed + size
+      || (arena->committed + size) * ArenaSpare(arena)
+         < (double)(arena->spareCommitted + extra))
+    return;
+  *basePIIO = basePI;
+  *limitPIIO = limitPI;
+}
+
+
+/* pagesMakeSpare -- make newly mapped pages spare */
+
+static void pagesMakeSpare(VMArena vmArena, Chunk chunk,
+                           Index basePI, Index limitPI)
+{
+  Arena arena = MustBeA(AbstractArena, vmArena);
+  Index i;
+
+  for (i = basePI; i < limitPI; ++i) {
+    Page page = ChunkPage(chunk, i);
+    AVER(!BTGet(chunk->allocTable, i));
+    PageSetPool(page, NULL);
+    PageSetType(page, PageStateSPARE);
+    RingInit(PageSpareRing(page));
+    RingAppend(&vmArena->spareRing, PageSpareRing(page));
+  }
+  arena->spareCommitted += ChunkPagesToSize(chunk, limitPI - basePI);
+}
+
+
 /* pagesMarkAllocated -- Mark the pages allocated */
 
 static Res pagesMarkAllocated(VMArena vmArena, VMChunk vmChunk,
                               Index basePI, Count pages, Pool pool)
 {
   Index cursor, i, j, k;
-  Index limitPI;
+  Index limitPI, mapBase, mapLimit;
   Chunk chunk = VMChunk2Chunk(vmChunk);
   Res res;
 
@@ -860,17 +964,26 @@ static Res pagesMarkAllocated(VMArena vmArena, VMChunk vmChunk,
       sparePageRelease(vmChunk, i);
       PageAlloc(chunk, i, pool);
     }
-    res = pageDescMap(vmChunk, j, k);
+    /* The extension only reaches outside the unmapped range [j, k)
+       when that range starts at basePI or ends at limitPI, so it
+       never overlaps the pages being allocated. */
+    mapBase = j;
+    mapLimit = k;
+    pagesHugeExtend(&mapBase, &mapLimit, vmArena, vmChunk);
+    res = pageDescMap(vmChunk, mapBase, mapLimit);
     if (res != ResOK)
       goto failSAMap;
     res = vmArenaMap(vmArena, VMChunkVM(vmChunk),
-                     PageIndexBase(chunk, j), PageIndexBase(chunk, k));
+                     PageIndexBase(chunk, mapBase),
+                     PageIndexBase(chunk, mapLimit));
     if (res != ResOK)
       goto failVMMap;
     for (i = j; i < k; ++i) {
       PageInit(chunk, i);
       PageAlloc(chunk, i, pool);
     }
+    pagesMakeSpare(vmArena, chunk, mapBase, j);
+    pagesMakeSpare(vmArena, chunk, k, mapLimit);
     cursor = k;
     if (cursor == limitPI)
       return ResOK;
@@ -882,7 +995,7 @@ static Res pagesMarkAllocated(VMArena vmArena, VMChunk vmChunk,
   return ResOK;
 
 failVMMap:
-  pageDescUnmap(vmChunk, j, k);
+  pageDescUnmap(vmChunk, mapBase, mapLimit);
 failSAMap:
   /* region from basePI to j needs deallocating */
   /* TODO: Consider making pages spare instead, then purging. */
@@ -948,28 +1061,36 @@ static Bool VMChunkPageMapped(Chunk chunk, Index index)
  *
  * Unmap the spare page passed, and possibly other pages in the chunk,
  * unmapping at least the size passed if available.  The amount unmapped
- * may exceed the size by up to one page.  Returns the amount of memory
- * unmapped.
+ * may exceed the size by up to one page, or if the chunk uses huge
+ * pages, by up to the spare pages in the huge pages at either end
+ * (see .huge.purge).  Returns the amount of memory unmapped.
  *
  * To minimse unmapping calls, the page passed is coalesced with spare
  * pages above and below, even though these may have been more recently
- * made spare.
+ * made spare.  If hugeOnly is TRUE, coalescing doesn't cross into huge
+ * pages that have allocated pages, because arenaUnmapSparePass skips
+ * the spare pages in those and may be using one as its place in the
+ * spare ring.
  */
 
-static Size chunkUnmapAroundPage(Chunk chunk, Size size, Page page)
+static Size chunkUnmapAroundPage(Chunk chunk, Size size, Page page,
+                                 Bool hugeOnly)
 {
   VMChunk vmChunk;
   Size purged = 0;
   Size pageSize;
   Index basePI, limitPI;
+  Count hugeGrains;
 
   AVERT(Chunk, chunk);
   vmChunk = Chunk2VMChunk(chunk);
   AVERT(VMChunk, vmChunk);
   AVER(PageState(page) == PageStateSPARE);
   /* size is arbitrary */
+  AVERT(Bool, hugeOnly);
 
   pageSize = ChunkPageSize(chunk);
+  hugeGrains = vmChunkHugeGrains(vmChunk);
 
   basePI = (Index)(page - chunk->pageTable);
   AVER(basePI < chunk->pages); /* page is within chunk's page table */
@@ -979,12 +1100,16 @@ static Size chunkUnmapAroundPage(Chunk chunk, Size size, Page page)
     sparePageRelease(vmChunk, limitPI);
     ++limitPI;
     purged += pageSize;
-  } while (purged < size &&
+  } while ((purged < size || !IndexIsAligned(limitPI, hugeGrains)) &&
            limitPI < chunk->pages &&
-           pageState(vmChunk, limitPI) == PageStateSPARE);
-  while (purged < size &&
+           pageState(vmChunk, limitPI) == PageStateSPARE &&
+           (!hugeOnly || !IndexIsAligned(limitPI, hugeGrains)
+            || vmChunkHugeSpare(vmChunk, limitPI)));
+  while ((purged < size || !IndexIsAligned(basePI, hugeGrains)) &&
          basePI > 0 &&
-         pageState(vmChunk, basePI - 1) == PageStateSPARE) {
+         pageState(vmChunk, basePI - 1) == PageStateSPARE &&
+         (!hugeOnly || !IndexIsAligned(basePI, hugeGrains)
+          || vmChunkHugeSpare(vmChunk, basePI - 1))) {
     --basePI;
     sparePageRelease(vmChunk, basePI);
     purged += pageSize;
@@ -1001,21 +1126,30 @@ static Size chunkUnmapAroundPage(Chunk chunk, Size size, Page page)
 }
 
 
-/* arenaUnmapSpare -- return spare pages to the OS
+/* arenaUnmapSparePass -- return spare pages to the OS
  *
  * The size is the desired amount to purge, and the amount that was purged is
  * returned.  If filter is not NULL, then only pages within that chunk are
- * unmapped.
+ * unmapped.  If hugeOnly is TRUE, then only pages in huge pages with no
+ * allocated pages are unmapped, and only as many pages of the spare
+ * ring as there are grains in a huge page are examined, since pages
+ * that don't qualify stay on the ring and would otherwise be examined
+ * again on every purge.
  */
 
-static Size arenaUnmapSpare(Arena arena, Size size, Chunk filter)
+static Size arenaUnmapSparePass(Arena arena, Size size, Chunk filter,
+                                Bool hugeOnly)
 {
   VMArena vmArena = MustBeA(VMArena, arena);
   Ring node;
   Size purged = 0;
+  Count scan = 0, scanLimit = 0;
 
   if (filter != NULL)
     AVERT(Chunk, filter);
+  AVERT(Bool, hugeOnly);
+  if (hugeOnly)
+    scanLimit = VMHugePageSize(VMArenaVM(vmArena)) / ArenaGrainSize(arena);
 
   /* Start by looking at the oldest page on the spare ring, to try to
      get some LRU behaviour from the spare pages cache. */
@@ -1029,12 +1163,17 @@ static Size arenaUnmapSpare(Arena arena, Size size, Chunk filter)
     Page page = PageOfSpareRing(next);
     Chunk chunk = NULL; /* suppress uninit warning */
     Bool b;
+    if (hugeOnly && ++scan > scanLimit)
+      break;
     /* Use the fact that the page table resides in the chunk to find the
        chunk that owns the page. */
     b = ChunkOfAddr(&chunk, arena, (Addr)page);
     AVER(b);
-    if (filter == NULL || chunk == filter) {
-      purged += chunkUnmapAroundPage(chunk, size - purged, page);
+    if ((filter == NULL || chunk == filter)
+        && (!hugeOnly
+            || vmChunkHugeSpare(Chunk2VMChunk(chunk),
+                                (Index)(page - chunk->pageTable)))) {
+      purged += chunkUnmapAroundPage(chunk, size - purged, page, hugeOnly);
       /* chunkUnmapAroundPage must delete the page it's passed from the ring,
          or we can't make progress and there will be an infinite loop */
       AVER(RingNext(node) != next);
@@ -1045,12 +1184,85 @@ static Size arenaUnmapSpare(Arena arena, Size size, Chunk filter)
   return purged;
 }
 
+
+/* arenaUnmapSpare -- return spare pages to the OS
+ *
+ * .huge.purge: Unmapping part of a huge page makes the operating
+ * system split it into small pages.  So if the arena uses huge pages,
+ * first unmap spare pages in huge pages that have no allocated pages,
+ * and only then, if more must be purged, unmap other spare pages.
+ */
+
+static Size arenaUnmapSpare(Arena arena, Size size, Chunk filter)
+{
+  VMArena vmArena = MustBeA(VMArena, arena);
+  Size purged = 0;
+
+  if (VMHugePageSize(VMArenaVM(vmArena)) > ArenaGrainSize(arena))
+    purged = arenaUnmapSparePass(arena, size, filter, TRUE);
+  if (purged < size)
+    purged += arenaUnmapSparePass(arena, size - purged, filter, FALSE);
+  return purged;
+}
+
 static Size VMPurgeSpare(Arena arena, Size size)
 {
   return arenaUnmapSpare(arena, size, NULL);
 }
 
 
+/* VMFillSpare -- commit free memory as spare pages
+ *
+ * .commit-ahead: Map unmapped free pages, and make them spare, until
+ * size bytes have been mapped or there are no more.  Pages are taken
+ * from the bottom of each chunk, because that's where first-fit
+ * allocation looks first.  If the VM prefaults, the pages are then
+ * ready for use without page faults.  See
+ * <design/arena#.spare.ahead>.
+ */
+
+static Size VMFillSpare(Arena arena, Size size)
+{
+  VMArena vmArena = MustBeA(VMArena, arena);
+  Ring node, next;
+  Size filled = 0;
+
+  RING_FOR(node, &arena->chunkRing, next) {
+    Chunk chunk = RING_ELT(Chunk, arenaRing, node);
+    VMChunk vmChunk = Chunk2VMChunk(chunk);
+    Index basePI, limitPI, cursor = chunk->allocBase;
+    while (filled < size
+           && cursor < chunk->pages
+           && BTFindLongResRange(&basePI, &limitPI, vmChunk->pages.mapped,
+                                 cursor, chunk->pages, 1))
+    {
+      Count pages = ChunkSizeToPages(chunk, SizeAlignUp(size - filled,
+                                                        ChunkPageSize(chunk)));
+      Res res;
+      if (limitPI - basePI > pages)
+        limitPI = basePI + pages;
+      res = pageDescMap(vmChunk, basePI, limitPI);
+      if (res != ResOK)
+        return filled;
+      res = vmArenaMap(vmArena, VMChunkVM(vmChunk),
+                       PageIndexBase(chunk, basePI),
+                       PageIndexBase(chunk, limitPI));
+      if (res != ResOK) {
+        pageDescUnmap(vmChunk, basePI, limitPI);
+        return filled;
+      }
+      pagesMakeSpare(vmArena, chunk, basePI, limitPI);
+      filled += ChunkPagesToSize(chunk, limitPI - basePI);
+      cursor = limitPI;
+    }
+    if (filled >= size)
+      break;
+  }
+
+  return filled;
+}
+
+
 /* chunkUnmapSpare -- unmap all spare pages in a chunk */
 
 static void chunkUnmapSpare(Chunk chunk)
@@ -1110,7 +1322,12 @@ static void VMFree(Addr base, Size size, Pool pool)
   arena->spareCommitted += ChunkPagesToSize(chunk, piLimit - piBase);
   BTResRange(chunk->allocTable, piBase, piLimit);
 
-  /* Consider returning memory to the OS. */
+  /* Consider returning memory to the OS, unless the caller has
+     deferred that until a batch of frees is complete.  See
+     <design/arena#.spare.defer>. */
+  if (ArenaPurgeDeferred(arena))
+    return;
+
   /* Purging spare memory can cause page descriptors to be unmapped,
      causing ArenaCommitted to fall, so we can't be sure to unmap
      enough in one pass. This somewhat contradicts the goal of having
@@ -1232,6 +1449,7 @@ DEFINE_CLASS(Arena, VMArena, klass)
   klass->create = VMArenaCreate;
   klass->destroy = VMArenaDestroy;
   klass->purgeSpare = VMPurgeSpare;
+  klass->fillSpare = VMFillSpare;
   klass->grow = VMArenaGrow;
   klass->free = VMFree;
   klass->chunkInit = VMChunkInit;
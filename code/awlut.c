@@ -30,6 +30,11 @@
 
 static mps_word_t bogus_class;
 
+/* The software write barrier for the arena.  MPS_WRITE_BARRIER is
+   harmless for pools that don't use it, so all stores into tables go
+   through it. */
+static mps_wb_t wb;
+
 #define UNINIT 0x041412ED
 
 #define DYLAN_ALIGN 4 /* depends on value defined in fmtdy.c */
@@ -157,7 +162,7 @@ static mps_word_t *table_slot(mps_word_t *table, size_t n)
 static void set_table_slot(mps_word_t *table, size_t n, mps_word_t *p)
 {
   cdie(table[0] == (mps_word_t)table_wrapper, "set_table_slot");
-  table[3+n] = (mps_word_t)p;
+  MPS_WRITE_BARRIER(wb, (mps_addr_t *)&table[3+n], (mps_addr_t)p);
 }
 
 
@@ -168,8 +173,8 @@ static void table_link(mps_word_t *t1, mps_word_t *t2)
 {
   cdie(t1[0] == (mps_word_t)table_wrapper, "table_link 1");
   cdie(t2[0] == (mps_word_t)table_wrapper, "table_link 2");
-  t1[1] = (mps_word_t)t2;
-  t2[1] = (mps_word_t)t1;
+  MPS_WRITE_BARRIER(wb, (mps_addr_t *)&t1[1], (mps_addr_t)t2);
+  MPS_WRITE_BARRIER(wb, (mps_addr_t *)&t2[1], (mps_addr_t)t1);
 }
 
 
@@ -286,6 +291,7 @@ static void test(mps_arena_t arena,
 struct guff_s {
   mps_arena_t arena;
   mps_thr_t thr;
+  mps_bool_t software_barrier;
 };
 
 ATTRIBUTE_NOINLINE
@@ -314,9 +320,14 @@ static void setup(struct guff_s *guff)
     die(mps_pool_create_k(&leafpool, arena, mps_class_lo(), args),
         "Leaf Pool Create\n");
   } MPS_ARGS_END(args);
-  die(mps_pool_create(&tablepool, arena, mps_class_awl(), dylanweakfmt,
-                      dylan_weak_dependent),
-      "Table Pool Create\n");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, dylanweakfmt);
+    MPS_ARGS_ADD(args, MPS_KEY_AWL_FIND_DEPENDENT, dylan_weak_dependent);
+    MPS_ARGS_ADD(args, MPS_KEY_SOFTWARE_BARRIER, guff->software_barrier);
+    die(mps_pool_create_k(&tablepool, arena, mps_class_awl(), args),
+        "Table Pool Create\n");
+  } MPS_ARGS_END(args);
+  wb = mps_arena_wb(arena);
   die(mps_ap_create(&leafap, leafpool, mps_rank_exact()),
       "Leaf AP Create\n");
   die(mps_ap_create(&exactap, tablepool, mps_rank_exact()),
@@ -345,6 +356,7 @@ int main(int argc, char *argv[])
   struct guff_s guff;
   mps_arena_t arena;
   mps_thr_t thread;
+  int software_barrier;
 
   testlib_init(argc, argv);
 
@@ -352,14 +364,17 @@ int main(int argc, char *argv[])
   initialise_wrapper(string_wrapper);
   initialise_wrapper(table_wrapper);
 
-  die(mps_arena_create(&arena, mps_arena_class_vm(), testArenaSIZE),
-      "arena_create\n");
-  die(mps_thread_reg(&thread, arena), "thread_reg");
-  guff.arena = arena;
-  guff.thr = thread;
-  setup(&guff);
-  mps_thread_dereg(thread);
-  mps_arena_destroy(arena);
+  for (software_barrier = 0; software_barrier <= 1; ++software_barrier) {
+    die(mps_arena_create(&arena, mps_arena_class_vm(), testArenaSIZE),
+        "arena_create\n");
+    die(mps_thread_reg(&thread, arena), "thread_reg");
+    guff.arena = arena;
+    guff.thr = thread;
+    guff.software_barrier = software_barrier;
+    setup(&guff);
+    mps_thread_dereg(thread);
+    mps_arena_destroy(arena);
+  }
 
   printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
   return 0;
@@ -59,6 +59,43 @@ SRCID(bt, "$Id$");
 #define BTBitIndex(index) ((index) & (MPS_WORD_WIDTH - 1))
 
 
+/* BTWordLowestSet, BTWordHighestSet, BTWordCount -- word kernels
+ *
+ * Return the index of the lowest or highest set bit in a non-zero
+ * word, or the number of set bits in a word.  On GCC and Clang these
+ * compile to single instructions where the target has them (for
+ * example, tzcnt, lzcnt and popcnt on x86-64).  The portable versions
+ * use SWAR ("SIMD within a register") to work on all the bits of a
+ * word at once.
+ */
+
+#if defined(MPS_BUILD_GC) || defined(MPS_BUILD_LL)
+
+/* Word is unsigned long on these platforms: see <code/mpstd.h>. */
+#define BTWordLowestSet(word) ((Index)__builtin_ctzl(word))
+#define BTWordHighestSet(word) \
+  ((Index)(MPS_WORD_WIDTH - 1) - (Index)__builtin_clzl(word))
+#define BTWordCount(word) ((Count)__builtin_popcountl(word))
+
+#else
+
+#define BTWordLowestSet(word) ((Index)WordLowestSet(word))
+#define BTWordHighestSet(word) ((Index)SizeFloorLog2((Size)(word)))
+#define BTWordCount(word) btWordCount(word)
+
+#define BTWordREPEAT(byte) ((~(Word)0 / 0xFF) * (Word)(byte))
+
+static Count btWordCount(Word word)
+{
+  word -= (word >> 1) & BTWordREPEAT(0x55);
+  word = (word & BTWordREPEAT(0x33)) + ((word >> 2) & BTWordREPEAT(0x33));
+  word = (word + (word >> 4)) & BTWordREPEAT(0x0F);
+  return (Count)((word * BTWordREPEAT(0x01)) >> (MPS_WORD_WIDTH - 8));
+}
+
+#endif
+
+
 /* BTIsSmallRange -- test range size
  *
  * Predicate to determine whether a range is sufficiently small
@@ -433,31 +470,16 @@ btFindSetLabel:; \
 /* ACTION_FIND_SET_BIT -- Find first set bit in a range
  *
  * Helper macro to find the low bit in a range of a word.
- * Works by first shifting the base of the range to the low
- * bits of the word. Then loops performing a binary chop
- * over the data looking to see if a bit is set in the lower
- * half. If not, it must be in the upper half which is then
- * shifted down. The loop completes after using a chop unit
- * of a single single bit.
+ * Works by masking out the bits outside the range and then
+ * finding the lowest set bit with BTWordLowestSet.
  */
 
 #define ACTION_FIND_SET_BIT(wi,word,base,limit,label) \
   BEGIN \
-    /* no need to mask the low bits which are shifted */ \
-    Index actionIndex = (base); \
-    Word actionWord = ((word) & BTMaskHigh((limit))) >> actionIndex; \
-    Count actionMaskWidth = (MPS_WORD_WIDTH >> 1); \
-    Word actionMask = ~(Word)0 >> (MPS_WORD_WIDTH-actionMaskWidth); \
+    Word actionWord = (word) & BTMask((base), (limit)); \
     if (actionWord != (Word)0) { \
-      while (actionMaskWidth != (Count)0) { \
-        if ((actionWord & actionMask) == (Word)0) { \
-          actionIndex += actionMaskWidth; \
-          actionWord >>= actionMaskWidth; \
-        } \
-        actionMaskWidth >>= 1; \
-        actionMask >>= actionMaskWidth; \
-      } \
-      *bfsIndexReturn = ((wi) << MPS_WORD_SHIFT) | actionIndex; \
+      *bfsIndexReturn = ((wi) << MPS_WORD_SHIFT) \
+                        | BTWordLowestSet(actionWord); \
       *bfsFoundReturn = TRUE; \
       goto label; \
     } \
@@ -552,22 +574,10 @@ btFindSetHighLabel:; \
 
 #define ACTION_FIND_SET_BIT_HIGH(wi,word,base,limit,label) \
   BEGIN \
-    /* no need to mask the high bits which are shifted */ \
-    Index actionShift = MPS_WORD_WIDTH - (limit);  \
-    Index actionIndex = MPS_WORD_WIDTH - 1 - actionShift; \
-    Word actionWord = ((word) & BTMaskLow((base))) << actionShift; \
-    Count actionMaskWidth = (MPS_WORD_WIDTH >> 1); \
-    Word actionMask = ~(Word)0 << (MPS_WORD_WIDTH-actionMaskWidth); \
+    Word actionWord = (word) & BTMask((base), (limit)); \
     if (actionWord != (Word)0) { \
-      while (actionMaskWidth != (Count)0) { \
-        if ((actionWord & actionMask) == (Word)0) { \
-          actionIndex -= actionMaskWidth; \
-          actionWord <<= actionMaskWidth; \
-        } \
-        actionMaskWidth >>= 1; \
-        actionMask <<= actionMaskWidth; \
-      } \
-      *bfsIndexReturn = ((wi) << MPS_WORD_SHIFT) | actionIndex; \
+      *bfsIndexReturn = ((wi) << MPS_WORD_SHIFT) \
+                        | BTWordHighestSet(actionWord); \
       *bfsFoundReturn = TRUE; \
       goto label; \
     } \
@@ -1021,14 +1031,20 @@ void BTCopyOffsetRange(BT fromBT, BT toBT,
 Count BTCountResRange(BT bt, Index base, Index limit)
 {
   Count c = 0;
-  Index bit;
 
   AVERT(BT, bt);
   AVER(base < limit);
 
-  for (bit = base; bit < limit; ++bit)
-    if (!BTGet(bt, bit))
-      ++c;
+#define SINGLE_COUNT_RES_RANGE(i) \
+  if (!BTGet(bt, (i))) \
+    ++c
+#define BITS_COUNT_RES_RANGE(i,base,limit) \
+  c += BTWordCount(~bt[(i)] & BTMask((base),(limit)))
+#define WORD_COUNT_RES_RANGE(i) \
+  c += BTWordCount(~bt[(i)])
+
+  ACT_ON_RANGE(base, limit, SINGLE_COUNT_RES_RANGE,
+               BITS_COUNT_RES_RANGE, WORD_COUNT_RES_RANGE);
   return c;
 }
 
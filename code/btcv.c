@@ -6,7 +6,8 @@
  * .readership: MPS developers
  *
  * .coverage: Direct coverage of BTFind*ResRange*, BTRangesSame,
- * BTISResRange, BTIsSetRange, BTCopyRange, BTCopyOffsetRange.
+ * BTISResRange, BTIsSetRange, BTCopyRange, BTCopyOffsetRange,
+ * BTCountResRange.
  * Reasonable coverage of BTCopyInvertRange, BTResRange,
  * BTSetRange, BTRes, BTSet, BTCreate, BTDestroy.
  */
@@ -417,6 +418,7 @@ static void btIsRangeTests(BT bt1, BT bt2, Count btSize,
       /* test a table which is all reset apart from a set bit */
       /* near each of the base and limit of the range in question */
       Bool outside; /* true if set bits are both outside test range */
+      Count inside; /* number of set bits inside test range */
 
       outside = (b < base) && (l > limit);
       BTResRange(bt1, 0, btSize);
@@ -430,6 +432,13 @@ static void btIsRangeTests(BT bt1, BT bt2, Count btSize,
       cdie(BTIsResRange(bt1, base, limit) == outside, "BTISResRange");
       cdie(BTIsSetRange(bt2, base, limit) == outside, "BTISSetRange");
 
+      /* Count the set bits inside the range with BTCountResRange */
+      inside = (b >= base && b < limit)
+        + (l - 1 != b && l - 1 >= base && l - 1 < limit);
+      cdie(BTCountResRange(bt1, base, limit) == limit - base - inside,
+           "BTCountResRange");
+      cdie(BTCountResRange(bt2, base, limit) == inside, "BTCountResRange");
+
       /* Check the same range with BTRangesSame on an empty table */
       BTResRange(bt2, 0, btSize);
       cdie(BTRangesSame(bt1, bt2, base, limit) == outside, "BTRangeSame");
@@ -0,0 +1,1395 @@
+/* btree.c: B-TREE LAND IMPLEMENTATION
+ *
+ * $Id$
+ * Copyright (c) 2020 Ravenbrook Limited.  See end of file for license.
+ *
+ * .intro: This is a Land implementation that keeps its ranges in a
+ * B+-tree: the ranges are in the leaves, in address order, and each
+ * entry in an internal node records the base, largest size, and
+ * (optionally) zones of the ranges in its subtree.
+ *
+ * .design: <design/btree>.
+ *
+ * .readonly: Unlike the CBS <code/cbs.c>, searches don't restructure
+ * the tree, so finding a range writes nothing.
+ *
+ * .cursor: Operations that modify the tree first find the path from
+ * the root to a leaf entry, and record it in a cursor.  cursor->node[l]
+ * is the node at level l (the leaves are level 0, and the root is
+ * level height - 1) and cursor->index[l] is the index of the entry in
+ * that node on the path.
+ */
+
+#include "btree.h"
+#include "poolmfs.h"
+#include "mpscmfs.h"
+
+SRCID(btree, "$Id$");
+
+
+/* BTreeMIN -- minimum number of entries in a node other than the root */
+
+#define BTreeMIN (BTreeORDER / 2)
+
+
+/* BTreeHEIGHT_MAX -- maximum height of a tree
+ *
+ * A tree of height h has at least 2 * BTreeMIN^(h-2) ranges, and no
+ * tree can have more than 2^MPS_WORD_WIDTH ranges.
+ */
+
+#define BTreeHEIGHT_MAX ((Count)(MPS_WORD_WIDTH / 2 + 1))
+
+
+typedef struct BTreeCursorStruct {
+  BTreeNode node[BTreeHEIGHT_MAX]; /* node at each level of path */
+  Index index[BTreeHEIGHT_MAX]; /* index of entry on path in node */
+} BTreeCursorStruct, *BTreeCursor;
+
+
+/* BTreeEntryStruct -- a copy of an entry in a node */
+
+typedef struct BTreeEntryStruct {
+  Addr base;
+  union {
+    Addr limit;
+    BTreeNode child;
+  } the;
+  Size maxSize;
+  ZoneSet zones;
+} BTreeEntryStruct, *BTreeEntry;
+
+
+#define btreeArena(btree) LandArena(BTreeLand(btree))
+#define btreeLimit(node, i) ((node)->the.limit[i])
+#define btreeChild(node, i) ((node)->the.child[i])
+
+
+/* BTreeCheck -- check a B-tree */
+
+Bool BTreeCheck(BTree btree)
+{
+  Land land;
+  CHECKS(BTree, btree);
+  land = BTreeLand(btree);
+  CHECKD(Land, land);
+  CHECKC(BTree, btree);
+  CHECKD(Pool, btree->blockPool);
+  CHECKL(BoolCheck(btree->ownPool));
+  CHECKL(BoolCheck(btree->zoned));
+  CHECKL(btree->nodeSize == BTreeNodeSize(btree->zoned));
+  CHECKL(btree->height <= BTreeHEIGHT_MAX);
+  CHECKL((btree->root == NULL) == (btree->height == 0));
+  CHECKL(btree->root == NULL || btree->root->level + 1 == btree->height);
+  CHECKL(SizeIsAligned(btree->size, LandAlignment(land)));
+  CHECKL((btree->size == 0) == (btree->root == NULL));
+  STATISTIC(CHECKL((btree->rangeCount == 0) == (btree->root == NULL)));
+  return TRUE;
+}
+
+
+/* btreeGetEntry, btreeSetEntry -- copy an entry out of or into a node */
+
+static void btreeGetEntry(BTreeEntry entry, BTree btree, BTreeNode node,
+                          Index i)
+{
+  entry->base = node->base[i];
+  if (node->level == 0)
+    entry->the.limit = btreeLimit(node, i);
+  else
+    entry->the.child = btreeChild(node, i);
+  entry->maxSize = node->maxSize[i];
+  if (btree->zoned)
+    entry->zones = node->zones[i];
+}
+
+static void btreeSetEntry(BTree btree, BTreeNode node, Index i,
+                          BTreeEntry entry)
+{
+  node->base[i] = entry->base;
+  if (node->level == 0)
+    btreeLimit(node, i) = entry->the.limit;
+  else
+    btreeChild(node, i) = entry->the.child;
+  node->maxSize[i] = entry->maxSize;
+  if (btree->zoned)
+    node->zones[i] = entry->zones;
+}
+
+static void btreeCopyEntry(BTree btree, BTreeNode to, Index toIndex,
+                           BTreeNode from, Index fromIndex)
+{
+  BTreeEntryStruct entry;
+  btreeGetEntry(&entry, btree, from, fromIndex);
+  btreeSetEntry(btree, to, toIndex, &entry);
+}
+
+
+/* btreeNodeInsert, btreeNodeRemove -- insert or remove an entry in a
+ * node, moving the entries after it
+ */
+
+static void btreeNodeInsert(BTree btree, BTreeNode node, Index i,
+                            BTreeEntry entry)
+{
+  Index j;
+  AVER_CRITICAL(node->count < BTreeORDER);
+  AVER_CRITICAL(i <= node->count);
+  for (j = node->count; j > i; --j)
+    btreeCopyEntry(btree, node, j, node, j - 1);
+  btreeSetEntry(btree, node, i, entry);
+  ++node->count;
+}
+
+static void btreeNodeRemove(BTree btree, BTreeNode node, Index i)
+{
+  Index j;
+  AVER_CRITICAL(i < node->count);
+  for (j = i + 1; j < node->count; ++j)
+    btreeCopyEntry(btree, node, j - 1, node, j);
+  --node->count;
+}
+
+
+/* btreeRangeEntry -- make a leaf entry for a range */
+
+static void btreeRangeEntry(BTreeEntry entry, BTree btree,
+                            Addr base, Addr limit)
+{
+  entry->base = base;
+  entry->the.limit = limit;
+  entry->maxSize = AddrOffset(base, limit);
+  if (btree->zoned)
+    entry->zones = ZoneSetOfRange(btreeArena(btree), base, limit);
+}
+
+
+/* btreeNodeEntry -- make an internal entry for a node */
+
+static void btreeNodeEntry(BTreeEntry entry, BTree btree, BTreeNode node)
+{
+  Size maxSize = 0;
+  ZoneSet zones = ZoneSetEMPTY;
+  Index i;
+
+  AVER_CRITICAL(node->count > 0);
+  for (i = 0; i < node->count; ++i)
+    if (node->maxSize[i] > maxSize)
+      maxSize = node->maxSize[i];
+  if (btree->zoned)
+    for (i = 0; i < node->count; ++i)
+      zones = ZoneSetUnion(zones, node->zones[i]);
+
+  entry->base = node->base[0];
+  entry->the.child = node;
+  entry->maxSize = maxSize;
+  entry->zones = zones;
+}
+
+
+/* btreeRefreshEntry -- recalculate an internal entry from its child
+ *
+ * Returns TRUE if the entry changed.
+ */
+
+static Bool btreeRefreshEntry(BTree btree, BTreeNode node, Index i)
+{
+  BTreeEntryStruct entry;
+  Bool changed;
+
+  AVER_CRITICAL(node->level > 0);
+  AVER_CRITICAL(i < node->count);
+  btreeNodeEntry(&entry, btree, btreeChild(node, i));
+  changed = entry.base != node->base[i]
+    || entry.maxSize != node->maxSize[i]
+    || (btree->zoned && entry.zones != node->zones[i]);
+  if (changed)
+    btreeSetEntry(btree, node, i, &entry);
+  return changed;
+}
+
+
+/* btreeRefreshPath -- recalculate the entries on a path
+ *
+ * Call this when cursor->node[level - 1] has changed.  Stops as soon
+ * as an entry doesn't change, because the entries above it can't
+ * change either.
+ */
+
+static void btreeRefreshPath(BTree btree, BTreeCursor cursor, Count level)
+{
+  Count l;
+  for (l = level; l < btree->height; ++l)
+    if (!btreeRefreshEntry(btree, cursor->node[l], cursor->index[l]))
+      break;
+}
+
+
+/* btreeLocate -- find the path to an address
+ *
+ * Sets cursor->index[0] to the number of ranges in the leaf whose
+ * bases are at or below addr.  If this is zero, no range in the tree
+ * has a base at or below addr.
+ */
+
+static void btreeLocate(BTreeCursor cursor, BTree btree, Addr addr)
+{
+  BTreeNode node = btree->root;
+  Count level = btree->height;
+
+  AVER_CRITICAL(node != NULL);
+  for (;;) {
+    Index i = 0;
+    --level;
+    AVER_CRITICAL(node->level == level);
+    while (i < node->count && node->base[i] <= addr)
+      ++i;
+    cursor->node[level] = node;
+    if (level == 0) {
+      cursor->index[0] = i;
+      return;
+    }
+    if (i > 0)
+      --i;
+    cursor->index[level] = i;
+    node = btreeChild(node, i);
+  }
+}
+
+
+/* btreeDescend -- extend a cursor to the first or last leaf entry
+ * below the entry at a level
+ */
+
+static void btreeDescend(BTreeCursor cursor, Count level, Bool last)
+{
+  BTreeNode node = cursor->node[level];
+  while (level > 0) {
+    node = btreeChild(node, cursor->index[level]);
+    --level;
+    cursor->node[level] = node;
+    cursor->index[level] = last ? node->count - 1 : 0;
+  }
+}
+
+
+/* btreeFirst -- set cursor to the first range in the tree */
+
+static Bool btreeFirst(BTreeCursor cursor, BTree btree)
+{
+  Count top;
+  if (btree->root == NULL)
+    return FALSE;
+  top = btree->height - 1;
+  cursor->node[top] = btree->root;
+  cursor->index[top] = 0;
+  btreeDescend(cursor, top, FALSE);
+  return TRUE;
+}
+
+
+/* btreeNext -- move cursor to the next range */
+
+static Bool btreeNext(BTreeCursor cursor, BTree btree)
+{
+  Count l = 0;
+  while (cursor->index[l] + 1 >= cursor->node[l]->count) {
+    ++l;
+    if (l == btree->height)
+      return FALSE;
+  }
+  ++cursor->index[l];
+  btreeDescend(cursor, l, FALSE);
+  return TRUE;
+}
+
+
+/* btreeCursorRange -- get the range at the cursor */
+
+static void btreeCursorRange(Range rangeReturn, BTreeCursor cursor)
+{
+  BTreeNode leaf = cursor->node[0];
+  Index i = cursor->index[0];
+  AVER_CRITICAL(leaf->level == 0);
+  AVER_CRITICAL(i < leaf->count);
+  RangeInit(rangeReturn, leaf->base[i], btreeLimit(leaf, i));
+}
+
+
+/* btreeNodeAlloc, btreeNodeFree -- allocate and free nodes */
+
+static Res btreeNodeAlloc(BTreeNode *nodeReturn, BTree btree)
+{
+  Addr p;
+  Res res;
+
+  res = PoolAlloc(&p, btree->blockPool, btree->nodeSize);
+  if (res != ResOK)
+    return res;
+  *nodeReturn = (BTreeNode)p;
+  return ResOK;
+}
+
+static void btreeNodeFree(BTree btree, BTreeNode node)
+{
+  PoolFree(btree->blockPool, (Addr)node, btree->nodeSize);
+}
+
+
+/* btreeNodeSplit -- split a full node while inserting an entry
+ *
+ * The node and the entry to be inserted at index i make BTreeORDER + 1
+ * entries: the first half stay in node and the rest move to right.
+ */
+
+static void btreeNodeSplit(BTree btree, BTreeNode node, BTreeNode right,
+                           Index i, BTreeEntry entry)
+{
+  Count left = (BTreeORDER + 2) / 2;
+  Index j;
+
+  AVER_CRITICAL(node->count == BTreeORDER);
+  AVER_CRITICAL(i <= BTreeORDER);
+
+  right->level = node->level;
+  right->count = BTreeORDER + 1 - left;
+  for (j = BTreeORDER + 1; j-- > left;) {
+    if (j == i)
+      btreeSetEntry(btree, right, j - left, entry);
+    else
+      btreeCopyEntry(btree, right, j - left, node, j < i ? j : j - 1);
+  }
+  node->count = left;
+  if (i < left) {
+    for (j = left - 1; j > i; --j)
+      btreeCopyEntry(btree, node, j, node, j - 1);
+    btreeSetEntry(btree, node, i, entry);
+  }
+}
+
+
+/* btreeInsertAt -- insert a range into the leaf at the cursor
+ *
+ * .insert.prealloc: The nodes needed to split full nodes on the path
+ * are allocated before the tree is changed, so that if allocation
+ * fails, the tree is unchanged.
+ */
+
+static Res btreeInsertAt(BTree btree, BTreeCursor cursor,
+                         Addr base, Addr limit)
+{
+  BTreeNode spare[BTreeHEIGHT_MAX + 1];
+  Count need, used = 0, l;
+  BTreeEntryStruct entry;
+  BTreeNode node;
+  Index i;
+  Res res;
+
+  btreeRangeEntry(&entry, btree, base, limit);
+
+  if (btree->root == NULL) {
+    res = btreeNodeAlloc(&node, btree);
+    if (res != ResOK)
+      return res;
+    node->level = 0;
+    node->count = 0;
+    btreeNodeInsert(btree, node, 0, &entry);
+    btree->root = node;
+    btree->height = 1;
+    goto done;
+  }
+
+  for (need = 0; need < btree->height; ++need)
+    if (cursor->node[need]->count < BTreeORDER)
+      break;
+  if (need == btree->height)
+    ++need;                     /* new root */
+  for (l = 0; l < need; ++l) {
+    res = btreeNodeAlloc(&spare[l], btree);
+    if (res != ResOK) {
+      while (l > 0)
+        btreeNodeFree(btree, spare[--l]);
+      return res;
+    }
+  }
+
+  i = cursor->index[0];
+  for (l = 0; ; ++l) {
+    node = cursor->node[l];
+    if (node->count < BTreeORDER) {
+      btreeNodeInsert(btree, node, i, &entry);
+      btreeRefreshPath(btree, cursor, l + 1);
+      break;
+    }
+    AVER(used < need);
+    btreeNodeSplit(btree, node, spare[used], i, &entry);
+    btreeNodeEntry(&entry, btree, spare[used]);
+    ++used;
+    if (l + 1 == btree->height) {
+      BTreeEntryStruct leftEntry;
+      BTreeNode root;
+      AVER(used < need);
+      root = spare[used];
+      ++used;
+      root->level = l + 1;
+      root->count = 0;
+      btreeNodeEntry(&leftEntry, btree, node);
+      btreeNodeInsert(btree, root, 0, &leftEntry);
+      btreeNodeInsert(btree, root, 1, &entry);
+      btree->root = root;
+      ++btree->height;
+      AVER(btree->height <= BTreeHEIGHT_MAX);
+      break;
+    }
+    /* The split node's entry in its parent has changed too. */
+    (void)btreeRefreshEntry(btree, cursor->node[l + 1], cursor->index[l + 1]);
+    i = cursor->index[l + 1] + 1;
+  }
+  AVER(used == need);
+
+done:
+  btree->size += AddrOffset(base, limit);
+  STATISTIC(++btree->rangeCount);
+  return ResOK;
+}
+
+
+/* btreeDeleteAt -- delete the range at the cursor
+ *
+ * Nodes that fall below BTreeMIN entries borrow an entry from a
+ * sibling, or merge with it.  Never allocates.
+ */
+
+static void btreeDeleteAt(BTree btree, BTreeCursor cursor)
+{
+  BTreeNode node = cursor->node[0];
+  Index i = cursor->index[0];
+  Count l;
+
+  AVER_CRITICAL(btree->size >= node->maxSize[i]);
+  btree->size -= node->maxSize[i];
+  STATISTIC(--btree->rangeCount);
+  btreeNodeRemove(btree, node, i);
+
+  for (l = 0; ; ++l) {
+    BTreeNode parent, sibling;
+    BTreeEntryStruct entry;
+    Index pi, j;
+
+    node = cursor->node[l];
+    if (l + 1 == btree->height) {
+      AVER_CRITICAL(node == btree->root);
+      if (node->count == 0) {
+        btree->root = NULL;
+        btree->height = 0;
+        btreeNodeFree(btree, node);
+      } else if (node->level > 0 && node->count == 1) {
+        btree->root = btreeChild(node, 0);
+        --btree->height;
+        btreeNodeFree(btree, node);
+      }
+      return;
+    }
+    if (node->count >= BTreeMIN) {
+      btreeRefreshPath(btree, cursor, l + 1);
+      return;
+    }
+
+    parent = cursor->node[l + 1];
+    pi = cursor->index[l + 1];
+    AVER_CRITICAL(parent->count >= 2);
+
+    if (pi > 0 && btreeChild(parent, pi - 1)->count > BTreeMIN) {
+      /* borrow the last entry of the left sibling */
+      sibling = btreeChild(parent, pi - 1);
+      btreeGetEntry(&entry, btree, sibling, sibling->count - 1);
+      --sibling->count;
+      btreeNodeInsert(btree, node, 0, &entry);
+      (void)btreeRefreshEntry(btree, parent, pi - 1);
+      (void)btreeRefreshEntry(btree, parent, pi);
+      btreeRefreshPath(btree, cursor, l + 2);
+      return;
+    }
+    if (pi + 1 < parent->count
+        && btreeChild(parent, pi + 1)->count > BTreeMIN) {
+      /* borrow the first entry of the right sibling */
+      sibling = btreeChild(parent, pi + 1);
+      btreeGetEntry(&entry, btree, sibling, 0);
+      btreeNodeRemove(btree, sibling, 0);
+      btreeNodeInsert(btree, node, node->count, &entry);
+      (void)btreeRefreshEntry(btree, parent, pi);
+      (void)btreeRefreshEntry(btree, parent, pi + 1);
+      btreeRefreshPath(btree, cursor, l + 2);
+      return;
+    }
+
+    /* Merge with a sibling, and remove the emptied node's entry from
+       the parent, which may now be below the minimum. */
+    if (pi > 0) {
+      sibling = btreeChild(parent, pi - 1);
+      for (j = 0; j < node->count; ++j)
+        btreeCopyEntry(btree, sibling, sibling->count + j, node, j);
+      sibling->count += node->count;
+      btreeNodeFree(btree, node);
+      btreeNodeRemove(btree, parent, pi);
+      (void)btreeRefreshEntry(btree, parent, pi - 1);
+      cursor->index[l + 1] = pi - 1;
+    } else {
+      sibling = btreeChild(parent, pi + 1);
+      for (j = 0; j < sibling->count; ++j)
+        btreeCopyEntry(btree, node, node->count + j, sibling, j);
+      node->count += sibling->count;
+      btreeNodeFree(btree, sibling);
+      btreeNodeRemove(btree, parent, pi + 1);
+      (void)btreeRefreshEntry(btree, parent, pi);
+    }
+  }
+}
+
+
+/* btreeSetRange -- change the range at the cursor in place
+ *
+ * The new range must not overlap its neighbours, so that the order of
+ * ranges is unchanged.
+ */
+
+static void btreeSetRange(BTree btree, BTreeCursor cursor,
+                          Addr base, Addr limit)
+{
+  BTreeNode leaf = cursor->node[0];
+  Index i = cursor->index[0];
+  BTreeEntryStruct entry;
+
+  AVER_CRITICAL(base < limit);
+  AVER_CRITICAL(btree->size >= leaf->maxSize[i]);
+  btree->size -= leaf->maxSize[i];
+  btreeRangeEntry(&entry, btree, base, limit);
+  btreeSetEntry(btree, leaf, i, &entry);
+  btree->size += entry.maxSize;
+  btreeRefreshPath(btree, cursor, 1);
+}
+
+
+/* btreeDeleteFromRange -- delete part of the range at the cursor
+ *
+ * .delete.alloc: Only allocates if the deleted part splits the range.
+ */
+
+static Res btreeDeleteFromRange(BTree btree, BTreeCursor cursor,
+                                Addr base, Addr limit)
+{
+  RangeStruct old;
+  Res res;
+
+  btreeCursorRange(&old, cursor);
+  AVER_CRITICAL(RangeBase(&old) <= base);
+  AVER_CRITICAL(base < limit);
+  AVER_CRITICAL(limit <= RangeLimit(&old));
+
+  if (base == RangeBase(&old) && limit == RangeLimit(&old)) {
+    btreeDeleteAt(btree, cursor);
+  } else if (base == RangeBase(&old)) {
+    btreeSetRange(btree, cursor, limit, RangeLimit(&old));
+  } else if (limit == RangeLimit(&old)) {
+    btreeSetRange(btree, cursor, RangeBase(&old), base);
+  } else {
+    /* Shrink the range to the fragment at left, and insert the
+       fragment at right after it.  If the insertion fails, the tree is
+       unchanged (.insert.prealloc), so restore the range. */
+    btreeSetRange(btree, cursor, RangeBase(&old), base);
+    ++cursor->index[0];
+    res = btreeInsertAt(btree, cursor, limit, RangeLimit(&old));
+    if (res != ResOK) {
+      --cursor->index[0];
+      btreeSetRange(btree, cursor, RangeBase(&old), RangeLimit(&old));
+      return res;
+    }
+  }
+  return ResOK;
+}
+
+
+/* btreeInitComm -- initialise a B-tree
+ *
+ * <design/land#.function.init>.
+ */
+
+static Res btreeInitComm(Land land, LandClass klass, Arena arena,
+                         Align alignment, ArgList args, Bool zoned)
+{
+  BTree btree;
+  ArgStruct arg;
+  Res res;
+  Pool blockPool = NULL;
+
+  AVER(land != NULL);
+  res = NextMethod(Land, BTree, init)(land, arena, alignment, args);
+  if (res != ResOK)
+    return res;
+  btree = CouldBeA(BTree, land);
+
+  if (ArgPick(&arg, args, CBSBlockPool))
+    blockPool = arg.val.pool;
+
+  btree->zoned = zoned;
+  btree->nodeSize = BTreeNodeSize(zoned);
+  if (blockPool != NULL) {
+    btree->blockPool = blockPool;
+    btree->ownPool = FALSE;
+  } else {
+    MPS_ARGS_BEGIN(pcArgs) {
+      MPS_ARGS_ADD(pcArgs, MPS_KEY_MFS_UNIT_SIZE, btree->nodeSize);
+      res = PoolCreate(&btree->blockPool, arena, PoolClassMFS(), pcArgs);
+    } MPS_ARGS_END(pcArgs);
+    if (res != ResOK) {
+      NextMethod(Inst, BTree, finish)(MustBeA(Inst, land));
+      return res;
+    }
+    btree->ownPool = TRUE;
+  }
+  btree->root = NULL;
+  btree->height = 0;
+  btree->size = 0;
+  STATISTIC(btree->rangeCount = 0);
+
+  SetClassOfPoly(land, klass);
+  btree->sig = BTreeSig;
+  AVERC(BTree, btree);
+  return ResOK;
+}
+
+static Res btreeInit(Land land, Arena arena, Align alignment, ArgList args)
+{
+  return btreeInitComm(land, CLASS(BTree), arena, alignment, args, FALSE);
+}
+
+static Res btreeInitZoned(Land land, Arena arena, Align alignment,
+                          ArgList args)
+{
+  return btreeInitComm(land, CLASS(BTreeZoned), arena, alignment, args,
+                       TRUE);
+}
+
+
+/* btreeFinish -- finish a B-tree
+ *
+ * <design/land#.function.finish>.
+ */
+
+static void btreeFreeNodes(BTree btree, BTreeNode node)
+{
+  Index i;
+  if (node->level > 0)
+    for (i = 0; i < node->count; ++i)
+      btreeFreeNodes(btree, btreeChild(node, i));
+  btreeNodeFree(btree, node);
+}
+
+static void btreeFinish(Inst inst)
+{
+  Land land = MustBeA(Land, inst);
+  BTree btree = MustBeA(BTree, land);
+
+  btree->sig = SigInvalid;
+  if (btree->ownPool)
+    PoolDestroy(btree->blockPool);
+  else if (btree->root != NULL)
+    btreeFreeNodes(btree, btree->root);
+  btree->root = NULL;
+
+  NextMethod(Inst, BTree, finish)(inst);
+}
+
+
+/* btreeSize -- total size of ranges in B-tree
+ *
+ * <design/land#.function.size>.
+ */
+
+static Size btreeSize(Land land)
+{
+  BTree btree = MustBeA_CRITICAL(BTree, land);
+  return btree->size;
+}
+
+
+/* btreeInsert -- insert a range, coalescing it with its neighbours
+ *
+ * <design/land#.function.insert>.
+ *
+ * .insert.alloc: Only allocates if the range doesn't abut an existing
+ * range.
+ */
+
+static Res btreeInsert(Range rangeReturn, Land land, Range range)
+{
+  BTree btree = MustBeA_CRITICAL(BTree, land);
+  BTreeCursorStruct leftCursor, rightCursor;
+  Bool left = FALSE, right = FALSE;
+  RangeStruct leftRange, rightRange;
+  Addr base, limit;
+  Res res;
+
+  AVER_CRITICAL(rangeReturn != NULL);
+  AVERT_CRITICAL(Range, range);
+  AVER_CRITICAL(!RangeIsEmpty(range));
+  AVER_CRITICAL(RangeIsAligned(range, LandAlignment(land)));
+
+  base = RangeBase(range);
+  limit = RangeLimit(range);
+  /* Only used if left or right is set, but GCC can't see that. */
+  RangeInit(&leftRange, base, base);
+  RangeInit(&rightRange, limit, limit);
+
+  if (btree->root == NULL) {
+    res = btreeInsertAt(btree, &leftCursor, base, limit);
+    if (res != ResOK)
+      return res;
+    RangeCopy(rangeReturn, range);
+    return ResOK;
+  }
+
+  btreeLocate(&leftCursor, btree, base);
+  rightCursor = leftCursor;
+
+  /* Find the neighbours of the range, and check they don't overlap it. */
+  if (leftCursor.index[0] > 0) {
+    --leftCursor.index[0];
+    btreeCursorRange(&leftRange, &leftCursor);
+    if (RangeLimit(&leftRange) > base)
+      return ResFAIL;
+    left = RangeLimit(&leftRange) == base;
+  }
+  if (rightCursor.index[0] < rightCursor.node[0]->count) {
+    right = TRUE;
+  } else if (rightCursor.node[0]->count > 0) {
+    --rightCursor.index[0];
+    right = btreeNext(&rightCursor, btree);
+  }
+  if (right) {
+    btreeCursorRange(&rightRange, &rightCursor);
+    if (limit > RangeBase(&rightRange))
+      return ResFAIL;
+    right = RangeBase(&rightRange) == limit;
+  }
+
+  if (left && right) {
+    btreeSetRange(btree, &leftCursor, RangeBase(&leftRange),
+                  RangeLimit(&rightRange));
+    btreeDeleteAt(btree, &rightCursor);
+    RangeInit(rangeReturn, RangeBase(&leftRange), RangeLimit(&rightRange));
+  } else if (left) {
+    btreeSetRange(btree, &leftCursor, RangeBase(&leftRange), limit);
+    RangeInit(rangeReturn, RangeBase(&leftRange), limit);
+  } else if (right) {
+    btreeSetRange(btree, &rightCursor, base, RangeLimit(&rightRange));
+    RangeInit(rangeReturn, base, RangeLimit(&rightRange));
+  } else {
+    /* Insert after the left neighbour, if any, in its leaf. */
+    if (RangeBase(range) > leftCursor.node[0]->base[0])
+      ++leftCursor.index[0];
+    res = btreeInsertAt(btree, &leftCursor, base, limit);
+    if (res != ResOK)
+      return res;
+    RangeCopy(rangeReturn, range);
+  }
+  return ResOK;
+}
+
+
+/* btreeExtendBlockPool -- extend block pool with memory */
+
+static void btreeExtendBlockPool(BTree btree, Addr base, Addr limit)
+{
+  Tract tract;
+  Addr addr;
+
+  AVERC(BTree, btree);
+  AVER(base < limit);
+
+  /* Steal tracts from their owning pool */
+  TRACT_FOR(tract, addr, BTreeLand(btree)->arena, base, limit) {
+    TractFinish(tract);
+    TractInit(tract, btree->blockPool, addr);
+  }
+
+  /* Extend the block pool with the stolen memory. */
+  MFSExtend(btree->blockPool, base, limit);
+}
+
+
+/* btreeInsertSteal -- insert a range, possibly stealing memory for the
+ * block pool
+ *
+ * As cbsInsertSteal <code/cbs.c>.  An arena grain holds enough nodes
+ * for any insertion (.insert.prealloc).
+ */
+
+static Res btreeInsertSteal(Range rangeReturn, Land land, Range rangeIO)
+{
+  BTree btree = MustBeA(BTree, land);
+  Arena arena = land->arena;
+  Size grainSize = ArenaGrainSize(arena);
+  Res res;
+
+  AVER(rangeReturn != NULL);
+  AVER(rangeReturn != rangeIO);
+  AVERT(Range, rangeIO);
+  AVER(!RangeIsEmpty(rangeIO));
+  AVER(RangeIsAligned(rangeIO, LandAlignment(land)));
+  AVER(AlignIsAligned(LandAlignment(land), grainSize));
+  AVER(btree->nodeSize * (btree->height + 1) <= grainSize);
+
+  res = btreeInsert(rangeReturn, land, rangeIO);
+  if (res != ResOK && res != ResFAIL) {
+    /* Steal an arena grain and use it to extend the block pool. */
+    Addr stolenBase = RangeBase(rangeIO);
+    Addr stolenLimit = AddrAdd(stolenBase, grainSize);
+    btreeExtendBlockPool(btree, stolenBase, stolenLimit);
+
+    /* Update the inserted range and try again. */
+    RangeSetBase(rangeIO, stolenLimit);
+    AVERT(Range, rangeIO);
+    if (RangeIsEmpty(rangeIO)) {
+      RangeCopy(rangeReturn, rangeIO);
+      res = ResOK;
+    } else {
+      res = btreeInsert(rangeReturn, land, rangeIO);
+      AVER(res == ResOK);  /* since we just extended the block pool */
+    }
+  }
+  return res;
+}
+
+
+/* btreeDelete -- remove a range
+ *
+ * <design/land#.function.delete>.
+ */
+
+static Res btreeDelete(Range rangeReturn, Land land, Range range)
+{
+  BTree btree = MustBeA(BTree, land);
+  BTreeCursorStruct cursor;
+  RangeStruct old;
+  Addr base, limit;
+
+  AVER(rangeReturn != NULL);
+  AVERT(Range, range);
+  AVER(!RangeIsEmpty(range));
+  AVER(RangeIsAligned(range, LandAlignment(land)));
+
+  base = RangeBase(range);
+  limit = RangeLimit(range);
+
+  if (btree->root == NULL)
+    return ResFAIL;
+  btreeLocate(&cursor, btree, base);
+  if (cursor.index[0] == 0)
+    return ResFAIL;
+  --cursor.index[0];
+  btreeCursorRange(&old, &cursor);
+  if (base >= RangeLimit(&old) || limit > RangeLimit(&old))
+    return ResFAIL;
+
+  RangeCopy(rangeReturn, &old);
+  return btreeDeleteFromRange(btree, &cursor, base, limit);
+}
+
+
+/* btreeDeleteSteal -- delete a range, possibly stealing memory for the
+ * block pool
+ *
+ * As cbsDeleteSteal <code/cbs.c>.
+ */
+
+static Res btreeDeleteSteal(Range rangeReturn, Land land, Range range)
+{
+  BTree btree = MustBeA(BTree, land);
+  Arena arena = land->arena;
+  Size grainSize = ArenaGrainSize(arena);
+  RangeStruct containingRange;
+  Res res;
+
+  AVER(rangeReturn != NULL);
+  AVERT(Range, range);
+  AVER(!RangeIsEmpty(range));
+  AVER(RangeIsAligned(range, LandAlignment(land)));
+  AVER(AlignIsAligned(LandAlignment(land), grainSize));
+
+  res = btreeDelete(&containingRange, land, range);
+  if (res == ResOK) {
+    RangeCopy(rangeReturn, &containingRange);
+  } else if (res != ResFAIL) {
+    /* Steal an arena grain from the base of the containing range and
+       use it to extend the block pool. */
+    Addr stolenBase = RangeBase(&containingRange);
+    Addr stolenLimit = AddrAdd(stolenBase, grainSize);
+    RangeStruct stolenRange;
+    AVER(stolenLimit <= RangeBase(range));
+    RangeInit(&stolenRange, stolenBase, stolenLimit);
+    res = btreeDelete(&containingRange, land, &stolenRange);
+    AVER(res == ResOK);  /* since this does not split any range */
+    btreeExtendBlockPool(btree, stolenBase, stolenLimit);
+
+    /* Try again with original range. */
+    res = btreeDelete(rangeReturn, land, range);
+    AVER(res == ResOK);  /* since we just extended the block pool */
+  }
+  return res;
+}
+
+
+/* btreeIterate -- iterate over all ranges in address order
+ *
+ * <design/land#.function.iterate>.
+ */
+
+static Bool btreeIterateNode(Land land, BTreeNode node,
+                             LandVisitor visitor, void *closure)
+{
+  Index i;
+  for (i = 0; i < node->count; ++i) {
+    if (node->level == 0) {
+      RangeStruct range;
+      RangeInit(&range, node->base[i], btreeLimit(node, i));
+      if (!visitor(land, &range, closure))
+        return FALSE;
+    } else if (!btreeIterateNode(land, btreeChild(node, i),
+                                 visitor, closure)) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+static Bool btreeIterate(Land land, LandVisitor visitor, void *closure)
+{
+  BTree btree = MustBeA(BTree, land);
+
+  AVER(FUNCHECK(visitor));
+
+  if (btree->root == NULL)
+    return TRUE;
+  return btreeIterateNode(land, btree->root, visitor, closure);
+}
+
+
+/* btreeIterateAndDelete -- iterate over all ranges, deleting some
+ *
+ * <design/land#.function.iterate.and.delete>.  Deleting a range may
+ * rebalance the tree, so after each deletion the cursor is found
+ * again from the base of the deleted range.
+ */
+
+static Bool btreeIterateAndDelete(Land land, LandDeleteVisitor visitor,
+                                  void *closure)
+{
+  BTree btree = MustBeA(BTree, land);
+  BTreeCursorStruct cursor;
+  Bool more;
+
+  AVER(FUNCHECK(visitor));
+
+  more = btreeFirst(&cursor, btree);
+  while (more) {
+    RangeStruct range;
+    Bool deleteRange = FALSE;
+    btreeCursorRange(&range, &cursor);
+    if (!visitor(&deleteRange, land, &range, closure)) {
+      if (deleteRange)
+        btreeDeleteAt(btree, &cursor);
+      return FALSE;
+    }
+    if (deleteRange) {
+      btreeDeleteAt(btree, &cursor);
+      if (btree->root == NULL)
+        break;
+      btreeLocate(&cursor, btree, RangeBase(&range));
+      if (cursor.index[0] < cursor.node[0]->count)
+        continue;
+      cursor.index[0] = cursor.node[0]->count - 1;
+    }
+    more = btreeNext(&cursor, btree);
+  }
+  return TRUE;
+}
+
+
+/* btreeFindDeleteRange -- delete appropriate part of range found */
+
+static void btreeFindDeleteRange(Range rangeReturn, Range oldRangeReturn,
+                                 BTree btree, BTreeCursor cursor,
+                                 Size size, FindDelete findDelete)
+{
+  Addr base, limit;
+  Res res;
+
+  btreeCursorRange(oldRangeReturn, cursor);
+  AVER_CRITICAL(RangeSize(oldRangeReturn) >= size);
+  base = RangeBase(oldRangeReturn);
+  limit = RangeLimit(oldRangeReturn);
+
+  switch (findDelete) {
+  case FindDeleteNONE:
+    RangeCopy(rangeReturn, oldRangeReturn);
+    return;
+  case FindDeleteLOW:
+    limit = AddrAdd(base, size);
+    break;
+  case FindDeleteHIGH:
+    base = AddrSub(limit, size);
+    break;
+  case FindDeleteENTIRE:
+    break;
+  default:
+    NOTREACHED;
+    break;
+  }
+
+  RangeInit(rangeReturn, base, limit);
+  res = btreeDeleteFromRange(btree, cursor, base, limit);
+  /* Deleting from one end of a range never allocates. */
+  AVER_CRITICAL(res == ResOK);
+}
+
+
+/* btreeFindFirstCursor, btreeFindLastCursor -- find the path to the
+ * first or last range of at least the given size
+ */
+
+static Bool btreeFindFirstCursor(BTreeCursor cursor, BTree btree, Size size)
+{
+  BTreeNode node = btree->root;
+  Count l;
+
+  for (l = btree->height; l-- > 0;) {
+    Index i;
+    for (i = 0; i < node->count; ++i)
+      if (node->maxSize[i] >= size)
+        break;
+    if (i == node->count) {
+      AVER_CRITICAL(node == btree->root); /* maxSize is exact */
+      return FALSE;
+    }
+    cursor->node[l] = node;
+    cursor->index[l] = i;
+    if (l > 0)
+      node = btreeChild(node, i);
+  }
+  return btree->root != NULL;
+}
+
+static Bool btreeFindLastCursor(BTreeCursor cursor, BTree btree, Size size)
+{
+  BTreeNode node = btree->root;
+  Count l;
+
+  for (l = btree->height; l-- > 0;) {
+    Index i;
+    for (i = node->count; i > 0; --i)
+      if (node->maxSize[i - 1] >= size)
+        break;
+    if (i == 0) {
+      AVER_CRITICAL(node == btree->root); /* maxSize is exact */
+      return FALSE;
+    }
+    cursor->node[l] = node;
+    cursor->index[l] = i - 1;
+    if (l > 0)
+      node = btreeChild(node, i - 1);
+  }
+  return btree->root != NULL;
+}
+
+
+/* btreeFindFirst -- find the first range of at least the given size */
+
+static Bool btreeFindFirst(Range rangeReturn, Range oldRangeReturn,
+                           Land land, Size size, FindDelete findDelete)
+{
+  BTree btree = MustBeA_CRITICAL(BTree, land);
+  BTreeCursorStruct cursor;
+
+  AVER_CRITICAL(rangeReturn != NULL);
+  AVER_CRITICAL(oldRangeReturn != NULL);
+  AVER_CRITICAL(size > 0);
+  AVER_CRITICAL(SizeIsAligned(size, LandAlignment(land)));
+  AVERT_CRITICAL(FindDelete, findDelete);
+
+  if (!btreeFindFirstCursor(&cursor, btree, size))
+    return FALSE;
+  btreeFindDeleteRange(rangeReturn, oldRangeReturn, btree, &cursor,
+                       size, findDelete);
+  return TRUE;
+}
+
+
+/* btreeFindLast -- find the last range of at least the given size */
+
+static Bool btreeFindLast(Range rangeReturn, Range oldRangeReturn,
+                          Land land, Size size, FindDelete findDelete)
+{
+  BTree btree = MustBeA_CRITICAL(BTree, land);
+  BTreeCursorStruct cursor;
+
+  AVER_CRITICAL(rangeReturn != NULL);
+  AVER_CRITICAL(oldRangeReturn != NULL);
+  AVER_CRITICAL(size > 0);
+  AVER_CRITICAL(SizeIsAligned(size, LandAlignment(land)));
+  AVERT_CRITICAL(FindDelete, findDelete);
+
+  if (!btreeFindLastCursor(&cursor, btree, size))
+    return FALSE;
+  btreeFindDeleteRange(rangeReturn, oldRangeReturn, btree, &cursor,
+                       size, findDelete);
+  return TRUE;
+}
+
+
+/* btreeFindLargest -- find the largest range */
+
+static Bool btreeFindLargest(Range rangeReturn, Range oldRangeReturn,
+                             Land land, Size size, FindDelete findDelete)
+{
+  BTree btree = MustBeA_CRITICAL(BTree, land);
+  BTreeCursorStruct cursor;
+  BTreeEntryStruct entry;
+  Bool found;
+
+  AVER_CRITICAL(rangeReturn != NULL);
+  AVER_CRITICAL(oldRangeReturn != NULL);
+  AVER_CRITICAL(size > 0);
+  AVERT_CRITICAL(FindDelete, findDelete);
+
+  if (btree->root == NULL)
+    return FALSE;
+  btreeNodeEntry(&entry, btree, btree->root);
+  if (entry.maxSize < size)
+    return FALSE;
+  found = btreeFindFirstCursor(&cursor, btree, entry.maxSize);
+  AVER_CRITICAL(found); /* maxSize is exact, so we will find it. */
+  btreeFindDeleteRange(rangeReturn, oldRangeReturn, btree, &cursor,
+                       size, findDelete);
+  return TRUE;
+}
+
+
+/* btreeFindInZones -- find a range within a zone set
+ *
+ * Finds a range of at least the given size that lies entirely within
+ * a zone set: the first such range, if high is FALSE, or the last, if
+ * high is TRUE.  Subtrees with no large enough range, or (in a zoned
+ * B-tree) no range in the zone set, are skipped.
+ */
+
+typedef struct BTreeZonesClosureStruct {
+  Arena arena;
+  ZoneSet zoneSet;
+  Size size;
+  Bool high;
+  Addr base;
+  Addr limit;
+} BTreeZonesClosureStruct, *BTreeZonesClosure;
+
+static Bool btreeFindInZonesNode(BTreeCursor cursor, BTree btree,
+                                 BTreeNode node, BTreeZonesClosure my)
+{
+  RangeInZoneSet search = my->high ? RangeInZoneSetLast : RangeInZoneSetFirst;
+  Index k;
+
+  for (k = 0; k < node->count; ++k) {
+    Index i = my->high ? node->count - 1 - k : k;
+    if (node->maxSize[i] < my->size)
+      continue;
+    if (btree->zoned
+        && ZoneSetInter(node->zones[i], my->zoneSet) == ZoneSetEMPTY)
+      continue;
+    cursor->node[node->level] = node;
+    cursor->index[node->level] = i;
+    if (node->level == 0) {
+      if (search(&my->base, &my->limit, node->base[i], btreeLimit(node, i),
+                 my->arena, my->zoneSet, my->size))
+        return TRUE;
+    } else if (btreeFindInZonesNode(cursor, btree, btreeChild(node, i), my)) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+static Res btreeFindInZones(Bool *foundReturn, Range rangeReturn,
+                            Range oldRangeReturn, Land land, Size size,
+                            ZoneSet zoneSet, Bool high)
+{
+  BTree btree = MustBeA_CRITICAL(BTree, land);
+  BTreeCursorStruct cursor;
+  BTreeZonesClosureStruct closure;
+  RangeStruct old;
+  Addr base, limit;
+  Res res;
+
+  AVER_CRITICAL(foundReturn != NULL);
+  AVER_CRITICAL(rangeReturn != NULL);
+  AVER_CRITICAL(oldRangeReturn != NULL);
+  /* AVERT_CRITICAL(ZoneSet, zoneSet); */
+  AVERT_CRITICAL(Bool, high);
+
+  *foundReturn = FALSE;
+  if (zoneSet == ZoneSetEMPTY || btree->root == NULL)
+    return ResOK;
+  if (zoneSet == ZoneSetUNIV) {
+    FindDelete fd = high ? FindDeleteHIGH : FindDeleteLOW;
+    *foundReturn = (high ? btreeFindLast : btreeFindFirst)
+      (rangeReturn, oldRangeReturn, land, size, fd);
+    return ResOK;
+  }
+  if (ZoneSetIsSingle(zoneSet) && size > ArenaStripeSize(LandArena(land)))
+    return ResOK;
+
+  closure.arena = LandArena(land);
+  closure.zoneSet = zoneSet;
+  closure.size = size;
+  closure.high = high;
+  if (!btreeFindInZonesNode(&cursor, btree, btree->root, &closure))
+    return ResOK;
+
+  if (high) {
+    base = AddrSub(closure.limit, size);
+    limit = closure.limit;
+  } else {
+    base = closure.base;
+    limit = AddrAdd(closure.base, size);
+  }
+  btreeCursorRange(&old, &cursor);
+  res = btreeDeleteFromRange(btree, &cursor, base, limit);
+  if (res != ResOK)
+    return res;         /* not enough memory to split range */
+  RangeInit(rangeReturn, base, limit);
+  RangeCopy(oldRangeReturn, &old);
+  *foundReturn = TRUE;
+  return ResOK;
+}
+
+
+/* btreeDescribe -- describe a B-tree
+ *
+ * <design/land#.function.describe>.
+ */
+
+static Res btreeDescribeNode(BTree btree, BTreeNode node,
+                             mps_lib_FILE *stream, Count depth)
+{
+  Index i;
+  Res res;
+
+  for (i = 0; i < node->count; ++i) {
+    if (node->level == 0) {
+      res = WriteF(stream, depth, "[$P,$P)\n",
+                   (WriteFP)node->base[i], (WriteFP)btreeLimit(node, i),
+                   NULL);
+    } else {
+      res = WriteF(stream, depth, "$P {$U", (WriteFP)node->base[i],
+                   (WriteFU)node->maxSize[i], NULL);
+      if (res == ResOK && btree->zoned)
+        res = WriteF(stream, 0, ", $B", (WriteFB)node->zones[i], NULL);
+      if (res == ResOK)
+        res = WriteF(stream, 0, "}\n", NULL);
+      if (res == ResOK)
+        res = btreeDescribeNode(btree, btreeChild(node, i), stream,
+                                depth + 2);
+    }
+    if (res != ResOK)
+      return res;
+  }
+  return ResOK;
+}
+
+static Res btreeDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
+{
+  Land land = CouldBeA(Land, inst);
+  BTree btree = CouldBeA(BTree, land);
+  Res res;
+
+  if (!TESTC(BTree, btree))
+    return ResPARAM;
+  if (stream == NULL)
+    return ResPARAM;
+
+  res = NextMethod(Inst, BTree, describe)(inst, stream, depth);
+  if (res != ResOK)
+    return res;
+
+  res = WriteF(stream, depth + 2,
+               "blockPool $P\n", (WriteFP)btree->blockPool,
+               "ownPool   $U\n", (WriteFU)btree->ownPool,
+               "height    $U\n", (WriteFU)btree->height,
+               STATISTIC_WRITE("rangeCount $U\n",
+                               (WriteFU)btree->rangeCount)
+               NULL);
+  if (res != ResOK)
+    return res;
+
+  if (btree->root == NULL)
+    return ResOK;
+  return btreeDescribeNode(btree, btree->root, stream, depth + 2);
+}
+
+
+DEFINE_CLASS(Land, BTree, klass)
+{
+  INHERIT_CLASS(klass, BTree, Land);
+  klass->instClassStruct.describe = btreeDescribe;
+  klass->instClassStruct.finish = btreeFinish;
+  klass->size = sizeof(BTreeStruct);
+  klass->init = btreeInit;
+  klass->sizeMethod = btreeSize;
+  klass->insert = btreeInsert;
+  klass->insertSteal = btreeInsertSteal;
+  klass->delete = btreeDelete;
+  klass->deleteSteal = btreeDeleteSteal;
+  klass->iterate = btreeIterate;
+  klass->iterateAndDelete = btreeIterateAndDelete;
+  klass->findFirst = btreeFindFirst;
+  klass->findLast = btreeFindLast;
+  klass->findLargest = btreeFindLargest;
+  klass->findInZones = btreeFindInZones;
+  AVERT(LandClass, klass);
+}
+
+DEFINE_CLASS(Land, BTreeZoned, klass)
+{
+  INHERIT_CLASS(klass, BTreeZoned, BTree);
+  klass->init = btreeInitZoned;
+  AVERT(LandClass, klass);
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
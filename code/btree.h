@@ -0,0 +1,121 @@
+/* btree.h: B-TREE LAND INTERFACE
+ *
+ * $Id$
+ * Copyright (c) 2020 Ravenbrook Limited.  See end of file for license.
+ *
+ * .source: <design/btree>.
+ */
+
+#ifndef btree_h
+#define btree_h
+
+#include "mpmtypes.h"
+#include "mpm.h"
+#include "mpmst.h"
+#include "cbs.h"
+
+
+/* BTreeORDER -- maximum number of entries in a node
+ *
+ * Eight bases fill a 64-byte cache line on a 64-bit platform, so
+ * searching a node reads one line of bases.  Nodes other than the
+ * root have at least BTreeORDER / 2 entries.
+ */
+
+#define BTreeORDER ((Count)8)
+
+
+/* BTreeNodeStruct -- node of a B-tree
+ *
+ * In a leaf, entry i is the range [base[i], limit[i]).  In an
+ * internal node, entry i is the subtree the.child[i], and base[i] is
+ * the base of the first range in that subtree.  maxSize[i] is the
+ * size of the largest range in the entry, and zones[i] is the union
+ * of the zones of its ranges.  The zones array is only present in
+ * zoned B-trees: see BTreeNodeSize.
+ */
+
+typedef struct BTreeNodeStruct {
+  Count count;                  /* number of entries in use */
+  Count level;                  /* height above the leaves */
+  Addr base[BTreeORDER];        /* base of first range in entry */
+  union {
+    Addr limit[BTreeORDER];     /* leaf: limit of range */
+    BTreeNode child[BTreeORDER]; /* internal: subtree */
+  } the;
+  Size maxSize[BTreeORDER];     /* size of largest range in entry */
+  ZoneSet zones[BTreeORDER];    /* zoned only: zones of ranges in entry */
+} BTreeNodeStruct;
+
+#define BTreeNodeSize(zoned) \
+  ((zoned) ? sizeof(BTreeNodeStruct) : offsetof(BTreeNodeStruct, zones))
+
+typedef struct BTreeStruct *BTree, *BTreeZoned;
+
+extern Bool BTreeCheck(BTree btree);
+
+#define BTreeLand(btree) (&(btree)->landStruct)
+
+DECLARE_CLASS(Land, BTree, Land);
+DECLARE_CLASS(Land, BTreeZoned, BTree);
+
+/* BTree classes take the CBSBlockPool keyword argument, so that they
+ * can replace a CBS. */
+
+
+/* TreeLand -- address-ordered land used by the arena and MVFF
+ *
+ * <design/btree#.config>.  If CONFIG_LAND_BTREE is defined, the
+ * arena's free land and MVFF's lands are B-trees; otherwise they are
+ * CBSs.
+ */
+
+#if defined(CONFIG_LAND_BTREE)
+#define TreeLandCheck           BTreeCheck
+#define TreeLandLand            BTreeLand
+#define TreeLandFastClass()     CLASS(BTree)
+#define TreeLandZonedClass()    CLASS(BTreeZoned)
+#define TreeLandFastBlockSize   BTreeNodeSize(FALSE)
+#define TreeLandZonedBlockSize  BTreeNodeSize(TRUE)
+#define TreeLandForget(tl)      ((tl)->root = NULL, (tl)->height = 0)
+#else
+#define TreeLandCheck           CBSCheck
+#define TreeLandLand            CBSLand
+#define TreeLandFastClass()     CLASS(CBSFast)
+#define TreeLandZonedClass()    CLASS(CBSZoned)
+#define TreeLandFastBlockSize   sizeof(CBSFastBlockStruct)
+#define TreeLandZonedBlockSize  sizeof(CBSZonedBlockStruct)
+#define TreeLandForget(tl)      ((tl)->splayTreeStruct.root = TreeEMPTY)
+#endif
+
+#endif /* btree_h */
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
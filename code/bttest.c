@@ -14,6 +14,7 @@
 
 #include <stdio.h> /* fflush, fgets, printf, putchar, puts */
 #include <stdlib.h> /* exit, strtol */
+#include <time.h> /* CLOCKS_PER_SEC, clock, clock_t */
 
 SRCID(bttest, "$Id$");
 
@@ -217,6 +218,80 @@ static void findLongResRange(void)
 }
 
 
+/* benchmark -- measure throughput of the range operations
+ *
+ * Runs each range operation 'n' times over the whole BT (as currently
+ * set up) and prints the throughput in millions of bits per second.
+ */
+
+static void benchmarkReport(const char *name, clock_t start, Count n)
+{
+  double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+  double bits = (double)n * (double)btSize;
+  if (seconds > 0.0)
+    printf("%-24s %10.1f Mbit/s\n", name, bits / seconds / 1e6);
+  else
+    printf("%-24s (too fast to measure)\n", name);
+}
+
+static void benchmark(void)
+{
+  Count i, n = argCount > 0 ? args[0] : 1000;
+  Count sink = 0;
+  Index base, limit;
+  clock_t start;
+  BT copy;
+  Res res;
+
+  if (bt == NULL) {
+    printf("no BT\n");
+    return;
+  }
+  res = BTCreate(&copy, arena, btSize);
+  if (res != ResOK) {
+    printf("BTCreate returned %d\n", res);
+    return;
+  }
+
+  start = clock();
+  for (i = 0; i < n; ++i)
+    sink += BTCountResRange(bt, 0, btSize);
+  benchmarkReport("BTCountResRange", start, n);
+
+  start = clock();
+  for (i = 0; i < n; ++i)
+    sink += BTIsResRange(bt, 0, btSize);
+  benchmarkReport("BTIsResRange", start, n);
+
+  start = clock();
+  for (i = 0; i < n; ++i)
+    BTCopyInvertRange(bt, copy, 0, btSize);
+  benchmarkReport("BTCopyInvertRange", start, n);
+
+  start = clock();
+  for (i = 0; i < n; ++i)
+    if (BTFindShortResRange(&base, &limit, bt, 0, btSize, 1))
+      sink += base;
+  benchmarkReport("BTFindShortResRange", start, n);
+
+  start = clock();
+  for (i = 0; i < n; ++i)
+    if (BTFindShortResRangeHigh(&base, &limit, bt, 0, btSize, 1))
+      sink += base;
+  benchmarkReport("BTFindShortResRangeHigh", start, n);
+
+  start = clock();
+  for (i = 0; i < n; ++i)
+    if (BTFindLongResRange(&base, &limit, bt, 0, btSize, btSize))
+      sink += base;
+  benchmarkReport("BTFindLongResRange", start, n);
+
+  BTDestroy(copy, arena, btSize);
+  if (sink == 0)
+    printf("(no reset bits found)\n");
+}
+
+
 static void help(void)
 {
   printf("c <s>             create a BT of size 's'\n"
@@ -231,6 +306,7 @@ static void help(void)
   printf("f <l> [<i> <i>]   find a reset range of length 'l'.\n"
          "fh <l> [<i> <i>]  find a reset range length 'l', working downwards\n"
          "fl <l> [<i> <i>]  find a reset range of length at least 'l'\n"
+         "b [<n>]           measure throughput of range operations\n"
          "q                 quit\n"
          "?                 print this message\n");
   printf("\n"
@@ -256,6 +332,7 @@ static struct commandShapeStruct {
   {"f", 1, 3, findShortResRange},
   {"fh", 1, 3, findShortResRangeHigh},
   {"fl", 1, 3, findLongResRange},
+  {"b", 0, 1, benchmark},
   {"?", 0, 0, help},
   {"q", 0, 0, quit},
   { NULL, 0, 0, NULL}
@@ -41,12 +41,21 @@ Bool BufferCheck(Buffer buffer)
   CHECKU(Pool, buffer->pool);
   CHECKL(buffer->arena == buffer->pool->arena);
   CHECKD_NOSIG(Ring, &buffer->poolRing);
+  CHECKD_NOSIG(Ring, &buffer->threadRing);
   CHECKL(BoolCheck(buffer->isMutator));
   CHECKL(buffer->fillSize >= 0.0);
   CHECKL(buffer->emptySize >= 0.0);
   CHECKL(buffer->emptySize <= buffer->fillSize);
   CHECKL(buffer->alignment == buffer->pool->alignment);
   CHECKL(AlignCheck(buffer->alignment));
+  CHECKL(BoolCheck(buffer->perThread));
+  if (buffer->thread != NULL) {
+    CHECKL(buffer->perThread);
+    CHECKL(ThreadCheckSimple(buffer->thread));
+  }
+  /* Per-thread buffers are on their thread's ring or the pool's idle
+     ring: <design/buffer#.thread>. */
+  CHECKL(buffer->perThread != RingIsSingle(&buffer->threadRing));
 
   /* If any of the buffer's fields indicate that it is reset, make */
   /* sure it is really reset.  Otherwise, check various properties */
@@ -154,6 +163,8 @@ static Res BufferAbsDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
                 "poolLimit $A\n",   (WriteFA)buffer->poolLimit,
                 "alignment $W\n",   (WriteFW)buffer->alignment,
                 "rampCount $U\n",   (WriteFU)buffer->rampCount,
+                "perThread $S\n",   WriteFYesNo(buffer->perThread),
+                "thread $P\n",      (WriteFP)buffer->thread,
                 NULL);
 }
 
@@ -203,6 +214,9 @@ static Res BufferAbsInit(Buffer buffer, Pool pool, Bool isMutator, ArgList args)
   buffer->ap_s.limit = (mps_addr_t)0;
   buffer->poolLimit = (Addr)0;
   buffer->rampCount = 0;
+  buffer->perThread = FALSE;
+  buffer->thread = NULL;
+  RingInit(&buffer->threadRing);
 
   /* .init.sig-serial: Now the vanilla stuff is initialized, sign the
      buffer and give it a serial number. It can then be safely checked
@@ -246,6 +260,10 @@ Res BufferCreate(Buffer *bufferReturn, BufferClass klass,
   AVERT(BufferClass, klass);
   AVERT(Pool, pool);
 
+  /* <design/pool#.cache.buffer> */
+  if (pool->cache != NULL)
+    return ResPARAM;
+
   arena = PoolArena(pool);
 
   /* Allocate memory for the buffer descriptor structure. */
@@ -269,6 +287,114 @@ failAlloc:
 }
 
 
+/* BufferForThread -- find or create the calling thread's buffer in a pool
+ *
+ * <design/buffer#.thread>.  Find the calling thread among the threads
+ * registered with the arena.  If it already has a per-thread buffer in
+ * the pool, return it.  Otherwise, claim an idle per-thread buffer
+ * released by a thread that has been deregistered, or create a new
+ * one.  Returns ResFAIL if the calling thread is not registered.
+ */
+
+Res BufferForThread(Buffer *bufferReturn, Pool pool)
+{
+  Thread thread = NULL;
+  Ring threadRing;
+  Ring node, nextNode;
+  Buffer buffer;
+  Res res;
+
+  AVER(bufferReturn != NULL);
+  AVERT(Pool, pool);
+
+  RING_FOR(node, ArenaThreadRing(PoolArena(pool)), nextNode) {
+    Thread t = ThreadRingThread(node);
+    if (ThreadIsCurrent(t)) {
+      thread = t;
+      break;
+    }
+  }
+  if (thread == NULL)
+    return ResFAIL;
+
+  threadRing = ThreadBufferRing(thread);
+  RING_FOR(node, threadRing, nextNode) {
+    buffer = RING_ELT(Buffer, threadRing, node);
+    AVER(buffer->thread == thread);
+    if (BufferPool(buffer) == pool) {
+      *bufferReturn = buffer;
+      return ResOK;
+    }
+  }
+
+  if (!RingIsSingle(&pool->idleBufferRing)) {
+    buffer = RING_ELT(Buffer, threadRing, RingNext(&pool->idleBufferRing));
+    AVER(buffer->thread == NULL);
+    RingRemove(&buffer->threadRing);
+  } else {
+    res = BufferCreate(&buffer, PoolDefaultBufferClass(pool), pool, TRUE,
+                       mps_args_none);
+    if (res != ResOK)
+      return res;
+    buffer->perThread = TRUE;
+  }
+  buffer->thread = thread;
+  RingAppend(threadRing, &buffer->threadRing);
+  AVERT(Buffer, buffer);
+
+  *bufferReturn = buffer;
+  return ResOK;
+}
+
+
+/* BufferThreadRelease -- release a thread's per-thread buffers
+ *
+ * Called when the thread is deregistered.  The buffers are detached,
+ * so that the objects allocated in them are accounted and their
+ * segments can be collected, and become idle, so that the next thread
+ * to ask for a buffer in the pool needn't create one.
+ * <design/buffer#.thread.release>.
+ */
+
+void BufferThreadRelease(Arena arena, Thread thread)
+{
+  Ring node, nextNode;
+
+  AVERT(Arena, arena);
+  AVER(ThreadArena(thread) == arena);
+
+  RING_FOR(node, ThreadBufferRing(thread), nextNode) {
+    Buffer buffer = RING_ELT(Buffer, threadRing, node);
+    AVER(buffer->thread == thread);
+    AVER(BufferIsReady(buffer));
+    BufferDetach(buffer, BufferPool(buffer));
+    buffer->thread = NULL;
+    RingRemove(&buffer->threadRing);
+    RingAppend(&BufferPool(buffer)->idleBufferRing, &buffer->threadRing);
+  }
+}
+
+
+/* BufferThreadFinish -- destroy a pool's per-thread buffers
+ *
+ * Called when the pool is destroyed, since the client can't destroy
+ * idle per-thread buffers itself.
+ */
+
+void BufferThreadFinish(Pool pool)
+{
+  Ring node, nextNode;
+
+  AVERT(Pool, pool);
+
+  RING_FOR(node, &pool->bufferRing, nextNode) {
+    Buffer buffer = RING_ELT(Buffer, poolRing, node);
+    if (buffer->perThread)
+      BufferDestroy(buffer);
+  }
+}
+
+
 /* BufferDetach -- detach a buffer from a region  */
 
 void BufferDetach(Buffer buffer, Pool pool)
@@ -343,10 +469,13 @@ static void BufferAbsFinish(Inst inst)
 
   /* Detach the buffer from its owning pool and unsig it. */
   RingRemove(&buffer->poolRing);
+  if (buffer->perThread)
+    RingRemove(&buffer->threadRing);
   InstFinish(MustBeA(Inst, buffer));
   buffer->sig = SigInvalid;
 
   /* Finish off the generic buffer fields. */
+  RingFinish(&buffer->threadRing);
   RingFinish(&buffer->poolRing);
 
   EVENT1(BufferFinish, buffer);
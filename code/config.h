@@ -331,6 +331,21 @@
 #endif
 
 
+/* PREFETCH -- hint that memory will be read soon
+ *
+ * Use to start loading memory into the cache some time before it is
+ * needed, such as the page table entries and objects for deferred
+ * fixes.  Prefetching never faults, so the address need not be valid.
+ * See <https://gcc.gnu.org/onlinedocs/gcc/Other-Builtins.html>.
+ */
+
+#if defined(MPS_BUILD_GC) || defined(MPS_BUILD_LL)
+#define PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define PREFETCH(addr) NOOP
+#endif
+
+
 /* Buffer Configuration -- see <code/buffer.c> */
 
 #define BUFFER_RANK_DEFAULT (mps_rank_exact())
@@ -354,6 +369,9 @@
 /* AMC treats objects larger than or equal to this as "Large" */
 #define AMC_LARGE_SIZE_DEFAULT ((Size)32768)
 #define AMC_EXTEND_BY_DEFAULT  ((Size)8192)
+/* log2 of the size of the cards in an AMC segment card table: see
+ * <design/poolamc#.scan.card> */
+#define AMC_CARD_SHIFT 9
 
 
 /* Pool AMS Configuration -- see <code/poolams.c> */
@@ -376,6 +394,22 @@
 #define LO_GEN_DEFAULT       0
 
 
+/* Adaptive segregated allocation caches -- see <code/sac.c#adapt> */
+
+#define SAC_ADAPT_CLASS_COUNT ((Count)12)
+#define SAC_ADAPT_STEPS ((Count)4)   /* candidate sizes per doubling */
+#define SAC_ADAPT_INTERVAL ((Count)256)
+#define SAC_ADAPT_COUNT_MAX ((Count)1024)
+
+
+/* Pool cache of small blocks -- see <design/pool#.cache.sac> */
+
+#define POOL_CACHE_CLASS_COUNT ((Count)8)
+#define POOL_CACHE_BLOCK_COUNT ((Count)64)
+#define POOL_CACHE_MAGAZINE_SIZE ((Count)32)
+#define POOL_CACHE_MAGAZINE_COUNT ((Count)64)
+
+
 /* Pool MFS Configuration -- see <code/poolmfs.c> */
 
 #define MFS_EXTEND_BY_DEFAULT ((Size)65536)
@@ -390,6 +424,8 @@
 #define MVFF_ARENA_HIGH_DEFAULT  FALSE
 #define MVFF_FIRST_FIT_DEFAULT   TRUE
 #define MVFF_SPARE_DEFAULT       0.75
+#define MVFF_CACHE_DEFAULT       FALSE
+#define MVFF_GOOD_FIT_DEFAULT    FALSE
 
 
 /* Pool MVT Configuration -- see <code/poolmv2.c> */
@@ -407,6 +443,20 @@
 
 #define ArenaPollALLOCTIME (65536.0)
 
+/* ArenaPollOVERFLOWLIMIT is the most by which the polling interval is
+ * shortened while a trace is running and a generation that is not
+ * being collected is over capacity.  See
+ * <design/strategy#.policy.overflow>. */
+
+#define ArenaPollOVERFLOWLIMIT (8.0)
+
+/* ArenaPollBACKGROUNDSLACK is how far, in bytes of allocation, the
+ * mutator may get ahead of a background collector before it starts
+ * doing collection work itself.  See
+ * <design/strategy#.policy.background>. */
+
+#define ArenaPollBACKGROUNDSLACK (16.0 * ArenaPollALLOCTIME)
+
 /* .client.seg-size: ARENA_CLIENT_GRAIN_SIZE is the minimum size, in
  * bytes, of a grain in the client arena. It's set at 8192 with no
  * particular justification. */
@@ -417,6 +467,22 @@
 
 #define ARENA_SPARE_DEFAULT     0.75
 
+/* ARENA_SPARE_DECAY_TIME is the time (in seconds) over which an arena
+ * in background mode returns spare committed memory in excess of the
+ * spare commit limit to the operating system.  See
+ * <design/arena#.spare.decay>. */
+
+#define ARENA_SPARE_DECAY_TIME  (1.0)
+
+/* ARENA_DEFAULT_COMMIT_AHEAD is the default amount of spare committed
+ * memory (in bytes) that an arena in background mode keeps ready for
+ * allocation.  ARENA_COMMIT_AHEAD_STEP is the most that it commits in
+ * one step, to bound the time the arena is locked.  See
+ * <design/arena#.spare.ahead>. */
+
+#define ARENA_DEFAULT_COMMIT_AHEAD ((Size)0)
+#define ARENA_COMMIT_AHEAD_STEP ((Size)1 << 20)
+
 /* ARENA_DEFAULT_PAUSE_TIME is the maximum time (in seconds) that
  * operations within the arena may pause the mutator for.  The default
  * is set for typical human interaction.  See mps_arena_pause_time_set
@@ -425,6 +491,7 @@
 #define ARENA_DEFAULT_PAUSE_TIME (0.1)
 
 #define ARENA_DEFAULT_ZONED     TRUE
+#define ARENA_DEFAULT_SOFT_DIRTY FALSE
 
 /* ARENA_MINIMUM_COLLECTABLE_SIZE is the minimum size (in bytes) of
  * collectable memory that might be considered worthwhile to run a
@@ -506,6 +573,18 @@
 #define VMJunkBYTE ((unsigned char)0xA9)
 #define VMParamSize (sizeof(Word))
 
+/* VM_HUGE_PAGE_SIZE is the size of the huge pages that the VM asks the
+ * operating system for if MPS_KEY_ARENA_HUGE_PAGES is TRUE.  This is
+ * the size of a transparent huge page on Linux on x86-64 and ARM64.
+ * VMs smaller than VM_HUGE_PAGE_MIN don't use huge pages: they gain
+ * little, and aligning many small chunks to huge pages puts them all
+ * in the same zones.  See <design/vm#.huge>. */
+#define VM_HUGE_PAGE_SIZE ((Size)2 << 20)
+#define VM_HUGE_PAGE_MIN (4 * VM_HUGE_PAGE_SIZE)
+#define VM_HUGE_PAGES_DEFAULT FALSE
+#define VM_DISCARD_DEFAULT FALSE
+#define VM_PREFAULT_DEFAULT FALSE
+
 
 /* .feature.li: Linux feature specification
  *
@@ -519,8 +598,13 @@
  * prmcix.h    stack_t, siginfo_t        <signal.h>    _XOPEN_SOURCE
  * prmclii3.c  REG_EAX etc.              <ucontext.h>  _GNU_SOURCE
  * prmclii6.c  REG_RAX etc.              <ucontext.h>  _GNU_SOURCE
+ * protsdli.c  pread                     <unistd.h>    _XOPEN_SOURCE >= 500
+ * protsdli.c  O_CLOEXEC                 <fcntl.h>     _GNU_SOURCE
  * pthrdext.c  sigaction etc.            <signal.h>    _XOPEN_SOURCE
  * vmix.c      MAP_ANON                  <sys/mman.h>  _GNU_SOURCE
+ * vmix.c      MADV_HUGEPAGE             <sys/mman.h>  _GNU_SOURCE
+ * vmix.c      MADV_FREE                 <sys/mman.h>  _GNU_SOURCE
+ * vmix.c      MADV_POPULATE_WRITE       <sys/mman.h>  _GNU_SOURCE
  *
  * It is not possible to localize these feature specifications around
  * the individual headers: all headers share a common set of features
@@ -621,11 +705,26 @@
 #endif
 
 
+/* Chunk Map Configuration -- see <code/tract.c#chunk-map> */
+
+#define ChunkMapLENGTH  256     /* number of entries in chunk map */
+#define ChunkMapSHIFT    20     /* minimum log2 of space per map entry */
+
+
 /* Tracer Configuration -- see <code/trace.c> */
 
 #define TraceLIMIT ((size_t)1)
 /* I count 4 function calls to scan, 10 to copy. */
 #define TraceCopyScanRATIO (1.5)
+/* Reclaiming a segment counts as this fraction of the work of
+   scanning it.  See <design/trace#.reclaim.work>. */
+#define TraceReclaimScanRATIO (0.125)
+/* Segments reclaimed at a time when an allocation needs the space.
+   See <design/trace#.reclaim.demand>. */
+#define TraceReclaimDemandCOUNT ((Count)8)
+/* Number of fixes that can be deferred in a ScanState.
+   See <design/trace#.fix.defer>. */
+#define ScanStateDeferLENGTH 16
 
 
 /* Events
@@ -704,6 +803,15 @@
 #define WB_DEFER_HIT   1  /* boring scans after barrier hit */
 
 
+/* Software write barrier
+ *
+ * <design/write-barrier#.software.cards>.  The card table has one byte
+ * for each 2^WB_CARD_SHIFT bytes of address space spanned by the arena.
+ */
+
+#define WB_CARD_SHIFT       9   /* log2 of bytes per card */
+
+
 #endif /* config_h */
 
 
@@ -0,0 +1,241 @@
+/* dirtytest.c: SOFT-DIRTY WRITE BARRIER TEST
+ *
+ * $Id$
+ * Copyright (c) 2020 Ravenbrook Limited.  See end of file for license.
+ *
+ * .overview: This test case checks the write barrier implemented with
+ * soft-dirty page tracking (see <design/write-barrier#.soft-dirty>).
+ * It promotes a table of old objects, then stores references to young
+ * objects into random slots of the old objects while the nursery is
+ * collected, so that the young objects are only kept alive if each
+ * harvest finds the old segments that were written.  It then checks
+ * that every young object can still be reached, with the contents it
+ * was given.
+ *
+ * .skip: The test is skipped unless /proc/self/clear_refs accepts
+ * "4", because otherwise the arena can't even try to use soft-dirty
+ * page tracking.  If the kernel accepts it but doesn't maintain the
+ * bits, the arena falls back to memory protection (see
+ * <design/write-barrier#.soft-dirty.fallback>), and the test checks
+ * that instead.
+ *
+ * .fork: The test forks after promoting the old objects, and both
+ * processes then make and check the young objects.  The child must
+ * track its own writes, not its parent's, and its collections must
+ * not clear the bits its parent relies on (see <code/protsdli.c#.fork>).
+ */
+
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "mpm.h"
+#include "mps.h"
+#include "mpsavm.h"
+#include "mpscamc.h"
+#include "testlib.h"
+
+#include <stdio.h> /* fclose, fflush, fopen, fputs, printf */
+#include <stdlib.h> /* free, malloc */
+#include <sys/wait.h> /* waitpid, WEXITSTATUS, WIFEXITED */
+#include <unistd.h> /* fork */
+
+
+#define testArenaSIZE   ((size_t)64 << 20)
+#define oldCOUNT        1024
+#define slotCOUNT       32
+#define storeCOUNT      200000
+#define checkFREQ       20000
+
+static mps_gen_param_s testChain[2] = {
+  { 256, 0.9 },
+  { 65536, 0.1 }
+};
+
+
+/* clear_refs_accepted -- does the kernel accept a soft-dirty clear? */
+
+static mps_bool_t clear_refs_accepted(void)
+{
+  FILE *stream = fopen("/proc/self/clear_refs", "w");
+  mps_bool_t accepted;
+
+  if (stream == NULL)
+    return FALSE;
+  accepted = fputs("4", stream) != EOF;
+  if (fclose(stream) == EOF)
+    accepted = FALSE;
+  return accepted;
+}
+
+
+/* check -- check that every young object has survived intact
+ *
+ * expected[i * slotCOUNT + j] is the number of the young object last
+ * stored in slot j of old object i, plus one, or zero if none.
+ */
+
+static void check(mps_arena_t arena, mps_pool_t pool, mps_word_t *old,
+                  unsigned long *expected)
+{
+  size_t i, j;
+
+  for (i = 0; i < oldCOUNT; ++i) {
+    for (j = 0; j < slotCOUNT; ++j) {
+      mps_word_t young = DYLAN_VECTOR_SLOT(old[i], j);
+      unsigned long k = expected[i * slotCOUNT + j];
+      if (k == 0) {
+        Insist(young == DYLAN_INT(0));
+      } else {
+        mps_pool_t young_pool;
+        Insist(mps_addr_pool(&young_pool, arena, (mps_addr_t)young));
+        Insist(young_pool == pool);
+        Insist(DYLAN_VECTOR_SLOT(young, 0) == DYLAN_INT(k));
+      }
+    }
+  }
+}
+
+
+/* test -- run the test, returning TRUE in the parent process */
+
+static mps_bool_t test(void)
+{
+  mps_arena_t arena;
+  mps_fmt_t format;
+  mps_chain_t chain;
+  mps_pool_t pool;
+  mps_ap_t ap;
+  mps_root_t root;
+  mps_word_t old[oldCOUNT + 1];
+  unsigned long *expected;
+  mps_word_t collections;
+  unsigned long k;
+  size_t i;
+  pid_t pid;
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SOFT_DIRTY, TRUE);
+    die(mps_arena_create_k(&arena, mps_arena_class_vm(), args),
+        "arena_create");
+  } MPS_ARGS_END(args);
+  printf("soft-dirty page tracking %s\n",
+         ArenaSoftDirty((Arena)arena) ? "active" : "unavailable");
+
+  die(dylan_fmt(&format, arena), "fmt_create");
+  die(mps_chain_create(&chain, arena, NELEMS(testChain), testChain),
+      "chain_create");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    die(mps_pool_create_k(&pool, arena, mps_class_amc(), args),
+        "pool_create");
+  } MPS_ARGS_END(args);
+  die(mps_ap_create_k(&ap, pool, mps_args_none), "ap_create");
+
+  /* The root is scanned while the objects are being made, so it must
+     be initialized first.  The last entry holds the most recent young
+     object. */
+  for (i = 0; i <= oldCOUNT; ++i)
+    old[i] = DYLAN_INT(0);
+  die(mps_root_create_area(&root, arena, mps_rank_exact(), 0,
+                           old, old + oldCOUNT + 1, mps_scan_area, NULL),
+      "root_create");
+
+  expected = malloc(oldCOUNT * slotCOUNT * sizeof expected[0]);
+  Insist(expected != NULL);
+  for (i = 0; i < oldCOUNT * slotCOUNT; ++i)
+    expected[i] = 0;
+
+  /* Promote the old objects out of the nursery, so that references
+     from them to young objects are only found by the write barrier. */
+  for (i = 0; i < oldCOUNT; ++i)
+    die(make_dylan_vector(&old[i], ap, slotCOUNT), "make old");
+  die(mps_arena_collect(arena), "collect");
+  mps_arena_release(arena);
+  collections = mps_collections(arena);
+
+  /* .fork */
+  fflush(stdout); /* so the output isn't duplicated */
+  pid = fork();
+  cdie(pid >= 0, "fork failed");
+
+  for (k = 1; k <= storeCOUNT; ++k) {
+    size_t slot = rnd() % (oldCOUNT * slotCOUNT);
+    die(make_dylan_vector(&old[oldCOUNT], ap, 1), "make young");
+    DYLAN_VECTOR_SLOT(old[oldCOUNT], 0) = DYLAN_INT(k);
+    DYLAN_VECTOR_SLOT(old[slot / slotCOUNT], slot % slotCOUNT)
+      = old[oldCOUNT];
+    expected[slot] = k;
+    if (k % checkFREQ == 0)
+      check(arena, pool, old, expected);
+  }
+
+  collections = mps_collections(arena) - collections;
+  printf("%lu collections\n", (unsigned long)collections);
+  Insist(collections > 0);
+
+  mps_arena_park(arena);
+  check(arena, pool, old, expected);
+
+  if (pid != 0) {
+    /* Parent: wait for child and check that its exit status is zero. */
+    int stat;
+    cdie(pid == waitpid(pid, &stat, 0), "waitpid failed");
+    cdie(WIFEXITED(stat), "child did not exit normally");
+    cdie(WEXITSTATUS(stat) == 0, "child exited with nonzero status");
+  }
+
+  free(expected);
+  mps_root_destroy(root);
+  mps_ap_destroy(ap);
+  mps_pool_destroy(pool);
+  mps_chain_destroy(chain);
+  mps_fmt_destroy(format);
+  mps_arena_destroy(arena);
+  return pid != 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+  testlib_init(argc, argv);
+
+  if (!clear_refs_accepted()) {
+    printf("%s: skipped: /proc/self/clear_refs not available\n", argv[0]);
+    return 0;
+  }
+
+  if (test())
+    printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
+  return 0;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -9,12 +9,27 @@
  * It repeatedly runs over an array of blocks and allocates or frees them
  * with some probability, then frees all the remaining blocks at the end.
  * This test can be iterated.
+ *
+ * The "mvffl" test times each call to mps_alloc, and with the -G
+ * option, another thread keeps running full collections of an AMC
+ * pool in the same arena meanwhile.  Comparing the latencies with and
+ * without the -k option shows the effect of the pool's cache of small
+ * blocks: see <design/pool#.cache>.
+ *
+ * The "mvffm" test gives each thread a segregated allocation cache
+ * that exchanges magazines with the pool's depot: see
+ * <design/pool#.cache.magazine>.
+ *
+ * The -f option makes MVFF find free blocks with two-level segregated
+ * fit instead of address-ordered first fit: see <design/tlsf>.
  */
 
 #include "mps.c"
 
 #include "testlib.h"
 #include "testthr.h"
+#include "fmtdy.h"
+#include "fmtdytst.h"
 
 #ifdef MPS_OS_W3
 #include "getopt.h"
@@ -23,7 +38,7 @@
 #endif
 
 #include <stdio.h> /* fprintf, stderr */
-#include <stdlib.h> /* alloca, exit, EXIT_SUCCESS, EXIT_FAILURE */
+#include <stdlib.h> /* alloca, exit, EXIT_SUCCESS, EXIT_FAILURE, free, malloc */
 #include <time.h> /* CLOCKS_PER_SEC, clock */
 
 #define DJMUST(expr) \
@@ -56,9 +71,59 @@ static mps_bool_t zoned = TRUE;   /* arena allocates using zones */
 static size_t arena_size = 256ul * 1024 * 1024; /* arena size */
 static size_t arena_grain_size = 1; /* arena grain size */
 static double spare = ARENA_SPARE_DEFAULT; /* spare commit fraction */
+static mps_bool_t cache = FALSE;  /* MVFF caches small blocks */
+static mps_bool_t pool_cached = FALSE; /* pool has a cache, so no AP */
+static mps_bool_t pool_sac = FALSE; /* each thread has a magazine SAC */
+static mps_bool_t good_fit = FALSE; /* MVFF uses segregated fit */
+static size_t collect_size = 0;   /* size of root to collect, or zero */
+static volatile int collector_stop;
+
+
+/* Latency histogram for mps_alloc, in cycles.  Each power of two is
+   divided into four buckets.  With more than one thread the counts
+   are approximate, as the updates are not synchronized. */
+
+#define LATENCY_BUCKETS 256
+
+static unsigned long latency[LATENCY_BUCKETS];
+static EventClock latency_max;
+
+static void latency_record(EventClock t)
+{
+  unsigned shift = 0;
+  if (t > latency_max)
+    latency_max = t;
+  while (t >= 8) {
+    t >>= 1;
+    ++shift;
+  }
+  ++latency[shift * 4 + (unsigned)t];
+}
+
+/* latency_bound -- upper bound of the latencies in a bucket */
+
+static double latency_bound(unsigned i)
+{
+  if (i < 4)
+    return (double)(i + 1);
+  return (double)((i % 4) + 5) * (double)((unsigned long)1 << (i / 4 - 1));
+}
+
+static double latency_quantile(unsigned long total, double q)
+{
+  unsigned long sum = 0;
+  unsigned i;
+  for (i = 0; i < LATENCY_BUCKETS; ++i) {
+    sum += latency[i];
+    if ((double)sum >= q * (double)total)
+      return latency_bound(i);
+  }
+  return (double)latency_max;
+}
 
 #define DJRUN(fname, alloc, free) \
-  static unsigned fname##_inner(mps_ap_t ap, unsigned depth, unsigned r) { \
+  static unsigned fname##_inner(mps_ap_t ap, mps_sac_t sac, \
+                                unsigned depth, unsigned r) { \
     struct {void *p; size_t s;} *blocks = alloca(sizeof(blocks[0]) * nblocks); \
     unsigned j, k; \
     \
@@ -85,7 +150,7 @@ static double spare = ARENA_SPARE_DEFAULT; /* spare commit fraction */
       } \
       if (rinter > 0 && depth > 0 && ++r % rinter == 0) { \
         /* putchar('>'); fflush(stdout); */ \
-        r = fname##_inner(ap, depth - 1, r); \
+        r = fname##_inner(ap, sac, depth - 1, r); \
         /* putchar('<'); fflush(stdout); */ \
       } \
     } \
@@ -102,12 +167,17 @@ static double spare = ARENA_SPARE_DEFAULT; /* spare commit fraction */
   static void *fname(void *p) { \
     unsigned i; \
     mps_ap_t ap = NULL; \
-    if (pool != NULL) \
+    mps_sac_t sac = NULL; \
+    if (pool != NULL && !pool_cached) \
       DJMUST(mps_ap_create_k(&ap, pool, mps_args_none)); \
+    if (pool != NULL && pool_sac) \
+      DJMUST(mps_sac_create_magazine(&sac, pool)); \
     for (i = 0; i < niter; ++i) \
-      (void)fname##_inner(ap, rmax, 0); \
+      (void)fname##_inner(ap, sac, rmax, 0); \
     if (ap != NULL) \
       mps_ap_destroy(ap); \
+    if (sac != NULL) \
+      mps_sac_destroy(sac); \
     return p; \
   }
 
@@ -128,6 +198,33 @@ DJRUN(dj_malloc, MALLOC_ALLOC, MALLOC_FREE)
 DJRUN(dj_alloc, MPS_ALLOC, MPS_FREE)
 
 
+/* timed mps_alloc/mps_free benchmark */
+
+#define TIMED_ALLOC(p, s) \
+  do { \
+    EventClock _t0, _t1; \
+    EVENT_CLOCK(_t0); \
+    mps_alloc(&p, pool, s); \
+    EVENT_CLOCK(_t1); \
+    latency_record(_t1 - _t0); \
+  } while(0)
+
+DJRUN(dj_alloc_timed, TIMED_ALLOC, MPS_FREE)
+
+
+/* magazine SAC benchmark */
+
+#define SAC_ALLOC(p, s) \
+  do { \
+    mps_res_t _res; \
+    MPS_SAC_ALLOC_FAST(_res, p, sac, s, FALSE); \
+    (void)_res; \
+  } while(0)
+#define SAC_FREE(p, s)  MPS_SAC_FREE_FAST(sac, p, s)
+
+DJRUN(dj_sac, SAC_ALLOC, SAC_FREE)
+
+
 /* reserve/free benchmark */
 
 #define ALIGN_UP(s, a) (((s) + ((a) - 1)) & ~((a) - 1))
@@ -159,6 +256,12 @@ static void weave(dj_t dj)
 static void watch(dj_t dj, const char *name)
 {
   clock_t start, finish;
+  unsigned long total = 0;
+  unsigned i;
+
+  for (i = 0; i < LATENCY_BUCKETS; ++i)
+    latency[i] = 0;
+  latency_max = 0;
 
   start = clock();
   if (nthreads == 1)
@@ -168,6 +271,73 @@ static void watch(dj_t dj, const char *name)
   finish = clock();
 
   printf("%s: %g\n", name, (double)(finish - start) / CLOCKS_PER_SEC);
+
+  for (i = 0; i < LATENCY_BUCKETS; ++i)
+    total += latency[i];
+  if (total > 0)
+    printf("%s alloc cycles: p50 %g p99 %g p99.9 %g max %g (%lu allocs)\n",
+           name, latency_quantile(total, 0.5),
+           latency_quantile(total, 0.99), latency_quantile(total, 0.999),
+           (double)latency_max, total);
+}
+
+
+/* collector -- keep running full collections of a live AMC heap
+ *
+ * Each collection holds the arena lock from start to finish, so
+ * this stalls any thread that needs the arena lock meanwhile.
+ */
+
+static void *collector(void *p)
+{
+  void *marker = &marker;
+  mps_thr_t thread;
+  mps_root_t reg_root, root;
+  mps_fmt_t format;
+  mps_pool_t amc;
+  mps_ap_t ap;
+  mps_word_t *refs;
+  size_t i, nrefs = collect_size / sizeof(mps_word_t);
+  unsigned long collections = 0;
+
+  DJMUST(mps_thread_reg(&thread, arena));
+  DJMUST(mps_root_create_thread(&reg_root, arena, thread, marker));
+  DJMUST(dylan_fmt(&format, arena));
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    DJMUST(mps_pool_create_k(&amc, arena, mps_class_amc(), args));
+  } MPS_ARGS_END(args);
+  DJMUST(mps_ap_create_k(&ap, amc, mps_args_none));
+
+  refs = malloc(nrefs * sizeof refs[0]);
+  if (refs == NULL) {
+    fprintf(stderr, "Couldn't allocate root\n");
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0; i < nrefs; ++i)
+    refs[i] = DYLAN_INT(0);
+  DJMUST(mps_root_create_area(&root, arena, mps_rank_exact(), 0,
+                              refs, refs + nrefs, mps_scan_area, NULL));
+  for (i = 0; i < nrefs; ++i)
+    DJMUST(make_dylan_vector(&refs[i], ap, 2));
+
+  while (!collector_stop) {
+    DJMUST(mps_arena_collect(arena));
+    mps_arena_release(arena);
+    ++collections;
+  }
+  printf("collector: %lu collections of %lu objects\n",
+         collections, (unsigned long)nrefs);
+
+  mps_arena_park(arena);
+  mps_root_destroy(root);
+  free(refs);
+  mps_ap_destroy(ap);
+  mps_pool_destroy(amc);
+  mps_fmt_destroy(format);
+  mps_root_destroy(reg_root);
+  mps_thread_dereg(thread);
+  return p;
 }
 
 
@@ -192,8 +362,27 @@ static void arena_wrap(dj_t dj, mps_pool_class_t pool_class, const char *name)
     MPS_ARGS_ADD(args, MPS_KEY_SPARE, spare);
     DJMUST(mps_arena_create_k(&arena, mps_arena_class_vm(), args));
   } MPS_ARGS_END(args);
-  DJMUST(mps_pool_create_k(&pool, arena, pool_class, mps_args_none));
-  watch(dj, name);
+  /* <design/pool#.cache.buffer> */
+  pool_sac = dj == dj_sac;
+  pool_cached = (cache && dj != dj_reserve) || pool_sac;
+  MPS_ARGS_BEGIN(args) {
+    if (pool_cached)
+      MPS_ARGS_ADD(args, MPS_KEY_MVFF_CACHE, TRUE);
+    if (good_fit && pool_class == mps_class_mvff())
+      MPS_ARGS_ADD(args, MPS_KEY_MVFF_GOOD_FIT, TRUE);
+    DJMUST(mps_pool_create_k(&pool, arena, pool_class, args));
+  } MPS_ARGS_END(args);
+  if (collect_size > 0) {
+    testthr_t collector_thread;
+    DJMUST(dylan_make_wrappers());
+    collector_stop = FALSE;
+    testthr_create(&collector_thread, collector, NULL);
+    watch(dj, name);
+    collector_stop = TRUE;
+    testthr_join(&collector_thread, NULL);
+  } else {
+    watch(dj, name);
+  }
   mps_pool_destroy(pool);
   mps_arena_destroy(arena);
 }
@@ -216,6 +405,9 @@ static struct option longopts[] = {
   {"arena-grain-size", required_argument, NULL, 'a'},
   {"arena-unzoned",    no_argument,       NULL, 'z'},
   {"spare",            required_argument, NULL, 'S'},
+  {"cache",            no_argument,       NULL, 'k'},
+  {"collect",          required_argument, NULL, 'G'},
+  {"good-fit",         no_argument,       NULL, 'f'},
   {NULL,               0,                 NULL, 0  }
 };
 
@@ -236,6 +428,8 @@ static struct {
   {"mvt",   arena_wrap, dj_reserve, mps_class_mvt},
   {"mvff",  arena_wrap, dj_reserve, mps_class_mvff},
   {"mvffa", arena_wrap, dj_alloc,   mps_class_mvff}, /* mvff with alloc */
+  {"mvffl", arena_wrap, dj_alloc_timed, mps_class_mvff}, /* timed alloc */
+  {"mvffm", arena_wrap, dj_sac,     mps_class_mvff}, /* magazine SACs */
   {"an",    wrap,       dj_malloc,  dummy_class},
 };
 
@@ -250,7 +444,7 @@ int main(int argc, char *argv[])
 
   seed = rnd_seed();
 
-  while ((ch = getopt_long(argc, argv, "ht:i:p:b:s:c:r:d:m:a:x:zS:",
+  while ((ch = getopt_long(argc, argv, "ht:i:p:b:s:c:r:d:m:a:x:zS:kG:f",
                            longopts, NULL)) != -1)
     switch (ch) {
     case 't':
@@ -315,6 +509,26 @@ int main(int argc, char *argv[])
     case 'S':
       spare = strtod(optarg, NULL);
       break;
+    case 'k':
+      cache = TRUE;
+      break;
+    case 'f':
+      good_fit = TRUE;
+      break;
+    case 'G': {
+        char *p;
+        collect_size = (size_t)strtoul(optarg, &p, 10);
+        switch(toupper(*p)) {
+        case 'G': collect_size <<= 30; break;
+        case 'M': collect_size <<= 20; break;
+        case 'K': collect_size <<= 10; break;
+        case '\0': break;
+        default:
+          fprintf(stderr, "Bad collect size %s\n", optarg);
+          return EXIT_FAILURE;
+        }
+      }
+      break;
     default:
       /* This is printed in parts to keep within the 509 character
          limit for string literals in portable standard C. */
@@ -359,11 +573,20 @@ int main(int argc, char *argv[])
               rinter,
               rmax,
               spare);
+      fprintf(stderr,
+              "  -k, --cache\n"
+              "    MVFF caches small blocks (alloc interface only)\n"
+              "  -G n, --collect=n[KMG]\n"
+              "    Collect a root of size n in another thread\n"
+              "  -f, --good-fit\n"
+              "    MVFF uses two-level segregated fit\n");
       fprintf(stderr,
               "Tests:\n"
               "  mvt   pool class MVT\n"
               "  mvff  pool class MVFF (buffer interface)\n"
               "  mvffa pool class MVFF (alloc interface)\n"
+              "  mvffl pool class MVFF (alloc interface, timed)\n"
+              "  mvffm pool class MVFF (per-thread magazine SACs)\n"
               "  an    malloc\n");
       return EXIT_FAILURE;
     }
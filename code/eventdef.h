@@ -36,7 +36,7 @@
  */
 
 #define EVENT_VERSION_MAJOR  ((unsigned)2)
-#define EVENT_VERSION_MEDIAN ((unsigned)0)
+#define EVENT_VERSION_MEDIAN ((unsigned)1)
 #define EVENT_VERSION_MINOR  ((unsigned)0)
 
 
@@ -554,7 +554,8 @@
   PARAM(X,  0, P, arena, "trace's arena") \
   PARAM(X,  1, P, trace, "the trace") \
   PARAM(X,  2, P, seg, "grey segment found") \
-  PARAM(X,  3, W, rank, "current rank")
+  PARAM(X,  3, W, rank, "current rank") \
+  PARAM(X,  4, W, greySegCount, "grey segments remaining for trace")
 
 #define EVENT_TraceFix_PARAMS(PARAM, X) \
   PARAM(X,  0, P, ss, "the scan state") \
@@ -0,0 +1,298 @@
+/* fixbench.c -- fix throughput benchmark
+ *
+ * $Id$
+ * Copyright (c) 2020 Ravenbrook Limited.  See end of file for license.
+ *
+ * This benchmark measures the cost of fixing references during a
+ * collection, in a client arena made up of many chunks.  It makes a
+ * large exact root in which every word is a reference to one of a
+ * smaller number of objects spread across the chunks, so that nearly
+ * all the work of a full collection is done by _mps_fix2 looking up
+ * references that have already been fixed.  See
+ * <design/trace#.fix.chunkmap>.
+ */
+
+#include "mps.c"
+#include "testlib.h"
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "mpm.h"
+
+#ifdef MPS_OS_W3
+#include "getopt.h"
+#else
+#include <getopt.h>
+#endif
+
+#include <stdio.h> /* fflush, fprintf, printf, stderr, stdout */
+#include <stdlib.h> /* exit, EXIT_FAILURE, EXIT_SUCCESS, free, malloc */
+#include <time.h> /* clock, CLOCKS_PER_SEC */
+
+#define RESMUST(expr) \
+  do { \
+    mps_res_t res = (expr); \
+    if (res != MPS_RES_OK) { \
+      fprintf(stderr, #expr " returned %d\n", res); \
+      exit(EXIT_FAILURE); \
+    } \
+  } while(0)
+
+static rnd_state_t seed = 0;      /* random number seed */
+static unsigned nchunks = 32;     /* chunks in arena */
+static size_t chunk_size = 4ul * 1024 * 1024; /* size of each chunk */
+static size_t nrefs = 1ul << 20;  /* references in root */
+static size_t nobjects = 4096;    /* objects referred to by root */
+static unsigned ncollect = 10;    /* full collections to time */
+
+
+/* fix_refs -- time full collections of a heap referenced from a root */
+
+static void fix_refs(mps_pool_class_t pool_class, const char *name)
+{
+  mps_arena_t arena;
+  mps_fmt_t format;
+  mps_pool_t pool;
+  mps_ap_t ap;
+  mps_root_t root;
+  mps_word_t *refs;
+  void **blocks;
+  size_t slots, i;
+  unsigned k;
+  clock_t begin, collect_time = 0;
+  double seconds;
+
+  blocks = malloc(nchunks * sizeof blocks[0]);
+  if (blocks == NULL) {
+    fprintf(stderr, "Couldn't allocate chunk table\n");
+    exit(EXIT_FAILURE);
+  }
+  for (k = 0; k < nchunks; ++k) {
+    blocks[k] = malloc(chunk_size);
+    if (blocks[k] == NULL) {
+      fprintf(stderr, "Couldn't allocate chunk %u\n", k);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, chunk_size);
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_CL_BASE, blocks[0]);
+    RESMUST(mps_arena_create_k(&arena, mps_arena_class_cl(), args));
+  } MPS_ARGS_END(args);
+  for (k = 1; k < nchunks; ++k)
+    RESMUST(mps_arena_extend(arena, blocks[k], chunk_size));
+
+  RESMUST(dylan_fmt(&format, arena));
+  RESMUST(dylan_make_wrappers());
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    RESMUST(mps_pool_create_k(&pool, arena, pool_class, args));
+  } MPS_ARGS_END(args);
+  RESMUST(mps_ap_create_k(&ap, pool, mps_args_none));
+
+  /* The root is scanned while the objects are being made, so it must
+     be initialized first. Tagged integers are ignored by the fix. */
+  refs = malloc(nrefs * sizeof refs[0]);
+  if (refs == NULL) {
+    fprintf(stderr, "Couldn't allocate root\n");
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0; i < nrefs; ++i)
+    refs[i] = DYLAN_INT(0);
+  RESMUST(mps_root_create_area(&root, arena, mps_rank_exact(), 0,
+                               refs, refs + nrefs, mps_scan_area, NULL));
+
+  /* Make the objects big enough that together they occupy about a
+     quarter of the arena, leaving room for them to be copied. */
+  slots = chunk_size / 4 * nchunks / nobjects / sizeof(mps_word_t);
+  slots = slots > 2 ? slots - 2 : 1;
+  for (i = 0; i < nobjects && i < nrefs; ++i)
+    RESMUST(make_dylan_vector(&refs[i], ap, slots));
+  for (; i < nrefs; ++i)
+    refs[i] = refs[rnd() % nobjects];
+
+  for (k = 0; k < ncollect; ++k) {
+    begin = clock();
+    RESMUST(mps_arena_collect(arena));
+    mps_arena_release(arena);
+    collect_time += clock() - begin;
+  }
+
+  seconds = (double)collect_time / CLOCKS_PER_SEC;
+  printf("%s: %g (%u collections of %lu references in %u chunks)\n",
+         name, seconds, ncollect, (unsigned long)nrefs, nchunks);
+  if (ncollect > 0)
+    printf("%s fix: %g ns per reference\n", name,
+           seconds * 1e9 / ncollect / (double)nrefs);
+
+  mps_arena_park(arena);
+  mps_root_destroy(root);
+  mps_ap_destroy(ap);
+  mps_pool_destroy(pool);
+  mps_fmt_destroy(format);
+  mps_arena_destroy(arena);
+  free(refs);
+  for (k = 0; k < nchunks; ++k)
+    free(blocks[k]);
+  free(blocks);
+}
+
+
+/* Command-line options definitions.  See getopt_long(3). */
+
+static struct option longopts[] = {
+  {"help",             no_argument,       NULL, 'h'},
+  {"nchunks",          required_argument, NULL, 'k'},
+  {"chunk-size",       required_argument, NULL, 's'},
+  {"nrefs",            required_argument, NULL, 'n'},
+  {"nobjects",         required_argument, NULL, 'o'},
+  {"ncollect",         required_argument, NULL, 'c'},
+  {"seed",             required_argument, NULL, 'x'},
+  {NULL,               0,                 NULL, 0  }
+};
+
+
+static struct {
+  const char *name;
+  mps_pool_class_t (*pool_class)(void);
+} pools[] = {
+  {"amc", mps_class_amc},
+  {"ams", mps_class_ams},
+  {"awl", mps_class_awl},
+};
+
+
+/* Command-line driver */
+
+int main(int argc, char *argv[])
+{
+  int ch;
+  unsigned i;
+  mps_bool_t seed_specified = FALSE;
+
+  seed = rnd_seed();
+
+  while ((ch = getopt_long(argc, argv, "hk:s:n:o:c:x:",
+                           longopts, NULL)) != -1)
+    switch (ch) {
+    case 'k':
+      nchunks = (unsigned)strtoul(optarg, NULL, 10);
+      break;
+    case 's': {
+        char *p;
+        chunk_size = (size_t)strtoul(optarg, &p, 10);
+        switch(toupper(*p)) {
+        case 'G': chunk_size <<= 30; break;
+        case 'M': chunk_size <<= 20; break;
+        case 'K': chunk_size <<= 10; break;
+        case '\0': break;
+        default:
+          fprintf(stderr, "Bad chunk size %s\n", optarg);
+          return EXIT_FAILURE;
+        }
+      }
+      break;
+    case 'n':
+      nrefs = (size_t)strtoul(optarg, NULL, 10);
+      break;
+    case 'o':
+      nobjects = (size_t)strtoul(optarg, NULL, 10);
+      break;
+    case 'c':
+      ncollect = (unsigned)strtoul(optarg, NULL, 10);
+      break;
+    case 'x':
+      seed = strtoul(optarg, NULL, 10);
+      seed_specified = TRUE;
+      break;
+    default:
+      /* This is printed in parts to keep within the 509 character
+         limit for string literals in portable standard C. */
+      fprintf(stderr,
+              "Usage: %s [option...] [test...]\n"
+              "Options:\n"
+              "  -k n, --nchunks=n\n"
+              "    Number of chunks in the arena (default %u)\n"
+              "  -s n, --chunk-size=n[KMG]?\n"
+              "    Size of each chunk (default %lu)\n"
+              "  -n n, --nrefs=n\n"
+              "    Number of references in the root (default %lu)\n"
+              "  -o n, --nobjects=n\n"
+              "    Number of objects they refer to (default %lu)\n",
+              argv[0],
+              nchunks,
+              (unsigned long)chunk_size,
+              (unsigned long)nrefs,
+              (unsigned long)nobjects);
+      fprintf(stderr,
+              "  -c n, --ncollect=n\n"
+              "    Time n full collections (default %u)\n"
+              "  -x n, --seed=n\n"
+              "    Random number seed (default from entropy)\n"
+              "Tests:\n"
+              "  amc   pool class AMC\n"
+              "  ams   pool class AMS\n"
+              "  awl   pool class AWL\n",
+              ncollect);
+      return EXIT_FAILURE;
+    }
+  argc -= optind;
+  argv += optind;
+
+  if (nchunks == 0 || nobjects == 0 || nrefs < nobjects) {
+    fprintf(stderr, "Need at least one chunk, one object, "
+            "and a reference to each object\n");
+    return EXIT_FAILURE;
+  }
+
+  if (!seed_specified) {
+    printf("seed: %lu\n", seed);
+    (void)fflush(stdout);
+  }
+
+  while (argc > 0) {
+    for (i = 0; i < NELEMS(pools); ++i)
+      if (strcmp(argv[0], pools[i].name) == 0)
+        goto found;
+    fprintf(stderr, "unknown pool test \"%s\"\n", argv[0]);
+    return EXIT_FAILURE;
+  found:
+    (void)mps_lib_assert_fail_install(assert_die);
+    rnd_state_set(seed);
+    fix_refs(pools[i].pool_class(), pools[i].name);
+    --argc;
+    ++argv;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
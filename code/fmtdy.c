@@ -223,8 +223,9 @@ static mps_res_t dylan_scan_contig(mps_ss_t mps_ss,
           r = *p++;
           if(((mps_word_t)r&3) != 0) /* pointers tagged with 0 */
             goto loop;             /* not a pointer */
-          if(!MPS_FIX1(mps_ss, r)) goto loop;
-          res = MPS_FIX2(mps_ss, p-1);
+          /* Defer the fix so that the MPS can prefetch for several */
+          /* references at once.  We never look at *(p-1) again. */
+          res = MPS_FIX_DEFER(mps_ss, p-1);
           if(res == MPS_RES_OK) goto loop;
           return res;
     out:  assert(p == limit);
@@ -150,6 +150,14 @@ mps_res_t make_dylan_vector(mps_word_t *v, mps_ap_t ap, size_t slots)
 
 
 void dylan_write(mps_addr_t addr, mps_addr_t *refs, size_t nr_refs)
+{
+  dylan_write_wb(NULL, addr, refs, nr_refs);
+}
+
+/*  As dylan_write, but if wb is not NULL, store using the software
+    write barrier. */
+void dylan_write_wb(mps_wb_t wb, mps_addr_t addr,
+                    mps_addr_t *refs, size_t nr_refs)
 {
   mps_word_t *p = (mps_word_t *)addr;
   mps_word_t t = p[1] >> 2;
@@ -158,11 +166,16 @@ void dylan_write(mps_addr_t addr, mps_addr_t *refs, size_t nr_refs)
   if(p[0] == (mps_word_t)tvw && t > 0) {
     mps_word_t r = rnd();
     size_t i = 2 + (rnd() % t);
+    mps_word_t value;
 
     if(r & 1)
-      p[i] = ((r & ~(mps_word_t)3) | 1); /* random int */
+      value = ((r & ~(mps_word_t)3) | 1); /* random int */
+    else
+      value = (mps_word_t)refs[(r >> 1) % nr_refs]; /* random ptr */
+    if (wb == NULL)
+      p[i] = value;
     else
-      p[i] = (mps_word_t)refs[(r >> 1) % nr_refs]; /* random ptr */
+      MPS_WRITE_BARRIER(wb, (mps_addr_t *)&p[i], (mps_addr_t)value);
   }
 }
 
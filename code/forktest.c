@@ -7,6 +7,11 @@
  * checks that the MPS correctly runs in the child process after a
  * fork() on FreeBSD, Linux or macOS.
  *
+ * .freeze: After the fork, both processes freeze the heap, and then
+ * insert new objects into the list so that the new objects are only
+ * reachable from frozen objects. Collections must find them via the
+ * write barrier on the frozen segments.
+ *
  * .format: This test case uses a trivial object format in which each
  * object contains a single reference.
  */
@@ -100,7 +105,7 @@ int main(int argc, char *argv[])
   mps_thr_t thread;
   mps_root_t stack_root;
   mps_ap_t obj_ap;
-  size_t i;
+  size_t i, count;
   obj_t obj, first;
 
   testlib_init(argc, argv);
@@ -169,6 +174,40 @@ int main(int argc, char *argv[])
 
   mps_arena_park(arena);
 
+  /* .freeze: Collect, so that the segments have accurate summaries
+     and can be clean, then insert a new object after every tenth
+     frozen object. The freeze empties obj_ap, so the new objects
+     are not allocated in a frozen segment. */
+  die(mps_arena_collect(arena), "mps_arena_collect");
+  mps_arena_freeze(arena);
+  for (obj = first, i = 0; obj != NULL; obj = obj->u.ref, ++i) {
+    if (i % 10 == 0) {
+      size_t size = sizeof(obj_s);
+      mps_addr_t addr;
+      obj_t new;
+      do {
+        die(mps_reserve(&addr, obj_ap, size), "Couldn't allocate.");
+        new = addr;
+        new->type = TYPE_REF;
+        new->u.ref = NULL;
+      } while (!mps_commit(obj_ap, addr, size));
+      new->u.ref = obj->u.ref;
+      obj->u.ref = new;
+      obj = new;
+    }
+  }
+  die(mps_arena_collect(arena), "mps_arena_collect");
+
+  count = 0;
+  for (obj = first; obj != NULL; obj = obj->u.ref) {
+    mps_pool_t obj_pool;
+    Insist(mps_addr_pool(&obj_pool, arena, obj));
+    Insist(obj_pool == pool);
+    Insist(obj->type == TYPE_REF);
+    ++count;
+  }
+  Insist(count == 110000);
+
   if (pid != 0) {
     /* Parent: wait for child and check that its exit status is zero. */
     int stat;
@@ -203,6 +203,8 @@ Arena FormatArena(Format format)
 
 Res FormatScan(Format format, ScanState ss, Addr base, Addr limit)
 {
+  Res res;
+
   /* TODO: How critical are these? */
   AVERT_CRITICAL(Format, format);
   AVERT_CRITICAL(ScanState, ss);
@@ -212,12 +214,17 @@ Res FormatScan(Format format, ScanState ss, Addr base, Addr limit)
 
   /* TODO: EVENT here? */
 
-  /* scannedSize is accumulated whether or not format->scan succeeds,
-     so it's safe to accumulate now so that we can tail-call
-     format->scan. */
   ss->scannedSize += AddrOffset(base, limit);
 
-  return format->scan(&ss->ss_s, base, limit);
+  res = format->scan(&ss->ss_s, base, limit);
+  if (res != ResOK) {
+    ScanStateDiscard(ss);
+    return res;
+  }
+
+  /* Fix any references that the scanner deferred with MPS_FIX_DEFER.
+     <design/trace#.fix.defer.flush> */
+  return ScanStateFlush(ss);
 }
 
 
@@ -19,7 +19,7 @@
 #include <getopt.h>
 #endif
 
-#include <stdio.h> /* fprintf, printf, putchars, sscanf, stderr, stdout */
+#include <stdio.h> /* fprintf, printf, putchars, sprintf, sscanf, stderr, stdout */
 #include <stdlib.h> /* alloca, exit, EXIT_FAILURE, EXIT_SUCCESS, strtoul */
 #include <time.h> /* clock, CLOCKS_PER_SEC */
 
@@ -55,8 +55,17 @@ static size_t arena_size = 256ul * 1024 * 1024; /* arena size */
 static size_t arena_grain_size = 1; /* arena grain size */
 static unsigned pinleaf = FALSE;  /* are leaf objects pinned at start */
 static mps_bool_t zoned = TRUE;   /* arena allocates using zones */
+static mps_bool_t huge_pages = FALSE; /* arena uses huge pages */
+static mps_bool_t spare_discard = FALSE; /* arena discards spare pages */
+static mps_bool_t prefault = FALSE; /* arena faults pages in */
+static size_t commit_ahead = 0;   /* spare memory to keep ready */
 static double pause_time = ARENA_DEFAULT_PAUSE_TIME; /* maximum pause time */
 static double spare = ARENA_SPARE_DEFAULT; /* spare commit fraction */
+static unsigned ncollect = 0;     /* full collections per iteration */
+static unsigned old_depth = 0;    /* depth of long-lived tree */
+static mps_bool_t background = FALSE; /* collect on a separate thread */
+static mps_bool_t scale = FALSE;  /* run with 1, 2, 4, ... nthreads threads */
+static volatile int collector_stop;
 
 typedef struct gcthread_s *gcthread_t;
 
@@ -68,14 +77,36 @@ struct gcthread_s {
     mps_root_t reg_root;
     mps_ap_t ap;
     gcthread_fn_t fn;
+    clock_t collect_time;  /* time spent in full collections */
+    unsigned collections;  /* number of full collections */
+    clock_t max_pause;     /* longest allocation that reached the MPS */
+    unsigned long fills;   /* allocations that reached the MPS */
 };
 
 typedef mps_word_t obj_t;
 
-static obj_t mkvector(mps_ap_t ap, size_t n)
+/* mkvector -- allocate a vector, timing it if it may reach the MPS
+ *
+ * An allocation that doesn't fit in the allocation point's buffer
+ * (or finds the buffer trapped) goes to the MPS, which may do a unit
+ * of collection work, so this is where the mutator pauses. Timing
+ * only these keeps the cost of clock() off the fast path.
+ */
+static obj_t mkvector(gcthread_t thread, size_t n)
 {
+  mps_ap_t ap = thread->ap;
+  size_t size = (n + 2) * sizeof(mps_word_t);
   mps_word_t v;
-  RESMUST(make_dylan_vector(&v, ap, n));
+  if (ap->limit == NULL || (size_t)((char *)ap->limit - (char *)ap->init) < size) {
+    clock_t begin = clock(), pause;
+    RESMUST(make_dylan_vector(&v, ap, n));
+    pause = clock() - begin;
+    if (pause > thread->max_pause)
+      thread->max_pause = pause;
+    ++thread->fills;
+  } else {
+    RESMUST(make_dylan_vector(&v, ap, n));
+  }
   return v;
 }
 
@@ -90,15 +121,15 @@ static void aset(obj_t v, size_t i, obj_t val)
 }
 
 /* mktree - make a tree of nodes with depth d. */
-static obj_t mktree(mps_ap_t ap, unsigned d, obj_t leaf)
+static obj_t mktree(gcthread_t thread, unsigned d, obj_t leaf)
 {
   obj_t tree;
   size_t i;
   if (d <= 0)
     return leaf;
-  tree = mkvector(ap, width);
+  tree = mkvector(thread, width);
   for (i = 0; i < width; ++i) {
-    aset(tree, i, mktree(ap, d - 1, leaf));
+    aset(tree, i, mktree(thread, d - 1, leaf));
   }
   return tree;
 }
@@ -120,7 +151,7 @@ static obj_t random_subtree(obj_t tree, unsigned levels)
  * NOTE: Changing preuse will dramatically change how much work
  * is done.  In particular, if preuse==1, the old tree is returned
  * unchanged. */
-static obj_t new_tree(mps_ap_t ap, obj_t oldtree, unsigned d)
+static obj_t new_tree(gcthread_t thread, obj_t oldtree, unsigned d)
 {
   obj_t subtree;
   size_t i;
@@ -129,9 +160,9 @@ static obj_t new_tree(mps_ap_t ap, obj_t oldtree, unsigned d)
   } else {
     if (d == 0)
       return objNULL;
-    subtree = mkvector(ap, width);
+    subtree = mkvector(thread, width);
     for (i = 0; i < width; ++i) {
-      aset(subtree, i, new_tree(ap, oldtree, d - 1));
+      aset(subtree, i, new_tree(thread, oldtree, d - 1));
     }
   }
   return subtree;
@@ -140,22 +171,22 @@ static obj_t new_tree(mps_ap_t ap, obj_t oldtree, unsigned d)
 /* Update tree to be identical tree but with nodes reallocated
  * with probability pupdate.  This avoids writing to vector slots
  * if unecessary. */
-static obj_t update_tree(mps_ap_t ap, obj_t oldtree, unsigned d)
+static obj_t update_tree(gcthread_t thread, obj_t oldtree, unsigned d)
 {
   obj_t tree;
   size_t i;
   if (oldtree == objNULL || d == 0)
     return oldtree;
   if (rnd_double() < pupdate) {
-    tree = mkvector(ap, width);
+    tree = mkvector(thread, width);
     for (i = 0; i < width; ++i) {
-      aset(tree, i, update_tree(ap, aref(oldtree, i), d - 1));
+      aset(tree, i, update_tree(thread, aref(oldtree, i), d - 1));
     }
   } else {
     tree = oldtree;
     for (i = 0; i < width; ++i) {
       obj_t oldsubtree = aref(oldtree, i);
-      obj_t subtree = update_tree(ap, oldsubtree, d - 1);
+      obj_t subtree = update_tree(thread, oldsubtree, d - 1);
       if (subtree != oldsubtree) {
         aset(tree, i, subtree);
       }
@@ -164,20 +195,45 @@ static obj_t update_tree(mps_ap_t ap, obj_t oldtree, unsigned d)
   return tree;
 }
 
+/* collect -- time full collections while the tree is still alive
+ *
+ * This measures the cost of tracing the whole of the live heap, as
+ * opposed to the incremental collections interleaved with the
+ * allocation in gc_tree. The tree is stored in a volatile local so
+ * that it stays visible to the ambiguous stack scan.
+ */
+static void collect(gcthread_t thread, obj_t tree)
+{
+  volatile obj_t live = tree;
+  unsigned i;
+  for (i = 0; i < ncollect; ++i) {
+    clock_t begin = clock();
+    RESMUST(mps_arena_collect(arena));
+    mps_arena_release(arena);
+    thread->collect_time += clock() - begin;
+    ++thread->collections;
+  }
+  UNUSED(live);
+}
+
 static void *gc_tree(gcthread_t thread)
 {
   unsigned i, j;
-  mps_ap_t ap = thread->ap;
-  obj_t leaf = pinleaf ? mktree(ap, 1, objNULL) : objNULL;
+  obj_t leaf = pinleaf ? mktree(thread, 1, objNULL) : objNULL;
+  /* A long-lived tree, kept alive on the stack for the whole run, so
+     that it gets promoted and older generations have work to do. */
+  volatile obj_t old = mktree(thread, old_depth, objNULL);
   for (i = 0; i < niter; ++i) {
-    obj_t tree = mktree(ap, depth, leaf);
+    obj_t tree = mktree(thread, depth, leaf);
     for (j = 0 ; j < npass; ++j) {
       if (preuse < 1.0)
-        tree = new_tree(ap, tree, depth);
+        tree = new_tree(thread, tree, depth);
       if (pupdate > 0.0)
-        tree = update_tree(ap, tree, depth);
+        tree = update_tree(thread, tree, depth);
     }
+    collect(thread, tree);
   }
+  UNUSED(old);
   return NULL;
 }
 
@@ -186,6 +242,10 @@ static void *start(void *p)
 {
   gcthread_t thread = p;
   void *marker;
+  thread->collect_time = 0;
+  thread->collections = 0;
+  thread->max_pause = 0;
+  thread->fills = 0;
   RESMUST(mps_thread_reg(&thread->mps_thread, arena));
   RESMUST(mps_root_create_thread(&thread->reg_root, arena,
                                  thread->mps_thread, &marker));
@@ -197,7 +257,9 @@ static void *start(void *p)
   return NULL;
 }
 
-static void weave(gcthread_fn_t fn)
+static void weave(gcthread_fn_t fn, clock_t *collect_time_o,
+                  unsigned *collections_o, clock_t *max_pause_o,
+                  unsigned long *fills_o)
 {
   gcthread_t threads = alloca(sizeof(threads[0]) * nthreads);
   unsigned t;
@@ -208,31 +270,78 @@ static void weave(gcthread_fn_t fn)
     testthr_create(&thread->thread, start, thread);
   }
 
-  for (t = 0; t < nthreads; ++t)
+  for (t = 0; t < nthreads; ++t) {
     testthr_join(&threads[t].thread, NULL);
+    *collect_time_o += threads[t].collect_time;
+    *collections_o += threads[t].collections;
+    if (threads[t].max_pause > *max_pause_o)
+      *max_pause_o = threads[t].max_pause;
+    *fills_o += threads[t].fills;
+  }
 }
 
-static void weave1(gcthread_fn_t fn)
+static void weave1(gcthread_fn_t fn, clock_t *collect_time_o,
+                   unsigned *collections_o, clock_t *max_pause_o,
+                   unsigned long *fills_o)
 {
   gcthread_t thread = alloca(sizeof(thread[0]));
 
   thread->fn = fn;
   start(thread);
+  *collect_time_o += thread->collect_time;
+  *collections_o += thread->collections;
+  if (thread->max_pause > *max_pause_o)
+    *max_pause_o = thread->max_pause;
+  *fills_o += thread->fills;
 }
 
 
+/* collector -- do the incremental work in background mode
+ *
+ * See <design/strategy#.policy.background>.
+ */
+static void *collector(void *p)
+{
+  UNUSED(p);
+  while (!collector_stop) {
+    if (!mps_arena_step(arena, pause_time, 0.0))
+      testthr_yield();
+  }
+  return NULL;
+}
+
 static void watch(gcthread_fn_t fn, const char *name)
 {
-  clock_t begin, end;
+  clock_t begin, end, collect_time = 0, max_pause = 0;
+  unsigned collections = 0;
+  unsigned long fills = 0;
+  testthr_t collector_thread;
 
   begin = clock();
+  if (background) {
+    mps_arena_background_set(arena, TRUE);
+    collector_stop = FALSE;
+    testthr_create(&collector_thread, collector, NULL);
+  }
   if (nthreads == 1)
-    weave1(fn);
+    weave1(fn, &collect_time, &collections, &max_pause, &fills);
   else
-    weave(fn);
+    weave(fn, &collect_time, &collections, &max_pause, &fills);
+  if (background) {
+    collector_stop = TRUE;
+    testthr_join(&collector_thread, NULL);
+    mps_arena_background_set(arena, FALSE);
+  }
   end = clock();
 
   printf("%s: %g\n", name, (double)(end - begin) / CLOCKS_PER_SEC);
+  printf("%s max pause: %g\n", name, (double)max_pause / CLOCKS_PER_SEC);
+  if (nthreads > 0)
+    printf("%s fills: %lu (%lu per thread)\n", name, fills, fills / nthreads);
+  if (collections > 0)
+    printf("%s collect: %g (%u collections, mean %g)\n", name,
+           (double)collect_time / CLOCKS_PER_SEC, collections,
+           (double)collect_time / CLOCKS_PER_SEC / collections);
 }
 
 
@@ -246,6 +355,10 @@ static void arena_setup(gcthread_fn_t fn,
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, arena_size);
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_GRAIN_SIZE, arena_grain_size);
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_ZONED, zoned);
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_HUGE_PAGES, huge_pages);
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SPARE_DISCARD, spare_discard);
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_PREFAULT, prefault);
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_COMMIT_AHEAD, commit_ahead);
     MPS_ARGS_ADD(args, MPS_KEY_PAUSE_TIME, pause_time);
     MPS_ARGS_ADD(args, MPS_KEY_SPARE, spare);
     RESMUST(mps_arena_create_k(&arena, mps_arena_class_vm(), args));
@@ -289,8 +402,16 @@ static struct option longopts[] = {
   {"pin-leaf",         no_argument,       NULL, 'l'},
   {"seed",             required_argument, NULL, 'x'},
   {"arena-unzoned",    no_argument,       NULL, 'z'},
+  {"huge-pages",       no_argument,       NULL, 'H'},
+  {"spare-discard",    no_argument,       NULL, 'D'},
+  {"prefault",         no_argument,       NULL, 'F'},
+  {"commit-ahead",     required_argument, NULL, 'A'},
   {"pause-time",       required_argument, NULL, 'P'},
   {"spare",            required_argument, NULL, 'S'},
+  {"ncollect",         required_argument, NULL, 'c'},
+  {"old-depth",        required_argument, NULL, 'o'},
+  {"background",       no_argument,       NULL, 'B'},
+  {"scale",            no_argument,       NULL, 'T'},
   {NULL,               0,                 NULL, 0  }
 };
 
@@ -316,7 +437,7 @@ int main(int argc, char *argv[])
 
   seed = rnd_seed();
 
-  while ((ch = getopt_long(argc, argv, "ht:i:p:g:m:a:w:d:r:u:lx:zP:S:",
+  while ((ch = getopt_long(argc, argv, "ht:i:p:g:m:a:w:d:r:u:lx:zHDFA:P:S:c:o:BT",
                            longopts, NULL)) != -1)
     switch (ch) {
     case 't':
@@ -407,12 +528,47 @@ int main(int argc, char *argv[])
     case 'z':
       zoned = FALSE;
       break;
+    case 'H':
+      huge_pages = TRUE;
+      break;
+    case 'D':
+      spare_discard = TRUE;
+      break;
+    case 'F':
+      prefault = TRUE;
+      break;
+    case 'A': {
+        char *p;
+        commit_ahead = (size_t)strtoul(optarg, &p, 10);
+        switch(toupper(*p)) {
+        case 'G': commit_ahead <<= 30; break;
+        case 'M': commit_ahead <<= 20; break;
+        case 'K': commit_ahead <<= 10; break;
+        case '\0': break;
+        default:
+          fprintf(stderr, "Bad commit-ahead size %s\n", optarg);
+          return EXIT_FAILURE;
+        }
+      }
+      break;
     case 'P':
       pause_time = strtod(optarg, NULL);
       break;
     case 'S':
       spare = strtod(optarg, NULL);
       break;
+    case 'c':
+      ncollect = (unsigned)strtoul(optarg, NULL, 10);
+      break;
+    case 'o':
+      old_depth = (unsigned)strtoul(optarg, NULL, 10);
+      break;
+    case 'B':
+      background = TRUE;
+      break;
+    case 'T':
+      scale = TRUE;
+      break;
     default:
       /* This is printed in parts to keep within the 509 character
          limit for string literals in portable standard C. */
@@ -458,16 +614,36 @@ int main(int argc, char *argv[])
       fprintf(stderr,
               "  -z, --arena-unzoned\n"
               "    Disable zoned allocation in the arena\n"
+              "  -H, --huge-pages\n"
+              "    Back the arena with transparent huge pages\n"
+              "  -D, --spare-discard\n"
+              "    Discard spare pages instead of unmapping them\n"
+              "  -F, --prefault\n"
+              "    Fault pages in when the arena maps them\n"
+              "  -A n, --commit-ahead=n[KMG]?\n"
+              "    Spare memory to keep ready in background mode\n");
+      fprintf(stderr,
               "  -P t, --pause-time\n"
               "    Maximum pause time in seconds (default %f)\n"
               "  -S f, --spare\n"
               "    Maximum spare committed fraction (default %f)\n"
+              "  -c n, --ncollect=n\n"
+              "    Time n full collections after each iteration (default %u)\n"
+              "  -o n, --old-depth=n\n"
+              "    Depth of tree kept alive for the whole run (default %u)\n",
+              pause_time,
+              spare,
+              ncollect,
+              old_depth);
+      fprintf(stderr,
+              "  -B, --background\n"
+              "    Do incremental work on a separate collector thread\n"
+              "  -T, --scale\n"
+              "    Run each test with 1, 2, 4, ... up to n threads\n"
               "Tests:\n"
               "  amc   pool class AMC\n"
               "  ams   pool class AMS\n"
-              "  awl   pool class AWL\n",
-              pause_time,
-              spare);
+              "  awl   pool class AWL\n");
       return EXIT_FAILURE;
     }
   argc -= optind;
@@ -486,8 +662,24 @@ int main(int argc, char *argv[])
     return EXIT_FAILURE;
   found:
     (void)mps_lib_assert_fail_install(assert_die);
-    rnd_state_set(seed);
-    arena_setup(pools[i].fn, pools[i].pool_class(), pools[i].name);
+    if (scale) {
+      /* Run with 1, 2, 4, ... threads, ending with the number of
+         threads given by -t, to show how allocation scales. */
+      unsigned max_threads = nthreads;
+      for (nthreads = 1; ; nthreads *= 2) {
+        char name[64];
+        if (nthreads > max_threads)
+          nthreads = max_threads;
+        sprintf(name, "%s/%u", pools[i].name, nthreads);
+        rnd_state_set(seed);
+        arena_setup(pools[i].fn, pools[i].pool_class(), name);
+        if (nthreads == max_threads)
+          break;
+      }
+    } else {
+      rnd_state_set(seed);
+      arena_setup(pools[i].fn, pools[i].pool_class(), pools[i].name);
+    }
     --argc;
     ++argv;
   }
@@ -162,7 +162,6 @@ Bool GlobalsCheck(Globals arenaGlobals)
   Arena arena;
   TraceId ti;
   Trace trace;
-  Rank rank;
 
   CHECKS(Globals, arenaGlobals);
   arena = GlobalsArena(arenaGlobals);
@@ -220,8 +219,6 @@ Bool GlobalsCheck(Globals arenaGlobals)
     CHECKL(TraceIdMessagesCheck(arena, ti));
   TRACE_SET_ITER_END(ti, trace, TraceSetUNIV, arena);
 
-  for(rank = RankMIN; rank < RankLIMIT; ++rank)
-    CHECKD_NOSIG(Ring, &arena->greyRing[rank]);
   CHECKD_NOSIG(Ring, &arena->chainRing);
 
   CHECKL(arena->tracedWork >= 0.0);
@@ -256,7 +253,6 @@ Bool GlobalsCheck(Globals arenaGlobals)
 Res GlobalsInit(Globals arenaGlobals)
 {
   Arena arena;
-  Rank rank;
   TraceId ti;
 
   /* This is one of the first things that happens, */
@@ -338,8 +334,6 @@ Res GlobalsInit(Globals arenaGlobals)
     arena->tMessage[ti] = NULL;
   }
 
-  for(rank = RankMIN; rank < RankLIMIT; ++rank)
-    RingInit(&arena->greyRing[rank]);
   RingInit(&arena->chainRing);
 
   HistoryInit(ArenaHistory(arena));
@@ -431,7 +425,6 @@ failChainCreate:
 void GlobalsFinish(Globals arenaGlobals)
 {
   Arena arena;
-  Rank rank;
 
   arena = GlobalsArena(arenaGlobals);
   AVERT(Globals, arenaGlobals);
@@ -445,8 +438,6 @@ void GlobalsFinish(Globals arenaGlobals)
   RingFinish(&arena->messageRing);
   RingFinish(&arena->threadRing);
   RingFinish(&arena->deadRing);
-  for(rank = RankMIN; rank < RankLIMIT; ++rank)
-    RingFinish(&arena->greyRing[rank]);
   RingFinish(&arenaGlobals->rootRing);
   RingFinish(&arenaGlobals->poolRing);
   RingFinish(&arenaGlobals->globalRing);
@@ -463,7 +454,6 @@ void GlobalsPrepareToDestroy(Globals arenaGlobals)
   TraceId ti;
   Trace trace;
   Chain defaultChain;
-  Rank rank;
 
   AVERT(Globals, arenaGlobals);
 
@@ -540,8 +530,6 @@ void GlobalsPrepareToDestroy(Globals arenaGlobals)
   AVER(RingIsSingle(&arena->threadRing)); /* <design/check/#.common> */
   AVER(RingIsSingle(&arena->deadRing));
   AVER(RingIsSingle(&arenaGlobals->rootRing)); /* <design/check/#.common> */
-  for(rank = RankMIN; rank < RankLIMIT; ++rank)
-    AVER(RingIsSingle(&arena->greyRing[rank]));
   AVER(RingLength(&arenaGlobals->poolRing) == arenaGlobals->systemPools); /* <design/check/#.common> */
 }
 
@@ -807,10 +795,26 @@ Bool ArenaStep(Globals globals, double interval, double multiplier)
     TraceAdvance(trace);
     if (trace->state == TraceFINISHED)
       TraceDestroyFinished(trace);
+    PolicyStep(arena);
     workWasDone = TRUE;
     now = ClockNow();
   } while (now < intervalEnd);
 
+  /* In background mode, frees leave excess spare memory to be
+     returned here.  See <design/arena#.spare.decay>. */
+  if (arena->background && ArenaPurgeStep(arena, now)) {
+    now = ClockNow();
+    workWasDone = TRUE;
+  }
+
+  /* Keep some spare memory ready for allocation, so that threads that
+     allocate don't have to wait for it to be mapped.  See
+     <design/arena#.spare.ahead>. */
+  if (arena->background && ArenaCommitAheadStep(arena)) {
+    now = ClockNow();
+    workWasDone = TRUE;
+  }
+
   if (workWasDone) {
     ArenaAccumulateTime(arena, start, now);
   }
@@ -3,12 +3,16 @@
  * $Id$
  * Copyright (c) 2001-2020 Ravenbrook Limited.  See end of file for license.
  *
- * Test all three Land implementations against duplicate operations on
+ * Test all the Land implementations against duplicate operations on
  * a bit-table.
  *
- * Test the "steal" operations on a CBS.
+ * Test the "steal" operations on a CBS and a B-tree.
+ *
+ * The CBS and B-tree tests print the time taken by each land class, so
+ * that their performance can be compared.
  */
 
+#include "btree.h"
 #include "cbs.h"
 #include "failover.h"
 #include "freelist.h"
@@ -18,16 +22,18 @@
 #include "mpstd.h"
 #include "poolmfs.h"
 #include "testlib.h"
+#include "tlsf.h"
 
 #include <stdio.h> /* printf */
+#include <time.h> /* CLOCKS_PER_SEC, clock */
 
 SRCID(landtest, "$Id$");
 
 
 #define ArraySize ((Size)123456)
 
-/* CBS is much faster than Freelist, so we apply more operations to
- * the former. */
+/* CBS and B-tree are much faster than Freelist, so we apply more
+ * operations to the former. */
 #define nCBSOperations ((Size)125000)
 #define nFLOperations ((Size)12500)
 #define nFOOperations ((Size)12500)
@@ -43,6 +49,7 @@ typedef struct TestStateStruct {
   Addr block;
   Size size;
   Land land;
+  Bool goodFit;                 /* land finds a good fit, not first/last */
 } TestStateStruct, *TestState;
 
 typedef struct CheckTestClosureStruct {
@@ -377,7 +384,34 @@ static void find(TestState state, Size size, Bool high, FindDelete findDelete)
 
   Insist(found == expected);
 
-  if (found) {
+  if (found && state->goodFit) {
+    /* Any free block that is big enough will do. */
+    Index oldBase = indexOfAddr(state, RangeBase(&oldRange));
+    Index oldLimit = indexOfAddr(state, RangeLimit(&oldRange));
+    Index foundBase = indexOfAddr(state, RangeBase(&foundRange));
+    Index foundLimit = indexOfAddr(state, RangeLimit(&foundRange));
+    Insist(BTIsResRange(state->allocTable, oldBase, oldLimit));
+    Insist(oldBase == 0 || BTGet(state->allocTable, oldBase - 1));
+    Insist(oldLimit == state->size || BTGet(state->allocTable, oldLimit));
+    Insist(oldLimit - oldBase >= size);
+    switch(findDelete) {
+    case FindDeleteNONE:
+    case FindDeleteENTIRE:
+      Insist(foundBase == oldBase && foundLimit == oldLimit);
+      break;
+    case FindDeleteLOW:
+      Insist(foundBase == oldBase && foundLimit == oldBase + size);
+      break;
+    case FindDeleteHIGH:
+      Insist(foundBase == oldLimit - size && foundLimit == oldLimit);
+      break;
+    default:
+      cdie(0, "invalid findDelete");
+      break;
+    }
+    if (findDelete != FindDeleteNONE)
+      BTSetRange(state->allocTable, foundBase, foundLimit);
+  } else if (found) {
     Insist(expectedBase == indexOfAddr(state, RangeBase(&foundRange)));
     Insist(expectedLimit == indexOfAddr(state, RangeLimit(&foundRange)));
 
@@ -429,6 +463,17 @@ static void test(TestState state, unsigned n, unsigned operations)
   }
 }
 
+/* test_timed -- test a land and print the time taken */
+
+static void test_timed(TestState state, unsigned n, unsigned operations)
+{
+  clock_t start = clock();
+  test(state, n, operations);
+  printf("%s: %u operations in %.3fs\n",
+         ClassName(ClassOfPoly(Land, state->land)), n,
+         (double)(clock() - start) / CLOCKS_PER_SEC);
+}
+
 #define testArenaSIZE   (((size_t)4)<<20)
 
 static void test_land(void)
@@ -440,22 +485,30 @@ static void test_land(void)
     {CBSClassGet, 2},
     {CBSFastClassGet, 3},
     {CBSZonedClassGet, 3},
+    {BTreeClassGet, 3},
+    {BTreeZonedClassGet, 3},
   };
   mps_arena_t mpsArena;
   Arena arena;
   TestStateStruct state;
-  void *p;
+  void *p, *q;
   MFSStruct blockPool;
+  union {
+    CBSStruct cbs;
+    BTreeStruct btree;
+  } treeStruct;
   CBSStruct cbsStruct;
   FreelistStruct flStruct;
   FailoverStruct foStruct;
   Land cbs = CBSLand(&cbsStruct);
   Land fl = FreelistLand(&flStruct);
   Land fo = FailoverLand(&foStruct);
+  TLSF tlsf;
   Pool mfs = MFSPool(&blockPool);
   size_t i;
 
   state.size = ArraySize;
+  state.goodFit = FALSE;
   state.align = (1 << rnd() % 4) * MPS_PF_ALIGN;
 
   NAllocateTried = NAllocateSucceeded = NDeallocateTried =
@@ -477,20 +530,36 @@ static void test_land(void)
            (void *)AddrAdd(state.block, state.size));
   }
 
-  /* 1. Test CBS */
+  /* 1. Test CBS and B-tree */
 
   for (i = 0; i < NELEMS(cbsConfig); ++i) {
+    Land land = CBSLand(&treeStruct.cbs); /* landStruct is first in both */
     MPS_ARGS_BEGIN(args) {
-      die((mps_res_t)LandInit(cbs, cbsConfig[i].klass(), arena, state.align,
+      die((mps_res_t)LandInit(land, cbsConfig[i].klass(), arena, state.align,
                               NULL, args),
           "failed to initialise CBS");
     } MPS_ARGS_END(args);
-    state.land = cbs;
-    test(&state, nCBSOperations, cbsConfig[i].operations);
-    LandFinish(cbs);
+    state.land = land;
+    test_timed(&state, nCBSOperations, cbsConfig[i].operations);
+    LandFinish(land);
   }
 
-  /* 2. Test Freelist */
+  /* 2. Test TLSF */
+
+  die((mps_res_t)ControlAlloc(&q, arena, sizeof(TLSFStruct)),
+      "failed to allocate TLSF");
+  tlsf = q;
+  die((mps_res_t)LandInit(TLSFLand(tlsf), CLASS(TLSF), arena, state.align,
+                          NULL, mps_args_none),
+      "failed to initialise TLSF");
+  state.land = TLSFLand(tlsf);
+  state.goodFit = TRUE;
+  test_timed(&state, nCBSOperations, 3);
+  state.goodFit = FALSE;
+  LandFinish(TLSFLand(tlsf));
+  ControlFree(arena, tlsf, sizeof(TLSFStruct));
+
+  /* 3. Test Freelist */
 
   die((mps_res_t)LandInit(fl, CLASS(Freelist), arena, state.align,
                           NULL, mps_args_none),
@@ -499,7 +568,7 @@ static void test_land(void)
   test(&state, nFLOperations, 3);
   LandFinish(fl);
 
-  /* 3. Test CBS-failing-over-to-Freelist (always failing over on
+  /* 4. Test CBS-failing-over-to-Freelist (always failing over on
    * first iteration, never failing over on second; see fotest.c for a
    * test case that randomly switches fail-over on and off)
    */
@@ -562,14 +631,17 @@ static void shuffle(Addr *addr, size_t n)
   }
 }
 
-static void test_steal(void)
+static void test_steal(LandClass klass, Size unitSize)
 {
   mps_arena_t mpsArena;
   Arena arena;
-  MFSStruct mfs;                /* stores blocks for the CBS */
+  MFSStruct mfs;                /* stores blocks for the land */
   Pool pool = MFSPool(&mfs);
-  CBSStruct cbs;                /* allocated memory land */
-  Land land = CBSLand(&cbs);
+  union {
+    CBSStruct cbs;
+    BTreeStruct btree;
+  } landStruct;                 /* allocated memory land */
+  Land land = CBSLand(&landStruct.cbs); /* landStruct is first in both */
   Addr base;
   Addr addr[4096];
   Size grainSize;
@@ -582,7 +654,7 @@ static void test_steal(void)
   grainSize = ArenaGrainSize(arena);
 
   MPS_ARGS_BEGIN(args) {
-    MPS_ARGS_ADD(args, MPS_KEY_MFS_UNIT_SIZE, sizeof(RangeTreeStruct));
+    MPS_ARGS_ADD(args, MPS_KEY_MFS_UNIT_SIZE, unitSize);
     MPS_ARGS_ADD(args, MPS_KEY_EXTEND_BY, grainSize);
     MPS_ARGS_ADD(args, MFSExtendSelf, FALSE);
     die(PoolInit(pool, arena, CLASS(MFSPool), args), "pool");
@@ -590,7 +662,7 @@ static void test_steal(void)
 
   MPS_ARGS_BEGIN(args) {
     MPS_ARGS_ADD(args, CBSBlockPool, pool);
-    die(LandInit(land, CLASS(CBS), arena, grainSize, NULL, args),
+    die(LandInit(land, klass, arena, grainSize, NULL, args),
         "land");
   } MPS_ARGS_END(args);
 
@@ -644,7 +716,8 @@ int main(int argc, char *argv[])
 {
   testlib_init(argc, argv);
   test_land();
-  test_steal();
+  test_steal(CLASS(CBS), sizeof(RangeTreeStruct));
+  test_steal(CLASS(BTree), BTreeNodeSize(FALSE));
   printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
   return 0;
 }
@@ -145,6 +145,7 @@ static void GenDescInit(Arena arena, GenDesc gen, GenParamStruct *params)
   gen->zones = ZoneSetEMPTY;
   gen->capacity = params->capacity * 1024;
   gen->mortality = params->mortality;
+  gen->frozenSize = 0;
   RingInit(&gen->locusRing);
   RingInit(&gen->segRing);
   gen->activeTraces = TraceSetEMPTY;
@@ -175,9 +176,10 @@ static void GenDescFinish(Arena arena, GenDesc gen)
 }
 
 
-/* GenDescNewSize -- return effective size of generation */
+/* genDescRawNewSize -- return new size of generation, including
+ * frozen memory */
 
-Size GenDescNewSize(GenDesc gen)
+static Size genDescRawNewSize(GenDesc gen)
 {
   Size size = 0;
   Ring node, nextNode;
@@ -193,6 +195,35 @@ Size GenDescNewSize(GenDesc gen)
 }
 
 
+/* GenDescNewSize -- return effective size of generation
+ *
+ * Frozen segments are never condemned, so their new memory is never
+ * aged. Leave it out, so that it doesn't cause the generation to be
+ * collected over and over again <design/strategy#.freeze.account>.
+ */
+
+Size GenDescNewSize(GenDesc gen)
+{
+  Size size = genDescRawNewSize(gen);
+  return size > gen->frozenSize ? size - gen->frozenSize : 0;
+}
+
+
+/* GenDescFreeze -- note that all memory in generation is frozen
+ *
+ * ArenaFreeze calls this after emptying the buffers, so all the new
+ * memory in the generation is in frozen segments. From then on, the
+ * frozen size is maintained by PoolGenAccountForEmpty, PoolGenUndefer
+ * and PoolGenFree <design/strategy#.freeze.account>.
+ */
+
+void GenDescFreeze(GenDesc gen)
+{
+  AVERT(GenDesc, gen);
+  gen->frozenSize = genDescRawNewSize(gen);
+}
+
+
 /* genDescTraceStart -- notify generation of start of a trace */
 
 void GenDescStartTrace(GenDesc gen, Trace trace)
@@ -210,6 +241,7 @@ void GenDescStartTrace(GenDesc gen, Trace trace)
   genTrace->condemned = 0;
   genTrace->forwarded = 0;
   genTrace->preservedInPlace = 0;
+  genTrace->newAtCondemn = 0;
 }
 
 
@@ -256,6 +288,22 @@ void GenDescCondemned(GenDesc gen, Trace trace, Size size)
 }
 
 
+/* GenDescCondemnEnd -- the trace has finished condemning the generation
+ *
+ * Record the generation's new size, so that ChainOverflow can measure
+ * how much has been allocated in it since.
+ */
+
+void GenDescCondemnEnd(GenDesc gen, Trace trace)
+{
+  AVERT(GenDesc, gen);
+  AVERT(Trace, trace);
+  AVER(TraceSetIsMember(gen->activeTraces, trace));
+
+  gen->trace[trace->ti].newAtCondemn = GenDescNewSize(gen);
+}
+
+
 /* GenDescSurvived -- memory in a generation survived a trace */
 
 void GenDescSurvived(GenDesc gen, Trace trace, Size forwarded,
@@ -310,6 +358,7 @@ Res GenDescDescribe(GenDesc gen, mps_lib_FILE *stream, Count depth)
                "  zones $B\n", (WriteFB)gen->zones,
                "  capacity $U\n", (WriteFW)gen->capacity,
                "  mortality $D\n", (WriteFD)gen->mortality,
+               "  frozenSize $U\n", (WriteFW)gen->frozenSize,
                "  activeTraces $B\n", (WriteFB)gen->activeTraces,
                NULL);
   if (res != ResOK)
@@ -322,6 +371,7 @@ Res GenDescDescribe(GenDesc gen, mps_lib_FILE *stream, Count depth)
                  "  condemned $U\n", (WriteFW)genTrace->condemned,
                  "  forwarded $U\n", (WriteFW)genTrace->forwarded,
                  "  preservedInPlace $U\n", (WriteFW)genTrace->preservedInPlace,
+                 "  newAtCondemn $U\n", (WriteFW)genTrace->newAtCondemn,
                  "}\n", NULL);
     if (res != ResOK)
       return res;
@@ -482,6 +532,44 @@ double ChainDeferral(Chain chain)
 }
 
 
+/* ChainOverflow -- how far the chain's generations are over capacity
+ *
+ * Return the largest ratio of new size to capacity among the
+ * generations in the chain.  For a generation that is being
+ * collected, only the memory allocated since it was condemned
+ * counts.  A ratio greater than 1 means that a generation would have
+ * been condemned had a trace not already been running.  See
+ * <design/strategy#.policy.overflow>.
+ */
+
+double ChainOverflow(Chain chain)
+{
+  double overflow = 0.0;
+  size_t i;
+
+  AVERT(Chain, chain);
+
+  for (i = 0; i < chain->genCount; ++i) {
+    GenDesc gen = &chain->gens[i];
+    Size newSize = GenDescNewSize(gen);
+    TraceId ti;
+    Trace trace;
+    double ratio;
+
+    TRACE_SET_ITER(ti, trace, gen->activeTraces, chain->arena)
+      Size since = gen->trace[ti].newAtCondemn;
+      newSize = newSize > since ? newSize - since : 0;
+    TRACE_SET_ITER_END(ti, trace, gen->activeTraces, chain->arena);
+
+    ratio = (double)newSize / ((double)gen->capacity + 1.0);
+    if (ratio > overflow)
+      overflow = ratio;
+  }
+
+  return overflow;
+}
+
+
 /* ChainDescribe -- describe a chain */
 
 Res ChainDescribe(Chain chain, mps_lib_FILE *stream, Count depth)
@@ -664,17 +752,19 @@ void PoolGenAccountForFill(PoolGen pgen, Size size)
 
 /* PoolGenAccountForEmpty -- accounting for emptying a buffer
  *
- * Call this when the client program returns memory to the pool via
- * BufferEmpty. The deferred flag indicates whether the accounting of
- * the used memory (for the purpose of scheduling collections) should
- * be deferred until later.
+ * Call this when the client program returns memory in seg to the pool
+ * via BufferEmpty. The deferred flag indicates whether the accounting
+ * of the used memory (for the purpose of scheduling collections)
+ * should be deferred until later.
  *
  * <design/strategy#.accounting.op.empty>
  */
 
-void PoolGenAccountForEmpty(PoolGen pgen, Size used, Size unused, Bool deferred)
+void PoolGenAccountForEmpty(PoolGen pgen, Seg seg, Size used, Size unused,
+                            Bool deferred)
 {
   AVERT(PoolGen, pgen);
+  AVERT(Seg, seg);
   AVERT(Bool, deferred);
 
   AVER(pgen->bufferedSize >= used + unused);
@@ -683,6 +773,8 @@ void PoolGenAccountForEmpty(PoolGen pgen, Size used, Size unused, Bool deferred)
     pgen->newDeferredSize += used;
   } else {
     pgen->newSize += used;
+    if (SegFrozen(seg))
+      pgen->gen->frozenSize += used;
   }
   pgen->freeSize += unused;
 }
@@ -745,21 +837,24 @@ void PoolGenAccountForReclaim(PoolGen pgen, Size reclaimed, Bool deferred)
 /* PoolGenUndefer -- finish deferring accounting
  *
  * Call this when exiting ramp mode, passing the amount of old
- * (condemned at least once) and new (never condemned) memory whose
- * accounting was deferred (for example, during a ramp).
+ * (condemned at least once) and new (never condemned) memory in seg
+ * whose accounting was deferred (for example, during a ramp).
  *
  * <design/strategy#.accounting.op.undefer>
  */
 
-void PoolGenUndefer(PoolGen pgen, Size oldSize, Size newSize)
+void PoolGenUndefer(PoolGen pgen, Seg seg, Size oldSize, Size newSize)
 {
   AVERT(PoolGen, pgen);
+  AVERT(Seg, seg);
   AVER(pgen->oldDeferredSize >= oldSize);
   pgen->oldDeferredSize -= oldSize;
   pgen->oldSize += oldSize;
   AVER(pgen->newDeferredSize >= newSize);
   pgen->newDeferredSize -= newSize;
   pgen->newSize += newSize;
+  if (SegFrozen(seg))
+    pgen->gen->frozenSize += newSize;
 }
 
 
@@ -823,6 +918,13 @@ void PoolGenFree(PoolGen pgen, Seg seg, Size freeSize, Size oldSize,
   size = SegSize(seg);
   AVER(freeSize + oldSize + newSize == size);
 
+  /* The frozen size may be short if a frozen segment was merged with
+     one that was not frozen <design/strategy#.freeze.account>. */
+  if (SegFrozen(seg) && !deferred) {
+    GenDesc gen = pgen->gen;
+    gen->frozenSize -= gen->frozenSize > newSize ? newSize : gen->frozenSize;
+  }
+
   PoolGenAccountForFree(pgen, size, oldSize, newSize, deferred);
 
   RingRemove(&SegGCSeg(seg)->genRing);
@@ -31,6 +31,7 @@ typedef struct GenTraceStruct {
   Size condemned;        /* size of objects condemned by the trace */
   Size forwarded;        /* size of objects that were forwarded by the trace */
   Size preservedInPlace; /* size of objects preserved in place by the trace */
+  Size newAtCondemn;     /* new size after condemning, see ChainOverflow */
 } GenTraceStruct;
 
 
@@ -46,6 +47,7 @@ typedef struct GenDescStruct {
   ZoneSet zones;        /* zoneset for this generation */
   Size capacity;        /* capacity in bytes */
   double mortality;     /* moving average mortality */
+  Size frozenSize;      /* new size in frozen segments */
   RingStruct locusRing; /* Ring of all PoolGen's in this GenDesc (locus) */
   RingStruct segRing;   /* Ring of GCSegs in this generation */
   TraceSet activeTraces; /* set of traces collecting this generation */
@@ -92,9 +94,11 @@ typedef struct mps_chain_s {
 extern Bool GenDescCheck(GenDesc gen);
 extern Size GenDescNewSize(GenDesc gen);
 extern Size GenDescTotalSize(GenDesc gen);
+extern void GenDescFreeze(GenDesc gen);
 extern void GenDescStartTrace(GenDesc gen, Trace trace);
 extern void GenDescEndTrace(GenDesc gen, Trace trace);
 extern void GenDescCondemned(GenDesc gen, Trace trace, Size size);
+extern void GenDescCondemnEnd(GenDesc gen, Trace trace);
 extern void GenDescSurvived(GenDesc gen, Trace trace, Size forwarded, Size preservedInPlace);
 extern Res GenDescDescribe(GenDesc gen, mps_lib_FILE *stream, Count depth);
 #define GenDescOfTraceRing(node, tr) PARENT(GenDescStruct, trace, RING_ELT(GenTrace, traceRing, node) - (tr)->ti)
@@ -105,6 +109,7 @@ extern void ChainDestroy(Chain chain);
 extern Bool ChainCheck(Chain chain);
 
 extern double ChainDeferral(Chain chain);
+extern double ChainOverflow(Chain chain);
 extern size_t ChainGens(Chain chain);
 extern GenDesc ChainGen(Chain chain, Index gen);
 extern Res ChainDescribe(Chain chain, mps_lib_FILE *stream, Count depth);
@@ -117,10 +122,10 @@ extern Res PoolGenAlloc(Seg *segReturn, PoolGen pgen, SegClass klass,
 extern void PoolGenFree(PoolGen pgen, Seg seg, Size freeSize, Size oldSize,
                         Size newSize, Bool deferred);
 extern void PoolGenAccountForFill(PoolGen pgen, Size size);
-extern void PoolGenAccountForEmpty(PoolGen pgen, Size used, Size unused, Bool deferred);
+extern void PoolGenAccountForEmpty(PoolGen pgen, Seg seg, Size used, Size unused, Bool deferred);
 extern void PoolGenAccountForAge(PoolGen pgen, Size wasBuffered, Size wasNew, Bool deferred);
 extern void PoolGenAccountForReclaim(PoolGen pgen, Size reclaimed, Bool deferred);
-extern void PoolGenUndefer(PoolGen pgen, Size oldSize, Size newSize);
+extern void PoolGenUndefer(PoolGen pgen, Seg seg, Size oldSize, Size newSize);
 extern void PoolGenAccountForSegSplit(PoolGen pgen);
 extern void PoolGenAccountForSegMerge(PoolGen pgen);
 extern Res PoolGenDescribe(PoolGen gen, mps_lib_FILE *stream, Count depth);
@@ -219,14 +219,37 @@ Bool (WordIsP2)(Word word)
 
 Shift SizeFloorLog2(Size size)
 {
-  Shift l = 0;
-
   AVER(size != 0);
-  while(size > 1) {
-    ++l;
-    size >>= 1;
+#if defined(MPS_BUILD_GC) || defined(MPS_BUILD_LL)
+  /* Size is unsigned long on these platforms: see <code/mpstd.h>. */
+  return (Shift)(MPS_WORD_WIDTH - 1) - (Shift)__builtin_clzl(size);
+#else
+  {
+    Shift l = 0;
+    while(size > 1) {
+      ++l;
+      size >>= 1;
+    }
+    return l;
   }
-  return l;
+#endif
+}
+
+Shift WordLowestSet(Word word)
+{
+  AVER(word != 0);
+#if defined(MPS_BUILD_GC) || defined(MPS_BUILD_LL)
+  return (Shift)__builtin_ctzl(word);
+#else
+  {
+    Shift l = 0;
+    while ((word & 1) == 0) {
+      ++l;
+      word >>= 1;
+    }
+    return l;
+  }
+#endif
 }
 
 Shift SizeLog2(Size size)
@@ -154,12 +154,16 @@ extern Bool ResIsAllocFailure(Res res);
  * power of 2.
  *
  * SizeFloorLog2 returns the floor of the logarithm in base 2 of size.
- * size can be any positive non-zero value.  */
+ * size can be any positive non-zero value.
+ *
+ * WordLowestSet returns the index of the least significant set bit
+ * in word, which must be non-zero.  */
 
 extern Bool (SizeIsP2)(Size size);
 #define SizeIsP2(size) WordIsP2((Word)size)
 extern Shift SizeLog2(Size size);
 extern Shift SizeFloorLog2(Size size);
+extern Shift WordLowestSet(Word word);
 
 extern Bool (WordIsP2)(Word word);
 #define WordIsP2(word) ((word) > 0 && ((word) & ((word) - 1)) == 0)
@@ -208,6 +212,7 @@ extern Res PoolDescribe(Pool pool, mps_lib_FILE *stream, Count depth);
 #define PoolAlignment(pool)     ((pool)->alignment)
 #define PoolSegRing(pool)       (&(pool)->segRing)
 #define PoolArenaRing(pool) (&(pool)->arenaRing)
+#define PoolSoftwareBarrier(pool) RVALUE((pool)->softwareBarrier)
 #define PoolOfArenaRing(node) RING_ELT(Pool, arenaRing, node)
 #define PoolHasAttr(pool, Attr) ((ClassOfPoly(Pool, pool)->attr & (Attr)) != 0)
 #define PoolSizeGrains(pool, size) ((size) >> (pool)->alignShift)
@@ -231,6 +236,13 @@ extern void PoolDestroy(Pool pool);
 extern BufferClass PoolDefaultBufferClass(Pool pool);
 extern Res PoolAlloc(Addr *pReturn, Pool pool, Size size);
 extern void (PoolFree)(Pool pool, Addr old, Size size);
+extern Res PoolCacheInit(Pool pool);
+extern void PoolCacheFinish(Pool pool);
+extern Res PoolCacheSACCreate(SAC *sacReturn, Pool pool);
+extern Bool PoolCacheAlloc(Addr *pReturn, Pool pool, Size size);
+extern Bool PoolCacheFree(Pool pool, Addr old, Size size);
+extern Res PoolCacheFill(Addr *pReturn, Pool pool, Size size);
+extern void PoolCacheEmpty(Pool pool, Addr old, Size size);
 extern PoolGen PoolSegPoolGen(Pool pool, Seg seg);
 extern Res PoolTraceBegin(Pool pool, Trace trace);
 extern void PoolFreeWalk(Pool pool, FreeBlockVisitor f, void *p);
@@ -351,6 +363,8 @@ extern const char *MessageNoGCStartWhy(Message message);
 extern void ScanStateInit(ScanState ss, TraceSet ts, Arena arena,
                           Rank rank, ZoneSet white);
 extern void ScanStateFinish(ScanState ss);
+extern Res ScanStateFlush(ScanState ss);
+extern void ScanStateDiscard(ScanState ss);
 extern Bool ScanStateCheck(ScanState ss);
 extern void ScanStateSetSummary(ScanState ss, RefSet summary);
 extern RefSet ScanStateSummary(ScanState ss);
@@ -382,6 +396,7 @@ extern Rank TraceRankForAccess(Arena arena, Seg seg);
 extern void TraceSegAccess(Arena arena, Seg seg, AccessSet mode);
 
 extern void TraceAdvance(Trace trace);
+extern Bool TraceReclaimSome(Arena arena, Count count);
 extern Res TraceStartCollectAll(Trace *traceReturn, Arena arena, TraceStartWhy why);
 extern Res TraceDescribe(Trace trace, mps_lib_FILE *stream, Count depth);
 
@@ -396,6 +411,9 @@ extern Bool TraceIdMessagesCheck(Arena arena, TraceId ti);
 extern Res TraceIdMessagesCreate(Arena arena, TraceId ti);
 extern void TraceIdMessagesDestroy(Arena arena, TraceId ti);
 
+#define TraceGreyRing(trace, rank) (&(trace)->greyRing[rank])
+#define TraceWhiteRing(trace) (&(trace)->whiteRing)
+
 /* Equivalent to <code/mps.h> MPS_SCAN_BEGIN */
 
 #define TRACE_SCAN_BEGIN(ss) \
@@ -429,7 +447,7 @@ extern void TraceIdMessagesDestroy(Arena arena, TraceId ti);
 #define TRACE_FIX2(ss, refIO) \
   (SCANref = (mps_addr_t)*(refIO), \
    SCANres = _mps_fix2(&(ss)->ss_s, &SCANref), \
-   *(refIO) = SCANref, \
+   (SCANref != (mps_addr_t)*(refIO) ? (void)(*(refIO) = SCANref) : (void)0), \
    SCANres)
 
 /* Equivalent to <code/mps.h> MPS_FIX12 */
@@ -488,7 +506,6 @@ extern void GlobalsReinitializeAll(void);
 #define ArenaZoneShift(arena)   ((arena)->zoneShift)
 #define ArenaStripeSize(arena)  ((Size)1 << ArenaZoneShift(arena))
 #define ArenaGrainSize(arena)   ((arena)->grainSize)
-#define ArenaGreyRing(arena, rank) (&(arena)->greyRing[rank])
 #define ArenaPoolRing(arena) (&ArenaGlobals(arena)->poolRing)
 #define ArenaChunkTree(arena) RVALUE((arena)->chunkTree)
 #define ArenaChunkRing(arena)   (&(arena)->chunkRing)
@@ -524,6 +541,7 @@ extern void ArenaClamp(Globals globals);
 extern void ArenaRelease(Globals globals);
 extern void ArenaPark(Globals globals);
 extern void ArenaPostmortem(Globals globals);
+extern void ArenaFreeze(Globals globals);
 extern Res ArenaStartCollect(Globals globals, TraceStartWhy why);
 extern Res ArenaCollect(Globals globals, TraceStartWhy why);
 extern Bool ArenaBusy(Arena arena);
@@ -573,6 +591,19 @@ extern Size ArenaCommitted(Arena arena);
 extern Size ArenaSpareCommitted(Arena arena);
 extern double ArenaSpare(Arena arena);
 extern void ArenaSetSpare(Arena arena, double spare);
+extern void ArenaDeferPurge(Arena arena);
+extern void ArenaPurge(Arena arena);
+#define ArenaPurgeDeferred(arena) \
+  RVALUE((arena)->purgeDeferred || (arena)->background)
+extern Bool ArenaPurgeStep(Arena arena, Clock now);
+extern Bool ArenaCommitAheadStep(Arena arena);
+#define ArenaSoftDirty(arena)   RVALUE((arena)->softDirty)
+#define ArenaWB(arena)          (&(arena)->wbStruct)
+#define ArenaHasCards(arena)    RVALUE((arena)->hasCards)
+extern Res ArenaCardsInit(Arena arena);
+extern void ArenaCardsFinish(Arena arena);
+extern Bool ArenaCardsDirty(Arena arena, Addr base, Addr limit);
+extern void ArenaCardsClear(Arena arena);
 #define ArenaSpareCommitLimit(arena) ((Size)(ArenaCommitted(arena) * ArenaSpare(arena)))
 #define ArenaCurrentSpare(arena) ((double)ArenaSpareCommitted(arena) / ArenaCommitted(arena))
 
@@ -580,7 +611,10 @@ extern Size ArenaCommitLimit(Arena arena);
 extern Res ArenaSetCommitLimit(Arena arena, Size limit);
 extern double ArenaPauseTime(Arena arena);
 extern void ArenaSetPauseTime(Arena arena, double pauseTime);
+extern Bool ArenaBackground(Arena arena);
+extern void ArenaSetBackground(Arena arena, Bool background);
 extern Size ArenaNoPurgeSpare(Arena arena, Size size);
+extern Size ArenaNoFillSpare(Arena arena, Size size);
 extern Res ArenaNoGrow(Arena arena, LocusPref pref, Size size);
 
 extern Size ArenaAvail(Arena arena);
@@ -611,6 +645,7 @@ extern Bool PolicyShouldCollectWorld(Arena arena, double availableTime,
 extern Bool PolicyStartTrace(Trace *traceReturn, Bool *collectWorldReturn,
                              Arena arena, Bool collectWorldAllowed);
 extern Bool PolicyPoll(Arena arena);
+extern void PolicyStep(Arena arena);
 extern Bool PolicyPollAgain(Arena arena, Clock start, Bool moreWork, Work tracedWork);
 
 
@@ -695,13 +730,23 @@ extern Addr (SegLimit)(Seg seg);
 #define SegGrey(seg)            RVALUE((TraceSet)(seg)->grey)
 #define SegWhite(seg)           RVALUE((TraceSet)(seg)->white)
 #define SegNailed(seg)          RVALUE((TraceSet)(seg)->nailed)
+#define SegFrozen(seg)          RVALUE((Bool)(seg)->frozen)
 #define SegPoolRing(seg)        (&(seg)->poolRing)
 #define SegOfPoolRing(node)     RING_ELT(Seg, poolRing, (node))
-#define SegOfGreyRing(node)     (&(RING_ELT(GCSeg, greyRing, (node)) \
-                                   ->segStruct))
+#define SegOfGreyRing(node, trace) \
+  (&(RING_ELT(GCSeg, greyRing, (node) - (trace)->ti)->segStruct))
+#define SegOfWhiteRing(node, trace) \
+  (&(RING_ELT(GCSeg, whiteRing, (node) - (trace)->ti)->segStruct))
 
 #define SegSummary(seg)         (((GCSeg)(seg))->summary)
 
+/* Is the write barrier on the segment implemented without memory
+   protection?  See <design/write-barrier#.soft-dirty.protect> and
+   <design/write-barrier#.software.protect>. */
+#define SegUnprotectedBarrier(seg) \
+  (ArenaSoftDirty(PoolArena(SegPool(seg))) \
+   || PoolSoftwareBarrier(SegPool(seg)))
+
 #define SegSetPM(seg, mode)     ((void)((seg)->pm = BS_BITFIELD(Access, (mode))))
 #define SegSetSM(seg, mode)     ((void)((seg)->sm = BS_BITFIELD(Access, (mode))))
 #define SegSetDepth(seg, d)     ((void)((seg)->depth = BITFIELD(unsigned, (d), ShieldDepthWIDTH)))
@@ -713,6 +758,9 @@ extern Addr (SegLimit)(Seg seg);
 extern Res BufferCreate(Buffer *bufferReturn, BufferClass klass,
                         Pool pool, Bool isMutator, ArgList args);
 extern void BufferDestroy(Buffer buffer);
+extern Res BufferForThread(Buffer *bufferReturn, Pool pool);
+extern void BufferThreadRelease(Arena arena, Thread thread);
+extern void BufferThreadFinish(Pool pool);
 extern Bool BufferCheck(Buffer buffer);
 extern Bool SegBufCheck(SegBuf segbuf);
 extern Res BufferDescribe(Buffer buffer, mps_lib_FILE *stream, Count depth);
@@ -23,13 +23,22 @@
 #define testLOOPS 10
 
 
-/* check_allocated_size -- check the allocated size of the pool */
+/* check_allocated_size -- check the allocated size of the pool
+ *
+ * If the pool caches small blocks, they are rounded up to the size of
+ * their class, and blocks in the cache count as allocated.
+ */
+
+static mps_bool_t cached = FALSE;
 
 static void check_allocated_size(mps_pool_t pool, size_t allocated)
 {
   size_t total_size = mps_pool_total_size(pool);
   size_t free_size = mps_pool_free_size(pool);
-  Insist(total_size - free_size == allocated);
+  if (cached)
+    Insist(total_size - free_size >= allocated);
+  else
+    Insist(total_size - free_size == allocated);
 }
 
 
@@ -168,6 +177,25 @@ static void testInArena(mps_arena_class_t arena_class, size_t arena_grain_size,
                mps_class_mvff(), args), "stress MVFF");
   } MPS_ARGS_END(args);
 
+  MPS_ARGS_BEGIN(args) {
+    mps_align_t align = rnd_align(sizeof(void *), arena_grain_size);
+    MPS_ARGS_ADD(args, MPS_KEY_ALIGN, align);
+    MPS_ARGS_ADD(args, MPS_KEY_MVFF_CACHE, TRUE);
+    cached = TRUE;
+    die(stress(arena, NULL, randomSizeAligned, align, "MVFF cached",
+               mps_class_mvff(), args), "stress MVFF cached");
+    cached = FALSE;
+  } MPS_ARGS_END(args);
+
+  MPS_ARGS_BEGIN(args) {
+    mps_align_t align = rnd_align(sizeof(void *), arena_grain_size);
+    MPS_ARGS_ADD(args, MPS_KEY_ALIGN, align);
+    MPS_ARGS_ADD(args, MPS_KEY_MVFF_GOOD_FIT, TRUE);
+    MPS_ARGS_ADD(args, MPS_KEY_SPARE, rnd_double());
+    die(stress(arena, NULL, randomSizeAligned, align, "MVFF good fit",
+               mps_class_mvff(), args), "stress MVFF good fit");
+  } MPS_ARGS_END(args);
+
   MPS_ARGS_BEGIN(args) {
     mps_align_t align = rnd_align(sizeof(void *), arena_grain_size);
     MPS_ARGS_ADD(args, MPS_KEY_ALIGN, align);
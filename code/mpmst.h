@@ -91,11 +91,16 @@ typedef struct mps_pool_s {     /* generic structure */
   Arena arena;                  /* owning arena */
   RingStruct arenaRing;         /* link in list of pools in arena */
   RingStruct bufferRing;        /* allocation buffers are attached to pool */
+  RingStruct idleBufferRing;    /* idle per-thread buffers <design/buffer#.thread> */
   Serial bufferSerial;          /* serial of next buffer */
   RingStruct segRing;           /* segs are attached to pool */
   Align alignment;              /* alignment for grains */
   Shift alignShift;             /* log2(alignment) */
   Format format;                /* format or NULL */
+  Bool softwareBarrier;         /* <design/write-barrier#.software> */
+  Lock cacheLock;               /* protects cache, <design/pool#.cache> */
+  SAC cache;                    /* cache of small blocks, or NULL */
+  SACDepot cacheDepot;          /* magazines for thread caches, or NULL */
 } PoolStruct;
 
 
@@ -234,6 +239,8 @@ typedef struct SegStruct {      /* segment structure */
   TraceSet nailed : TraceLIMIT; /* traces for which seg has nailed objects */
   RankSet rankSet : RankLIMIT;  /* ranks of references in this seg */
   unsigned defer : WB_DEFER_BITS; /* defer write barrier for this many scans */
+  BOOLFIELD(frozen);            /* never condemned, <design/strategy#.freeze> */
+  BOOLFIELD(clean);             /* refers only to frozen objects */
 } SegStruct;
 
 
@@ -246,7 +253,8 @@ typedef struct SegStruct {      /* segment structure */
 
 typedef struct GCSegStruct {    /* GC segment structure */
   SegStruct segStruct;          /* superclass fields must come first */
-  RingStruct greyRing;          /* link in list of grey segs */
+  RingStruct greyRing[TraceLIMIT]; /* link in each trace's grey segs */
+  RingStruct whiteRing[TraceLIMIT]; /* link in each trace's white segs */
   RefSet summary;               /* summary of references out of seg */
   Buffer buffer;                /* non-NULL if seg is buffered */
   RingStruct genRing;           /* link in list of segs in gen */
@@ -325,6 +333,9 @@ typedef struct BufferStruct {
   Addr poolLimit;               /* the pool's idea of the limit */
   Align alignment;              /* allocation alignment */
   unsigned rampCount;           /* see <code/buffer.c#ramp.hack> */
+  Bool perThread;               /* <design/buffer#.thread> */
+  Thread thread;                /* thread using per-thread buffer, or NULL */
+  RingStruct threadRing;        /* in thread's or pool's idle buffer ring */
 } BufferStruct;
 
 
@@ -417,6 +428,9 @@ typedef struct ScanStateStruct {
   STATISTIC_DECL(Count preservedInPlaceCount) /* objects preserved in place */
   STATISTIC_DECL(Size copiedSize) /* bytes copied */
   Size scannedSize;             /* bytes scanned */
+  Size boringSize;              /* bytes known not to refer to white set */
+  Count deferCount;             /* number of deferred fixes */
+  mps_addr_t *deferred[ScanStateDeferLENGTH]; /* <design/trace#.fix.defer> */
 } ScanStateStruct;
 
 
@@ -437,12 +451,15 @@ typedef struct TraceStruct {
   SegFixMethod fix;             /* fix method to apply to references */
   void *fixClosure;             /* see .ss.fix-closure */
   RingStruct genRing;           /* ring of generations condemned for trace */
+  RingStruct greyRing[RankLIMIT]; /* ring of grey segments at each rank */
+  RingStruct whiteRing;         /* ring of white segments */
   STATISTIC_DECL(Size preTraceArenaReserved) /* ArenaReserved before this trace */
   Size condemned;               /* condemned bytes */
   Size notCondemned;            /* collectable but not condemned */
   Size foundation;              /* initial grey set size */
   Work quantumWork;             /* tracing work to be done in each poll */
-  STATISTIC_DECL(Count greySegCount) /* number of grey segments */
+  Count greySegCount;           /* number of grey segments */
+  Size reclaimWork;             /* <design/trace#.reclaim.work> */
   STATISTIC_DECL(Count greySegMax) /* maximum number of grey segments */
   STATISTIC_DECL(Count rootScanCount) /* number of roots scanned */
   Count rootScanSize;           /* total size of scanned roots */
@@ -481,6 +498,7 @@ typedef struct mps_arena_class_s {
   ArenaCreateMethod create;
   ArenaDestroyMethod destroy;
   ArenaPurgeSpareMethod purgeSpare;
+  ArenaFillSpareMethod fillSpare;
   ArenaExtendMethod extend;
   ArenaGrowMethod grow;
   ArenaFreeMethod free;
@@ -605,6 +623,42 @@ typedef struct CBSStruct {
 } CBSStruct;
 
 
+/* BTreeStruct -- B-tree land
+ *
+ * BTree is a Land implementation that maintains a collection of
+ * disjoint ranges in a B+-tree.
+ *
+ * See <code/btree.c>.
+ */
+
+#define BTreeSig ((Sig)0x519B72EE) /* SIGnature B-TREE */
+
+typedef struct BTreeStruct {
+  LandStruct landStruct;        /* superclass fields come first */
+  BTreeNode root;               /* root node, or NULL if empty */
+  Count height;                 /* number of levels of nodes */
+  Pool blockPool;               /* pool that manages nodes */
+  Size nodeSize;                /* size of node structure */
+  Bool ownPool;                 /* did we create blockPool? */
+  Bool zoned;                   /* maintain zone sets? */
+  Size size;                    /* total size of ranges in B-tree */
+  STATISTIC_DECL(Count rangeCount) /* number of ranges in B-tree */
+  Sig sig;                      /* .class.end-sig */
+} BTreeStruct;
+
+
+/* TreeLandStruct -- address-ordered land used by the arena and MVFF
+ *
+ * See <design/btree#.config>.
+ */
+
+#if defined(CONFIG_LAND_BTREE)
+typedef BTreeStruct TreeLandStruct;
+#else
+typedef CBSStruct TreeLandStruct;
+#endif
+
+
 /* FailoverStruct -- fail over from one land to another
  *
  * Failover is a Land implementation that combines two other Lands,
@@ -715,8 +769,9 @@ typedef struct MVFFStruct {     /* MVFF pool outer structure */
   Size avgSize;                 /* client estimate of allocation size */
   double spare;                 /* spare space fraction, see MVFFReduce */
   MFSStruct cbsBlockPoolStruct; /* stores blocks for CBSs */
-  CBSStruct totalCBSStruct;     /* all memory allocated from the arena */
-  CBSStruct freeCBSStruct;      /* free memory (primary) */
+  TreeLandStruct totalCBSStruct; /* all memory allocated from the arena */
+  TreeLandStruct freeCBSStruct; /* free memory (primary, unless good fit) */
+  Land freePrimary;             /* free memory (primary) */
   FreelistStruct flStruct;      /* free memory (secondary, for emergencies) */
   FailoverStruct foStruct;      /* free memory (fail-over mechanism) */
   Bool firstFit;                /* as opposed to last fit */
@@ -725,6 +780,30 @@ typedef struct MVFFStruct {     /* MVFF pool outer structure */
 } MVFFStruct;
 
 
+/* ChunkMapEntryStruct -- entry in the arena's chunk map
+ *
+ * See <code/tract.c#chunk-map>.
+ */
+
+typedef struct ChunkMapEntryStruct {
+  Chunk chunk;                  /* only or lower chunk in entry, or NULL */
+  Chunk upper;                  /* upper of two chunks in entry, or NULL */
+  Bool shared;                  /* more than two chunks in this entry? */
+} ChunkMapEntryStruct;
+
+
+/* CardTableStruct -- software write barrier card table
+ *
+ * See <code/arena.c#cards>.
+ */
+
+typedef struct CardTableStruct {
+  mps_wb_cards_s wbCards;       /* the table, <code/mps.h#wb> */
+  CardTable older;              /* table this one replaced, or NULL */
+  Size size;                    /* size of this block */
+} CardTableStruct;
+
+
 /* ArenaStruct -- generic arena
  *
  * See <code/arena.c>.
@@ -747,7 +826,11 @@ typedef struct mps_arena_s {
 
   Size spareCommitted;          /* amount of memory in hysteresis fund */
   double spare;                 /* maximum spareCommitted/committed */
+  Bool purgeDeferred;           /* <design/arena#.spare.defer> */
+  Clock lastPurge;              /* <design/arena#.spare.decay> */
+  Size commitAhead;             /* <design/arena#.spare.ahead> */
   double pauseTime;             /* maximum pause time, in seconds */
+  Bool background;              /* <design/strategy#.policy.background> */
 
   Shift zoneShift;              /* see also <code/ref.c> */
   Size grainSize;               /* <design/arena#.grain> */
@@ -758,13 +841,20 @@ typedef struct mps_arena_s {
   Chunk primary;                /* the primary chunk */
   RingStruct chunkRing;         /* all the chunks, in a ring for iteration */
   Tree chunkTree;               /* all the chunks, in a tree for fast lookup */
+  Addr chunkMapBase;            /* base of address range in chunk map */
+  Shift chunkMapShift;          /* log2 of address space per map entry */
+  ChunkMapEntryStruct chunkMap[ChunkMapLENGTH]; /* <code/tract.c#chunk-map> */
   Serial chunkSerial;           /* next chunk number */
 
   Bool hasFreeLand;              /* Is freeLand available? */
   MFSStruct freeCBSBlockPoolStruct;
-  CBSStruct freeLandStruct;
+  TreeLandStruct freeLandStruct;
   ZoneSet freeZones;            /* zones not yet allocated */
   Bool zoned;                   /* use zoned allocation? */
+  Bool softDirty;               /* <design/write-barrier#.soft-dirty> */
+  Bool hasCards;                /* card table allocated? */
+  mps_wb_s wbStruct;            /* <design/write-barrier#.software> */
+  CardTable cardTables;         /* card tables, newest first */
 
   /* locus fields <code/locus.c> */
   GenDescStruct topGen;         /* generation descriptor for dynamic gen */
@@ -805,7 +895,6 @@ typedef struct mps_arena_s {
   double tracedTime;
   Clock lastWorldCollect;
 
-  RingStruct greyRing[RankLIMIT]; /* ring of grey segments at each rank */
   RingStruct chainRing;         /* ring of chains */
 
   struct HistoryStruct historyStruct;
@@ -73,6 +73,8 @@ typedef struct BufferClassStruct *BufferClass; /* <design/buffer> */
 typedef unsigned BufferMode;            /* <design/buffer> */
 typedef struct mps_fmt_s *Format;       /* <design/format> */
 typedef struct LockStruct *Lock;        /* <code/lock.c>* */
+typedef struct SACStruct *SAC;          /* <code/sac.c> */
+typedef struct SACDepotStruct *SACDepot; /* <code/sac.c> */
 typedef struct mps_pool_s *Pool;        /* <design/pool> */
 typedef Pool AbstractPool;
 typedef struct mps_pool_class_s *PoolClass;  /* <code/poolclas.c> */
@@ -81,7 +83,8 @@ typedef struct ScanStateStruct *ScanState; /* <design/trace> */
 typedef struct mps_chain_s *Chain;      /* <design/trace> */
 typedef struct TractStruct *Tract;      /* <design/arena> */
 typedef struct ChunkStruct *Chunk;      /* <code/tract.c> */
-typedef struct ChunkCacheEntryStruct *ChunkCacheEntry; /* <code/tract.c> */
+typedef struct ChunkMapEntryStruct *ChunkMapEntry; /* <code/tract.c> */
+typedef struct CardTableStruct *CardTable; /* <code/arena.c#cards> */
 typedef union PageUnion *Page;          /* <code/tract.c> */
 typedef struct SegStruct *Seg;          /* <code/seg.c> */
 typedef struct GCSegStruct *GCSeg;      /* <code/seg.c> */
@@ -104,6 +107,7 @@ typedef struct RangeStruct *Range;      /* <design/range> */
 typedef struct RangeTreeStruct *RangeTree;
 typedef struct LandStruct *Land;        /* <design/land> */
 typedef struct LandClassStruct *LandClass; /* <design/land> */
+typedef struct BTreeNodeStruct *BTreeNode; /* <design/btree> */
 typedef unsigned FindDelete;            /* <design/land> */
 typedef struct ShieldStruct *Shield; /* <design/shield> */
 typedef struct HistoryStruct *History;  /* <design/arena#.ld> */
@@ -117,6 +121,7 @@ typedef Res (*ArenaCreateMethod)(Arena *arenaReturn, ArgList args);
 typedef void (*ArenaDestroyMethod)(Arena arena);
 typedef Res (*ArenaInitMethod)(Arena arena, Size grainSize, ArgList args);
 typedef Size (*ArenaPurgeSpareMethod)(Arena arena, Size size);
+typedef Size (*ArenaFillSpareMethod)(Arena arena, Size size);
 typedef Res (*ArenaExtendMethod)(Arena arena, Addr base, Size size);
 typedef Res (*ArenaGrowMethod)(Arena arena, LocusPref pref, Size size);
 typedef void (*ArenaFreeMethod)(Addr base, Size size, Pool pool);
@@ -67,6 +67,8 @@
 #include "rangetree.c"
 #include "splay.c"
 #include "cbs.c"
+#include "tlsf.c"
+#include "btree.c"
 #include "ss.c"
 #include "version.c"
 #include "table.c"
@@ -106,6 +108,7 @@
 #include "than.c"       /* generic threads manager */
 #include "vman.c"       /* malloc-based pseudo memory mapping */
 #include "protan.c"     /* generic memory protection */
+#include "protsdan.c"   /* generic dirty page tracking */
 #include "prmcan.c"     /* generic operating system mutator context */
 #include "prmcanan.c"   /* generic architecture mutator context */
 #include "span.c"       /* generic stack probe */
@@ -118,6 +121,7 @@
 #include "thxc.c"       /* macOS Mach threading */
 #include "vmix.c"       /* Posix virtual memory */
 #include "protix.c"     /* Posix protection */
+#include "protsdan.c"   /* generic dirty page tracking */
 #include "protxc.c"     /* macOS Mach exception handling */
 #include "prmci3.c"     /* IA-32 mutator context */
 #include "prmcxc.c"     /* macOS mutator context */
@@ -132,6 +136,7 @@
 #include "thxc.c"       /* macOS Mach threading */
 #include "vmix.c"       /* Posix virtual memory */
 #include "protix.c"     /* Posix protection */
+#include "protsdan.c"   /* generic dirty page tracking */
 #include "protxc.c"     /* macOS Mach exception handling */
 #include "prmci6.c"     /* x86-64 mutator context */
 #include "prmcxc.c"     /* macOS mutator context */
@@ -147,6 +152,7 @@
 #include "pthrdext.c"   /* Posix thread extensions */
 #include "vmix.c"       /* Posix virtual memory */
 #include "protix.c"     /* Posix protection */
+#include "protsdan.c"   /* generic dirty page tracking */
 #include "protsgix.c"   /* Posix signal handling */
 #include "prmcanan.c"   /* generic architecture mutator context */
 #include "prmcix.c"     /* Posix mutator context */
@@ -162,6 +168,7 @@
 #include "pthrdext.c"   /* Posix thread extensions */
 #include "vmix.c"       /* Posix virtual memory */
 #include "protix.c"     /* Posix protection */
+#include "protsdan.c"   /* generic dirty page tracking */
 #include "protsgix.c"   /* Posix signal handling */
 #include "prmcanan.c"   /* generic architecture mutator context */
 #include "prmcix.c"     /* Posix mutator context */
@@ -177,6 +184,7 @@
 #include "pthrdext.c"   /* Posix thread extensions */
 #include "vmix.c"       /* Posix virtual memory */
 #include "protix.c"     /* Posix protection */
+#include "protsdli.c"   /* Linux soft-dirty page tracking */
 #include "protsgix.c"   /* Posix signal handling */
 #include "prmci3.c"     /* IA-32 mutator context */
 #include "prmcix.c"     /* Posix mutator context */
@@ -192,6 +200,7 @@
 #include "pthrdext.c"   /* Posix thread extensions */
 #include "vmix.c"       /* Posix virtual memory */
 #include "protix.c"     /* Posix protection */
+#include "protsdli.c"   /* Linux soft-dirty page tracking */
 #include "protsgix.c"   /* Posix signal handling */
 #include "prmci6.c"     /* x86-64 mutator context */
 #include "prmcix.c"     /* Posix mutator context */
@@ -206,6 +215,7 @@
 #include "thw3.c"       /* Windows threading */
 #include "vmw3.c"       /* Windows virtual memory */
 #include "protw3.c"     /* Windows protection */
+#include "protsdan.c"   /* generic dirty page tracking */
 #include "prmci3.c"     /* IA-32 mutator context */
 #include "prmcw3.c"     /* Windows mutator context */
 #include "prmcw3i3.c"   /* Windows on IA-32 mutator context */
@@ -220,6 +230,7 @@
 #include "thw3.c"       /* Windows threading */
 #include "vmw3.c"       /* Windows virtual memory */
 #include "protw3.c"     /* Windows protection */
+#include "protsdan.c"   /* generic dirty page tracking */
 #include "prmci6.c"     /* x86-64 mutator context */
 #include "prmcw3.c"     /* Windows mutator context */
 #include "prmcw3i6.c"   /* Windows on x86-64 mutator context */
@@ -57,6 +57,7 @@ typedef struct mps_thr_s    *mps_thr_t;    /* thread registration */
 typedef struct mps_ap_s     *mps_ap_t;     /* allocation point */
 typedef struct mps_ld_s     *mps_ld_t;     /* location dependency */
 typedef struct mps_ss_s     *mps_ss_t;     /* scan state */
+typedef struct mps_wb_s     *mps_wb_t;     /* software write barrier */
 typedef struct mps_message_s
   *mps_message_t;                          /* message */
 typedef struct mps_alloc_pattern_s
@@ -171,6 +172,21 @@ extern const struct mps_key_s _mps_key_ARENA_SIZE;
 extern const struct mps_key_s _mps_key_ARENA_ZONED;
 #define MPS_KEY_ARENA_ZONED     (&_mps_key_ARENA_ZONED)
 #define MPS_KEY_ARENA_ZONED_FIELD b
+extern const struct mps_key_s _mps_key_ARENA_SOFT_DIRTY;
+#define MPS_KEY_ARENA_SOFT_DIRTY (&_mps_key_ARENA_SOFT_DIRTY)
+#define MPS_KEY_ARENA_SOFT_DIRTY_FIELD b
+extern const struct mps_key_s _mps_key_ARENA_HUGE_PAGES;
+#define MPS_KEY_ARENA_HUGE_PAGES (&_mps_key_ARENA_HUGE_PAGES)
+#define MPS_KEY_ARENA_HUGE_PAGES_FIELD b
+extern const struct mps_key_s _mps_key_ARENA_SPARE_DISCARD;
+#define MPS_KEY_ARENA_SPARE_DISCARD (&_mps_key_ARENA_SPARE_DISCARD)
+#define MPS_KEY_ARENA_SPARE_DISCARD_FIELD b
+extern const struct mps_key_s _mps_key_ARENA_PREFAULT;
+#define MPS_KEY_ARENA_PREFAULT (&_mps_key_ARENA_PREFAULT)
+#define MPS_KEY_ARENA_PREFAULT_FIELD b
+extern const struct mps_key_s _mps_key_ARENA_COMMIT_AHEAD;
+#define MPS_KEY_ARENA_COMMIT_AHEAD (&_mps_key_ARENA_COMMIT_AHEAD)
+#define MPS_KEY_ARENA_COMMIT_AHEAD_FIELD size
 extern const struct mps_key_s _mps_key_FORMAT;
 #define MPS_KEY_FORMAT          (&_mps_key_FORMAT)
 #define MPS_KEY_FORMAT_FIELD    format
@@ -217,6 +233,9 @@ extern const struct mps_key_s _mps_key_SPARE;
 extern const struct mps_key_s _mps_key_INTERIOR;
 #define MPS_KEY_INTERIOR        (&_mps_key_INTERIOR)
 #define MPS_KEY_INTERIOR_FIELD  b
+extern const struct mps_key_s _mps_key_SOFTWARE_BARRIER;
+#define MPS_KEY_SOFTWARE_BARRIER (&_mps_key_SOFTWARE_BARRIER)
+#define MPS_KEY_SOFTWARE_BARRIER_FIELD b
 
 extern const struct mps_key_s _mps_key_VMW3_TOP_DOWN;
 #define MPS_KEY_VMW3_TOP_DOWN   (&_mps_key_VMW3_TOP_DOWN)
@@ -353,6 +372,13 @@ typedef struct mps_sac_class_s {
 
 #define mps_sac_classes_s mps_sac_class_s
 
+typedef struct mps_sac_stats_s {
+  size_t mps_allocs;            /* allocations through the cache */
+  size_t mps_fills;             /* allocations that missed the cache */
+  size_t mps_empties;           /* frees that overflowed the cache */
+  size_t mps_adapts;            /* times an adaptive cache adapted */
+} mps_sac_stats_s;
+
 
 /* Location Dependency */
 /* .ld: Keep in sync with <code/mpmst.h#ld.struct>. */
@@ -370,6 +396,21 @@ typedef struct mps_ss_s {
 } mps_ss_s;
 
 
+/* Software Write Barrier */
+/* .wb: Keep in sync with <code/arena.c#cards>. */
+
+typedef struct mps_wb_cards_s {
+  mps_word_t _base;             /* address of first card */
+  mps_word_t _count;            /* number of cards, not counting overflow */
+  mps_word_t _shift;            /* log2 of bytes per card */
+  unsigned char *_cards;        /* cards, followed by the overflow card */
+} mps_wb_cards_s;
+
+typedef struct mps_wb_s {
+  mps_wb_cards_s *_table;       /* current card table */
+} mps_wb_s;
+
+
 /* Format Variants */
 
 typedef struct mps_fmt_A_s {
@@ -436,6 +477,7 @@ extern void mps_arena_clamp(mps_arena_t);
 extern void mps_arena_release(mps_arena_t);
 extern void mps_arena_park(mps_arena_t);
 extern void mps_arena_postmortem(mps_arena_t);
+extern void mps_arena_freeze(mps_arena_t);
 extern mps_res_t mps_arena_start_collect(mps_arena_t);
 extern mps_res_t mps_arena_collect(mps_arena_t);
 extern mps_bool_t mps_arena_step(mps_arena_t, double, double);
@@ -460,6 +502,9 @@ extern size_t mps_arena_spare_commit_limit(mps_arena_t);
 extern double mps_arena_pause_time(mps_arena_t);
 extern void mps_arena_pause_time_set(mps_arena_t, double);
 
+extern mps_bool_t mps_arena_background(mps_arena_t);
+extern void mps_arena_background_set(mps_arena_t, mps_bool_t);
+
 extern mps_bool_t mps_arena_busy(mps_arena_t);
 extern mps_bool_t mps_arena_has_addr(mps_arena_t, mps_addr_t);
 extern mps_bool_t mps_addr_pool(mps_pool_t *, mps_arena_t, mps_addr_t);
@@ -524,6 +569,7 @@ extern void mps_free(mps_pool_t, mps_addr_t, size_t);
 extern mps_res_t mps_ap_create(mps_ap_t *, mps_pool_t, ...);
 extern mps_res_t mps_ap_create_v(mps_ap_t *, mps_pool_t, va_list);
 extern mps_res_t mps_ap_create_k(mps_ap_t *, mps_pool_t, mps_arg_s []);
+extern mps_res_t mps_ap_for_thread(mps_ap_t *, mps_pool_t);
 extern void mps_ap_destroy(mps_ap_t);
 
 extern mps_res_t (mps_reserve)(mps_addr_t *, mps_ap_t, size_t);
@@ -547,10 +593,13 @@ extern mps_res_t mps_ap_alloc_pattern_reset(mps_ap_t);
 
 extern mps_res_t mps_sac_create(mps_sac_t *, mps_pool_t, size_t,
                                 mps_sac_classes_s *);
+extern mps_res_t mps_sac_create_magazine(mps_sac_t *, mps_pool_t);
+extern mps_res_t mps_sac_create_adaptive(mps_sac_t *, mps_pool_t, size_t);
 extern void mps_sac_destroy(mps_sac_t);
 extern mps_res_t mps_sac_alloc(mps_addr_t *, mps_sac_t, size_t, mps_bool_t);
 extern void mps_sac_free(mps_sac_t, mps_addr_t, size_t);
 extern void mps_sac_flush(mps_sac_t);
+extern void mps_sac_stats(mps_sac_stats_s *, mps_sac_t);
 
 /* Direct access to mps_sac_fill and mps_sac_empty is not supported. */
 extern mps_res_t mps_sac_fill(mps_addr_t *, mps_sac_t, size_t, mps_bool_t);
@@ -705,6 +754,27 @@ extern mps_bool_t mps_ld_isstale_any(mps_ld_t, mps_arena_t);
 extern mps_word_t mps_collections(mps_arena_t);
 
 
+/* Software Write Barrier */
+/* .wb.store: Keep in sync with <code/arena.c#cards>. */
+
+extern mps_wb_t mps_arena_wb(mps_arena_t);
+
+#define MPS_WRITE_BARRIER(wb, addr, ref) \
+  MPS_BEGIN \
+    mps_wb_t _mps_wb = (wb); \
+    mps_addr_t *_mps_wb_addr = (addr); \
+    mps_wb_cards_s *_mps_wb_table; \
+    mps_word_t _mps_wb_card; \
+    *_mps_wb_addr = (ref); \
+    _mps_wb_table = _mps_wb->_table; \
+    _mps_wb_card = ((mps_word_t)_mps_wb_addr - _mps_wb_table->_base) \
+                   >> _mps_wb_table->_shift; \
+    if (_mps_wb_card > _mps_wb_table->_count) \
+      _mps_wb_card = _mps_wb_table->_count; \
+    _mps_wb_table->_cards[_mps_wb_card] = 1; \
+  MPS_END
+
+
 /* Messages */
 
 extern void mps_message_type_enable(mps_arena_t, mps_message_type_t);
@@ -819,6 +889,12 @@ extern mps_res_t _mps_fix2(mps_ss_t, mps_addr_t *);
   (MPS_FIX1(ss, *(ref_io)) ? \
    MPS_FIX2(ss, ref_io) : MPS_RES_OK)
 
+extern mps_res_t _mps_fix_defer(mps_ss_t, mps_addr_t *);
+extern mps_res_t mps_fix_flush(mps_ss_t);
+#define MPS_FIX_DEFER(ss, ref_io) \
+  (MPS_FIX1(ss, *(ref_io)) ? \
+   _mps_fix_defer(ss, ref_io) : MPS_RES_OK)
+
 /* MPS_FIX is deprecated */
 #define MPS_FIX(ss, ref_io) MPS_FIX12(ss, ref_io)
 
@@ -256,6 +256,24 @@ void mps_arena_pause_time_set(mps_arena_t arena, double pause_time)
   ArenaLeave(arena);
 }
 
+mps_bool_t mps_arena_background(mps_arena_t arena)
+{
+  Bool background;
+
+  ArenaEnter(arena);
+  background = ArenaBackground(arena);
+  ArenaLeave(arena);
+
+  return background;
+}
+
+void mps_arena_background_set(mps_arena_t arena, mps_bool_t background)
+{
+  ArenaEnter(arena);
+  ArenaSetBackground(arena, BOOLOF(background));
+  ArenaLeave(arena);
+}
+
 
 void mps_arena_clamp(mps_arena_t arena)
 {
@@ -283,6 +301,14 @@ void mps_arena_park(mps_arena_t arena)
 }
 
 
+void mps_arena_freeze(mps_arena_t arena)
+{
+  ArenaEnter(arena);
+  ArenaFreeze(ArenaGlobals(arena));
+  ArenaLeave(arena);
+}
+
+
 void mps_arena_postmortem(mps_arena_t arena)
 {
   /* Don't call ArenaEnter -- one of the purposes of this function is
@@ -775,6 +801,12 @@ mps_res_t mps_alloc(mps_addr_t *p_o, mps_pool_t pool, size_t size)
   AVER_CRITICAL(TESTT(Pool, pool));
   arena = PoolArena(pool);
 
+  /* <design/pool#.cache.lock> */
+  if (pool->cache != NULL && PoolCacheAlloc(&p, pool, size)) {
+    *p_o = (mps_addr_t)p;
+    return MPS_RES_OK;
+  }
+
   ArenaEnter(arena);
   STACK_CONTEXT_BEGIN(arena) {
 
@@ -786,7 +818,10 @@ mps_res_t mps_alloc(mps_addr_t *p_o, mps_pool_t pool, size_t size)
     /* Note: class may allow unaligned size, see */
     /* <design/pool#.method.alloc.size.align>. */
 
-    res = PoolAlloc(&p, pool, size);
+    if (pool->cache != NULL)
+      res = PoolCacheFill(&p, pool, size);
+    else
+      res = PoolAlloc(&p, pool, size);
 
   } STACK_CONTEXT_END(arena);
   ArenaLeave(arena);
@@ -805,6 +840,10 @@ void mps_free(mps_pool_t pool, mps_addr_t p, size_t size)
   AVER_CRITICAL(TESTT(Pool, pool));
   arena = PoolArena(pool);
 
+  /* <design/pool#.cache.lock> */
+  if (pool->cache != NULL && PoolCacheFree(pool, (Addr)p, size))
+    return;
+
   ArenaEnter(arena);
 
   AVERT_CRITICAL(Pool, pool);
@@ -812,7 +851,10 @@ void mps_free(mps_pool_t pool, mps_addr_t p, size_t size)
   /* Note: class may allow unaligned size, see */
   /* <design/pool#.method.free.size.align>. */
 
-  PoolFree(pool, (Addr)p, size);
+  if (pool->cache != NULL)
+    PoolCacheEmpty(pool, (Addr)p, size);
+  else
+    PoolFree(pool, (Addr)p, size);
   ArenaLeave(arena);
 }
 
@@ -882,6 +924,35 @@ mps_res_t mps_ap_create_k(mps_ap_t *mps_ap_o,
   return MPS_RES_OK;
 }
 
+/* mps_ap_for_thread -- get the calling thread's allocation point
+ *
+ * <design/buffer#.thread>.
+ */
+
+mps_res_t mps_ap_for_thread(mps_ap_t *mps_ap_o, mps_pool_t pool)
+{
+  Arena arena;
+  Buffer buf;
+  Res res;
+
+  AVER(mps_ap_o != NULL);
+  AVER(TESTT(Pool, pool));
+  arena = PoolArena(pool);
+
+  ArenaEnter(arena);
+
+  AVERT(Pool, pool);
+  res = BufferForThread(&buf, pool);
+
+  ArenaLeave(arena);
+
+  if (res != ResOK)
+    return (mps_res_t)res;
+
+  *mps_ap_o = BufferAP(buf);
+  return MPS_RES_OK;
+}
+
 void mps_ap_destroy(mps_ap_t mps_ap)
 {
   Buffer buf = BufferOfAP(mps_ap);
@@ -893,6 +964,9 @@ void mps_ap_destroy(mps_ap_t mps_ap)
 
   ArenaEnter(arena);
 
+  /* Per-thread allocation points are destroyed with their pool. */
+  AVER(!buf->perThread);
+
   BufferDestroy(buf);
 
   ArenaLeave(arena);
@@ -1137,6 +1211,57 @@ mps_res_t mps_sac_create(mps_sac_t *mps_sac_o, mps_pool_t pool,
 }
 
 
+/* mps_sac_create_magazine -- create an SAC that uses the pool's depot */
+
+mps_res_t mps_sac_create_magazine(mps_sac_t *mps_sac_o, mps_pool_t pool)
+{
+  Arena arena;
+  SAC sac;
+  Res res;
+
+  AVER(mps_sac_o != NULL);
+  AVER(TESTT(Pool, pool));
+  arena = PoolArena(pool);
+
+  ArenaEnter(arena);
+
+  res = PoolCacheSACCreate(&sac, pool);
+
+  ArenaLeave(arena);
+
+  if (res != ResOK)
+    return (mps_res_t)res;
+  *mps_sac_o = ExternalSACOfSAC(sac);
+  return (mps_res_t)res;
+}
+
+
+/* mps_sac_create_adaptive -- create an SAC that adapts its classes */
+
+mps_res_t mps_sac_create_adaptive(mps_sac_t *mps_sac_o, mps_pool_t pool,
+                                  size_t cache_size)
+{
+  Arena arena;
+  SAC sac;
+  Res res;
+
+  AVER(mps_sac_o != NULL);
+  AVER(TESTT(Pool, pool));
+  arena = PoolArena(pool);
+
+  ArenaEnter(arena);
+
+  res = SACCreateAdaptive(&sac, pool, (Size)cache_size);
+
+  ArenaLeave(arena);
+
+  if (res != ResOK)
+    return (mps_res_t)res;
+  *mps_sac_o = ExternalSACOfSAC(sac);
+  return (mps_res_t)res;
+}
+
+
 /* mps_sac_destroy -- destroy an SAC object */
 
 void mps_sac_destroy(mps_sac_t mps_sac)
@@ -1173,6 +1298,26 @@ void mps_sac_flush(mps_sac_t mps_sac)
 }
 
 
+/* mps_sac_stats -- report how well an SAC is doing
+ *
+ * The SAC belongs to the calling thread, and its counts are only
+ * updated by that thread, so this doesn't need the arena lock.
+ */
+
+void mps_sac_stats(mps_sac_stats_s *stats_o, mps_sac_t mps_sac)
+{
+  SAC sac = SACOfExternalSAC(mps_sac);
+
+  AVER(stats_o != NULL);
+  AVER(TESTT(SAC, sac));
+
+  stats_o->mps_allocs = sac->allocCount;
+  stats_o->mps_fills = sac->fillCount;
+  stats_o->mps_empties = sac->emptyCount;
+  stats_o->mps_adapts = sac->adapt == NULL ? 0 : sac->adapt->adaptCount;
+}
+
+
 /* mps_sac_fill -- alloc an object, and perhaps fill the cache */
 
 mps_res_t mps_sac_fill(mps_addr_t *p_o, mps_sac_t mps_sac, size_t size,
@@ -1188,6 +1333,12 @@ mps_res_t mps_sac_fill(mps_addr_t *p_o, mps_sac_t mps_sac, size_t size,
   arena = SACArena(sac);
   UNUSED(unused);
 
+  /* <design/pool#.cache.magazine.lock> */
+  if (sac->depot != NULL && SACDepotFill(&p, sac, size)) {
+    *p_o = (mps_addr_t)p;
+    return MPS_RES_OK;
+  }
+
   ArenaEnter(arena);
 
   res = SACFill(&p, sac, size);
@@ -1211,6 +1362,9 @@ void mps_sac_empty(mps_sac_t mps_sac, mps_addr_t p, size_t size)
   AVER(TESTT(SAC, sac));
   arena = SACArena(sac);
 
+  if (sac->depot != NULL && SACDepotEmpty(sac, (Addr)p, (Size)size))
+    return;
+
   ArenaEnter(arena);
 
   SACEmpty(sac, (Addr)p, (Size)size);
@@ -1224,12 +1378,16 @@ void mps_sac_empty(mps_sac_t mps_sac, mps_addr_t p, size_t size)
 mps_res_t mps_sac_alloc(mps_addr_t *p_o, mps_sac_t mps_sac, size_t size,
                         mps_bool_t unused)
 {
+  SAC sac = SACOfExternalSAC(mps_sac);
   Res res;
 
   AVER(p_o != NULL);
-  AVER(TESTT(SAC, SACOfExternalSAC(mps_sac)));
+  AVER(TESTT(SAC, sac));
   AVER(size > 0);
 
+  /* Counted here rather than in MPS_SAC_ALLOC_FAST, because clients
+     compile the layout of _mps_sac_s into their code. */
+  ++sac->allocCount;
   MPS_SAC_ALLOC_FAST(res, *p_o, mps_sac, size, (unused != 0));
   return (mps_res_t)res;
 }
@@ -1606,6 +1764,7 @@ void mps_thread_dereg(mps_thr_t thread)
 
   ArenaEnter(arena);
 
+  BufferThreadRelease(arena, thread);
   ThreadDeregister(thread, arena);
 
   ArenaLeave(arena);
@@ -1669,6 +1828,18 @@ mps_word_t mps_collections(mps_arena_t arena)
 }
 
 
+/* mps_arena_wb -- get the software write barrier for an arena
+ *
+ * The structure is embedded in the arena, so its address never
+ * changes and no lock is needed: see <code/arena.c#cards.grow>.
+ */
+
+mps_wb_t mps_arena_wb(mps_arena_t arena)
+{
+  return ArenaWB(arena);
+}
+
+
 /* mps_finalize -- register for finalization */
 
 mps_res_t mps_finalize(mps_arena_t arena, mps_addr_t *refref)
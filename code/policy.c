@@ -15,6 +15,60 @@
 SRCID(policy, "$Id$");
 
 
+/* policyOverCommitLimit -- would allocating definitely exceed the
+ * commit limit? */
+
+static Bool policyOverCommitLimit(Arena arena, Size size)
+{
+  if (arena->spareCommitted < size) {
+    Size necessaryCommitIncrease = size - arena->spareCommitted;
+    if (arena->committed + necessaryCommitIncrease > arena->commitLimit
+        || arena->committed + necessaryCommitIncrease < arena->committed) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+
+/* policyPollSoon -- make the next poll do some tracing work
+ *
+ * A failed allocation doesn't advance fillMutatorSize, so without this
+ * a mutator that retries an allocation that failed during a trace
+ * would never poll again, and the trace would never free the memory.
+ * See <design/trace#.reclaim.demand.progress>.
+ */
+
+static void policyPollSoon(Arena arena)
+{
+  Globals globals = ArenaGlobals(arena);
+  if (globals->pollThreshold > globals->fillMutatorSize)
+    globals->pollThreshold = globals->fillMutatorSize;
+}
+
+
+/* policyAllocZones -- allocate from the free land in zones, then in
+ * moreZones */
+
+static Res policyAllocZones(Tract *tractReturn, Arena arena,
+                            LocusPref pref, ZoneSet zones,
+                            ZoneSet moreZones, Size size, Pool pool)
+{
+  Res res = ResRESOURCE;
+
+  if (zones != ZoneSetEMPTY) {
+    res = ArenaFreeLandAlloc(tractReturn, arena, zones, pref->high,
+                             size, pool);
+    if (res == ResOK)
+      return res;
+  }
+  if (moreZones != zones)
+    res = ArenaFreeLandAlloc(tractReturn, arena, moreZones, pref->high,
+                             size, pool);
+  return res;
+}
+
+
 /* PolicyAlloc -- allocation policy
  *
  * This is the code responsible for making decisions about where to allocate
@@ -45,36 +99,49 @@ Res PolicyAlloc(Tract *tractReturn, Arena arena, LocusPref pref,
   AVER(arena == PoolArena(pool));
 
   /* Don't attempt to allocate if doing so would definitely exceed the
-   * commit limit. */
-  if (arena->spareCommitted < size) {
-    Size necessaryCommitIncrease = size - arena->spareCommitted;
-    if (arena->committed + necessaryCommitIncrease > arena->commitLimit
-        || arena->committed + necessaryCommitIncrease < arena->committed) {
+   * commit limit, unless reclaiming the condemned segments of a
+   * finished trace makes room.  Only do this for automatically
+   * managed pools, so that reclaiming doesn't re-enter the pools
+   * that the arena uses for its own structures.
+   * <design/trace#.reclaim.demand> */
+  if (policyOverCommitLimit(arena, size)) {
+    Bool over = TRUE;
+    while (over && PoolHasAttr(pool, AttrGC)
+           && TraceReclaimSome(arena, TraceReclaimDemandCOUNT))
+      over = policyOverCommitLimit(arena, size);
+    if (over) {
+      if (PoolHasAttr(pool, AttrGC))
+        policyPollSoon(arena);
       return ResCOMMIT_LIMIT;
     }
   }
 
-  /* Plan A: allocate from the free land in the requested zones */
-  zones = ZoneSetDiff(pref->zones, pref->avoid);
-  if (zones != ZoneSetEMPTY) {
-    res = ArenaFreeLandAlloc(&tract, arena, zones, pref->high, size, pool);
-    if (res == ResOK)
-      goto found;
-  }
-
-  /* Plan B: add free zones that aren't blacklisted */
+  /* Plan A: allocate from the free land in the requested zones.
+   * Plan B: add free zones that aren't blacklisted */
   /* TODO: Pools without ambiguous roots might not care about the blacklist. */
   /* TODO: zones are precious and (currently) never deallocated, so we
    * should consider extending the arena first if address space is plentiful.
    * See also job003384. */
+  zones = ZoneSetDiff(pref->zones, pref->avoid);
   moreZones = ZoneSetUnion(pref->zones, ZoneSetDiff(arena->freeZones, pref->avoid));
-  if (moreZones != zones) {
-    res = ArenaFreeLandAlloc(&tract, arena, moreZones, pref->high, size, pool);
-    if (res == ResOK)
-      goto found;
+  res = policyAllocZones(&tract, arena, pref, zones, moreZones, size, pool);
+  if (res == ResOK)
+    goto found;
+
+  /* Plan C: Reclaim a few condemned segments of a finished trace,
+   * and try A and B again, until they succeed or there is nothing left
+   * to reclaim, before extending the arena for memory that is about to
+   * become free. */
+  if (PoolHasAttr(pool, AttrGC)) {
+    while (TraceReclaimSome(arena, TraceReclaimDemandCOUNT)) {
+      res = policyAllocZones(&tract, arena, pref, zones, moreZones,
+                             size, pool);
+      if (res == ResOK)
+        goto found;
+    }
   }
 
-  /* Plan C: Extend the arena, then try A and B again. */
+  /* Plan D: Extend the arena, then try A and B again. */
   if (moreZones != ZoneSetEMPTY) {
     res = Method(Arena, arena, grow)(arena, pref, size);
     /* If we can't extend because we hit the commit limit, try purging
@@ -86,23 +153,16 @@ Res PolicyAlloc(Tract *tractReturn, Arena arena, LocusPref pref,
         res = Method(Arena, arena, grow)(arena, pref, size);
     }
     if (res == ResOK) {
-      if (zones != ZoneSetEMPTY) {
-        res = ArenaFreeLandAlloc(&tract, arena, zones, pref->high, size, pool);
-        if (res == ResOK)
-          goto found;
-      }
-      if (moreZones != zones) {
-        res = ArenaFreeLandAlloc(&tract, arena, moreZones, pref->high,
-                                 size, pool);
-        if (res == ResOK)
-          goto found;
-      }
+      res = policyAllocZones(&tract, arena, pref, zones, moreZones,
+                             size, pool);
+      if (res == ResOK)
+        goto found;
     }
     /* TODO: Log an event here, since something went wrong, before
        trying the next plan anyway. */
   }
 
-  /* Plan D: add every zone that isn't blacklisted.  This might mix GC'd
+  /* Plan E: add every zone that isn't blacklisted.  This might mix GC'd
    * objects with those from other generations, causing the zone check
    * to give false positives and slowing down the collector. */
   /* TODO: log an event for this */
@@ -123,6 +183,8 @@ Res PolicyAlloc(Tract *tractReturn, Arena arena, LocusPref pref,
     goto found;
 
   /* Uh oh. */
+  if (PoolHasAttr(pool, AttrGC))
+    policyPollSoon(arena);
   return res;
 
 found:
@@ -356,9 +418,67 @@ failStart:
 Bool PolicyPoll(Arena arena)
 {
   Globals globals;
+  double threshold;
+  AVERT(Arena, arena);
+  globals = ArenaGlobals(arena);
+  threshold = globals->pollThreshold;
+  if (ArenaBackground(arena))
+    threshold += ArenaPollBACKGROUNDSLACK;
+  return threshold <= globals->fillMutatorSize;
+}
+
+
+/* PolicyStep -- account for a unit of work done by ArenaStep
+ *
+ * In background mode, work done by the collector thread counts
+ * towards the mutator's polling schedule, so that the mutator
+ * doesn't repeat it.  The threshold is not advanced more than one
+ * unit ahead of the mutator, so that if the collector stops, the
+ * mutator soon picks up the work.  See
+ * <design/strategy#.policy.background>.
+ */
+
+void PolicyStep(Arena arena)
+{
+  Globals globals;
+  double limit;
+
   AVERT(Arena, arena);
+
+  if (!ArenaBackground(arena))
+    return;
+
   globals = ArenaGlobals(arena);
-  return globals->pollThreshold <= globals->fillMutatorSize;
+  limit = globals->fillMutatorSize + ArenaPollALLOCTIME;
+  if (globals->pollThreshold < limit) {
+    double next = globals->pollThreshold + ArenaPollALLOCTIME;
+    globals->pollThreshold = next < limit ? next : limit;
+  }
+}
+
+
+/* policyOverflow -- factor by which to shorten the polling interval
+ *
+ * Return a number between 1 and ArenaPollOVERFLOWLIMIT: the largest
+ * overflow of any generation in any chain, clamped.  Generations being
+ * collected are measured by their allocation since they were condemned.
+ */
+
+static double policyOverflow(Arena arena)
+{
+  double overflow = 1.0;
+  Ring node, nextNode;
+
+  RING_FOR(node, &arena->chainRing, nextNode) {
+    Chain chain = RING_ELT(Chain, chainRing, node);
+    double chainOverflow = ChainOverflow(chain);
+    if (chainOverflow > overflow)
+      overflow = chainOverflow;
+  }
+
+  if (overflow > ArenaPollOVERFLOWLIMIT)
+    overflow = ArenaPollOVERFLOWLIMIT;
+  return overflow;
 }
 
 
@@ -393,8 +513,13 @@ Bool PolicyPollAgain(Arena arena, Clock start, Bool moreWork, Work tracedWork)
   globals = ArenaGlobals(arena);
 
   if (moreWork) {
-    /* We did one quantum of work; consume one unit of 'time'. */
-    nextPollThreshold = globals->pollThreshold + ArenaPollALLOCTIME;
+    /* We did one quantum of work; consume one unit of 'time'.  If a
+     * generation has overflowed, it can't be condemned (again) until
+     * this trace finishes, so come back sooner.
+     * See <design/strategy#.policy.overflow>. */
+    double overflow = policyOverflow(arena);
+    nextPollThreshold = globals->pollThreshold
+                        + ArenaPollALLOCTIME / overflow;
   } else {
     /* No more work to do.  Sleep until NOW + a bit. */
     nextPollThreshold = globals->fillMutatorSize + ArenaPollALLOCTIME;
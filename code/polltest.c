@@ -0,0 +1,157 @@
+/* polltest.c: POLLING SCHEDULE TEST
+ *
+ * $Id$
+ * Copyright (c) 2020 Ravenbrook Limited.  See end of file for license.
+ *
+ * .overview: This test case checks that the polling interval is
+ * shortened when the mutator outpaces an incremental trace (see
+ * <design/strategy#.policy.overflow>).  It starts a collection of a
+ * large live heap, then allocates into the nursery, which the trace
+ * has condemned, until the nursery has more than its capacity of new
+ * memory.  It checks that ChainOverflow sees this, and that
+ * PolicyPollAgain then advances the poll threshold by less than
+ * ArenaPollALLOCTIME.
+ */
+
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "mpm.h"
+#include "mps.h"
+#include "mpsavm.h"
+#include "mpscamc.h"
+#include "testlib.h"
+
+#include <stdio.h> /* printf */
+
+
+#define testArenaSIZE   ((size_t)64 << 20)
+#define liveCOUNT       100000  /* objects in the live heap */
+#define youngSIZE       ((size_t)2 << 20) /* bytes to allocate during trace */
+
+static mps_gen_param_s testChain[2] = {
+  { 64, 0.9 },
+  { 65536, 0.1 }
+};
+
+
+static void test(void)
+{
+  mps_arena_t arena;
+  mps_fmt_t format;
+  mps_chain_t chain;
+  mps_pool_t pool;
+  mps_ap_t ap;
+  mps_root_t root;
+  mps_word_t live[2];
+  double overflow, before, after;
+  size_t i, allocated;
+  Arena a;
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
+    /* One quantum of work per poll, so the trace lasts a long time. */
+    MPS_ARGS_ADD(args, MPS_KEY_PAUSE_TIME, 0.0);
+    die(mps_arena_create_k(&arena, mps_arena_class_vm(), args),
+        "arena_create");
+  } MPS_ARGS_END(args);
+  a = (Arena)arena;
+
+  die(dylan_fmt(&format, arena), "fmt_create");
+  die(mps_chain_create(&chain, arena, NELEMS(testChain), testChain),
+      "chain_create");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    die(mps_pool_create_k(&pool, arena, mps_class_amc(), args),
+        "pool_create");
+  } MPS_ARGS_END(args);
+  die(mps_ap_create_k(&ap, pool, mps_args_none), "ap_create");
+
+  live[0] = live[1] = DYLAN_INT(0);
+  die(mps_root_create_area(&root, arena, mps_rank_exact(), 0,
+                           live, live + 2, mps_scan_area, NULL),
+      "root_create");
+
+  /* Build a live list while the arena is parked, so that it is all
+     condemned by the collection below and takes many polls to trace. */
+  mps_arena_park(arena);
+  for (i = 0; i < liveCOUNT; ++i) {
+    die(make_dylan_vector(&live[1], ap, 2), "make live");
+    DYLAN_VECTOR_SLOT(live[1], 0) = live[0];
+    live[0] = live[1];
+  }
+  live[1] = DYLAN_INT(0);
+
+  die(mps_arena_start_collect(arena), "start_collect");
+  mps_arena_release(arena);
+
+  /* Allocate in the condemned nursery until it overflows. */
+  for (allocated = 0; allocated < youngSIZE;
+       allocated += 4 * sizeof(mps_word_t)) {
+    die(make_dylan_vector(&live[1], ap, 2), "make young");
+  }
+
+  ArenaEnter(a);
+  Insist(a->busyTraces != TraceSetEMPTY);
+  overflow = ChainOverflow((Chain)chain);
+  printf("overflow %g\n", overflow);
+  Insist(overflow > 1.0);
+
+  /* Pretend that the pause time has been used up with work left. */
+  before = ArenaGlobals(a)->pollThreshold;
+  Insist(!PolicyPollAgain(a, ClockNow() - ClocksPerSec(), TRUE, 0));
+  after = ArenaGlobals(a)->pollThreshold;
+  printf("poll interval %g of %g\n", after - before,
+         (double)ArenaPollALLOCTIME);
+  Insist(after - before < ArenaPollALLOCTIME);
+  ArenaLeave(a);
+
+  mps_arena_park(arena);
+  mps_root_destroy(root);
+  mps_ap_destroy(ap);
+  mps_pool_destroy(pool);
+  mps_chain_destroy(chain);
+  mps_fmt_destroy(format);
+  mps_arena_destroy(arena);
+}
+
+
+int main(int argc, char *argv[])
+{
+  testlib_init(argc, argv);
+
+  test();
+
+  printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
+  return 0;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
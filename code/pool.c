@@ -29,6 +29,7 @@
  */
 
 #include "mpm.h"
+#include "sac.h"
 
 SRCID(pool, "$Id$");
 
@@ -88,6 +89,7 @@ Bool PoolCheck(Pool pool)
   CHECKU(Arena, pool->arena);
   CHECKD_NOSIG(Ring, &pool->arenaRing);
   CHECKD_NOSIG(Ring, &pool->bufferRing);
+  CHECKD_NOSIG(Ring, &pool->idleBufferRing);
   /* Cannot check pool->bufferSerial */
   CHECKD_NOSIG(Ring, &pool->segRing);
   CHECKL(AlignCheck(pool->alignment));
@@ -95,6 +97,11 @@ Bool PoolCheck(Pool pool)
   CHECKL(pool->alignment == PoolGrainsSize(pool, (Align)1));
   if (pool->format != NULL)
     CHECKD(Format, pool->format);
+  CHECKL(BoolCheck(pool->softwareBarrier));
+  CHECKL(!pool->softwareBarrier || ArenaHasCards(pool->arena));
+  CHECKL((pool->cache == NULL) == (pool->cacheLock == NULL));
+  CHECKL(pool->cache == NULL || TESTT(SAC, pool->cache));
+  CHECKL((pool->cache == NULL) == (pool->cacheDepot == NULL));
   return TRUE;
 }
 
@@ -113,6 +120,7 @@ ARG_DEFINE_KEY(MAX_SIZE, Size);
 ARG_DEFINE_KEY(ALIGN, Align);
 ARG_DEFINE_KEY(SPARE, double);
 ARG_DEFINE_KEY(INTERIOR, Bool);
+ARG_DEFINE_KEY(SOFTWARE_BARRIER, Bool);
 
 
 /* PoolInit -- initialize a pool
@@ -192,6 +200,7 @@ void PoolDestroy(Pool pool)
   AVERT(Pool, pool);
   arena = pool->arena;
   size = ClassOfPoly(Pool, pool)->size;
+  BufferThreadFinish(pool);
   PoolFinish(pool);
 
   /* .space.free: Free the pool instance structure.  See .space.alloc */
@@ -257,6 +266,215 @@ void (PoolFree)(Pool pool, Addr old, Size size)
 }
 
 
+/* poolCacheClasses -- the classes of a pool's cache
+ *
+ * <design/pool#.cache.sac>.  The SACs that use the pool's depot must
+ * have the same classes as the pool's cache, so that a block has the
+ * same size whichever way it was allocated.
+ */
+
+static void poolCacheClasses(mps_sac_class_s *classes, Pool pool,
+                             Count cachedCount)
+{
+  Size size;
+  Index i;
+
+  size = SizeAlignUp(sizeof(Addr), PoolAlignment(pool));
+  for (i = 0; i < POOL_CACHE_CLASS_COUNT; ++i) {
+    classes[i].mps_block_size = size;
+    classes[i].mps_cached_count = cachedCount;
+    classes[i].mps_frequency = 1;
+    size *= 2;
+  }
+}
+
+
+/* PoolCacheInit -- give a pool a cache of small blocks
+ *
+ * <design/pool#.cache>.  Called from a manual pool class's init
+ * method, once the pool's alignment is known.
+ */
+
+Res PoolCacheInit(Pool pool)
+{
+  mps_sac_class_s classes[POOL_CACHE_CLASS_COUNT];
+  Arena arena;
+  Lock lock;
+  SAC sac;
+  SACDepot depot;
+  void *p;
+  Res res;
+
+  AVERT(Pool, pool);
+  AVER(!PoolHasAttr(pool, AttrGC));
+  AVER(pool->cache == NULL);
+  arena = PoolArena(pool);
+
+  poolCacheClasses(classes, pool, POOL_CACHE_BLOCK_COUNT);
+
+  res = ControlAlloc(&p, arena, LockSize());
+  if (res != ResOK)
+    goto failLockAlloc;
+  lock = p;
+  LockInit(lock);
+
+  res = SACCreate(&sac, pool, NELEMS(classes), classes);
+  if (res != ResOK)
+    goto failSACCreate;
+
+  res = SACDepotCreate(&depot, pool, POOL_CACHE_MAGAZINE_SIZE,
+                       POOL_CACHE_MAGAZINE_COUNT);
+  if (res != ResOK)
+    goto failDepotCreate;
+
+  pool->cacheLock = lock;
+  pool->cache = sac;
+  pool->cacheDepot = depot;
+  AVERT(Pool, pool);
+  return ResOK;
+
+failDepotCreate:
+  SACDestroy(sac);
+failSACCreate:
+  LockFinish(lock);
+  ControlFree(arena, lock, LockSize());
+failLockAlloc:
+  return res;
+}
+
+
+/* PoolCacheFinish -- return the blocks in a pool's cache and destroy it
+ *
+ * Called from the pool class's finish method, while the pool can
+ * still free blocks.  Does nothing if the pool has no cache.
+ */
+
+void PoolCacheFinish(Pool pool)
+{
+  Arena arena;
+
+  AVERT(Pool, pool);
+  if (pool->cache == NULL)
+    return;
+  arena = PoolArena(pool);
+  SACDepotDestroy(pool->cacheDepot);
+  SACDestroy(pool->cache);
+  LockFinish(pool->cacheLock);
+  ControlFree(arena, pool->cacheLock, LockSize());
+  pool->cacheDepot = NULL;
+  pool->cache = NULL;
+  pool->cacheLock = NULL;
+}
+
+
+/* PoolCacheSACCreate -- create a thread's SAC for a pool with a cache
+ *
+ * <design/pool#.cache.magazine>.  The SAC has the same classes as the
+ * pool's cache, and exchanges magazines with the pool's depot.
+ * Returns ResPARAM if the pool has no cache.
+ */
+
+Res PoolCacheSACCreate(SAC *sacReturn, Pool pool)
+{
+  mps_sac_class_s classes[POOL_CACHE_CLASS_COUNT];
+
+  AVER(sacReturn != NULL);
+  AVERT(Pool, pool);
+
+  if (pool->cache == NULL)
+    return ResPARAM;
+  poolCacheClasses(classes, pool, 2 * POOL_CACHE_MAGAZINE_SIZE);
+  return SACCreateMagazine(sacReturn, pool->cacheDepot,
+                           NELEMS(classes), classes);
+}
+
+
+/* PoolCacheAlloc -- allocate a block from a pool's cache
+ *
+ * Claims only the cache lock, not the arena lock, and returns FALSE if
+ * the cache has no block of the right size.  <design/pool#.cache.lock>.
+ */
+
+Bool PoolCacheAlloc(Addr *pReturn, Pool pool, Size size)
+{
+  Bool b;
+
+  AVER_CRITICAL(pReturn != NULL);
+  AVER_CRITICAL(TESTT(Pool, pool));
+  AVER_CRITICAL(pool->cache != NULL);
+  AVER_CRITICAL(size > 0);
+
+  LockClaim(pool->cacheLock);
+  b = SACAllocFast(pReturn, pool->cache, size);
+  LockRelease(pool->cacheLock);
+  return b;
+}
+
+
+/* PoolCacheFree -- free a block to a pool's cache
+ *
+ * Claims only the cache lock, not the arena lock, and returns FALSE if
+ * there's no room in the cache for the block.
+ */
+
+Bool PoolCacheFree(Pool pool, Addr old, Size size)
+{
+  Bool b;
+
+  AVER_CRITICAL(TESTT(Pool, pool));
+  AVER_CRITICAL(pool->cache != NULL);
+  AVER_CRITICAL(old != NULL);
+  AVER_CRITICAL(size > 0);
+
+  LockClaim(pool->cacheLock);
+  b = SACFreeFast(pool->cache, old, size);
+  LockRelease(pool->cacheLock);
+  return b;
+}
+
+
+/* PoolCacheFill -- allocate a block via a pool's cache, from the pool
+ *
+ * Called with the arena lock held, when PoolCacheAlloc has failed.
+ * <design/pool#.cache.lock.race>.
+ */
+
+Res PoolCacheFill(Addr *pReturn, Pool pool, Size size)
+{
+  Res res = ResOK;
+
+  AVER(pReturn != NULL);
+  AVERT(Pool, pool);
+  AVER(pool->cache != NULL);
+  AVER(size > 0);
+
+  LockClaim(pool->cacheLock);
+  if (!SACAllocFast(pReturn, pool->cache, size))
+    res = SACFill(pReturn, pool->cache, size);
+  LockRelease(pool->cacheLock);
+  return res;
+}
+
+
+/* PoolCacheEmpty -- free a block via a pool's cache, to the pool
+ *
+ * Called with the arena lock held, when PoolCacheFree has failed.
+ */
+
+void PoolCacheEmpty(Pool pool, Addr old, Size size)
+{
+  AVERT(Pool, pool);
+  AVER(pool->cache != NULL);
+  AVER(old != NULL);
+  AVER(size > 0);
+
+  LockClaim(pool->cacheLock);
+  if (!SACFreeFast(pool->cache, old, size))
+    SACEmpty(pool->cache, old, size);
+  LockRelease(pool->cacheLock);
+}
+
+
 /* PoolSegPoolGen -- get pool generation for a segment */
 
 PoolGen PoolSegPoolGen(Pool pool, Seg seg)
@@ -72,23 +72,39 @@ void PoolClassMixInCollect(PoolClass klass)
 Res PoolAbsInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
 {
   ArgStruct arg;
+  Bool softwareBarrier = FALSE;
 
   AVER(pool != NULL);
   AVERT(Arena, arena);
   UNUSED(args);
   UNUSED(klass); /* used for debug pools only */
 
+  /* The card table is shared by all pools in the arena that use the
+     software write barrier: <design/write-barrier#.software>. */
+  if (ArgPick(&arg, args, MPS_KEY_SOFTWARE_BARRIER))
+    softwareBarrier = arg.val.b;
+  if (softwareBarrier && !ArenaHasCards(arena)) {
+    Res res = ArenaCardsInit(arena);
+    if (res != ResOK)
+      return res;
+  }
+
   /* Superclass init */
   InstInit(CouldBeA(Inst, pool));
 
   pool->arena = arena;
   RingInit(&pool->arenaRing);
   RingInit(&pool->bufferRing);
+  RingInit(&pool->idleBufferRing);
   RingInit(&pool->segRing);
   pool->bufferSerial = (Serial)0;
   pool->alignment = MPS_PF_ALIGN;
   pool->alignShift = SizeLog2(pool->alignment);
   pool->format = NULL;
+  pool->softwareBarrier = softwareBarrier;
+  pool->cacheLock = NULL;
+  pool->cache = NULL;
+  pool->cacheDepot = NULL;
 
   if (ArgPick(&arg, args, MPS_KEY_FORMAT)) {
     Format format = arg.val.format;
@@ -140,6 +156,7 @@ void PoolAbsFinish(Inst inst)
   InstFinish(CouldBeA(Inst, pool));
 
   RingFinish(&pool->segRing);
+  RingFinish(&pool->idleBufferRing);
   RingFinish(&pool->bufferRing);
   RingFinish(&pool->arenaRing);
 }
@@ -339,6 +356,10 @@ Res PoolAbsDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
                (WriteFP)pool->arena, (WriteFU)pool->arena->serial,
                "alignment $W\n", (WriteFW)pool->alignment,
                "alignShift $W\n", (WriteFW)pool->alignShift,
+               "softwareBarrier $S\n",
+               WriteFYesNo(pool->softwareBarrier),
+               "cache $P\n", (WriteFP)pool->cache,
+               "cacheDepot $P\n", (WriteFP)pool->cacheDepot,
                NULL);
   if (res != ResOK)
     return res;
@@ -110,9 +110,13 @@ typedef struct amcSegStruct {
   amcGen gen;               /* generation this segment belongs to */
   Nailboard board;          /* nailboard for this segment or NULL if none */
   Size forwarded[TraceLIMIT]; /* size of objects forwarded for each trace */
+  RefSet *cards;            /* card summaries or NULL if none */
+  Count cardCount;          /* number of cards in the segment */
+  RefSet cardSummary;       /* union of card summaries, or RefSetUNIV */
   BOOLFIELD(accountedAsBuffered); /* .seg.accounted-as-buffered */
   BOOLFIELD(old);           /* .seg.old */
   BOOLFIELD(deferred);      /* .seg.deferred */
+  BOOLFIELD(cardsScanned);  /* cards just recomputed by amcSegScanCards */
   Sig sig;                  /* <code/misc.h#sig> */
 } amcSegStruct;
 
@@ -127,9 +131,11 @@ static Bool amcSegCheck(amcSeg amcseg)
     CHECKD(Nailboard, amcseg->board);
     CHECKL(SegNailed(MustBeA(Seg, amcseg)) != TraceSetEMPTY);
   }
+  CHECKL((amcseg->cards == NULL) == (amcseg->cardCount == 0));
   /* CHECKL(BoolCheck(amcseg->accountedAsBuffered)); <design/type#.bool.bitfield.check> */
   /* CHECKL(BoolCheck(amcseg->old)); <design/type#.bool.bitfield.check> */
   /* CHECKL(BoolCheck(amcseg->deferred)); <design/type#.bool.bitfield.check> */
+  /* CHECKL(BoolCheck(amcseg->cardsScanned)); <design/type#.bool.bitfield.check> */
   return TRUE;
 }
 
@@ -160,6 +166,10 @@ static Res AMCSegInit(Seg seg, Pool pool, Addr base, Size size, ArgList args)
   amcseg->accountedAsBuffered = FALSE;
   amcseg->old = FALSE;
   amcseg->deferred = FALSE;
+  amcseg->cards = NULL;
+  amcseg->cardCount = 0;
+  amcseg->cardSummary = RefSetUNIV;
+  amcseg->cardsScanned = FALSE;
 
   SetClassOfPoly(seg, CLASS(amcSeg));
   amcseg->sig = amcSegSig;
@@ -176,6 +186,10 @@ static void amcSegFinish(Inst inst)
   Seg seg = MustBeA(Seg, inst);
   amcSeg amcseg = MustBeA(amcSeg, seg);
 
+  if (amcseg->cards != NULL)
+    ControlFree(PoolArena(SegPool(seg)), amcseg->cards,
+                amcseg->cardCount * sizeof amcseg->cards[0]);
+
   amcseg->sig = SigInvalid;
 
   /* finish the superclass fields last */
@@ -183,6 +197,25 @@ static void amcSegFinish(Inst inst)
 }
 
 
+/* amcSegSetSummary -- change the summary on an AMC segment
+ *
+ * Any change to the summary other than the one that immediately
+ * follows a scan by amcSegScanCards invalidates the card summaries.
+ * <design/poolamc#.scan.card.invalid>.
+ */
+
+static void amcSegSetSummary(Seg seg, RefSet summary)
+{
+  amcSeg amcseg = MustBeA_CRITICAL(amcSeg, seg);
+
+  if (!amcseg->cardsScanned || summary != amcseg->cardSummary)
+    amcseg->cardSummary = RefSetUNIV;
+  amcseg->cardsScanned = FALSE;
+
+  NextMethod(Seg, amcSeg, setSummary)(seg, summary);
+}
+
+
 /* AMCSegSketch -- summarise the segment state for a human reader
  *
  * Write a short human-readable text representation of the segment
@@ -358,6 +391,7 @@ DEFINE_CLASS(Seg, amcSeg, klass)
   klass->instClassStruct.finish = amcSegFinish;
   klass->size = sizeof(amcSegStruct);
   klass->init = AMCSegInit;
+  klass->setSummary = amcSegSetSummary;
   klass->bufferEmpty = amcSegBufferEmpty;
   klass->whiten = amcSegWhiten;
   klass->scan = amcSegScan;
@@ -422,6 +456,7 @@ typedef struct AMCStruct { /* <design/poolamc#.struct> */
   amcPinnedFunction pinned; /* function determining if block is pinned */
   Size extendBy;           /* segment size to extend pool by */
   Size largeSize;          /* min size of "large" segments */
+  Size fillSizeMax;        /* max size of small fills, see .fill.grow */
   Sig sig;                 /* <design/pool#.outer-structure.sig> */
 } AMCStruct;
 
@@ -457,6 +492,7 @@ typedef struct amcBufStruct {
   SegBufStruct segbufStruct;    /* superclass fields must come first */
   amcGen gen;                   /* The AMC generation */
   Bool forHashArrays;           /* allocates hash table arrays, see AMCBufferFill */
+  Size fillSize;                /* size of next small fill, see .fill.grow */
   Sig sig;                      /* <design/sig> */
 } amcBufStruct;
 
@@ -471,6 +507,7 @@ static Bool amcBufCheck(amcBuf amcbuf)
   if(amcbuf->gen != NULL)
     CHECKD(amcGen, amcbuf->gen);
   CHECKL(BoolCheck(amcbuf->forHashArrays));
+  CHECKL(amcbuf->fillSize > 0);
   /* hash array buffers only created by mutator */
   CHECKL(BufferIsMutator(MustBeA(Buffer, amcbuf)) || !amcbuf->forHashArrays);
   return TRUE;
@@ -527,6 +564,7 @@ static Res AMCBufInit(Buffer buffer, Pool pool, Bool isMutator, ArgList args)
     amcbuf->gen = NULL;
   }
   amcbuf->forHashArrays = forHashArrays;
+  amcbuf->fillSize = amc->extendBy;
 
   SetClassOfPoly(buffer, CLASS(amcBuf));
   amcbuf->sig = amcBufSig;
@@ -785,6 +823,11 @@ static Res amcInitComm(Pool pool, Arena arena, PoolClass klass,
   /* .extend-by.aligned: extendBy is aligned to the arena alignment. */
   amc->extendBy = SizeArenaGrains(extendBy, arena);
   amc->largeSize = largeSize;
+  /* .fill.grow.max: The largest whole number of grains below the
+   * large size, but no smaller than extendBy. */
+  amc->fillSizeMax = SizeAlignDown(largeSize - 1, ArenaGrainSize(arena));
+  if (amc->fillSizeMax < amc->extendBy)
+    amc->fillSizeMax = amc->extendBy;
 
   SetClassOfPoly(pool, klass);
   amc->sig = AMCSig;
@@ -939,8 +982,8 @@ static Res AMCBufferFill(Addr *baseReturn, Addr *limitReturn,
   /* Create and attach segment.  The location of this segment is */
   /* expressed via the pool generation. We rely on the arena to */
   /* organize locations appropriately.  */
-  if (size < amc->extendBy) {
-    grainsSize = amc->extendBy; /* .extend-by.aligned */
+  if (size < amcbuf->fillSize) {
+    grainsSize = amcbuf->fillSize; /* .extend-by.aligned */
   } else {
     grainsSize = SizeArenaGrains(size, arena);
   }
@@ -994,6 +1037,17 @@ static Res AMCBufferFill(Addr *baseReturn, Addr *limitReturn,
   PoolGenAccountForFill(pgen, SegSize(seg));
   MustBeA(amcSeg, seg)->accountedAsBuffered = TRUE;
 
+  /* .fill.grow: A mutator buffer that keeps coming back for more gets
+   * bigger segments, so that the thread enters the arena (and takes
+   * the arena lock) less often.  Growth stops short of the large size
+   * so that the segments are still treated as small or medium.  See
+   * <design/poolamc#.buffer.fill.grow>. */
+  if (BufferIsMutator(buffer) && amcbuf->fillSize < amc->fillSizeMax) {
+    amcbuf->fillSize *= 2;
+    if (amcbuf->fillSize > amc->fillSizeMax)
+      amcbuf->fillSize = amc->fillSizeMax;
+  }
+
   *baseReturn = base;
   *limitReturn = limit;
   return ResOK;
@@ -1030,6 +1084,17 @@ static void amcSegBufferEmpty(Seg seg, Buffer buffer)
     AVER(limit <= SegLimit(seg));
   }
 
+  /* .fill.shrink: A mutator buffer that is emptied with more than
+   * half of it unused (for example, because it was trapped at a flip)
+   * was too big, so shrink the next fill. */
+  if (BufferIsMutator(buffer)
+      && AddrOffset(init, limit) > AddrOffset(base, limit) / 2)
+  {
+    amcBuf amcbuf = MustBeA(amcBuf, buffer);
+    if (amcbuf->fillSize / 2 >= amc->extendBy)
+      amcbuf->fillSize = SizeArenaGrains(amcbuf->fillSize / 2, arena);
+  }
+
   /* <design/poolamc#.flush.pad> */
   if (init < limit) {
     ShieldExpose(arena, seg);
@@ -1047,7 +1112,7 @@ static void amcSegBufferEmpty(Seg seg, Buffer buffer)
 
   if (amcseg->accountedAsBuffered) {
     /* Account the entire buffer (including the padding object) as used. */
-    PoolGenAccountForEmpty(&amcseg->gen->pgen, SegSize(seg), 0,
+    PoolGenAccountForEmpty(&amcseg->gen->pgen, seg, SegSize(seg), 0,
                            amcseg->deferred);
     amcseg->accountedAsBuffered = FALSE;
   }
@@ -1118,7 +1183,7 @@ static void AMCRampEnd(Pool pool, Buffer buf)
          && SegWhite(seg) == TraceSetEMPTY)
       {
         if (!amcseg->accountedAsBuffered)
-          PoolGenUndefer(pgen,
+          PoolGenUndefer(pgen, seg,
                          amcseg->old ? SegSize(seg) : 0,
                          amcseg->old ? 0 : SegSize(seg));
         amcseg->deferred = FALSE;
@@ -1388,6 +1453,84 @@ static Res amcSegScanNailed(Bool *totalReturn, ScanState ss, Pool pool,
 }
 
 
+/* amcSegScanCards -- scan an unbuffered segment card by card
+ *
+ * The objects starting in each card of the segment are scanned as a
+ * batch, and the summary of the references found in the batch is
+ * recorded in the card table.  If the card table is valid, batches
+ * whose card summary does not intersect the white set are skipped,
+ * and their summaries are added to the scan state instead.
+ * <design/poolamc#.scan.card>.
+ */
+static Res amcSegScanCards(Seg seg, ScanState ss, Format format)
+{
+  amcSeg amcseg = MustBeA(amcSeg, seg);
+  Addr segBase = SegBase(seg);
+  Addr limit = AddrAdd(SegLimit(seg), format->headerSize);
+  Addr base = AddrAdd(segBase, format->headerSize);
+  ZoneSet white = ScanStateWhite(ss);
+  RefSet unfixed = ScanStateUnfixedSummary(ss);
+  RefSet fixed = ss->fixedSummary;
+  RefSet skipped = RefSetEMPTY;
+  RefSet summary = RefSetEMPTY;
+  Bool valid;
+  Index i;
+  Res res = ResOK;
+
+  AVER(amcseg->cards != NULL);
+
+  /* <design/poolamc#.scan.card.invalid> */
+  valid = amcseg->cardSummary != RefSetUNIV
+    && amcseg->cardSummary == SegSummary(seg);
+  amcseg->cardSummary = RefSetUNIV;
+  amcseg->cardsScanned = FALSE;
+
+  for (i = 0; i < amcseg->cardCount; ++i) {
+    Addr cardLimit = AddrAdd(AddrAdd(segBase, (Size)(i + 1) << AMC_CARD_SHIFT),
+                             format->headerSize);
+    Addr next = base;
+
+    /* Find the batch of objects whose bases lie in this card. */
+    while (next < cardLimit && next < limit)
+      next = (*format->skip)(next);
+    if (next == base) {
+      amcseg->cards[i] = RefSetEMPTY;
+      continue;
+    }
+
+    if (valid && ZoneSetInter(amcseg->cards[i], white) == ZoneSetEMPTY) {
+      skipped = RefSetUnion(skipped, amcseg->cards[i]);
+      ss->boringSize += AddrOffset(base, next);
+    } else {
+      ScanStateSetUnfixedSummary(ss, RefSetEMPTY);
+      ss->fixedSummary = RefSetEMPTY;
+      res = FormatScan(format, ss, base, next);
+      amcseg->cards[i] = ScanStateSummary(ss);
+      if (ZoneSetInter(ScanStateUnfixedSummary(ss), white) == ZoneSetEMPTY)
+        ss->boringSize += AddrOffset(base, next);
+      unfixed = RefSetUnion(unfixed, ScanStateUnfixedSummary(ss));
+      fixed = RefSetUnion(fixed, ss->fixedSummary);
+      if (res != ResOK)
+        break;
+    }
+    summary = RefSetUnion(summary, amcseg->cards[i]);
+    base = next;
+  }
+
+  /* The skipped batches refer to no white zones, so their summaries
+     can be added to the unfixed summary unchanged. */
+  ScanStateSetUnfixedSummary(ss, RefSetUnion(unfixed, skipped));
+  ss->fixedSummary = fixed;
+
+  if (res == ResOK) {
+    AVER(base == limit);
+    amcseg->cardSummary = summary;
+    amcseg->cardsScanned = TRUE;
+  }
+  return res;
+}
+
+
 /* amcSegScan -- scan a single seg, turning it black
  *
  * <design/poolamc#.seg-scan>.
@@ -1433,6 +1576,30 @@ static Res amcSegScan(Bool *totalReturn, Seg seg, ScanState ss)
     base = limit;
   }
 
+  /* <design/poolamc#.scan.card> */
+  if (base == AddrAdd(SegBase(seg), format->headerSize)
+      && SegSize(seg) < amc->largeSize
+      && SegSize(seg) > ((Size)1 << AMC_CARD_SHIFT))
+  {
+    amcSeg amcseg = MustBeA(amcSeg, seg);
+    if (amcseg->cards == NULL) {
+      Count cardCount = (SegSize(seg) + ((Size)1 << AMC_CARD_SHIFT) - 1)
+        >> AMC_CARD_SHIFT;
+      void *p;
+      res = ControlAlloc(&p, PoolArena(pool),
+                         cardCount * sizeof amcseg->cards[0]);
+      if (res == ResOK) {
+        amcseg->cards = p;
+        amcseg->cardCount = cardCount;
+      }
+    }
+    if (amcseg->cards != NULL) {
+      res = amcSegScanCards(seg, ss, format);
+      *totalReturn = (res == ResOK);
+      return res;
+    }
+  }
+
   /* <design/poolamc#.seg-scan.finish> @@@@ base? */
   limit = AddrAdd(SegLimit(seg), format->headerSize);
   AVER(SegBase(seg) <= base);
@@ -2117,6 +2284,7 @@ static Bool AMCCheck(AMC amc)
   /* if BEGIN or RAMPING, count must not be zero. */
   CHECKL((amc->rampCount != 0) || ((amc->rampMode != RampBEGIN) &&
                                    (amc->rampMode != RampRAMPING)));
+  CHECKL(amc->fillSizeMax >= amc->extendBy);
 
   return TRUE;
 }
@@ -1064,7 +1064,7 @@ static void amsSegBufferEmpty(Seg seg, Buffer buffer)
   amsseg->bufferedGrains = 0;
   amsseg->newGrains += usedGrains;
 
-  PoolGenAccountForEmpty(PoolSegPoolGen(pool, seg),
+  PoolGenAccountForEmpty(PoolSegPoolGen(pool, seg), seg,
                          PoolGrainsSize(pool, usedGrains),
                          PoolGrainsSize(pool, unusedGrains), FALSE);
 }
@@ -704,7 +704,7 @@ static void awlSegBufferEmpty(Seg seg, Buffer buffer)
   awlseg->bufferedGrains = 0;
   awlseg->newGrains += usedGrains;
 
-  PoolGenAccountForEmpty(PoolSegPoolGen(pool, seg),
+  PoolGenAccountForEmpty(PoolSegPoolGen(pool, seg), seg,
                          PoolGrainsSize(pool, usedGrains),
                          PoolGrainsSize(pool, unusedGrains), FALSE);
 }
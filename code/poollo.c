@@ -290,7 +290,7 @@ static void loSegBufferEmpty(Seg seg, Buffer buffer)
   loseg->bufferedGrains = 0;
   loseg->newGrains += usedGrains;
 
-  PoolGenAccountForEmpty(PoolSegPoolGen(pool, seg),
+  PoolGenAccountForEmpty(PoolSegPoolGen(pool, seg), seg,
                          PoolGrainsSize(pool, usedGrains),
                          PoolGrainsSize(pool, unusedGrains), FALSE);
 }
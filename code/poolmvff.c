@@ -18,6 +18,7 @@
  * PoolAlloc, MVFFAlloc) and mps_free (and then PoolFree, MVFFFree).
  */
 
+#include "btree.h"
 #include "cbs.h"
 #include "dbgpool.h"
 #include "failover.h"
@@ -27,6 +28,7 @@
 #include "poolmvff.h"
 #include "mpscmfs.h"
 #include "poolmfs.h"
+#include "tlsf.h"
 
 SRCID(poolmvff, "$Id$");
 
@@ -42,7 +44,8 @@ DECLARE_CLASS(Pool, MVFFDebugPool, MVFFPool);
 
 #define PoolMVFF(pool)     PARENT(MVFFStruct, poolStruct, pool)
 #define MVFFTotalLand(mvff)  (&(mvff)->totalCBSStruct.landStruct)
-#define MVFFFreePrimary(mvff)   (&(mvff)->freeCBSStruct.landStruct)
+#define MVFFFreePrimary(mvff)   RVALUE((mvff)->freePrimary)
+#define MVFFFreeCBS(mvff)   (&(mvff)->freeCBSStruct.landStruct)
 #define MVFFFreeSecondary(mvff)  FreelistLand(&(mvff)->flStruct)
 #define MVFFFreeLand(mvff)  FailoverLand(&(mvff)->foStruct)
 #define MVFFLocusPref(mvff) (&(mvff)->locusPrefStruct)
@@ -395,6 +398,8 @@ static void MVFFDebugVarargs(ArgStruct args[MPS_ARGS_MAX], va_list varargs)
 ARG_DEFINE_KEY(MVFF_SLOT_HIGH, Bool);
 ARG_DEFINE_KEY(MVFF_ARENA_HIGH, Bool);
 ARG_DEFINE_KEY(MVFF_FIRST_FIT, Bool);
+ARG_DEFINE_KEY(MVFF_CACHE, Bool);
+ARG_DEFINE_KEY(MVFF_GOOD_FIT, Bool);
 
 static Res MVFFInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
 {
@@ -405,6 +410,8 @@ static Res MVFFInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   Bool arenaHigh = MVFF_ARENA_HIGH_DEFAULT;
   Bool firstFit = MVFF_FIRST_FIT_DEFAULT;
   double spare = MVFF_SPARE_DEFAULT;
+  Bool cache = MVFF_CACHE_DEFAULT;
+  Bool goodFit = MVFF_GOOD_FIT_DEFAULT;
   MVFF mvff;
   Res res;
   ArgStruct arg;
@@ -440,6 +447,12 @@ static Res MVFFInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   if (ArgPick(&arg, args, MPS_KEY_MVFF_FIRST_FIT))
     firstFit = arg.val.b;
 
+  if (ArgPick(&arg, args, MPS_KEY_MVFF_CACHE))
+    cache = arg.val.b;
+
+  if (ArgPick(&arg, args, MPS_KEY_MVFF_GOOD_FIT))
+    goodFit = arg.val.b;
+
   AVER(extendBy > 0);           /* .arg.check */
   AVER(avgSize > 0);            /* .arg.check */
   AVER(avgSize <= extendBy);    /* .arg.check */
@@ -454,6 +467,8 @@ static Res MVFFInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   AVERT(Bool, slotHigh);
   AVERT(Bool, arenaHigh);
   AVERT(Bool, firstFit);
+  AVERT(Bool, cache);
+  AVERT(Bool, goodFit);
 
   res = NextMethod(Pool, MVFFPool, init)(pool, arena, klass, args);
   if (res != ResOK)
@@ -479,7 +494,7 @@ static Res MVFFInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
    * MVFF can be used during arena bootstrap as the control pool. */
 
   MPS_ARGS_BEGIN(piArgs) {
-    MPS_ARGS_ADD(piArgs, MPS_KEY_MFS_UNIT_SIZE, sizeof(CBSFastBlockStruct));
+    MPS_ARGS_ADD(piArgs, MPS_KEY_MFS_UNIT_SIZE, TreeLandFastBlockSize);
     res = PoolInit(MVFFBlockPool(mvff), arena, PoolClassMFS(), piArgs);
   } MPS_ARGS_END(piArgs);
   if (res != ResOK)
@@ -487,17 +502,29 @@ static Res MVFFInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
 
   MPS_ARGS_BEGIN(liArgs) {
     MPS_ARGS_ADD(liArgs, CBSBlockPool, MVFFBlockPool(mvff));
-    res = LandInit(MVFFTotalLand(mvff), CLASS(CBSFast), arena, align,
+    res = LandInit(MVFFTotalLand(mvff), TreeLandFastClass(), arena, align,
                    mvff, liArgs);
   } MPS_ARGS_END(liArgs);
   if (res != ResOK)
     goto failTotalLandInit;
 
-  MPS_ARGS_BEGIN(liArgs) {
-    MPS_ARGS_ADD(liArgs, CBSBlockPool, MVFFBlockPool(mvff));
-    res = LandInit(MVFFFreePrimary(mvff), CLASS(CBSFast), arena, align,
-                   mvff, liArgs);
-  } MPS_ARGS_END(liArgs);
+  /* <design/poolmvff#.impl.good-fit> */
+  if (goodFit) {
+    void *p;
+    res = ControlAlloc(&p, arena, sizeof(TLSFStruct));
+    if (res != ResOK)
+      goto failFreePrimaryAlloc;
+    mvff->freePrimary = TLSFLand((TLSF)p);
+    res = LandInit(MVFFFreePrimary(mvff), CLASS(TLSF), arena, align,
+                   mvff, mps_args_none);
+  } else {
+    mvff->freePrimary = MVFFFreeCBS(mvff);
+    MPS_ARGS_BEGIN(liArgs) {
+      MPS_ARGS_ADD(liArgs, CBSBlockPool, MVFFBlockPool(mvff));
+      res = LandInit(MVFFFreePrimary(mvff), TreeLandFastClass(), arena, align,
+                     mvff, liArgs);
+    } MPS_ARGS_END(liArgs);
+  }
   if (res != ResOK)
     goto failFreePrimaryInit;
 
@@ -515,6 +542,13 @@ static Res MVFFInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   if (res != ResOK)
     goto failFreeLandInit;
 
+  /* <design/pool#.cache> */
+  if (cache) {
+    res = PoolCacheInit(pool);
+    if (res != ResOK)
+      goto failCacheInit;
+  }
+
   SetClassOfPoly(pool, CLASS(MVFFPool));
   mvff->sig = MVFFSig;
   AVERC(MVFFPool, mvff);
@@ -524,11 +558,16 @@ static Res MVFFInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
 
   return ResOK;
 
+failCacheInit:
+  LandFinish(MVFFFreeLand(mvff));
 failFreeLandInit:
   LandFinish(MVFFFreeSecondary(mvff));
 failFreeSecondaryInit:
   LandFinish(MVFFFreePrimary(mvff));
 failFreePrimaryInit:
+  if (MVFFFreePrimary(mvff) != MVFFFreeCBS(mvff))
+    ControlFree(arena, MVFFFreePrimary(mvff), sizeof(TLSFStruct));
+failFreePrimaryAlloc:
   LandFinish(MVFFTotalLand(mvff));
 failTotalLandInit:
   PoolFinish(MVFFBlockPool(mvff));
@@ -567,6 +606,7 @@ static void MVFFFinish(Inst inst)
   Land totalLand;
 
   AVERT(MVFF, mvff);
+  PoolCacheFinish(pool);
   mvff->sig = SigInvalid;
 
   totalLand = MVFFTotalLand(mvff);
@@ -577,6 +617,8 @@ static void MVFFFinish(Inst inst)
   LandFinish(MVFFFreeLand(mvff));
   LandFinish(MVFFFreeSecondary(mvff));
   LandFinish(MVFFFreePrimary(mvff));
+  if (MVFFFreePrimary(mvff) != MVFFFreeCBS(mvff))
+    ControlFree(PoolArena(pool), MVFFFreePrimary(mvff), sizeof(TLSFStruct));
   LandFinish(totalLand);
   PoolFinish(MVFFBlockPool(mvff));
   NextMethod(Inst, MVFFPool, finish)(inst);
@@ -743,8 +785,11 @@ Bool MVFFCheck(MVFF mvff)
   CHECKL(mvff->spare >= 0.0);                   /* see .arg.check */
   CHECKL(mvff->spare <= 1.0);                   /* see .arg.check */
   CHECKD(MFS, &mvff->cbsBlockPoolStruct);
-  CHECKD(CBS, &mvff->totalCBSStruct);
-  CHECKD(CBS, &mvff->freeCBSStruct);
+  CHECKL(TreeLandCheck(&mvff->totalCBSStruct));
+  if (MVFFFreePrimary(mvff) == MVFFFreeCBS(mvff))
+    CHECKL(TreeLandCheck(&mvff->freeCBSStruct));
+  else
+    CHECKD(TLSF, CouldBeA(TLSF, MVFFFreePrimary(mvff)));
   CHECKD(Freelist, &mvff->flStruct);
   CHECKD(Failover, &mvff->foStruct);
   CHECKL((LandSize)(MVFFTotalLand(mvff)) >= (LandSize)(MVFFFreeLand(mvff)));
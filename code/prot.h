@@ -25,6 +25,15 @@ extern void ProtSet(Addr base, Addr limit, AccessSet mode);
 extern void ProtSync(Arena arena);
 
 
+/* Dirty Page Interface -- see <design/prot#.if.dirty> */
+
+extern Res ProtDirtyInit(void);
+extern void ProtDirtyFinish(void);
+extern void ProtDirtyClear(void);
+extern Bool ProtDirty(Addr base, Addr limit);
+extern void ProtDirtyRead(BT dirtyTable, Addr base, Addr limit, Shift shift);
+
+
 #endif /* prot_h */
 
 
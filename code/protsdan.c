@@ -0,0 +1,87 @@
+/* protsdan.c: GENERIC DIRTY PAGE TRACKING
+ *
+ *  $Id$
+ *  Copyright (c) 2020 Ravenbrook Limited.  See end of file for license.
+ *
+ * This is the dirty page tracking part of the protection interface
+ * for platforms whose operating systems don't provide it.  Arenas
+ * that ask for it fall back to the protection-based write barrier.
+ *
+ *
+ * DESIGN
+ *
+ * <design/prot#.if.dirty>.
+ */
+
+#include "mpm.h"
+
+SRCID(protsdan, "$Id$");
+
+
+/* ProtDirtyInit -- dirty page tracking is not available */
+
+Res ProtDirtyInit(void)
+{
+  return ResUNIMPL;
+}
+
+
+/* ProtDirtyFinish, ProtDirtyClear, ProtDirty, ProtDirtyRead --
+ * unreachable */
+
+void ProtDirtyFinish(void)
+{
+  NOTREACHED;
+}
+
+void ProtDirtyClear(void)
+{
+  NOTREACHED;
+}
+
+Bool ProtDirty(Addr base, Addr limit)
+{
+  UNUSED(base);
+  UNUSED(limit);
+  NOTREACHED;
+  return TRUE;
+}
+
+void ProtDirtyRead(BT dirtyTable, Addr base, Addr limit, Shift shift)
+{
+  UNUSED(dirtyTable);
+  UNUSED(base);
+  UNUSED(limit);
+  UNUSED(shift);
+  NOTREACHED;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -0,0 +1,365 @@
+/* protsdli.c: SOFT-DIRTY PAGE TRACKING FOR LINUX
+ *
+ *  $Id$
+ *  Copyright (c) 2020 Ravenbrook Limited.  See end of file for license.
+ *
+ * This implements the dirty page tracking part of the protection
+ * interface using the Linux "soft-dirty" page table bits.  Writing "4"
+ * to /proc/self/clear_refs clears the soft-dirty bits for the whole
+ * process, and the kernel sets the bit for a page again when it is
+ * next written.  Bit 55 of each page's entry in /proc/self/pagemap
+ * reports the soft-dirty bit.
+ *
+ *
+ * SOURCES
+ *
+ * .source.soft-dirty: "Soft-Dirty PTEs", the Linux kernel
+ * documentation <https://www.kernel.org/doc/Documentation/vm/soft-dirty.txt>.
+ *
+ * .source.pagemap: "Examining Process Page Tables", the Linux kernel
+ * documentation <https://www.kernel.org/doc/Documentation/vm/pagemap.txt>.
+ *
+ *
+ * DESIGN
+ *
+ * <design/prot#.if.dirty> and <design/write-barrier#.soft-dirty>.
+ *
+ *
+ * ASSUMPTIONS
+ *
+ * .assume.process: The soft-dirty bits belong to the process, and
+ * clearing them affects every user of them.  So only one arena at a
+ * time may use them: see .claim.
+ *
+ * .assume.little-endian: Pagemap entries are 64-bit words in native
+ * byte order.  C89 has no 64-bit integer type, so we read them as
+ * bytes, and assume that the byte order is little-endian, as it is on
+ * all the Linux platforms the MPS supports (IA-32 and x86-64).
+ *
+ * .assume.new: Pages that are mapped after the bits are cleared are
+ * reported as soft-dirty until the next clear, even if they have not
+ * been touched.  This is conservative.
+ *
+ * .fork: "/proc/self" is resolved when the files are opened, so after
+ * fork() the child's descriptors would still refer to the parent: the
+ * child would read and clear the parent's bits.  So a child handler
+ * installed with pthread_atfork reopens them (see
+ * <design/thread-safety#.sol.fork.atfork>).  The child doesn't know
+ * which pages were written since the last clear, so it reports every
+ * page as dirty until its first clear.
+ */
+
+#include "mpm.h"
+
+#if !defined(MPS_OS_LI)
+#error "protsdli.c is specific to MPS_OS_LI"
+#endif
+
+#include <fcntl.h>     /* for open */
+#include <pthread.h>   /* for pthread_atfork */
+#include <sys/mman.h>  /* for mmap, munmap */
+#include <unistd.h>    /* for close, pread, write */
+
+SRCID(protsdli, "$Id$");
+
+
+/* Bit 55 of a pagemap entry is the soft-dirty bit: see
+ * .assume.little-endian. */
+#define PAGEMAP_ENTRY_SIZE 8    /* bytes in a pagemap entry */
+#define PAGEMAP_SOFT_DIRTY_BYTE 6
+#define PAGEMAP_SOFT_DIRTY_BIT 0x80
+#define PAGEMAP_BATCH 64        /* pagemap entries read at a time */
+
+#define pagemapSoftDirty(entry) \
+  (((entry)[PAGEMAP_SOFT_DIRTY_BYTE] & PAGEMAP_SOFT_DIRTY_BIT) != 0)
+
+
+/* .claim: The file descriptors are only open while an arena has
+ * claimed the soft-dirty bits.  The global lock protects these
+ * variables. */
+
+static Bool dirtyClaimed = FALSE;
+static Bool dirtyAll = FALSE;     /* report every page dirty? */
+static Bool dirtyForkInstalled = FALSE;
+static int dirtyPagemap = -1;     /* /proc/self/pagemap */
+static int dirtyClearRefs = -1;   /* /proc/self/clear_refs */
+
+
+/* dirtyAtForkChild -- reopen the files in the child process
+ *
+ * See .fork.  If either file can't be reopened, every page stays
+ * dirty for as long as the arena uses the soft-dirty bits.
+ */
+
+static void dirtyAtForkChild(void)
+{
+  if (!dirtyClaimed)
+    return;
+  (void)close(dirtyPagemap);
+  (void)close(dirtyClearRefs);
+  dirtyPagemap = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+  dirtyClearRefs = open("/proc/self/clear_refs", O_WRONLY | O_CLOEXEC);
+  dirtyAll = TRUE;
+}
+
+
+/* dirtyPage -- read the pagemap entry for the page containing addr */
+
+static Bool dirtyPage(Bool *dirtyReturn, Addr addr)
+{
+  unsigned char entry[PAGEMAP_ENTRY_SIZE];
+  Word page = (Word)addr / ProtGranularity();
+  ssize_t n;
+
+  n = pread(dirtyPagemap, entry, sizeof entry, (off_t)(page * sizeof entry));
+  if (n != (ssize_t)sizeof entry)
+    return FALSE;
+  *dirtyReturn = pagemapSoftDirty(entry);
+  return TRUE;
+}
+
+
+/* dirtyProbe -- check that the kernel maintains the soft-dirty bits
+ *
+ * Kernels built without CONFIG_MEM_SOFT_DIRTY accept writes to
+ * clear_refs but never set bit 55, so we check that writing a page
+ * after clearing makes it dirty.
+ */
+
+static Bool dirtyProbe(void)
+{
+  Size grain = ProtGranularity();
+  void *p;
+  Bool dirty, ok;
+
+  p = mmap(NULL, grain, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON,
+           -1, 0);
+  if (p == MAP_FAILED)
+    return FALSE;
+  ProtDirtyClear();
+  ok = dirtyPage(&dirty, (Addr)p) && !dirty;
+  if (ok) {
+    *(volatile char *)p = 1;
+    ok = dirtyPage(&dirty, (Addr)p) && dirty;
+  }
+  (void)munmap(p, grain);
+  return ok;
+}
+
+
+/* ProtDirtyInit -- claim the soft-dirty bits for an arena
+ *
+ * Returns ResOK if the soft-dirty bits are available and have been
+ * cleared, or ResUNIMPL if the kernel doesn't support them or another
+ * arena has already claimed them.
+ */
+
+Res ProtDirtyInit(void)
+{
+  Res res = ResUNIMPL;
+
+  LockClaimGlobal();
+  if (dirtyClaimed)
+    goto done;
+
+  dirtyPagemap = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+  if (dirtyPagemap < 0)
+    goto done;
+  dirtyClearRefs = open("/proc/self/clear_refs", O_WRONLY | O_CLOEXEC);
+  if (dirtyClearRefs < 0)
+    goto failClearRefs;
+  if (!dirtyProbe())
+    goto failProbe;
+
+  if (!dirtyForkInstalled) {
+    pthread_atfork(NULL, NULL, dirtyAtForkChild);
+    dirtyForkInstalled = TRUE;
+  }
+  dirtyClaimed = TRUE;
+  res = ResOK;
+  goto done;
+
+failProbe:
+  (void)close(dirtyClearRefs);
+  dirtyClearRefs = -1;
+failClearRefs:
+  (void)close(dirtyPagemap);
+  dirtyPagemap = -1;
+done:
+  LockReleaseGlobal();
+  return res;
+}
+
+
+/* ProtDirtyFinish -- release the soft-dirty bits */
+
+void ProtDirtyFinish(void)
+{
+  LockClaimGlobal();
+  AVER(dirtyClaimed);
+  if (dirtyClearRefs >= 0)
+    (void)close(dirtyClearRefs);
+  if (dirtyPagemap >= 0)
+    (void)close(dirtyPagemap);
+  dirtyClearRefs = -1;
+  dirtyPagemap = -1;
+  dirtyClaimed = FALSE;
+  LockReleaseGlobal();
+}
+
+
+/* ProtDirtyClear -- clear the soft-dirty bits for the whole process
+ *
+ * If the write fails, later calls to ProtDirty report every page as
+ * dirty, which is conservative.
+ */
+
+void ProtDirtyClear(void)
+{
+  dirtyAll = dirtyClearRefs < 0 || dirtyPagemap < 0
+             || write(dirtyClearRefs, "4", 1) != 1;
+}
+
+
+/* ProtDirty -- might any page in the range have been written?
+ *
+ * Returns TRUE if any page overlapping [base, limit) has been written
+ * since the last call to ProtDirtyClear, or if the pagemap can't be
+ * read, or if the process has forked since then (see .fork).
+ */
+
+Bool ProtDirty(Addr base, Addr limit)
+{
+  unsigned char entries[PAGEMAP_BATCH * PAGEMAP_ENTRY_SIZE];
+  Size grain = ProtGranularity();
+  Word page, pageLimit;
+
+  AVER(dirtyClaimed);
+  AVER(base < limit);
+  if (dirtyAll)
+    return TRUE;
+
+  page = (Word)AddrAlignDown(base, grain) / grain;
+  pageLimit = (Word)AddrAlignUp(limit, grain) / grain;
+  while (page < pageLimit) {
+    Word count = pageLimit - page;
+    ssize_t n;
+    Index i;
+
+    if (count > PAGEMAP_BATCH)
+      count = PAGEMAP_BATCH;
+    n = pread(dirtyPagemap, entries, count * PAGEMAP_ENTRY_SIZE,
+              (off_t)(page * PAGEMAP_ENTRY_SIZE));
+    if (n != (ssize_t)(count * PAGEMAP_ENTRY_SIZE))
+      return TRUE;
+    for (i = 0; i < count; ++i)
+      if (pagemapSoftDirty(&entries[i * PAGEMAP_ENTRY_SIZE]))
+        return TRUE;
+    page += count;
+  }
+  return FALSE;
+}
+
+
+/* ProtDirtyRead -- read the dirty state of a range of memory
+ *
+ * Sets bit i of dirtyTable if any page overlapping the i'th unit of
+ * (1 << shift) bytes of [base, limit) has been written since the last
+ * call to ProtDirtyClear, and resets it otherwise.  The pagemap
+ * entries for the whole range are read with one pread into a scratch
+ * mapping, so that an arena can harvest a chunk with one read of the
+ * pagemap rather than one per segment.  If the pagemap can't be read,
+ * or every page is to be reported dirty (see .fork), every bit is set.
+ */
+
+void ProtDirtyRead(BT dirtyTable, Addr base, Addr limit, Shift shift)
+{
+  Size grain = ProtGranularity();
+  Size unit = (Size)1 << shift;
+  Count units;
+  Word firstPage, pageLimit;
+  Size size, done;
+  unsigned char *entries;
+  ssize_t n;
+  Index i;
+
+  AVER(dirtyClaimed);
+  AVER(dirtyTable != NULL);
+  AVER(base < limit);
+  AVER(AddrIsAligned(base, unit));
+  AVER(AddrIsAligned(limit, unit));
+
+  units = AddrOffset(base, limit) >> shift;
+  if (dirtyAll) {
+    BTSetRange(dirtyTable, 0, units);
+    return;
+  }
+  firstPage = (Word)AddrAlignDown(base, grain) / grain;
+  pageLimit = (Word)AddrAlignUp(limit, grain) / grain;
+  size = (pageLimit - firstPage) * PAGEMAP_ENTRY_SIZE;
+
+  entries = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANON, -1, 0);
+  if (entries == MAP_FAILED)
+    goto failMap;
+
+  /* The kernel may return fewer entries than asked for. */
+  for (done = 0; done < size; done += (Size)n) {
+    n = pread(dirtyPagemap, entries + done, size - done,
+              (off_t)(firstPage * PAGEMAP_ENTRY_SIZE + done));
+    if (n <= 0)
+      goto failRead;
+  }
+
+  BTResRange(dirtyTable, 0, units);
+  for (i = 0; i < units; ++i) {
+    Addr unitBase = AddrAdd(base, i << shift);
+    Word page = (Word)AddrAlignDown(unitBase, grain) / grain;
+    Word unitPageLimit = (Word)AddrAlignUp(AddrAdd(unitBase, unit), grain)
+                         / grain;
+    for (; page < unitPageLimit; ++page)
+      if (pagemapSoftDirty(&entries[(page - firstPage)
+                                    * PAGEMAP_ENTRY_SIZE])) {
+        BTSet(dirtyTable, i);
+        break;
+      }
+  }
+
+  (void)munmap(entries, size);
+  return;
+
+failRead:
+  (void)munmap(entries, size);
+failMap:
+  BTSetRange(dirtyTable, 0, units);
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -595,12 +595,19 @@ Res RootScan(ScanState ss, Root root)
     goto failScan;
   }
 
-  AVER(res == ResOK);
+  /* Fix any references that the scanner deferred with MPS_FIX_DEFER.
+     <design/trace#.fix.defer.flush> */
+  res = ScanStateFlush(ss);
+  if (res != ResOK)
+    goto failScan;
+
   root->grey = TraceSetDiff(root->grey, ss->traces);
   rootSetSummary(root, ScanStateSummary(ss));
   EVENT3(RootScan, root, ss->traces, ScanStateSummary(ss));
 
 failScan:
+  if (res != ResOK)
+    ScanStateDiscard(ss);
   if (root->pm != AccessSetEMPTY) {
     ProtSet(root->protBase, root->protLimit, root->pm);
   }
@@ -13,6 +13,22 @@ SRCID(sac, "$Id$");
 typedef _mps_sac_freelist_block_s *SACFreeListBlock;
 
 
+/* SACDepotCheck -- check function for SAC depots */
+
+ATTRIBUTE_UNUSED
+static Bool SACDepotCheck(SACDepot depot)
+{
+  CHECKS(SACDepot, depot);
+  CHECKU(Pool, depot->pool);
+  CHECKD_NOSIG(Lock, depot->lock);
+  CHECKL(depot->magazineSize > 0);
+  CHECKL(depot->magazineCount > 0);
+  CHECKL(depot->magazines != NULL);
+  /* can't check the lists without claiming the lock */
+  return TRUE;
+}
+
+
 /* SACCheck -- check function for SACs */
 
 static Bool sacFreeListBlockCheck(SACFreeListBlock fb)
@@ -43,6 +59,16 @@ static Bool SACCheck(SAC sac)
   CHECKS(SAC, sac);
   esac = ExternalSACOfSAC(sac);
   CHECKU(Pool, sac->pool);
+  if (sac->depot != NULL) {
+    CHECKU(SACDepot, sac->depot);
+    CHECKL(sac->depot->pool == sac->pool);
+    CHECKL(sac->classesCount <= sacClassLIMIT);
+  }
+  if (sac->adapt != NULL) {
+    CHECKL(sac->depot == NULL);
+    CHECKL(sac->classesCount == SAC_ADAPT_CLASS_COUNT);
+    CHECKL(sac->adapt->interval > 0);
+  }
   CHECKL(sac->classesCount > 0);
   CHECKL(sac->classesCount > sac->middleIndex);
   CHECKL(BoolCheck(esac->_trapped));
@@ -97,36 +123,12 @@ static Size sacSize(Index middleIndex, Count classesCount)
 }
 
 
-/* SACCreate -- create an SAC object */
+/* sacMiddle -- find the class in the middle of the frequencies */
 
-Res SACCreate(SAC *sacReturn, Pool pool, Count classesCount,
-              SACClasses classes)
+static Index sacMiddle(Count classesCount, SACClasses classes)
 {
-  void *p;
-  SAC sac;
-  Res res;
-  Index i, j;
-  Index middleIndex;  /* index of the size in the middle */
-  Size prevSize;
   unsigned totalFreq = 0;
-  mps_sac_t esac;
-
-  AVER(sacReturn != NULL);
-  AVERT(Pool, pool);
-  AVER(classesCount > 0);
-  /* In this cache type, there is no upper limit on classesCount. */
-  prevSize = sizeof(Addr) - 1; /* must large enough for freelist link */
-  /* @@@@ It would be better to dynamically adjust the smallest class */
-  /* to be large enough, but that gets complicated, if you have to */
-  /* merge classes because of the adjustment. */
-  for (i = 0; i < classesCount; ++i) {
-    AVER(classes[i].mps_block_size > 0);
-    AVER(SizeIsAligned(classes[i].mps_block_size, PoolAlignment(pool)));
-    AVER(prevSize < classes[i].mps_block_size);
-    prevSize = classes[i].mps_block_size;
-    /* no restrictions on count */
-    /* no restrictions on frequency */
-  }
+  Index i;
 
   /* Calculate frequency scale */
   for (i = 0; i < classesCount; ++i) {
@@ -144,18 +146,24 @@ Res SACCreate(SAC *sacReturn, Pool pool, Count classesCount,
     totalFreq -= classes[i].mps_frequency;
   }
   if (totalFreq <= classes[i].mps_frequency / 2)
-    middleIndex = i;
+    return i;
   else
-    middleIndex = i + 1; /* there must exist another class at i+1 */
+    return i + 1; /* there must exist another class at i+1 */
+}
 
-  /* Allocate SAC */
-  res = ControlAlloc(&p, PoolArena(pool), sacSize(middleIndex, classesCount));
-  if(res != ResOK)
-    goto failSACAlloc;
-  sac = p;
 
-  /* Move classes in place */
-  /* It's important this matches SACFind. */
+/* sacLayout -- move the classes into place around the middle
+ *
+ * Leaves all the freelists empty.  It's important this matches
+ * sacFind.
+ */
+
+static void sacLayout(SAC sac, Index middleIndex, Count classesCount,
+                      SACClasses classes)
+{
+  Index i, j;
+  mps_sac_t esac;
+
   esac = ExternalSACOfSAC(sac);
   for (j = middleIndex + 1, i = 0; j < classesCount; ++j, i += 2) {
     esac->_freelists[i]._size = classes[j].mps_block_size;
@@ -178,12 +186,80 @@ Res SACCreate(SAC *sacReturn, Pool pool, Count classesCount,
   esac->_freelists[i]._count_max = classes[j].mps_cached_count;
   esac->_freelists[i]._blocks = NULL;
 
-  /* finish init */
-  esac->_trapped = FALSE;
   esac->_middle = classes[middleIndex].mps_block_size;
-  sac->pool = pool;
   sac->classesCount = classesCount;
   sac->middleIndex = middleIndex;
+}
+
+
+/* sacStructSize -- size of a SAC structure as allocated
+ *
+ * An adaptive SAC may move its middle, so it has room for any middle:
+ * see .adapt.layout.
+ */
+
+static Size sacStructSize(SAC sac)
+{
+  if (sac->adapt != NULL)
+    return sacSize(sac->classesCount - 1, sac->classesCount);
+  return sacSize(sac->middleIndex, sac->classesCount);
+}
+
+
+/* sacCreate -- create an SAC object, perhaps with room to adapt */
+
+static Res sacCreate(SAC *sacReturn, Pool pool, Count classesCount,
+                     SACClasses classes, SACAdapt adapt)
+{
+  void *p;
+  SAC sac;
+  Res res;
+  Index i;
+  Index middleIndex;  /* index of the size in the middle */
+  Size prevSize, size;
+  mps_sac_t esac;
+
+  AVER(sacReturn != NULL);
+  AVERT(Pool, pool);
+  AVER(classesCount > 0);
+  /* In this cache type, there is no upper limit on classesCount. */
+  prevSize = sizeof(Addr) - 1; /* must large enough for freelist link */
+  /* @@@@ It would be better to dynamically adjust the smallest class */
+  /* to be large enough, but that gets complicated, if you have to */
+  /* merge classes because of the adjustment. */
+  for (i = 0; i < classesCount; ++i) {
+    AVER(classes[i].mps_block_size > 0);
+    AVER(SizeIsAligned(classes[i].mps_block_size, PoolAlignment(pool)));
+    AVER(prevSize < classes[i].mps_block_size);
+    prevSize = classes[i].mps_block_size;
+    /* no restrictions on count */
+    /* no restrictions on frequency */
+  }
+
+  middleIndex = sacMiddle(classesCount, classes);
+
+  /* Allocate SAC */
+  if (adapt != NULL)
+    size = sacSize(classesCount - 1, classesCount);
+  else
+    size = sacSize(middleIndex, classesCount);
+  res = ControlAlloc(&p, PoolArena(pool), size);
+  if(res != ResOK)
+    goto failSACAlloc;
+  sac = p;
+
+  /* Move classes in place */
+  sacLayout(sac, middleIndex, classesCount, classes);
+
+  /* finish init */
+  esac = ExternalSACOfSAC(sac);
+  esac->_trapped = FALSE;
+  sac->pool = pool;
+  sac->depot = NULL;
+  sac->adapt = adapt;
+  sac->allocCount = 0;
+  sac->fillCount = 0;
+  sac->emptyCount = 0;
   sac->sig = SACSig;
   AVERT(SAC, sac);
   *sacReturn = sac;
@@ -194,15 +270,128 @@ failSACAlloc:
 }
 
 
+/* SACCreate -- create an SAC object */
+
+Res SACCreate(SAC *sacReturn, Pool pool, Count classesCount,
+              SACClasses classes)
+{
+  return sacCreate(sacReturn, pool, classesCount, classes, NULL);
+}
+
+
+/* SACCreateAdaptive -- create an SAC that adapts its classes
+ *
+ * .adapt: The class sizes are chosen from a fixed list of candidate
+ * sizes: SAC_ADAPT_STEPS sizes per doubling, starting at one word
+ * (rounded up to the pool's alignment), and ending after
+ * SAC_ADAPT_CLASS_COUNT doublings.  The cache starts with the
+ * doublings as its classes.
+ *
+ * .adapt.sample: SACFill and SACEmpty, which are called only when the
+ * cache misses, record how many blocks they move to or from the pool
+ * in a histogram of the candidate size of the request.  Every
+ * SAC_ADAPT_INTERVAL misses, sacAdapt decays the histogram by half,
+ * chooses the most popular candidates as the new classes, and divides
+ * cacheSize bytes between the classes in proportion to their share of
+ * the histogram, so that classes that miss often get more room, and
+ * classes that are unused get none.
+ *
+ * .adapt.held: A block is freed with the size it was requested with,
+ * so a class that has blocks out with the client must go on mapping
+ * the same range of request sizes to the same block size, or the
+ * blocks would be cached or freed with the wrong size.  The SAC counts
+ * the blocks of each class that it has taken from the pool and not
+ * returned.  If that is more than the class has cached, sacAdapt keeps
+ * the class and the class below it, and chooses no size between them.
+ * Likewise, if overlarge blocks are out, it keeps the largest class
+ * and chooses no size above it.  This relies on blocks being freed
+ * through the SAC that allocated them.
+ *
+ * .adapt.layout: sacAdapt also moves the middle of the cache, where
+ * MPS_SAC_ALLOC_FAST starts its search, to the class in the middle of
+ * the traffic.  The SAC is allocated with room for any middle.
+ */
+
+Res SACCreateAdaptive(SAC *sacReturn, Pool pool, Size cacheSize)
+{
+  mps_sac_class_s classes[SAC_ADAPT_CLASS_COUNT];
+  Arena arena;
+  SACAdapt adapt;
+  Size size, align;
+  Index j, step;
+  void *p;
+  Res res;
+
+  AVER(sacReturn != NULL);
+  AVERT(Pool, pool);
+  arena = PoolArena(pool);
+  align = PoolAlignment(pool);
+
+  res = ControlAlloc(&p, arena, sizeof(SACAdaptStruct));
+  if (res != ResOK)
+    return res;
+  adapt = p;
+  adapt->cacheSize = cacheSize;
+  adapt->interval = SAC_ADAPT_INTERVAL;
+  adapt->adaptCount = 0;
+  adapt->sizeCount = 0;
+
+  /* Make the candidate sizes, and start with the same number of bytes
+     in each doubling. */
+  size = SizeAlignUp(sizeof(Addr), align);
+  for (j = 0; j < SAC_ADAPT_CLASS_COUNT; ++j) {
+    Count count = cacheSize / SAC_ADAPT_CLASS_COUNT / size;
+    for (step = 0; step < SAC_ADAPT_STEPS; ++step) {
+      Size stepSize = SizeAlignUp(size + size / SAC_ADAPT_STEPS * step,
+                                  align);
+      if (step > 0 && j + 1 == SAC_ADAPT_CLASS_COUNT)
+        break;
+      if (adapt->sizeCount == 0
+          || stepSize > adapt->size[adapt->sizeCount - 1]) {
+        AVER(adapt->sizeCount < sacAdaptSizeLIMIT);
+        adapt->size[adapt->sizeCount] = stepSize;
+        adapt->traffic[adapt->sizeCount] = 0;
+        adapt->weight[adapt->sizeCount] = 0;
+        ++adapt->sizeCount;
+      }
+      if (step == 0)
+        adapt->classSize[j] = adapt->sizeCount - 1;
+    }
+    AVER(adapt->size[adapt->classSize[j]] == size);
+    if (count > SAC_ADAPT_COUNT_MAX)
+      count = SAC_ADAPT_COUNT_MAX;
+    classes[j].mps_block_size = size;
+    classes[j].mps_cached_count = count;
+    classes[j].mps_frequency = 1;
+    adapt->held[j] = 0;
+    size *= 2;
+  }
+  adapt->held[SAC_ADAPT_CLASS_COUNT] = 0;
+
+  res = sacCreate(sacReturn, pool, SAC_ADAPT_CLASS_COUNT, classes, adapt);
+  if (res != ResOK) {
+    ControlFree(arena, adapt, sizeof(SACAdaptStruct));
+    return res;
+  }
+  return ResOK;
+}
+
+
 /* SACDestroy -- destroy an SAC object */
 
 void SACDestroy(SAC sac)
 {
+  Arena arena;
+  SACAdapt adapt;
+
   AVERT(SAC, sac);
+  arena = PoolArena(sac->pool);
+  adapt = sac->adapt;
   SACFlush(sac);
   sac->sig = SigInvalid;
-  ControlFree(PoolArena(sac->pool), sac,
-              sacSize(sac->middleIndex, sac->classesCount));
+  ControlFree(arena, sac, sacStructSize(sac));
+  if (adapt != NULL)
+    ControlFree(arena, adapt, sizeof(SACAdaptStruct));
 }
 
 
@@ -242,6 +431,324 @@ static void sacFind(Index *iReturn, Size *blockSizeReturn,
 }
 
 
+/* sacClassOfIndex -- the class whose blocks are in a freelist
+ *
+ * See sacLayout.  Returns classesCount for the overlarge freelist.
+ */
+
+static Index sacClassOfIndex(SAC sac, Index i)
+{
+  if (i % 2 == 0)
+    return sac->middleIndex + 1 + i / 2;
+  else
+    return sac->middleIndex - i / 2;
+}
+
+
+/* sacIndexOfClass -- the freelist holding the blocks of a class */
+
+static Index sacIndexOfClass(SAC sac, Index j)
+{
+  AVER(j < sac->classesCount);
+  if (j > sac->middleIndex)
+    return 2 * (j - sac->middleIndex - 1);
+  else
+    return 2 * (sac->middleIndex - j) + 1;
+}
+
+
+/* SACAllocFast -- alloc an object from the cache, if it has one
+ *
+ * This is MPS_SAC_ALLOC_FAST without the call to mps_sac_fill.  It
+ * returns FALSE if the cache has no block of the right class, and
+ * doesn't touch the pool, so that it can be called without the arena
+ * lock: see <design/pool#.cache.lock>.
+ */
+
+Bool SACAllocFast(Addr *p_o, SAC sac, Size size)
+{
+  Index i;
+  Size blockSize;
+  mps_sac_t esac;
+
+  AVER_CRITICAL(p_o != NULL);
+  AVER_CRITICAL(TESTT(SAC, sac));
+  AVER_CRITICAL(size != 0);
+  esac = ExternalSACOfSAC(sac);
+
+  sacFind(&i, &blockSize, sac, size);
+  if (esac->_freelists[i]._count == 0)
+    return FALSE;
+  *p_o = esac->_freelists[i]._blocks;
+  /* @@@@ ignoring shields for now */
+  esac->_freelists[i]._blocks = *ADDR_PTR(Addr, *p_o);
+  --esac->_freelists[i]._count;
+  return TRUE;
+}
+
+
+/* SACFreeFast -- free an object to the cache, if it has room
+ *
+ * This is MPS_SAC_FREE_FAST without the call to mps_sac_empty.  See
+ * SACAllocFast.
+ */
+
+Bool SACFreeFast(SAC sac, Addr p, Size size)
+{
+  Index i;
+  Size blockSize;
+  mps_sac_t esac;
+
+  AVER_CRITICAL(TESTT(SAC, sac));
+  AVER_CRITICAL(p != NULL);
+  AVER_CRITICAL(size != 0);
+  esac = ExternalSACOfSAC(sac);
+
+  sacFind(&i, &blockSize, sac, size);
+  if (esac->_freelists[i]._count >= esac->_freelists[i]._count_max)
+    return FALSE;
+  /* @@@@ ignoring shields for now */
+  *ADDR_PTR(Addr, p) = esac->_freelists[i]._blocks;
+  esac->_freelists[i]._blocks = p;
+  ++esac->_freelists[i]._count;
+  return TRUE;
+}
+
+
+/* sacAdaptHeld -- record blocks returned to the pool from freelist i
+ *
+ * See .adapt.held.  Blocks freed through another SAC may make the
+ * count too small, so it stops at zero.
+ */
+
+static void sacAdaptHeld(SAC sac, Index i, Count blockCount)
+{
+  SACAdapt adapt = sac->adapt;
+  Index j;
+
+  if (adapt == NULL)
+    return;
+  j = sacClassOfIndex(sac, i);
+  if (adapt->held[j] > blockCount)
+    adapt->held[j] -= blockCount;
+  else
+    adapt->held[j] = 0;
+}
+
+
+/* sacFreeBlocks -- free blocks from the front of a chain to the pool */
+
+static Addr sacFreeBlocks(SAC sac, Addr fl, Count blockCount,
+                          Size blockSize)
+{
+  Count j;
+
+  for (j = 0; j < blockCount; ++j) {
+    Addr cb = fl;
+    /* @@@@ ignoring shields for now */
+    fl = *ADDR_PTR(Addr, cb);
+    PoolFree(sac->pool, cb, blockSize);
+  }
+  return fl;
+}
+
+
+/* sacAdaptChoose -- choose the candidate sizes of the new classes
+ *
+ * See .adapt.held.  Sets chosen[s] for SAC_ADAPT_CLASS_COUNT candidate
+ * sizes: first those of classes that must be kept, then the most
+ * popular, then the old classes, largest first, then any others.
+ */
+
+static void sacAdaptChoose(Bool chosen[sacAdaptSizeLIMIT], SACAdapt adapt,
+                           Count counts[SAC_ADAPT_CLASS_COUNT])
+{
+  Bool barred[sacAdaptSizeLIMIT];
+  Count chosenCount = 0;
+  Index j, s;
+
+  for (s = 0; s < adapt->sizeCount; ++s) {
+    chosen[s] = FALSE;
+    barred[s] = FALSE;
+  }
+
+  for (j = 0; j < SAC_ADAPT_CLASS_COUNT; ++j)
+    if (adapt->held[j] > counts[j]) {
+      s = j > 0 ? adapt->classSize[j - 1] + 1 : 0;
+      for (; s < adapt->classSize[j]; ++s)
+        barred[s] = TRUE;
+      chosen[adapt->classSize[j]] = TRUE;
+      if (j > 0)
+        chosen[adapt->classSize[j - 1]] = TRUE;
+    }
+  if (adapt->held[SAC_ADAPT_CLASS_COUNT] > 0) {
+    s = adapt->classSize[SAC_ADAPT_CLASS_COUNT - 1];
+    chosen[s] = TRUE;
+    for (++s; s < adapt->sizeCount; ++s)
+      barred[s] = TRUE;
+  }
+  for (s = 0; s < adapt->sizeCount; ++s)
+    if (chosen[s])
+      ++chosenCount;
+  AVER(chosenCount <= SAC_ADAPT_CLASS_COUNT);
+
+  while (chosenCount < SAC_ADAPT_CLASS_COUNT) {
+    Index best = adapt->sizeCount;
+    for (s = 0; s < adapt->sizeCount; ++s)
+      if (!chosen[s] && !barred[s] && adapt->weight[s] > 0
+          && (best == adapt->sizeCount
+              || adapt->weight[s] > adapt->weight[best]))
+        best = s;
+    if (best == adapt->sizeCount)
+      break;
+    chosen[best] = TRUE;
+    ++chosenCount;
+  }
+
+  /* The old classes are never barred, so there are enough of them. */
+  for (j = SAC_ADAPT_CLASS_COUNT;
+       j > 0 && chosenCount < SAC_ADAPT_CLASS_COUNT; --j) {
+    s = adapt->classSize[j - 1];
+    AVER(!barred[s]);
+    if (!chosen[s]) {
+      chosen[s] = TRUE;
+      ++chosenCount;
+    }
+  }
+  AVER(chosenCount == SAC_ADAPT_CLASS_COUNT);
+}
+
+
+/* sacAdapt -- recompute the classes, counts and middle of an adaptive SAC
+ *
+ * See .adapt.  Called with the arena lock held, from SACFill or
+ * SACEmpty.  The blocks in each class that is kept are kept, up to its
+ * new count, and the rest are freed to the pool.
+ */
+
+static void sacAdapt(SAC sac)
+{
+  mps_sac_class_s classes[SAC_ADAPT_CLASS_COUNT];
+  Index classSize[SAC_ADAPT_CLASS_COUNT];
+  Addr blocks[SAC_ADAPT_CLASS_COUNT], newBlocks[SAC_ADAPT_CLASS_COUNT];
+  Count counts[SAC_ADAPT_CLASS_COUNT], newCounts[SAC_ADAPT_CLASS_COUNT];
+  Count held[SAC_ADAPT_CLASS_COUNT];
+  Count weight[SAC_ADAPT_CLASS_COUNT];
+  Bool chosen[sacAdaptSizeLIMIT];
+  SACAdapt adapt = sac->adapt;
+  mps_sac_t esac = ExternalSACOfSAC(sac);
+  Count total = 0;
+  Index i, j, k, s;
+
+  AVER(sac->classesCount == SAC_ADAPT_CLASS_COUNT);
+
+  for (s = 0; s < adapt->sizeCount; ++s) {
+    adapt->weight[s] = adapt->weight[s] / 2 + adapt->traffic[s];
+    adapt->traffic[s] = 0;
+    total += adapt->weight[s];
+  }
+  adapt->interval = SAC_ADAPT_INTERVAL;
+  if (total == 0)
+    return;
+  ++adapt->adaptCount;
+
+  /* Detach the freelists, and choose the new classes. */
+  for (j = 0; j < SAC_ADAPT_CLASS_COUNT; ++j) {
+    i = sacIndexOfClass(sac, j);
+    blocks[j] = esac->_freelists[i]._blocks;
+    counts[j] = esac->_freelists[i]._count;
+  }
+  sacAdaptChoose(chosen, adapt, counts);
+  for (s = 0, k = 0; s < adapt->sizeCount; ++s)
+    if (chosen[s]) {
+      classSize[k] = s;
+      weight[k] = 0;
+      newBlocks[k] = NULL;
+      newCounts[k] = 0;
+      held[k] = 0;
+      ++k;
+    }
+  AVER(k == SAC_ADAPT_CLASS_COUNT);
+
+  /* Each size's traffic goes to the class it would be allocated in. */
+  for (s = 0, k = 0; s < adapt->sizeCount; ++s) {
+    while (k < SAC_ADAPT_CLASS_COUNT && classSize[k] < s)
+      ++k;
+    if (k == SAC_ADAPT_CLASS_COUNT)
+      break; /* overlarge */
+    weight[k] += adapt->weight[s];
+  }
+
+  /* Move the blocks of the classes that are kept, and free the rest. */
+  for (j = 0, k = 0; j < SAC_ADAPT_CLASS_COUNT; ++j) {
+    while (k < SAC_ADAPT_CLASS_COUNT && classSize[k] < adapt->classSize[j])
+      ++k;
+    if (k < SAC_ADAPT_CLASS_COUNT && classSize[k] == adapt->classSize[j]) {
+      newBlocks[k] = blocks[j];
+      newCounts[k] = counts[j];
+      held[k] = adapt->held[j];
+    } else {
+      AVER(adapt->held[j] <= counts[j]); /* see .adapt.held */
+      (void)sacFreeBlocks(sac, blocks[j], counts[j],
+                          adapt->size[adapt->classSize[j]]);
+    }
+  }
+
+  for (k = 0; k < SAC_ADAPT_CLASS_COUNT; ++k) {
+    Size size = adapt->size[classSize[k]];
+    double share = (double)adapt->cacheSize * (double)weight[k]
+                   / (double)total;
+    Count count = (Count)(share / (double)size);
+    if (count > SAC_ADAPT_COUNT_MAX)
+      count = SAC_ADAPT_COUNT_MAX;
+    classes[k].mps_block_size = size;
+    classes[k].mps_cached_count = count;
+    /* Frequencies must not all be zero: see sacMiddle. */
+    classes[k].mps_frequency = (unsigned)weight[k] + 1;
+    adapt->classSize[k] = classSize[k];
+  }
+
+  sacLayout(sac, sacMiddle(SAC_ADAPT_CLASS_COUNT, classes),
+            SAC_ADAPT_CLASS_COUNT, classes);
+
+  /* Reattach the freelists, trimming them to their new counts. */
+  for (k = 0; k < SAC_ADAPT_CLASS_COUNT; ++k) {
+    Count excess = 0;
+    i = sacIndexOfClass(sac, k);
+    if (newCounts[k] > classes[k].mps_cached_count)
+      excess = newCounts[k] - classes[k].mps_cached_count;
+    esac->_freelists[i]._blocks =
+      sacFreeBlocks(sac, newBlocks[k], excess, classes[k].mps_block_size);
+    esac->_freelists[i]._count = newCounts[k] - excess;
+    adapt->held[k] = held[k] > excess ? held[k] - excess : 0;
+  }
+  AVERT(SAC, sac);
+}
+
+
+/* sacAdaptRecord -- record blocks moved to or from the pool
+ *
+ * See .adapt.sample.  Does nothing unless the SAC is adaptive.
+ */
+
+static void sacAdaptRecord(SAC sac, Size size, Count blockCount)
+{
+  SACAdapt adapt = sac->adapt;
+  Index s;
+
+  if (adapt == NULL)
+    return;
+  for (s = 0; s < adapt->sizeCount && adapt->size[s] < size; ++s)
+    NOOP;
+  if (s < adapt->sizeCount) /* not overlarge */
+    adapt->traffic[s] += blockCount;
+  AVER(adapt->interval > 0);
+  --adapt->interval;
+  if (adapt->interval == 0)
+    sacAdapt(sac);
+}
+
+
 /* SACFill -- alloc an object, and perhaps fill the cache */
 
 Res SACFill(Addr *p_o, SAC sac, Size size)
@@ -287,6 +794,10 @@ Res SACFill(Addr *p_o, SAC sac, Size size)
   *p_o = fl;
   /* @@@@ ignoring shields for now */
   esac->_freelists[i]._blocks = *ADDR_PTR(Addr, fl);
+  ++sac->fillCount;
+  if (sac->adapt != NULL)
+    sac->adapt->held[sacClassOfIndex(sac, i)] += j;
+  sacAdaptRecord(sac, size, j);
   return ResOK;
 }
 
@@ -299,19 +810,13 @@ Res SACFill(Addr *p_o, SAC sac, Size size)
 static void sacClassFlush(SAC sac, Index i, Size blockSize,
                           Count blockCount)
 {
-  Addr cb, fl;
-  Count j;
   mps_sac_t esac;
 
   esac = ExternalSACOfSAC(sac);
-  for (j = 0, fl = esac->_freelists[i]._blocks;
-       j < blockCount; ++j) {
-    /* @@@@ ignoring shields for now */
-    cb = fl; fl = *ADDR_PTR(Addr, cb);
-    PoolFree(sac->pool, cb, blockSize);
-  }
+  esac->_freelists[i]._blocks =
+    sacFreeBlocks(sac, esac->_freelists[i]._blocks, blockCount, blockSize);
   esac->_freelists[i]._count -= blockCount;
-  esac->_freelists[i]._blocks = fl;
+  sacAdaptHeld(sac, i, blockCount);
 }
 
 
@@ -345,20 +850,98 @@ void SACEmpty(SAC sac, Addr p, Size size)
     /* Computed as count - count/3, so that the rounding works out right. */
     blockCount = esac->_freelists[i]._count;
     blockCount -= esac->_freelists[i]._count / 3;
-    sacClassFlush(sac, i, blockSize, (blockCount > 0) ? blockCount : 1);
+    if (blockCount == 0)
+      blockCount = 1;
+    sacClassFlush(sac, i, blockSize, blockCount);
     /* Leave the current one in the cache. */
     esac->_freelists[i]._count += 1;
     /* @@@@ ignoring shields for now */
     *ADDR_PTR(Addr, p) = esac->_freelists[i]._blocks;
     esac->_freelists[i]._blocks = p;
+    ++sac->emptyCount;
+    sacAdaptRecord(sac, size, blockCount);
   } else {
     /* Free even the current one. */
     PoolFree(sac->pool, p, blockSize);
+    sacAdaptHeld(sac, i, 1);
+    ++sac->emptyCount;
+    sacAdaptRecord(sac, size, 1);
   }
 }
 
 
-/* SACFlush -- flush the cache, releasing all memory held in it */
+/* sacDeposit -- move blocks from a class to a magazine in the depot
+ *
+ * Moves the first blockCount blocks of freelist i to an empty magazine
+ * and puts it on the depot's list for the class.  Returns FALSE,
+ * leaving the freelist alone, if there are no empty magazines.  The
+ * chain is cut before claiming the depot lock, as the SAC belongs to
+ * the calling thread.
+ */
+
+static Bool sacDeposit(SAC sac, Index i, Size blockSize, Count blockCount)
+{
+  SACDepot depot = sac->depot;
+  SACMagazine mag;
+  Addr first, last, rest;
+  Count j;
+  mps_sac_t esac;
+
+  esac = ExternalSACOfSAC(sac);
+  AVER(blockCount > 0);
+  AVER(blockCount <= depot->magazineSize);
+  AVER(blockCount <= esac->_freelists[i]._count);
+
+  first = esac->_freelists[i]._blocks;
+  for (j = 1, last = first; j < blockCount; ++j)
+    /* @@@@ ignoring shields for now */
+    last = *ADDR_PTR(Addr, last);
+  rest = *ADDR_PTR(Addr, last);
+  *ADDR_PTR(Addr, last) = NULL;
+
+  LockClaim(depot->lock);
+  mag = depot->empty;
+  if (mag != NULL) {
+    depot->empty = mag->next;
+    mag->blocks = first;
+    mag->count = blockCount;
+    mag->blockSize = blockSize;
+    mag->next = depot->full[i];
+    depot->full[i] = mag;
+  }
+  LockRelease(depot->lock);
+
+  if (mag == NULL) {
+    *ADDR_PTR(Addr, last) = rest;
+    return FALSE;
+  }
+  esac->_freelists[i]._blocks = rest;
+  esac->_freelists[i]._count -= blockCount;
+  return TRUE;
+}
+
+
+/* sacClassDeposit -- move as many blocks as will fit to the depot */
+
+static void sacClassDeposit(SAC sac, Index i, Size blockSize)
+{
+  mps_sac_t esac = ExternalSACOfSAC(sac);
+
+  while (esac->_freelists[i]._count > 0) {
+    Count blockCount = esac->_freelists[i]._count;
+    if (blockCount > sac->depot->magazineSize)
+      blockCount = sac->depot->magazineSize;
+    if (!sacDeposit(sac, i, blockSize, blockCount))
+      break;
+  }
+}
+
+
+/* SACFlush -- flush the cache, releasing all memory held in it
+ *
+ * If the SAC has a depot, the blocks go there, and only the blocks
+ * that don't fit go back to the pool.
+ */
 
 void SACFlush(SAC sac)
 {
@@ -371,6 +954,8 @@ void SACFlush(SAC sac)
   esac = ExternalSACOfSAC(sac);
   for (j = sac->middleIndex + 1, i = 0;
        j < sac->classesCount; ++j, i += 2) {
+    if (sac->depot != NULL)
+      sacClassDeposit(sac, i, esac->_freelists[i]._size);
     sacClassFlush(sac, i, esac->_freelists[i]._size,
                   esac->_freelists[i]._count);
     AVER(esac->_freelists[i]._blocks == NULL);
@@ -378,16 +963,244 @@ void SACFlush(SAC sac)
   /* no need to flush overlarge, there's nothing there */
   prevSize = esac->_middle;
   for (j = sac->middleIndex, i = 1; j > 0; --j, i += 2) {
+    if (sac->depot != NULL)
+      sacClassDeposit(sac, i, prevSize);
     sacClassFlush(sac, i, prevSize, esac->_freelists[i]._count);
     AVER(esac->_freelists[i]._blocks == NULL);
     prevSize = esac->_freelists[i]._size;
   }
   /* flush smallest class */
+  if (sac->depot != NULL)
+    sacClassDeposit(sac, i, prevSize);
   sacClassFlush(sac, i, prevSize, esac->_freelists[i]._count);
   AVER(esac->_freelists[i]._blocks == NULL);
 }
 
 
+/* SACDepotCreate -- create a depot of magazines for a pool
+ *
+ * <design/pool#.cache.magazine>.  All the magazines are allocated
+ * here, so that moving blocks to the depot never needs the arena.
+ */
+
+Res SACDepotCreate(SACDepot *depotReturn, Pool pool,
+                   Count magazineSize, Count magazineCount)
+{
+  Arena arena;
+  SACDepot depot;
+  void *p;
+  Index i;
+  Res res;
+
+  AVER(depotReturn != NULL);
+  AVERT(Pool, pool);
+  AVER(magazineSize > 0);
+  AVER(magazineCount > 0);
+  arena = PoolArena(pool);
+
+  res = ControlAlloc(&p, arena, sizeof(SACDepotStruct));
+  if (res != ResOK)
+    goto failDepotAlloc;
+  depot = p;
+
+  res = ControlAlloc(&p, arena, LockSize());
+  if (res != ResOK)
+    goto failLockAlloc;
+  depot->lock = p;
+  LockInit(depot->lock);
+
+  res = ControlAlloc(&p, arena, magazineCount * sizeof(SACMagazineStruct));
+  if (res != ResOK)
+    goto failMagazinesAlloc;
+  depot->magazines = p;
+
+  depot->empty = NULL;
+  for (i = 0; i < magazineCount; ++i) {
+    SACMagazine mag = &depot->magazines[i];
+    mag->blocks = NULL;
+    mag->count = 0;
+    mag->blockSize = 0;
+    mag->next = depot->empty;
+    depot->empty = mag;
+  }
+  for (i = 0; i < NELEMS(depot->full); ++i)
+    depot->full[i] = NULL;
+
+  depot->pool = pool;
+  depot->magazineSize = magazineSize;
+  depot->magazineCount = magazineCount;
+  depot->sig = SACDepotSig;
+  AVERT(SACDepot, depot);
+  *depotReturn = depot;
+  return ResOK;
+
+failMagazinesAlloc:
+  LockFinish(depot->lock);
+  ControlFree(arena, depot->lock, LockSize());
+failLockAlloc:
+  ControlFree(arena, depot, sizeof(SACDepotStruct));
+failDepotAlloc:
+  return res;
+}
+
+
+/* SACDepotDestroy -- free the blocks in a depot and destroy it
+ *
+ * All the SACs that use the depot must have been destroyed.
+ */
+
+void SACDepotDestroy(SACDepot depot)
+{
+  Arena arena;
+  Index i;
+
+  AVERT(SACDepot, depot);
+  arena = PoolArena(depot->pool);
+
+  for (i = 0; i < NELEMS(depot->full); ++i) {
+    SACMagazine mag;
+    for (mag = depot->full[i]; mag != NULL; mag = mag->next) {
+      Addr cb, fl;
+      Count j;
+      for (j = 0, fl = mag->blocks; j < mag->count; ++j) {
+        /* @@@@ ignoring shields for now */
+        cb = fl; fl = *ADDR_PTR(Addr, cb);
+        PoolFree(depot->pool, cb, mag->blockSize);
+      }
+      AVER(fl == NULL);
+    }
+  }
+
+  depot->sig = SigInvalid;
+  ControlFree(arena, depot->magazines,
+              depot->magazineCount * sizeof(SACMagazineStruct));
+  LockFinish(depot->lock);
+  ControlFree(arena, depot->lock, LockSize());
+  ControlFree(arena, depot, sizeof(SACDepotStruct));
+}
+
+
+/* SACCreateMagazine -- create an SAC that exchanges magazines with a depot
+ *
+ * The classes must be the same for all the SACs that use the depot,
+ * and must hold at least a magazine's worth of blocks.
+ */
+
+Res SACCreateMagazine(SAC *sacReturn, SACDepot depot,
+                      Count classesCount, SACClasses classes)
+{
+  SAC sac;
+  Index i;
+  Res res;
+
+  AVER(sacReturn != NULL);
+  AVERT(SACDepot, depot);
+  AVER(classesCount <= sacClassLIMIT);
+  for (i = 0; i < classesCount; ++i)
+    AVER(classes[i].mps_cached_count >= depot->magazineSize);
+
+  res = SACCreate(&sac, depot->pool, classesCount, classes);
+  if (res != ResOK)
+    return res;
+  sac->depot = depot;
+  AVERT(SAC, sac);
+  *sacReturn = sac;
+  return ResOK;
+}
+
+
+/* SACDepotFill -- refill an empty class from the depot
+ *
+ * Swaps the empty class for a magazine from the depot, and allocates
+ * an object from it.  Returns FALSE if the depot has no magazine for
+ * the class, in which case the caller must claim the arena lock and
+ * call SACFill.  Only claims the depot lock.
+ */
+
+Bool SACDepotFill(Addr *p_o, SAC sac, Size size)
+{
+  SACDepot depot;
+  SACMagazine mag;
+  Addr blocks = NULL;
+  Count count = 0;
+  Index i;
+  Size blockSize;
+  mps_sac_t esac;
+
+  AVER(p_o != NULL);
+  AVERT(SAC, sac);
+  AVER(sac->depot != NULL);
+  AVER(size != 0);
+  depot = sac->depot;
+  esac = ExternalSACOfSAC(sac);
+
+  sacFind(&i, &blockSize, sac, size);
+  AVER(esac->_freelists[i]._count == 0);
+  if (esac->_freelists[i]._count_max == 0)
+    return FALSE; /* overlarge */
+
+  LockClaim(depot->lock);
+  mag = depot->full[i];
+  if (mag != NULL) {
+    depot->full[i] = mag->next;
+    blocks = mag->blocks;
+    count = mag->count;
+    mag->blocks = NULL;
+    mag->count = 0;
+    mag->next = depot->empty;
+    depot->empty = mag;
+  }
+  LockRelease(depot->lock);
+
+  if (mag == NULL)
+    return FALSE;
+  AVER(count > 0);
+  AVER(count <= esac->_freelists[i]._count_max);
+  *p_o = blocks;
+  /* @@@@ ignoring shields for now */
+  esac->_freelists[i]._blocks = *ADDR_PTR(Addr, blocks);
+  esac->_freelists[i]._count = count - 1;
+  ++sac->fillCount;
+  return TRUE;
+}
+
+
+/* SACDepotEmpty -- empty a full class to the depot
+ *
+ * Moves a magazine's worth of blocks from the full class to the
+ * depot, and frees the object to the class.  Returns FALSE if the
+ * depot has no room, in which case the caller must claim the arena
+ * lock and call SACEmpty.  Only claims the depot lock.
+ */
+
+Bool SACDepotEmpty(SAC sac, Addr p, Size size)
+{
+  Index i;
+  Size blockSize;
+  mps_sac_t esac;
+
+  AVERT(SAC, sac);
+  AVER(sac->depot != NULL);
+  AVER(p != NULL);
+  AVER(size > 0);
+  esac = ExternalSACOfSAC(sac);
+
+  sacFind(&i, &blockSize, sac, size);
+  AVER(esac->_freelists[i]._count == esac->_freelists[i]._count_max);
+  if (esac->_freelists[i]._count_max < sac->depot->magazineSize)
+    return FALSE; /* overlarge */
+
+  if (!sacDeposit(sac, i, blockSize, sac->depot->magazineSize))
+    return FALSE;
+  /* @@@@ ignoring shields for now */
+  *ADDR_PTR(Addr, p) = esac->_freelists[i]._blocks;
+  esac->_freelists[i]._blocks = p;
+  ++esac->_freelists[i]._count;
+  ++sac->emptyCount;
+  return TRUE;
+}
+
+
 /* C. COPYRIGHT AND LICENSE
  *
  * Copyright (C) 2001-2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
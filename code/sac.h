@@ -14,15 +14,42 @@
 #define sacClassLIMIT ((Count)8)
 
 
+/* SACAdapt -- state of an adaptive SAC
+ *
+ * <code/sac.c#adapt>.  The histogram is indexed by candidate size, the
+ * rest by class, smallest first.
+ */
+
+#define sacAdaptSizeLIMIT \
+  ((SAC_ADAPT_CLASS_COUNT - 1) * SAC_ADAPT_STEPS + 1)
+
+typedef struct SACAdaptStruct *SACAdapt;
+
+typedef struct SACAdaptStruct {
+  Size cacheSize;      /* bytes of blocks to divide between the classes */
+  Count interval;      /* misses until the next adaptation */
+  Count adaptCount;    /* number of adaptations */
+  Count sizeCount;     /* number of candidate sizes */
+  Size size[sacAdaptSizeLIMIT];     /* candidate sizes, ascending */
+  Count traffic[sacAdaptSizeLIMIT]; /* blocks moved since adaptation */
+  Count weight[sacAdaptSizeLIMIT];  /* decayed traffic */
+  Index classSize[SAC_ADAPT_CLASS_COUNT]; /* candidate size of class */
+  Count held[SAC_ADAPT_CLASS_COUNT + 1];  /* blocks taken from pool */
+} SACAdaptStruct;
+
+
 /* SAC -- the real segregated allocation caches */
 
 #define SACSig ((Sig)0x5195AC99) /* SIGnature SAC */
 
-typedef struct SACStruct *SAC;
-
 typedef struct SACStruct {
   Sig sig;
   Pool pool;
+  SACDepot depot;      /* depot to exchange magazines with, or NULL */
+  SACAdapt adapt;      /* adaptive state, or NULL */
+  Count allocCount;    /* number of calls to mps_sac_alloc */
+  Count fillCount;     /* number of fills (misses on allocation) */
+  Count emptyCount;    /* number of empties (misses on freeing) */
   Count classesCount;  /* number of classes */
   Index middleIndex;   /* index of the middle */
   _mps_sac_s esac_s;   /* variable length, must be last */
@@ -35,6 +62,35 @@ typedef struct SACStruct {
 #define SACArena(sac) PoolArena((sac)->pool)
 
 
+/* SACDepot -- shared depot of magazines
+ *
+ * <design/pool#.cache.magazine>.  A magazine is a chain of blocks of
+ * one class, moved between a thread's SAC and the depot as a whole.
+ */
+
+typedef struct SACMagazineStruct *SACMagazine;
+
+typedef struct SACMagazineStruct {
+  SACMagazine next;    /* next magazine on the same depot list */
+  Addr blocks;         /* chain of blocks, or NULL if empty */
+  Count count;         /* number of blocks in the chain */
+  Size blockSize;      /* size the blocks were allocated with */
+} SACMagazineStruct;
+
+#define SACDepotSig ((Sig)0x5195ADE9) /* SIGnature SAC DEPot */
+
+typedef struct SACDepotStruct {
+  Sig sig;
+  Pool pool;
+  Lock lock;                   /* protects the magazine lists */
+  Count magazineSize;          /* maximum blocks in a magazine */
+  Count magazineCount;         /* number of magazines */
+  SACMagazine magazines;       /* array of all the magazines */
+  SACMagazine empty;           /* list of empty magazines */
+  SACMagazine full[2 * sacClassLIMIT]; /* non-empty magazines, by freelist */
+} SACDepotStruct;
+
+
 /* SACClasses -- structure for specifying classes in the cache */
 /* .sacc: This structure must match <code/mps.h#sacc>. */
 
@@ -43,11 +99,22 @@ typedef struct mps_sac_classes_s *SACClasses;
 
 extern Res SACCreate(SAC *sac_o, Pool pool, Count classesCount,
                      SACClasses classes);
+extern Res SACCreateAdaptive(SAC *sacReturn, Pool pool, Size cacheSize);
 extern void SACDestroy(SAC sac);
+extern Bool SACAllocFast(Addr *p_o, SAC sac, Size size);
+extern Bool SACFreeFast(SAC sac, Addr p, Size size);
 extern Res SACFill(Addr *p_o, SAC sac, Size size);
 extern void SACEmpty(SAC sac, Addr p, Size size);
 extern void SACFlush(SAC sac);
 
+extern Res SACDepotCreate(SACDepot *depotReturn, Pool pool,
+                          Count magazineSize, Count magazineCount);
+extern void SACDepotDestroy(SACDepot depot);
+extern Res SACCreateMagazine(SAC *sacReturn, SACDepot depot,
+                             Count classesCount, SACClasses classes);
+extern Bool SACDepotFill(Addr *p_o, SAC sac, Size size);
+extern Bool SACDepotEmpty(SAC sac, Addr p, Size size);
+
 
 #endif /* sac_h */
 
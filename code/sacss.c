@@ -10,8 +10,11 @@
 #include "mpslib.h"
 #include "mpsavm.h"
 #include "mps.h"
+#include "mpm.h"
+#include "sac.h"
 
 #include "testlib.h"
+#include "testthr.h"
 #include "mpslib.h"
 
 #include <stdio.h>
@@ -25,6 +28,8 @@
 #define testArenaSIZE   ((((size_t)64)<<20) - 4)
 #define testSetSIZE 200
 #define testLOOPS 10
+#define testThreadCOUNT 4
+#define testPhaseCOUNT 12
 
 
 /* make -- allocate an object */
@@ -160,6 +165,186 @@ static size_t fixedSize(size_t i)
 }
 
 
+/* Magazine test: several threads allocate through SACs of their own
+ * in a pool with a cache, and each thread frees blocks allocated by
+ * the others.  <design/pool#.cache.magazine>.
+ *
+ * In phase k, thread t frees all the blocks in slot (t + k) % count,
+ * so that its classes fill up, and then allocates new ones there, so no two threads use a slot at once.
+ * Each block starts with a tag, which is checked before the block is
+ * freed, so that a block handed out twice is detected.
+ */
+
+typedef struct slot_s {
+  mps_word_t *ps[testSetSIZE];
+  size_t ss[testSetSIZE];
+  mps_word_t tags[testSetSIZE];
+} slot_s;
+
+static slot_s slots[testThreadCOUNT];
+static mps_sac_t sacs[testThreadCOUNT];
+static unsigned long phase;
+static size_t magazineMaxSize;
+
+static void *magazineThread(void *p)
+{
+  size_t t = (size_t)((char *)p - (char *)sacs) / sizeof sacs[0];
+  mps_sac_t sac = sacs[t];
+  slot_s *slot = &slots[(t + phase) % testThreadCOUNT];
+  size_t i;
+
+  for (i = 0; i < testSetSIZE; ++i)
+    if (slot->ps[i] != NULL) {
+      Insist(slot->ps[i][0] == slot->tags[i]);
+      MPS_SAC_FREE(sac, (mps_addr_t)slot->ps[i], slot->ss[i]);
+    }
+  for (i = 0; i < testSetSIZE; ++i) {
+    mps_addr_t obj;
+    mps_res_t res;
+    slot->ss[i] = sizeof(mps_word_t) + rnd() % magazineMaxSize;
+    MPS_SAC_ALLOC(res, obj, sac, slot->ss[i], FALSE);
+    die(res, "MPS_SAC_ALLOC");
+    slot->ps[i] = obj;
+    slot->tags[i] = (mps_word_t)((phase << 16) ^ (t << 12) ^ i);
+    slot->ps[i][0] = slot->tags[i];
+  }
+  return NULL;
+}
+
+static void magazines(mps_arena_t arena, mps_align_t align)
+{
+  testthr_t threads[testThreadCOUNT];
+  mps_pool_t pool;
+  mps_sac_t sac;
+  size_t t, i;
+
+  printf("MVFF magazines\n");
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ALIGN, align);
+    die(mps_pool_create_k(&pool, arena, mps_class_mvff(), args),
+        "pool create");
+  } MPS_ARGS_END(args);
+  cdie(mps_sac_create_magazine(&sac, pool) == MPS_RES_PARAM,
+       "mps_sac_create_magazine without cache");
+  mps_pool_destroy(pool);
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ALIGN, align);
+    MPS_ARGS_ADD(args, MPS_KEY_MVFF_CACHE, TRUE);
+    die(mps_pool_create_k(&pool, arena, mps_class_mvff(), args),
+        "pool create cached");
+  } MPS_ARGS_END(args);
+
+  /* Sizes in the cached classes, for most alignments. */
+  magazineMaxSize = 64 * alignUp(align, sizeof(void *));
+  for (t = 0; t < testThreadCOUNT; ++t) {
+    die(mps_sac_create_magazine(&sacs[t], pool), "mps_sac_create_magazine");
+    for (i = 0; i < testSetSIZE; ++i)
+      slots[t].ps[i] = NULL;
+  }
+
+  for (phase = 0; phase < testPhaseCOUNT; ++phase) {
+    for (t = 0; t < testThreadCOUNT; ++t)
+      testthr_create(&threads[t], magazineThread, &sacs[t]);
+    for (t = 0; t < testThreadCOUNT; ++t)
+      testthr_join(&threads[t], NULL);
+    if (phase == testPhaseCOUNT / 2)
+      mps_sac_flush(sacs[0]);
+  }
+
+  /* Free the blocks through mps_free, which shares the classes. */
+  for (t = 0; t < testThreadCOUNT; ++t)
+    for (i = 0; i < testSetSIZE; ++i) {
+      Insist(slots[t].ps[i][0] == slots[t].tags[i]);
+      mps_free(pool, (mps_addr_t)slots[t].ps[i], slots[t].ss[i]);
+    }
+  for (t = 0; t < testThreadCOUNT; ++t)
+    mps_sac_destroy(sacs[t]);
+  mps_pool_destroy(pool);
+}
+
+
+/* Adaptive test: allocate and free through an adaptive SAC while the
+ * distribution of sizes moves from small to large blocks, and check
+ * that the cache adapts, that it chooses some class sizes that aren't
+ * on the starting ladder of doublings, and that blocks aren't handed
+ * out twice.  <code/sac.c#adapt>.
+ */
+
+#define adaptiveLIVE 500
+#define adaptiveOPS 20000
+
+static void adaptive(mps_arena_t arena, mps_align_t align)
+{
+  mps_word_t *ps[adaptiveLIVE];
+  size_t ss[adaptiveLIVE];
+  mps_word_t tags[adaptiveLIVE];
+  mps_pool_t pool;
+  mps_sac_t sac;
+  mps_sac_stats_s stats;
+  SACAdapt adapt;
+  size_t i, op, unit = alignUp(align, sizeof(void *));
+  size_t refined = 0;
+
+  printf("MVFF adaptive\n");
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ALIGN, align);
+    die(mps_pool_create_k(&pool, arena, mps_class_mvff(), args),
+        "pool create");
+  } MPS_ARGS_END(args);
+  die(mps_sac_create_adaptive(&sac, pool, 1024 * unit),
+      "mps_sac_create_adaptive");
+
+  for (i = 0; i < adaptiveLIVE; ++i)
+    ps[i] = NULL;
+  for (op = 0; op < 2 * adaptiveOPS; ++op) {
+    /* Small blocks in the first half, larger in the second. */
+    size_t base = op < adaptiveOPS ? 2 : 64;
+    mps_addr_t obj;
+    mps_res_t res;
+
+    i = rnd() % adaptiveLIVE;
+    if (ps[i] != NULL) {
+      Insist(ps[i][0] == tags[i]);
+      mps_sac_free(sac, (mps_addr_t)ps[i], ss[i]);
+    }
+    ss[i] = (base + rnd() % base) * unit;
+    /* Only mps_sac_alloc counts allocations: see mps_sac_stats. */
+    res = mps_sac_alloc(&obj, sac, ss[i], FALSE);
+    die(res, "mps_sac_alloc");
+    ps[i] = obj;
+    tags[i] = (mps_word_t)op;
+    ps[i][0] = tags[i];
+  }
+
+  mps_sac_stats(&stats, sac);
+  printf("allocs %lu fills %lu empties %lu adapts %lu\n",
+         (unsigned long)stats.mps_allocs, (unsigned long)stats.mps_fills,
+         (unsigned long)stats.mps_empties, (unsigned long)stats.mps_adapts);
+  cdie(stats.mps_allocs == 2 * adaptiveOPS, "allocs");
+  cdie(stats.mps_fills <= stats.mps_allocs, "fills");
+  cdie(stats.mps_adapts > 0, "adapts");
+
+  adapt = SACOfExternalSAC(sac)->adapt;
+  for (i = 0; i < SAC_ADAPT_CLASS_COUNT; ++i) {
+    Size size = adapt->size[adapt->classSize[i]];
+    if ((size & (size - 1)) != 0) /* not a power of two */
+      ++refined;
+  }
+  printf("%lu classes off the ladder\n", (unsigned long)refined);
+  cdie(refined > 0, "refined");
+
+  for (i = 0; i < adaptiveLIVE; ++i) {
+    Insist(ps[i][0] == tags[i]);
+    MPS_SAC_FREE(sac, (mps_addr_t)ps[i], ss[i]);
+  }
+  mps_sac_destroy(sac);
+  mps_pool_destroy(pool);
+}
+
+
 static mps_pool_debug_option_s debugOptions = {
   /* .fence_template = */   "post",
   /* .fence_size = */       4,
@@ -207,6 +392,9 @@ static void testInArena(mps_arena_class_t arena_class, mps_arg_s *arena_args)
       "stress MFS");
   } MPS_ARGS_END(args);
 
+  magazines(arena, rnd_align(sizeof(void *), arena_grain_size));
+  adaptive(arena, rnd_align(sizeof(void *), arena_grain_size));
+
   mps_arena_destroy(arena);
 }
 
@@ -35,7 +35,8 @@
           mps_res_t res = MPS_FIX2(ss, &ref);           \
           if (res != MPS_RES_OK)                        \
             return res;                                 \
-          *p = (mps_word_t)ref | tag_bits;              \
+          if ((mps_word_t)ref != (word ^ tag_bits))     \
+            *p = (mps_word_t)ref | tag_bits;            \
         }                                               \
       }                                                 \
       ++p;                                              \
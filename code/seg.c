@@ -24,6 +24,9 @@ static void SegFinish(Seg seg);
 static Res SegInit(Seg seg, SegClass klass, Pool pool,
                    Addr base, Size size, ArgList args);
 
+static void gcSegSetGreyInternal(Seg seg, TraceSet oldGrey, TraceSet grey);
+static void gcSegSetWhiteInternal(Seg seg, TraceSet oldWhite, TraceSet white);
+
 
 /* Generic interface support */
 
@@ -132,6 +135,8 @@ static Res segAbsInit(Seg seg, Pool pool, Addr base, Size size, ArgList args)
   seg->defer = WB_DEFER_INIT;
   seg->depth = 0;
   seg->queued = FALSE;
+  seg->frozen = FALSE;
+  seg->clean = FALSE;
   seg->firstTract = NULL;
   RingInit(SegPoolRing(seg));
 
@@ -310,8 +315,19 @@ void SegSetSummary(Seg seg, RefSet summary)
   summary = RefSetUNIV;
 #endif
 
-  if (summary != SegSummary(seg))
-    Method(Seg, seg, setSummary)(seg, summary);
+  /* A clean segment has an empty summary. If references are added,
+     its other references become relevant, so it must be treated as
+     containing references to anything <design/strategy#.freeze.clean>. */
+  if (seg->clean && summary != RefSetEMPTY) {
+    seg->clean = FALSE;
+    summary = RefSetUNIV;
+  }
+
+  /* Dispatch even if the summary is unchanged, so that classes which
+     keep finer-grained summaries (such as AMC's card summaries, see
+     <design/poolamc#.scan.card.invalid>) learn that references in the
+     segment may have been written. */
+  Method(Seg, seg, setSummary)(seg, summary);
 }
 
 
@@ -328,6 +344,11 @@ void SegSetRankAndSummary(Seg seg, RankSet rankSet, RefSet summary)
   }
 #endif
 
+  if (seg->clean && summary != RefSetEMPTY) {
+    seg->clean = FALSE;
+    summary = RefSetUNIV;
+  }
+
   Method(Seg, seg, setRankSummary)(seg, rankSet, summary);
 }
 
@@ -399,6 +420,10 @@ Bool SegBufferFill(Addr *baseReturn, Addr *limitReturn, Seg seg, Size size,
   AVERT(Seg, seg);
   AVER(size > 0);
   AVERT(RankSet, rankSet);
+  /* Objects allocated in a frozen segment would never be reclaimed
+     <design/strategy#.freeze.alloc>. */
+  if (SegFrozen(seg))
+    return FALSE;
   return Method(Seg, seg, bufferFill)(baseReturn, limitReturn,
                                       seg, size, rankSet);
 }
@@ -915,6 +940,12 @@ Bool SegCheck(Seg seg)
      <design/shield#.inv.unsynced.depth>. */
   CHECKL(seg->sm == seg->pm || seg->depth > 0 || seg->queued);
 
+  /* A frozen segment is never condemned, and only a frozen segment
+     can be clean <design/strategy#.freeze.clean>. */
+  CHECKL(!seg->frozen || seg->white == TraceSetEMPTY);
+  CHECKL(!seg->clean || seg->frozen);
+  CHECKL(!seg->clean || seg->grey == TraceSetEMPTY);
+
   CHECKL(RankSetCheck(seg->rankSet));
   if (seg->rankSet == RankSetEMPTY) {
     /* <design/seg#.field.rankSet.empty>: If there are no refs */
@@ -1116,6 +1147,11 @@ static Res segTrivMerge(Seg seg, Seg segHi,
 
   /* no need to update fields which match. See .similar */
 
+  /* A segment that is partly frozen is frozen, but only clean if all
+     of it was clean <design/strategy#.freeze.clean>. */
+  seg->frozen = seg->frozen || segHi->frozen;
+  seg->clean = seg->clean && segHi->clean;
+
   seg->limit = limit;
   TRACT_FOR(tract, addr, arena, mid, limit) {
     AVERT(Tract, tract);
@@ -1190,6 +1226,8 @@ static Res segTrivSplit(Seg seg, Seg segHi,
   segHi->sm = seg->sm;
   segHi->depth = seg->depth;
   segHi->queued = seg->queued;
+  segHi->frozen = seg->frozen;
+  segHi->clean = seg->clean;
   segHi->firstTract = NULL;
   RingInit(SegPoolRing(segHi));
 
@@ -1429,6 +1467,7 @@ static void segTrivWalk(Seg seg, Format format, FormattedObjectsVisitor f,
 Bool GCSegCheck(GCSeg gcseg)
 {
   Seg seg;
+  TraceId ti;
   CHECKS(GCSeg, gcseg);
   seg = &gcseg->segStruct;
   CHECKD(Seg, seg);
@@ -1440,10 +1479,18 @@ Bool GCSegCheck(GCSeg gcseg)
     CHECKL(BufferRankSet(gcseg->buffer) == SegRankSet(seg));
   }
 
-  /* The segment should be on a grey ring if and only if it is grey. */
-  CHECKD_NOSIG(Ring, &gcseg->greyRing);
-  CHECKL((seg->grey == TraceSetEMPTY) ==
-         RingIsSingle(&gcseg->greyRing));
+  /* The segment should be on a trace's grey ring if and only if it is
+     grey for that trace. */
+  for (ti = 0; ti < TraceLIMIT; ++ti) {
+    CHECKD_NOSIG(Ring, &gcseg->greyRing[ti]);
+    CHECKL(BS_IS_MEMBER(seg->grey, ti) != RingIsSingle(&gcseg->greyRing[ti]));
+  }
+
+  /* Similarly for the white rings. */
+  for (ti = 0; ti < TraceLIMIT; ++ti) {
+    CHECKD_NOSIG(Ring, &gcseg->whiteRing[ti]);
+    CHECKL(BS_IS_MEMBER(seg->white, ti) != RingIsSingle(&gcseg->whiteRing[ti]));
+  }
 
   if (seg->rankSet == RankSetEMPTY) {
     /* <design/seg#.field.rankSet.empty> */
@@ -1461,6 +1508,7 @@ Bool GCSegCheck(GCSeg gcseg)
 static Res gcSegInit(Seg seg, Pool pool, Addr base, Size size, ArgList args)
 {
   GCSeg gcseg;
+  TraceId ti;
   Res res;
 
   /* Initialize the superclass fields first via next-method call */
@@ -1471,7 +1519,10 @@ static Res gcSegInit(Seg seg, Pool pool, Addr base, Size size, ArgList args)
 
   gcseg->summary = RefSetEMPTY;
   gcseg->buffer = NULL;
-  RingInit(&gcseg->greyRing);
+  for (ti = 0; ti < TraceLIMIT; ++ti) {
+    RingInit(&gcseg->greyRing[ti]);
+    RingInit(&gcseg->whiteRing[ti]);
+  }
   RingInit(&gcseg->genRing);
 
   SetClassOfPoly(seg, CLASS(GCSeg));
@@ -1488,11 +1539,14 @@ static void gcSegFinish(Inst inst)
 {
   Seg seg = MustBeA(Seg, inst);
   GCSeg gcseg = MustBeA(GCSeg, seg);
+  TraceId ti;
 
-  if (SegGrey(seg) != TraceSetEMPTY) {
-    RingRemove(&gcseg->greyRing);
-    seg->grey = TraceSetEMPTY;
-  }
+  if (SegGrey(seg) != TraceSetEMPTY)
+    gcSegSetGreyInternal(seg, SegGrey(seg), TraceSetEMPTY);
+  /* Pools may free a segment that is still white, for example when
+     reclaiming it. */
+  if (SegWhite(seg) != TraceSetEMPTY)
+    gcSegSetWhiteInternal(seg, SegWhite(seg), TraceSetEMPTY);
 
   EVENT5(SegSetSummary, PoolArena(SegPool(seg)), seg, SegSize(seg),
          gcseg->summary, RefSetEMPTY);
@@ -1504,7 +1558,10 @@ static void gcSegFinish(Inst inst)
   /* Don't leave a dangling buffer allocating into hyperspace. */
   AVER(gcseg->buffer == NULL); /* <design/check/#.common> */
 
-  RingFinish(&gcseg->greyRing);
+  for (ti = 0; ti < TraceLIMIT; ++ti) {
+    RingFinish(&gcseg->greyRing[ti]);
+    RingFinish(&gcseg->whiteRing[ti]);
+  }
   RingFinish(&gcseg->genRing);
 
   /* finish the superclass fields last */
@@ -1525,51 +1582,46 @@ static void gcSegSetGreyInternal(Seg seg, TraceSet oldGrey, TraceSet grey)
   GCSeg gcseg;
   Arena arena;
   Rank rank;
+  TraceId ti;
+  Trace trace;
+  TraceSet diff;
 
   /* Internal method. Parameters are checked by caller */
   gcseg = SegGCSeg(seg);
   arena = PoolArena(SegPool(seg));
   seg->grey = BS_BITFIELD(Trace, grey);
 
-  /* If the segment is now grey and wasn't before, add it to the */
-  /* appropriate grey list so that TraceFindGrey can locate it */
-  /* quickly later.  If it is no longer grey and was before, */
-  /* remove it from the list. */
-  if (oldGrey == TraceSetEMPTY) {
-    if (grey != TraceSetEMPTY) {
-      AVER(RankSetIsSingle(seg->rankSet));
-      for(rank = RankMIN; rank < RankLIMIT; ++rank)
-        if (RankSetIsMember(seg->rankSet, rank)) {
-          /* NOTE: We push the segment onto the front of the queue, so that
-             we preserve some locality of scanning, and so that we tend to
-             forward objects that are closely linked to the same or nearby
-             segments. */
-          RingInsert(ArenaGreyRing(arena, rank), &gcseg->greyRing);
-          break;
-        }
-      AVER(rank != RankLIMIT); /* there should've been a match */
-    }
-  } else {
-    if (grey == TraceSetEMPTY)
-      RingRemove(&gcseg->greyRing);
-  }
-
-  STATISTIC({
-    TraceId ti; Trace trace;
-    TraceSet diff;
-
-    diff = TraceSetDiff(grey, oldGrey);
+  /* For each trace for which the segment is now grey and wasn't */
+  /* before, add it to that trace's grey ring for its rank so that */
+  /* traceFindGrey can locate it quickly later.  For each trace for */
+  /* which it is no longer grey, remove it from that trace's ring. */
+  diff = TraceSetDiff(grey, oldGrey);
+  if (diff != TraceSetEMPTY) {
+    AVER(RankSetIsSingle(seg->rankSet));
+    for(rank = RankMIN; rank < RankLIMIT; ++rank)
+      if (RankSetIsMember(seg->rankSet, rank))
+        break;
+    AVER(rank != RankLIMIT); /* there should've been a match */
     TRACE_SET_ITER(ti, trace, diff, arena)
+      /* NOTE: We push the segment onto the front of the queue, so that
+         we preserve some locality of scanning, and so that we tend to
+         forward objects that are closely linked to the same or nearby
+         segments. */
+      RingInsert(TraceGreyRing(trace, rank), &gcseg->greyRing[ti]);
       ++trace->greySegCount;
-      if (trace->greySegCount > trace->greySegMax)
-        trace->greySegMax = trace->greySegCount;
+      STATISTIC({
+        if (trace->greySegCount > trace->greySegMax)
+          trace->greySegMax = trace->greySegCount;
+      });
     TRACE_SET_ITER_END(ti, trace, diff, arena);
+  }
 
-    diff = TraceSetDiff(oldGrey, grey);
-    TRACE_SET_ITER(ti, trace, diff, arena)
-      --trace->greySegCount;
-    TRACE_SET_ITER_END(ti, trace, diff, arena);
-  });
+  diff = TraceSetDiff(oldGrey, grey);
+  TRACE_SET_ITER(ti, trace, diff, arena)
+    RingRemove(&gcseg->greyRing[ti]);
+    AVER(trace->greySegCount > 0);
+    --trace->greySegCount;
+  TRACE_SET_ITER_END(ti, trace, diff, arena);
 }
 
 
@@ -1659,7 +1711,40 @@ static void gcSegSetWhite(Seg seg, TraceSet white)
   AVERT_CRITICAL(GCSeg, gcseg);
   AVER_CRITICAL(&gcseg->segStruct == seg);
 
+  gcSegSetWhiteInternal(seg, seg->white, white); /* do the work */
+}
+
+
+/* gcSegSetWhiteInternal -- change the whiteness of a segment
+ *
+ * Internal method for updating the whiteness of a GCSeg.  Updates
+ * the white rings, so that traceReclaim can find the segments it has
+ * to reclaim without walking the condemned generations.  Used by the
+ * split and merge methods as well as gcSegSetWhite.
+ */
+
+static void gcSegSetWhiteInternal(Seg seg, TraceSet oldWhite, TraceSet white)
+{
+  GCSeg gcseg;
+  Arena arena;
+  TraceId ti;
+  Trace trace;
+  TraceSet diff;
+
+  /* Internal method. Parameters are checked by caller */
+  gcseg = SegGCSeg(seg);
+  arena = PoolArena(SegPool(seg));
   seg->white = BS_BITFIELD(Trace, white);
+
+  diff = TraceSetDiff(white, oldWhite);
+  TRACE_SET_ITER(ti, trace, diff, arena)
+    RingAppend(TraceWhiteRing(trace), &gcseg->whiteRing[ti]);
+  TRACE_SET_ITER_END(ti, trace, diff, arena);
+
+  diff = TraceSetDiff(oldWhite, white);
+  TRACE_SET_ITER(ti, trace, diff, arena)
+    RingRemove(&gcseg->whiteRing[ti]);
+  TRACE_SET_ITER_END(ti, trace, diff, arena);
 }
 
 
@@ -1704,8 +1789,12 @@ static void mutatorSegSetRankSet(Seg seg, RankSet rankSet)
 
   if (oldRankSet == RankSetEMPTY) {
     if (rankSet != RankSetEMPTY) {
+      Arena arena = PoolArena(SegPool(seg));
       AVER_CRITICAL(SegGCSeg(seg)->summary == RefSetEMPTY);
-      ShieldRaise(PoolArena(SegPool(seg)), seg, AccessWRITE);
+      /* <design/write-barrier#.soft-dirty.protect>,
+         <design/write-barrier#.software.protect> */
+      if (!SegUnprotectedBarrier(seg))
+        ShieldRaise(arena, seg, AccessWRITE);
     }
   } else {
     if (rankSet == RankSetEMPTY) {
@@ -1723,13 +1812,18 @@ static void mutatorSegSetRankSet(Seg seg, RankSet rankSet)
  * the unprotectable data (that is, the mutator). We don't maintain
  * such a summary, assuming that the mutator can access all
  * references, so its summary is RefSetUNIV.
+ *
+ * If the arena uses soft-dirty page tracking, or the pool uses the
+ * software write barrier, then the barrier is never raised:
+ * <design/write-barrier#.soft-dirty.protect> and
+ * <design/write-barrier#.software.protect>.
  */
 
 static void mutatorSegSyncWriteBarrier(Seg seg)
 {
   Arena arena = PoolArena(SegPool(seg));
   /* Can't check seg -- this function enforces invariants tested by SegCheck. */
-  if (SegSummary(seg) == RefSetUNIV)
+  if (SegSummary(seg) == RefSetUNIV || SegUnprotectedBarrier(seg))
     ShieldLower(arena, seg, AccessWRITE);
   else
     ShieldRaise(arena, seg, AccessWRITE);
@@ -1747,6 +1841,9 @@ static void gcSegSetSummary(Seg seg, RefSet summary)
   AVERT_CRITICAL(GCSeg, gcseg);
   AVER_CRITICAL(&gcseg->segStruct == seg);
 
+  if (summary == gcseg->summary)
+    return;
+
   EVENT5(SegSetSummary, PoolArena(SegPool(seg)), seg, SegSize(seg),
          gcseg->summary, summary);
 
@@ -1763,8 +1860,10 @@ static void gcSegSetSummary(Seg seg, RefSet summary)
 
 static void mutatorSegSetSummary(Seg seg, RefSet summary)
 {
+  RefSet oldSummary = SegSummary(seg);
   NextMethod(Seg, MutatorSeg, setSummary)(seg, summary);
-  mutatorSegSyncWriteBarrier(seg);
+  if (summary != oldSummary)
+    mutatorSegSyncWriteBarrier(seg);
 }
 
 
@@ -1856,7 +1955,8 @@ static Res gcSegMerge(Seg seg, Seg segHi,
                       Addr base, Addr mid, Addr limit)
 {
   GCSeg gcseg, gcsegHi;
-  TraceSet grey;
+  TraceSet grey, white;
+  TraceId ti;
   RefSet summary;
   Buffer buf;
   Res res;
@@ -1878,6 +1978,8 @@ static Res gcSegMerge(Seg seg, Seg segHi,
   AVER(buf == NULL || gcseg->buffer == NULL); /* See .buffer */
   grey = SegGrey(segHi);      /* check greyness */
   AVER(SegGrey(seg) == grey);
+  white = SegWhite(segHi);    /* check whiteness */
+  AVER(SegWhite(seg) == white);
 
   /* Assume that the write barrier shield is being used to implement
      the remembered set only, and so we can merge the shield and
@@ -1901,9 +2003,13 @@ static Res gcSegMerge(Seg seg, Seg segHi,
 
   /* Update fields of gcseg. Finish gcsegHi. */
   gcSegSetGreyInternal(segHi, grey, TraceSetEMPTY);
+  gcSegSetWhiteInternal(segHi, white, TraceSetEMPTY);
   gcsegHi->summary = RefSetEMPTY;
   gcsegHi->sig = SigInvalid;
-  RingFinish(&gcsegHi->greyRing);
+  for (ti = 0; ti < TraceLIMIT; ++ti) {
+    RingFinish(&gcsegHi->greyRing[ti]);
+    RingFinish(&gcsegHi->whiteRing[ti]);
+  }
   RingRemove(&gcsegHi->genRing);
   RingFinish(&gcsegHi->genRing);
 
@@ -1932,7 +2038,8 @@ static Res gcSegSplit(Seg seg, Seg segHi,
 {
   GCSeg gcseg, gcsegHi;
   Buffer buf;
-  TraceSet grey;
+  TraceSet grey, white;
+  TraceId ti;
   Res res;
 
   AVERT(Seg, seg);
@@ -1945,6 +2052,7 @@ static Res gcSegSplit(Seg seg, Seg segHi,
   AVER(SegLimit(seg) == limit);
 
   grey = SegGrey(seg);
+  white = SegWhite(seg);
   buf = gcseg->buffer; /* Look for buffer to reassign to segHi */
   if (buf != NULL) {
     if (BufferLimit(buf) > mid) {
@@ -1964,11 +2072,15 @@ static Res gcSegSplit(Seg seg, Seg segHi,
   gcsegHi = SegGCSeg(segHi);
   gcsegHi->summary = gcseg->summary;
   gcsegHi->buffer = NULL;
-  RingInit(&gcsegHi->greyRing);
+  for (ti = 0; ti < TraceLIMIT; ++ti) {
+    RingInit(&gcsegHi->greyRing[ti]);
+    RingInit(&gcsegHi->whiteRing[ti]);
+  }
   RingInit(&gcsegHi->genRing);
   RingInsert(&gcseg->genRing, &gcsegHi->genRing);
   gcsegHi->sig = GCSegSig;
   gcSegSetGreyInternal(segHi, TraceSetEMPTY, grey);
+  gcSegSetWhiteInternal(segHi, TraceSetEMPTY, white);
 
   /* Reassign buffer if it's now connected to segHi  */
   if (NULL != buf) {
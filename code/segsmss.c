@@ -432,7 +432,7 @@ static void AMSUnallocateRange(AMS ams, Seg seg, Addr base, Addr limit)
   AVER(amsseg->bufferedGrains >= unallocatedGrains);
   amsseg->freeGrains += unallocatedGrains;
   amsseg->bufferedGrains -= unallocatedGrains;
-  PoolGenAccountForEmpty(ams->pgen, 0,
+  PoolGenAccountForEmpty(ams->pgen, seg, 0,
                          PoolGrainsSize(AMSPool(ams), unallocatedGrains),
                          FALSE);
 }
@@ -78,6 +78,14 @@ void testthr_create(testthr_t *thread_o, testthr_routine_t start, void *arg);
 
 void testthr_join(testthr_t *thread, void **result_o);
 
+
+/* testthr_yield -- give up the processor
+ *
+ * Let other threads run before the calling thread continues.
+ */
+
+void testthr_yield(void);
+
 #endif /* testthr_h */
 
 
@@ -7,6 +7,7 @@
 #include "testlib.h"
 #include "testthr.h"
 
+#include <sched.h> /* sched_yield */
 #include <string.h> /* strerror */
 
 void testthr_create(testthr_t *thread_o, testthr_routine_t start, void *arg)
@@ -23,6 +24,11 @@ void testthr_join(testthr_t *thread, void **result_o)
     error("pthread_join failed with result %d (%s)", res, strerror(res));
 }
 
+void testthr_yield(void)
+{
+  (void)sched_yield();
+}
+
 
 /* C. COPYRIGHT AND LICENSE
  *
@@ -37,6 +37,11 @@ void testthr_join(testthr_t *thread, void **result_o)
     *result_o = thread->result;
 }
 
+void testthr_yield(void)
+{
+  (void)SwitchToThread();
+}
+
 
 /* C. COPYRIGHT AND LICENSE
  *
@@ -67,6 +67,15 @@ extern Thread ThreadRingThread(Ring threadRing);
 
 
 extern Arena ThreadArena(Thread thread);
+extern Ring ThreadBufferRing(Thread thread);
+
+
+/*  ThreadIsCurrent
+ *
+ *  Return TRUE if the thread is the one that is calling this function.
+ */
+
+extern Bool ThreadIsCurrent(Thread thread);
 
 extern Res ThreadScan(ScanState ss, Thread thread, void *stackCold,
                       mps_area_scan_t scan_area,
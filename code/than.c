@@ -18,6 +18,7 @@ typedef struct mps_thr_s {      /* ANSI fake thread structure */
   Serial serial;                /* from arena->threadSerial */
   Arena arena;                  /* owning arena */
   RingStruct arenaRing;         /* attaches to arena */
+  RingStruct bufferRing;        /* <design/buffer#.thread> */
 } ThreadStruct;
 
 
@@ -27,6 +28,7 @@ Bool ThreadCheck(Thread thread)
   CHECKU(Arena, thread->arena);
   CHECKL(thread->serial < thread->arena->threadSerial);
   CHECKD_NOSIG(Ring, &thread->arenaRing);
+  CHECKD_NOSIG(Ring, &thread->bufferRing);
   return TRUE;
 }
 
@@ -54,6 +56,7 @@ Res ThreadRegister(Thread *threadReturn, Arena arena)
 
   thread->arena = arena;
   RingInit(&thread->arenaRing);
+  RingInit(&thread->bufferRing);
 
   thread->sig = ThreadSig;
   thread->serial = arena->threadSerial;
@@ -80,6 +83,7 @@ void ThreadDeregister(Thread thread, Arena arena)
   thread->sig = SigInvalid;
 
   RingFinish(&thread->arenaRing);
+  RingFinish(&thread->bufferRing);
 
   ControlFree(arena, thread, sizeof(ThreadStruct));
 }
@@ -116,6 +120,27 @@ Arena ThreadArena(Thread thread)
 }
 
 
+/* ThreadBufferRing -- ring of the thread's per-thread buffers */
+
+Ring ThreadBufferRing(Thread thread)
+{
+  AVERT(Thread, thread);
+  return &thread->bufferRing;
+}
+
+
+/* ThreadIsCurrent -- is this the calling thread?
+ *
+ * There is only one thread on the ANSI platform.
+ */
+
+Bool ThreadIsCurrent(Thread thread)
+{
+  AVERT(Thread, thread);
+  return TRUE;
+}
+
+
 Res ThreadScan(ScanState ss, Thread thread, void *stackCold,
                mps_area_scan_t scan_area,
                void *closure)
@@ -53,6 +53,7 @@ typedef struct mps_thr_s {       /* PThreads thread structure */
   Serial serial;                 /* from arena->threadSerial */
   Arena arena;                   /* owning arena */
   RingStruct arenaRing;          /* threads attached to arena */
+  RingStruct bufferRing;         /* <design/buffer#.thread> */
   Bool alive;                    /* thread believed to be alive? */
   PThreadextStruct thrextStruct; /* PThreads extension */
   pthread_t id;                  /* Pthread object of thread */
@@ -68,6 +69,7 @@ Bool ThreadCheck(Thread thread)
   CHECKU(Arena, thread->arena);
   CHECKL(thread->serial < thread->arena->threadSerial);
   CHECKD_NOSIG(Ring, &thread->arenaRing);
+  CHECKD_NOSIG(Ring, &thread->bufferRing);
   CHECKL(BoolCheck(thread->alive));
   CHECKD(PThreadext, &thread->thrextStruct);
   return TRUE;
@@ -99,6 +101,7 @@ Res ThreadRegister(Thread *threadReturn, Arena arena)
   thread->id = pthread_self();
 
   RingInit(&thread->arenaRing);
+  RingInit(&thread->bufferRing);
 
   thread->sig = ThreadSig;
   thread->serial = arena->threadSerial;
@@ -130,6 +133,7 @@ void ThreadDeregister(Thread thread, Arena arena)
   thread->sig = SigInvalid;
 
   RingFinish(&thread->arenaRing);
+  RingFinish(&thread->bufferRing);
 
   PThreadextFinish(&thread->thrextStruct);
 
@@ -247,6 +251,24 @@ Arena ThreadArena(Thread thread)
 }
 
 
+/* ThreadBufferRing -- ring of the thread's per-thread buffers */
+
+Ring ThreadBufferRing(Thread thread)
+{
+  AVERT(Thread, thread);
+  return &thread->bufferRing;
+}
+
+
+/* ThreadIsCurrent -- is this the calling thread? */
+
+Bool ThreadIsCurrent(Thread thread)
+{
+  AVERT(Thread, thread);
+  return pthread_equal(pthread_self(), thread->id); /* .thread.id */
+}
+
+
 /* ThreadScan -- scan the state of a thread (stack and regs) */
 
 Res ThreadScan(ScanState ss, Thread thread, void *stackCold,
@@ -69,6 +69,7 @@ typedef struct mps_thr_s {      /* Win32 thread structure */
   Serial serial;                /* from arena->threadSerial */
   Arena arena;                  /* owning arena */
   RingStruct arenaRing;         /* threads attached to arena */
+  RingStruct bufferRing;        /* <design/buffer#.thread> */
   Bool alive;                   /* thread believed to be alive? */
   HANDLE handle;                /* Handle of thread, see
                                  * <code/thw3.c#thread.handle> */
@@ -82,6 +83,7 @@ Bool ThreadCheck(Thread thread)
   CHECKU(Arena, thread->arena);
   CHECKL(thread->serial < thread->arena->threadSerial);
   CHECKD_NOSIG(Ring, &thread->arenaRing);
+  CHECKD_NOSIG(Ring, &thread->bufferRing);
   return TRUE;
 }
 
@@ -124,6 +126,7 @@ Res ThreadRegister(Thread *threadReturn, Arena arena)
   thread->id = GetCurrentThreadId();
 
   RingInit(&thread->arenaRing);
+  RingInit(&thread->bufferRing);
 
   thread->sig = ThreadSig;
   thread->serial = arena->threadSerial;
@@ -151,6 +154,7 @@ void ThreadDeregister(Thread thread, Arena arena)
   thread->sig = SigInvalid;
 
   RingFinish(&thread->arenaRing);
+  RingFinish(&thread->bufferRing);
 
   b = CloseHandle(thread->handle);
   AVER(b); /* .error.close-handle */
@@ -239,6 +243,25 @@ Arena ThreadArena(Thread thread)
   return thread->arena;
 }
 
+
+/* ThreadBufferRing -- ring of the thread's per-thread buffers */
+
+Ring ThreadBufferRing(Thread thread)
+{
+  AVERT(Thread, thread);
+  return &thread->bufferRing;
+}
+
+
+/* ThreadIsCurrent -- is this the calling thread? */
+
+Bool ThreadIsCurrent(Thread thread)
+{
+  AVERT(Thread, thread);
+  return thread->id == GetCurrentThreadId();
+}
+
+
 Res ThreadDescribe(Thread thread, mps_lib_FILE *stream, Count depth)
 {
   Res res;
@@ -42,6 +42,7 @@ typedef struct mps_thr_s {      /* macOS thread structure */
   Serial serial;                /* from arena->threadSerial */
   Arena arena;                  /* owning arena */
   RingStruct arenaRing;         /* attaches to arena */
+  RingStruct bufferRing;        /* <design/buffer#.thread> */
   Bool alive;                   /* thread believed to be alive? */
   Bool forking;                 /* thread currently calling fork? */
   thread_port_t port;           /* thread kernel port */
@@ -54,6 +55,7 @@ Bool ThreadCheck(Thread thread)
   CHECKU(Arena, thread->arena);
   CHECKL(thread->serial < thread->arena->threadSerial);
   CHECKD_NOSIG(Ring, &thread->arenaRing);
+  CHECKD_NOSIG(Ring, &thread->bufferRing);
   CHECKL(BoolCheck(thread->alive));
   CHECKL(BoolCheck(thread->forking));
   CHECKL(MACH_PORT_VALID(thread->port));
@@ -84,6 +86,7 @@ Res ThreadRegister(Thread *threadReturn, Arena arena)
 
   thread->arena = arena;
   RingInit(&thread->arenaRing);
+  RingInit(&thread->bufferRing);
 
   thread->serial = arena->threadSerial;
   ++arena->threadSerial;
@@ -116,6 +119,7 @@ void ThreadDeregister(Thread thread, Arena arena)
   thread->sig = SigInvalid;
 
   RingFinish(&thread->arenaRing);
+  RingFinish(&thread->bufferRing);
 
   ControlFree(arena, thread, sizeof(ThreadStruct));
 }
@@ -223,6 +227,26 @@ Arena ThreadArena(Thread thread)
 }
 
 
+/* ThreadBufferRing -- ring of the thread's per-thread buffers */
+
+Ring ThreadBufferRing(Thread thread)
+{
+  AVERT(Thread, thread);
+  return &thread->bufferRing;
+}
+
+
+/* ThreadIsCurrent -- is this the calling thread? */
+
+Bool ThreadIsCurrent(Thread thread)
+{
+  mach_port_t self = mach_thread_self();
+  AVERT(Thread, thread);
+  AVER(MACH_PORT_VALID(self));
+  return thread->port == self;
+}
+
+
 /* ThreadScan -- scan the state of a thread (stack and regs) */
 
 #include "prmcxc.h"
@@ -0,0 +1,842 @@
+/* tlsf.c: TWO-LEVEL SEGREGATED FIT LAND
+ *
+ * $Id$
+ * Copyright (c) 2020 Ravenbrook Limited.  See end of file for license.
+ *
+ * .intro: This is a Land implementation that finds free blocks in
+ * constant time, using segregated lists indexed by a two-level bitmap,
+ * after the "Two-Level Segregated Fit" allocator of Masmano et al.
+ *
+ * .design: <design/tlsf>.
+ *
+ * .tree: The blocks are also kept in a splay tree in address order,
+ * as in the CBS <code/cbs.c>, so that inserted ranges can be coalesced
+ * with their neighbours and deleted ranges found.  The tree has no
+ * per-node summaries, so changing a block's size or moving its ends
+ * (without reordering it) needs no tree operations.
+ */
+
+#include "tlsf.h"
+#include "poolmfs.h"
+#include "mpscmfs.h"
+
+SRCID(tlsf, "$Id$");
+
+
+#define tlsfSplay(tlsf) (&((tlsf)->splayTreeStruct))
+#define tlsfBlockOfTree(tree) \
+  PARENT(TLSFBlockStruct, rangeTreeStruct, RangeTreeOfTree(tree))
+#define tlsfBlockOfRing(ring) RING_ELT(TLSFBlock, listRing, ring)
+#define tlsfBlockNode(block) (&(block)->rangeTreeStruct)
+#define tlsfBlockBase(block) RangeTreeBase(tlsfBlockNode(block))
+#define tlsfBlockLimit(block) RangeTreeLimit(tlsfBlockNode(block))
+#define tlsfBlockSize(block) RangeTreeSize(tlsfBlockNode(block))
+#define tlsfUnits(tlsf, size) ((Word)(size) >> (tlsf)->alignShift)
+
+
+/* TLSFCheck -- check a TLSF */
+
+Bool TLSFCheck(TLSF tlsf)
+{
+  Land land;
+  CHECKS(TLSF, tlsf);
+  land = TLSFLand(tlsf);
+  CHECKD(Land, land);
+  CHECKC(TLSF, tlsf);
+  CHECKD(SplayTree, tlsfSplay(tlsf));
+  CHECKD(Pool, tlsf->blockPool);
+  CHECKL(SizeIsAligned(tlsf->size, LandAlignment(land)));
+  CHECKL(tlsf->alignShift == SizeLog2(LandAlignment(land)));
+  CHECKL((tlsf->size == 0) == (tlsf->blockCount == 0));
+  CHECKL((tlsf->firstMap == 0) == (tlsf->blockCount == 0));
+  return TRUE;
+}
+
+
+/* tlsfIndex -- segregated list index of blocks of a given size
+ *
+ * <design/tlsf#.impl.index>.  Sizes below TLSFSecondCOUNT alignment
+ * units map to first-level index zero, one list per size.  Larger
+ * sizes use their most significant bit for the first-level index,
+ * and the next TLSFSecondSHIFT bits for the second-level index.
+ */
+
+static Index tlsfIndex(Word units)
+{
+  Shift msb;
+
+  AVER_CRITICAL(units > 0);
+  if (units < TLSFSecondCOUNT)
+    return units;
+  msb = SizeFloorLog2(units);
+  return (msb - TLSFSecondSHIFT + 1) * TLSFSecondCOUNT
+    + ((units >> (msb - TLSFSecondSHIFT)) - TLSFSecondCOUNT);
+}
+
+
+/* tlsfListInsert, tlsfListRemove -- maintain the segregated lists
+ *
+ * Newly inserted blocks go at the front of their list, so that
+ * recently freed memory is reused first.
+ */
+
+static void tlsfListInsert(TLSF tlsf, TLSFBlock block)
+{
+  Index index, first, second;
+
+  index = tlsfIndex(tlsfUnits(tlsf, tlsfBlockSize(block)));
+  AVER_CRITICAL(index < TLSFListCOUNT);
+  first = index / TLSFSecondCOUNT;
+  second = index % TLSFSecondCOUNT;
+  block->index = index;
+  RingInsert(&tlsf->list[index], &block->listRing);
+  tlsf->secondMap[first] |= (Word)1 << second;
+  tlsf->firstMap |= (Word)1 << first;
+}
+
+static void tlsfListRemove(TLSF tlsf, TLSFBlock block)
+{
+  Index index = block->index, first, second;
+
+  AVER_CRITICAL(index < TLSFListCOUNT);
+  RingRemove(&block->listRing);
+  if (RingIsSingle(&tlsf->list[index])) {
+    first = index / TLSFSecondCOUNT;
+    second = index % TLSFSecondCOUNT;
+    tlsf->secondMap[first] &= ~((Word)1 << second);
+    if (tlsf->secondMap[first] == 0)
+      tlsf->firstMap &= ~((Word)1 << first);
+  }
+}
+
+
+/* tlsfBlockResized -- block has changed size: move it between lists
+ * if necessary, and update the total size
+ */
+
+static void tlsfBlockResized(TLSF tlsf, TLSFBlock block, Size oldSize)
+{
+  Size newSize = tlsfBlockSize(block);
+
+  AVER_CRITICAL(newSize > 0);
+  AVER_CRITICAL(tlsf->size + newSize >= oldSize);
+  tlsf->size = tlsf->size + newSize - oldSize;
+  if (tlsfIndex(tlsfUnits(tlsf, newSize)) != block->index) {
+    tlsfListRemove(tlsf, block);
+    tlsfListInsert(tlsf, block);
+  }
+}
+
+
+/* tlsfBlockAlloc -- allocate a new block and set its base and limit,
+ * but do not insert it into the TLSF yet
+ */
+
+static Res tlsfBlockAlloc(TLSFBlock *blockReturn, TLSF tlsf, Range range)
+{
+  TLSFBlock block;
+  Res res;
+  Addr p;
+
+  AVER_CRITICAL(blockReturn != NULL);
+  AVERT_CRITICAL(Range, range);
+
+  res = PoolAlloc(&p, tlsf->blockPool, sizeof(TLSFBlockStruct));
+  if (res != ResOK)
+    return res;
+  block = (TLSFBlock)p;
+  RangeTreeInit(tlsfBlockNode(block), range);
+  SplayNodeInit(tlsfSplay(tlsf), RangeTreeTree(tlsfBlockNode(block)));
+  RingInit(&block->listRing);
+
+  *blockReturn = block;
+  return ResOK;
+}
+
+
+/* tlsfBlockInsert -- insert a block into the tree and lists */
+
+static void tlsfBlockInsert(TLSF tlsf, TLSFBlock block)
+{
+  Bool b;
+
+  b = SplayTreeInsert(tlsfSplay(tlsf), RangeTreeTree(tlsfBlockNode(block)));
+  AVER_CRITICAL(b);
+  tlsfListInsert(tlsf, block);
+  ++tlsf->blockCount;
+  tlsf->size += tlsfBlockSize(block);
+}
+
+
+/* tlsfBlockDestroy -- remove a block from the lists and free it
+ *
+ * The caller is responsible for removing the block from the tree.
+ */
+
+static void tlsfBlockDestroy(TLSF tlsf, TLSFBlock block)
+{
+  Size size = tlsfBlockSize(block);
+
+  tlsfListRemove(tlsf, block);
+  RingFinish(&block->listRing);
+  AVER_CRITICAL(tlsf->blockCount > 0);
+  --tlsf->blockCount;
+  AVER_CRITICAL(tlsf->size >= size);
+  tlsf->size -= size;
+  RangeTreeFinish(tlsfBlockNode(block));
+  PoolFree(tlsf->blockPool, (Addr)block, sizeof(TLSFBlockStruct));
+}
+
+static void tlsfBlockDelete(TLSF tlsf, TLSFBlock block)
+{
+  Bool b;
+
+  b = SplayTreeDelete(tlsfSplay(tlsf), RangeTreeTree(tlsfBlockNode(block)));
+  AVER_CRITICAL(b);
+  tlsfBlockDestroy(tlsf, block);
+}
+
+
+/* tlsfInit -- initialise a TLSF
+ *
+ * <design/land#.function.init>.
+ */
+
+static Res tlsfInit(Land land, Arena arena, Align alignment, ArgList args)
+{
+  TLSF tlsf;
+  Res res;
+  Index i;
+
+  AVER(land != NULL);
+  res = NextMethod(Land, TLSF, init)(land, arena, alignment, args);
+  if (res != ResOK)
+    return res;
+  tlsf = CouldBeA(TLSF, land);
+
+  MPS_ARGS_BEGIN(pcArgs) {
+    MPS_ARGS_ADD(pcArgs, MPS_KEY_MFS_UNIT_SIZE, sizeof(TLSFBlockStruct));
+    res = PoolCreate(&tlsf->blockPool, arena, PoolClassMFS(), pcArgs);
+  } MPS_ARGS_END(pcArgs);
+  if (res != ResOK)
+    goto failPoolCreate;
+
+  SplayTreeInit(tlsfSplay(tlsf), RangeTreeCompare, RangeTreeKey,
+                SplayTrivUpdate);
+  tlsf->alignShift = SizeLog2(alignment);
+  tlsf->size = 0;
+  tlsf->blockCount = 0;
+  tlsf->firstMap = 0;
+  for (i = 0; i < TLSFFirstCOUNT; ++i)
+    tlsf->secondMap[i] = 0;
+  for (i = 0; i < TLSFListCOUNT; ++i)
+    RingInit(&tlsf->list[i]);
+
+  SetClassOfPoly(land, CLASS(TLSF));
+  tlsf->sig = TLSFSig;
+  AVERC(TLSF, tlsf);
+  return ResOK;
+
+failPoolCreate:
+  NextMethod(Inst, TLSF, finish)(MustBeA(Inst, land));
+  return res;
+}
+
+
+/* tlsfFinish -- finish a TLSF
+ *
+ * <design/land#.function.finish>.  Any remaining blocks are discarded
+ * along with the block pool.
+ */
+
+static void tlsfFinish(Inst inst)
+{
+  Land land = MustBeA(Land, inst);
+  TLSF tlsf = MustBeA(TLSF, land);
+  Index i;
+
+  tlsf->sig = SigInvalid;
+  for (i = 0; i < TLSFListCOUNT; ++i) {
+    Ring node, next;
+    RING_FOR(node, &tlsf->list[i], next)
+      RingRemove(node);
+    RingFinish(&tlsf->list[i]);
+  }
+  SplayTreeFinish(tlsfSplay(tlsf));
+  PoolDestroy(tlsf->blockPool);
+
+  NextMethod(Inst, TLSF, finish)(inst);
+}
+
+
+/* tlsfSize -- total size of ranges in TLSF
+ *
+ * <design/land#.function.size>.
+ */
+
+static Size tlsfSize(Land land)
+{
+  TLSF tlsf = MustBeA_CRITICAL(TLSF, land);
+  return tlsf->size;
+}
+
+
+/* tlsfInsert -- insert a range into the TLSF, coalescing it with its
+ * neighbours
+ *
+ * <design/land#.function.insert>.  This follows cbsInsert, see
+ * <code/cbs.c>.
+ */
+
+static Res tlsfInsert(Range rangeReturn, Land land, Range range)
+{
+  TLSF tlsf = MustBeA_CRITICAL(TLSF, land);
+  Tree leftSplay, rightSplay;
+  TLSFBlock leftBlock = NULL, rightBlock = NULL;
+  Addr base, limit, newBase, newLimit;
+  Size oldSize;
+  Res res;
+
+  AVER_CRITICAL(rangeReturn != NULL);
+  AVERT_CRITICAL(Range, range);
+  AVER_CRITICAL(!RangeIsEmpty(range));
+  AVER_CRITICAL(RangeIsAligned(range, LandAlignment(land)));
+
+  base = RangeBase(range);
+  limit = RangeLimit(range);
+
+  if (!SplayTreeNeighbours(&leftSplay, &rightSplay, tlsfSplay(tlsf),
+                           RangeTreeKeyOfBaseVar(base)))
+    return ResFAIL;
+
+  if (leftSplay != TreeEMPTY) {
+    leftBlock = tlsfBlockOfTree(leftSplay);
+    AVER_CRITICAL(tlsfBlockLimit(leftBlock) <= base);
+    if (tlsfBlockLimit(leftBlock) != base)
+      leftBlock = NULL;
+  }
+  if (rightSplay != TreeEMPTY) {
+    rightBlock = tlsfBlockOfTree(rightSplay);
+    if (limit > tlsfBlockBase(rightBlock))
+      return ResFAIL;   /* <code/cbs.c#insert.overlap> */
+    if (tlsfBlockBase(rightBlock) != limit)
+      rightBlock = NULL;
+  }
+
+  newBase = leftBlock != NULL ? tlsfBlockBase(leftBlock) : base;
+  newLimit = rightBlock != NULL ? tlsfBlockLimit(rightBlock) : limit;
+
+  if (leftBlock != NULL) {
+    oldSize = tlsfBlockSize(leftBlock);
+    if (rightBlock != NULL)
+      tlsfBlockDelete(tlsf, rightBlock);
+    RangeTreeSetLimit(tlsfBlockNode(leftBlock), newLimit);
+    tlsfBlockResized(tlsf, leftBlock, oldSize);
+  } else if (rightBlock != NULL) {
+    oldSize = tlsfBlockSize(rightBlock);
+    RangeTreeSetBase(tlsfBlockNode(rightBlock), base);
+    tlsfBlockResized(tlsf, rightBlock, oldSize);
+  } else {
+    TLSFBlock block;
+    res = tlsfBlockAlloc(&block, tlsf, range);
+    if (res != ResOK)
+      return res;
+    tlsfBlockInsert(tlsf, block);
+  }
+
+  RangeInit(rangeReturn, newBase, newLimit);
+  return ResOK;
+}
+
+
+/* tlsfDeleteFromBlock -- delete a range from a block that contains it
+ *
+ * .delete.alloc: Only allocates a block if the range splits the
+ * block.
+ */
+
+static Res tlsfDeleteFromBlock(TLSF tlsf, TLSFBlock block, Range range)
+{
+  Addr base = RangeBase(range), limit = RangeLimit(range);
+  Addr oldBase = tlsfBlockBase(block), oldLimit = tlsfBlockLimit(block);
+  Size oldSize = tlsfBlockSize(block);
+
+  AVER_CRITICAL(oldBase <= base);
+  AVER_CRITICAL(limit <= oldLimit);
+
+  if (base == oldBase && limit == oldLimit) {
+    tlsfBlockDelete(tlsf, block);
+  } else if (base == oldBase) {
+    RangeTreeSetBase(tlsfBlockNode(block), limit);
+    tlsfBlockResized(tlsf, block, oldSize);
+  } else if (limit == oldLimit) {
+    RangeTreeSetLimit(tlsfBlockNode(block), base);
+    tlsfBlockResized(tlsf, block, oldSize);
+  } else {
+    /* Shrink the block to the left fragment, and create a new block
+       for the right fragment. */
+    RangeStruct newRange;
+    TLSFBlock newBlock;
+    Res res;
+    RangeInit(&newRange, limit, oldLimit);
+    res = tlsfBlockAlloc(&newBlock, tlsf, &newRange);
+    if (res != ResOK)
+      return res;
+    RangeTreeSetLimit(tlsfBlockNode(block), base);
+    tlsfBlockResized(tlsf, block, oldSize);
+    tlsfBlockInsert(tlsf, newBlock);
+  }
+  return ResOK;
+}
+
+
+/* tlsfDelete -- remove a range from the TLSF
+ *
+ * <design/land#.function.delete>.
+ */
+
+static Res tlsfDelete(Range rangeReturn, Land land, Range range)
+{
+  TLSF tlsf = MustBeA(TLSF, land);
+  TLSFBlock block;
+  Tree tree;
+  RangeStruct oldRange;
+  Res res;
+
+  AVER(rangeReturn != NULL);
+  AVERT(Range, range);
+  AVER(!RangeIsEmpty(range));
+  AVER(RangeIsAligned(range, LandAlignment(land)));
+
+  if (!SplayTreeFind(&tree, tlsfSplay(tlsf),
+                     RangeTreeKeyOfBaseVar(RangeBase(range))))
+    return ResFAIL;
+  block = tlsfBlockOfTree(tree);
+  if (RangeLimit(range) > tlsfBlockLimit(block))
+    return ResFAIL;
+
+  RangeInit(&oldRange, tlsfBlockBase(block), tlsfBlockLimit(block));
+  res = tlsfDeleteFromBlock(tlsf, block, range);
+  if (res != ResOK)
+    return res;
+  RangeCopy(rangeReturn, &oldRange);
+  return ResOK;
+}
+
+
+/* tlsfIterate -- iterate over all blocks in address order
+ *
+ * <design/land#.function.iterate>.
+ */
+
+typedef struct TLSFIterateClosure {
+  Land land;
+  LandVisitor visitor;
+  void *visitorClosure;
+} TLSFIterateClosure;
+
+static Bool tlsfIterateVisit(Tree tree, void *closure)
+{
+  TLSFIterateClosure *my = closure;
+  TLSFBlock block = tlsfBlockOfTree(tree);
+  RangeStruct range;
+  RangeInit(&range, tlsfBlockBase(block), tlsfBlockLimit(block));
+  return my->visitor(my->land, &range, my->visitorClosure);
+}
+
+static Bool tlsfIterate(Land land, LandVisitor visitor, void *visitorClosure)
+{
+  TLSF tlsf = MustBeA(TLSF, land);
+  SplayTree splay = tlsfSplay(tlsf);
+  TLSFIterateClosure closure;
+
+  AVER(FUNCHECK(visitor));
+
+  closure.land = land;
+  closure.visitor = visitor;
+  closure.visitorClosure = visitorClosure;
+  return TreeTraverse(SplayTreeRoot(splay), splay->compare, splay->nodeKey,
+                      tlsfIterateVisit, &closure);
+}
+
+
+/* tlsfIterateAndDelete -- iterate over all blocks, deleting some
+ *
+ * <design/land#.function.iterate.and.delete>.
+ */
+
+typedef struct TLSFIterateAndDeleteClosure {
+  Land land;
+  LandDeleteVisitor visitor;
+  Bool cont;
+  void *visitorClosure;
+} TLSFIterateAndDeleteClosure;
+
+static Bool tlsfIterateAndDeleteVisit(Tree tree, void *closure)
+{
+  TLSFIterateAndDeleteClosure *my = closure;
+  TLSF tlsf = MustBeA(TLSF, my->land);
+  TLSFBlock block = tlsfBlockOfTree(tree);
+  Bool deleteNode = FALSE;
+  RangeStruct range;
+
+  RangeInit(&range, tlsfBlockBase(block), tlsfBlockLimit(block));
+  if (my->cont)
+    my->cont = my->visitor(&deleteNode, my->land, &range,
+                           my->visitorClosure);
+  if (deleteNode)
+    tlsfBlockDestroy(tlsf, block);
+  return deleteNode;
+}
+
+static Bool tlsfIterateAndDelete(Land land, LandDeleteVisitor visitor,
+                                 void *visitorClosure)
+{
+  TLSF tlsf = MustBeA(TLSF, land);
+  TLSFIterateAndDeleteClosure closure;
+
+  AVER(FUNCHECK(visitor));
+
+  closure.land = land;
+  closure.visitor = visitor;
+  closure.visitorClosure = visitorClosure;
+  closure.cont = TRUE;
+  TreeTraverseAndDelete(&tlsfSplay(tlsf)->root, tlsfIterateAndDeleteVisit,
+                        &closure);
+  return closure.cont;
+}
+
+
+/* tlsfFindBlock -- find a block of at least the given size
+ *
+ * <design/tlsf#.impl.find>.  Rounding the size up to the next list
+ * boundary means that any block on the first non-empty list at or
+ * above that boundary is big enough, and the bitmaps find that list
+ * in constant time.  If there is no such list, the list for the size
+ * itself may still hold a block that is big enough, so search it.
+ */
+
+static Bool tlsfFindBlock(TLSFBlock *blockReturn, TLSF tlsf, Size size)
+{
+  Word units = tlsfUnits(tlsf, size), rounded = units;
+  Index index, first, second;
+  Word map;
+  Ring node, next;
+
+  AVER_CRITICAL(units > 0);
+
+  if (units >= TLSFSecondCOUNT)
+    rounded += ((Word)1 << (SizeFloorLog2(units) - TLSFSecondSHIFT)) - 1;
+  if (rounded >= units) {
+    index = tlsfIndex(rounded);
+    first = index / TLSFSecondCOUNT;
+    second = index % TLSFSecondCOUNT;
+    map = tlsf->secondMap[first] & ((Word)-1 << second);
+    if (map == 0 && first + 1 < TLSFFirstCOUNT) {
+      map = tlsf->firstMap & ((Word)-1 << (first + 1));
+      if (map != 0) {
+        first = WordLowestSet(map);
+        map = tlsf->secondMap[first];
+        AVER_CRITICAL(map != 0);
+      }
+    }
+    if (map != 0) {
+      index = first * TLSFSecondCOUNT + WordLowestSet(map);
+      AVER_CRITICAL(!RingIsSingle(&tlsf->list[index]));
+      *blockReturn = tlsfBlockOfRing(RingNext(&tlsf->list[index]));
+      AVER_CRITICAL(tlsfBlockSize(*blockReturn) >= size);
+      return TRUE;
+    }
+  }
+
+  index = tlsfIndex(units);
+  RING_FOR(node, &tlsf->list[index], next) {
+    TLSFBlock block = tlsfBlockOfRing(node);
+    if (tlsfBlockSize(block) >= size) {
+      *blockReturn = block;
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+
+/* tlsfFindDeleteRange -- delete the appropriate range of a block found */
+
+static void tlsfFindDeleteRange(Range rangeReturn, Range oldRangeReturn,
+                                TLSF tlsf, TLSFBlock block, Size size,
+                                FindDelete findDelete)
+{
+  Addr base = tlsfBlockBase(block), limit = tlsfBlockLimit(block);
+  Res res;
+
+  AVER_CRITICAL(tlsfBlockSize(block) >= size);
+  RangeInit(oldRangeReturn, base, limit);
+
+  switch (findDelete) {
+  case FindDeleteNONE:
+    RangeInit(rangeReturn, base, limit);
+    return;
+  case FindDeleteLOW:
+    limit = AddrAdd(base, size);
+    break;
+  case FindDeleteHIGH:
+    base = AddrSub(limit, size);
+    break;
+  case FindDeleteENTIRE:
+    break;
+  default:
+    NOTREACHED;
+    break;
+  }
+
+  RangeInit(rangeReturn, base, limit);
+  res = tlsfDeleteFromBlock(tlsf, block, rangeReturn);
+  /* Deleting from one end of a block never allocates. */
+  AVER_CRITICAL(res == ResOK);
+}
+
+
+/* tlsfFind -- find a block of at least the given size
+ *
+ * <design/tlsf#.impl.good-fit>.  This is the method for both findFirst
+ * and findLast.  It returns a good fit rather than the first or last
+ * fit in address order.
+ */
+
+static Bool tlsfFind(Range rangeReturn, Range oldRangeReturn,
+                     Land land, Size size, FindDelete findDelete)
+{
+  TLSF tlsf = MustBeA_CRITICAL(TLSF, land);
+  TLSFBlock block;
+
+  AVER_CRITICAL(rangeReturn != NULL);
+  AVER_CRITICAL(oldRangeReturn != NULL);
+  AVER_CRITICAL(size > 0);
+  AVER_CRITICAL(SizeIsAligned(size, LandAlignment(land)));
+  AVERT_CRITICAL(FindDelete, findDelete);
+
+  if (!tlsfFindBlock(&block, tlsf, size))
+    return FALSE;
+  tlsfFindDeleteRange(rangeReturn, oldRangeReturn, tlsf, block,
+                      size, findDelete);
+  return TRUE;
+}
+
+
+/* tlsfFindLargest -- find the largest block
+ *
+ * The largest block is on the highest non-empty list, which the
+ * bitmaps find in constant time, but that list must be searched.
+ */
+
+static Bool tlsfFindLargest(Range rangeReturn, Range oldRangeReturn,
+                            Land land, Size size, FindDelete findDelete)
+{
+  TLSF tlsf = MustBeA_CRITICAL(TLSF, land);
+  TLSFBlock largest = NULL;
+  Index first, index;
+  Ring node, next;
+
+  AVER_CRITICAL(rangeReturn != NULL);
+  AVER_CRITICAL(oldRangeReturn != NULL);
+  AVER_CRITICAL(size > 0);
+  AVERT_CRITICAL(FindDelete, findDelete);
+
+  if (tlsf->firstMap == 0)
+    return FALSE;
+  first = SizeFloorLog2(tlsf->firstMap);
+  index = first * TLSFSecondCOUNT + SizeFloorLog2(tlsf->secondMap[first]);
+  RING_FOR(node, &tlsf->list[index], next) {
+    TLSFBlock block = tlsfBlockOfRing(node);
+    if (largest == NULL || tlsfBlockSize(block) > tlsfBlockSize(largest))
+      largest = block;
+  }
+  AVER_CRITICAL(largest != NULL);
+  if (tlsfBlockSize(largest) < size)
+    return FALSE;
+  tlsfFindDeleteRange(rangeReturn, oldRangeReturn, tlsf, largest,
+                      size, findDelete);
+  return TRUE;
+}
+
+
+/* tlsfFindInZones -- find a block within a zone set
+ *
+ * <design/tlsf#.impl.zones>.  The segregated lists know nothing of
+ * zones, so this searches the blocks in address order.
+ */
+
+typedef struct TLSFZonesClosureStruct {
+  Arena arena;
+  ZoneSet zoneSet;
+  Size size;
+  Bool high;
+  Bool found;
+  Addr base, limit;
+} TLSFZonesClosureStruct, *TLSFZonesClosure;
+
+static Bool tlsfFindInZonesVisit(Tree tree, void *closure)
+{
+  TLSFZonesClosure my = closure;
+  TLSFBlock block = tlsfBlockOfTree(tree);
+  RangeInZoneSet search;
+  Addr base, limit;
+
+  search = my->high ? RangeInZoneSetLast : RangeInZoneSetFirst;
+  if (search(&base, &limit, tlsfBlockBase(block), tlsfBlockLimit(block),
+             my->arena, my->zoneSet, my->size)) {
+    my->found = TRUE;
+    my->base = base;
+    my->limit = limit;
+    return my->high;            /* keep looking for a later one */
+  }
+  return TRUE;
+}
+
+static Res tlsfFindInZones(Bool *foundReturn, Range rangeReturn,
+                           Range oldRangeReturn, Land land, Size size,
+                           ZoneSet zoneSet, Bool high)
+{
+  TLSF tlsf = MustBeA(TLSF, land);
+  SplayTree splay = tlsfSplay(tlsf);
+  TLSFZonesClosureStruct closure;
+  RangeStruct range, oldRange;
+  Res res;
+
+  AVER(foundReturn != NULL);
+  AVER(rangeReturn != NULL);
+  AVER(oldRangeReturn != NULL);
+  AVER(size > 0);
+  AVERT(Bool, high);
+
+  *foundReturn = FALSE;
+  if (zoneSet == ZoneSetEMPTY)
+    return ResOK;
+
+  closure.arena = LandArena(land);
+  closure.zoneSet = zoneSet;
+  closure.size = size;
+  closure.high = high;
+  closure.found = FALSE;
+  (void)TreeTraverse(SplayTreeRoot(splay), splay->compare, splay->nodeKey,
+                     tlsfFindInZonesVisit, &closure);
+  if (!closure.found)
+    return ResOK;
+
+  if (high)
+    RangeInit(&range, AddrSub(closure.limit, size), closure.limit);
+  else
+    RangeInit(&range, closure.base, AddrAdd(closure.base, size));
+  res = tlsfDelete(&oldRange, land, &range);
+  if (res != ResOK)
+    return res;         /* not enough memory to split block */
+  RangeCopy(rangeReturn, &range);
+  RangeCopy(oldRangeReturn, &oldRange);
+  *foundReturn = TRUE;
+  return ResOK;
+}
+
+
+/* tlsfDescribe -- describe a TLSF
+ *
+ * <design/land#.function.describe>.
+ */
+
+static Res tlsfDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
+{
+  Land land = CouldBeA(Land, inst);
+  TLSF tlsf = CouldBeA(TLSF, land);
+  Index i;
+  Res res;
+
+  if (!TESTC(TLSF, tlsf))
+    return ResPARAM;
+  if (stream == NULL)
+    return ResPARAM;
+
+  res = NextMethod(Inst, TLSF, describe)(inst, stream, depth);
+  if (res != ResOK)
+    return res;
+
+  res = WriteF(stream, depth + 2,
+               "blockPool  $P\n", (WriteFP)tlsf->blockPool,
+               "size       $U\n", (WriteFU)tlsf->size,
+               "blockCount $U\n", (WriteFU)tlsf->blockCount,
+               "firstMap   $B\n", (WriteFB)tlsf->firstMap,
+               NULL);
+  if (res != ResOK)
+    return res;
+
+  for (i = 0; i < TLSFListCOUNT; ++i) {
+    Ring node, next;
+    if (RingIsSingle(&tlsf->list[i]))
+      continue;
+    res = WriteF(stream, depth + 2, "list $U:", (WriteFU)i, NULL);
+    if (res != ResOK)
+      return res;
+    RING_FOR(node, &tlsf->list[i], next) {
+      TLSFBlock block = tlsfBlockOfRing(node);
+      res = WriteF(stream, 0, " [$P,$P)",
+                   (WriteFP)tlsfBlockBase(block),
+                   (WriteFP)tlsfBlockLimit(block), NULL);
+      if (res != ResOK)
+        return res;
+    }
+    res = WriteF(stream, 0, "\n", NULL);
+    if (res != ResOK)
+      return res;
+  }
+
+  return ResOK;
+}
+
+
+DEFINE_CLASS(Land, TLSF, klass)
+{
+  INHERIT_CLASS(klass, TLSF, Land);
+  klass->instClassStruct.describe = tlsfDescribe;
+  klass->instClassStruct.finish = tlsfFinish;
+  klass->size = sizeof(TLSFStruct);
+  klass->init = tlsfInit;
+  klass->sizeMethod = tlsfSize;
+  klass->insert = tlsfInsert;
+  klass->delete = tlsfDelete;
+  klass->iterate = tlsfIterate;
+  klass->iterateAndDelete = tlsfIterateAndDelete;
+  klass->findFirst = tlsfFind;
+  klass->findLast = tlsfFind;
+  klass->findLargest = tlsfFindLargest;
+  klass->findInZones = tlsfFindInZones;
+  AVERT(LandClass, klass);
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
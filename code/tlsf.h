@@ -0,0 +1,97 @@
+/* tlsf.h: TLSF -- Two-Level Segregated Fit
+ *
+ * $Id$
+ * Copyright (c) 2020 Ravenbrook Limited.  See end of file for license.
+ *
+ * .source: <design/tlsf>.
+ */
+
+#ifndef tlsf_h
+#define tlsf_h
+
+#include "mpmtypes.h"
+#include "mpm.h"
+#include "mpmst.h"
+#include "rangetree.h"
+#include "splay.h"
+
+
+/* Segregated list configuration <design/tlsf#.impl.index>
+ *
+ * Each power of two is divided into TLSFSecondCOUNT classes, so the
+ * first-level index is one bit of the size in alignment units, and
+ * the second-level index is the next TLSFSecondSHIFT bits.
+ */
+
+#define TLSFSecondSHIFT ((Shift)4)
+#define TLSFSecondCOUNT ((Count)1 << TLSFSecondSHIFT)
+#define TLSFFirstCOUNT ((Count)MPS_WORD_WIDTH - TLSFSecondSHIFT + 1)
+#define TLSFListCOUNT (TLSFFirstCOUNT * TLSFSecondCOUNT)
+
+typedef struct TLSFBlockStruct *TLSFBlock;
+typedef struct TLSFBlockStruct {
+  struct RangeTreeStruct rangeTreeStruct; /* address-ordered tree node */
+  RingStruct listRing;          /* node in segregated list */
+  Index index;                  /* index of segregated list */
+} TLSFBlockStruct;
+
+
+/* TLSFStruct -- two-level segregated fit land
+ *
+ * The splay tree keeps the blocks in address order, for coalescing;
+ * the segregated lists and bitmaps find blocks by size.
+ */
+
+#define TLSFSig ((Sig)0x5197757F) /* SIGnature TLSF */
+
+typedef struct TLSFStruct *TLSF;
+typedef struct TLSFStruct {
+  LandStruct landStruct;        /* superclass fields come first */
+  SplayTreeStruct splayTreeStruct; /* blocks in address order */
+  Pool blockPool;               /* pool that manages blocks */
+  Shift alignShift;             /* log2 of land alignment */
+  Size size;                    /* total size of ranges in TLSF */
+  Count blockCount;             /* number of blocks in TLSF */
+  Word firstMap;                /* first-level bitmap */
+  Word secondMap[TLSFFirstCOUNT]; /* second-level bitmaps */
+  RingStruct list[TLSFListCOUNT]; /* segregated lists */
+  Sig sig;                      /* .class.end-sig */
+} TLSFStruct;
+
+extern Bool TLSFCheck(TLSF tlsf);
+
+#define TLSFLand(tlsf) (&(tlsf)->landStruct)
+
+DECLARE_CLASS(Land, TLSF, Land);
+
+#endif /* tlsf_h */
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
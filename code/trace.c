@@ -51,6 +51,7 @@ Bool ScanStateCheck(ScanState ss)
   CHECKL(TraceSetSuper(ss->arena->busyTraces, ss->traces));
   CHECKL(RankCheck(ss->rank));
   CHECKL(BoolCheck(ss->wasMarked));
+  CHECKL(ss->deferCount <= NELEMS(ss->deferred));
   /* @@@@ checks for counts missing */
   return TRUE;
 }
@@ -108,6 +109,8 @@ void ScanStateInit(ScanState ss, TraceSet ts, Arena arena,
   STATISTIC(ss->preservedInPlaceCount = (Count)0);
   STATISTIC(ss->copiedSize = (Size)0);
   ss->scannedSize = (Size)0; /* see .work */
+  ss->boringSize = (Size)0;
+  ss->deferCount = 0;
   ss->sig = ScanStateSig;
 
   AVERT(ScanState, ss);
@@ -119,6 +122,7 @@ void ScanStateInit(ScanState ss, TraceSet ts, Arena arena,
 void ScanStateFinish(ScanState ss)
 {
   AVERT(ScanState, ss);
+  AVER(ss->deferCount == 0); /* <design/trace#.fix.defer.flush> */
   ss->sig = SigInvalid;
 }
 
@@ -147,6 +151,8 @@ Bool TraceSetCheck(TraceSet ts)
 
 Bool TraceCheck(Trace trace)
 {
+  Rank rank;
+
   CHECKS(Trace, trace);
   CHECKU(Arena, trace->arena);
   CHECKL(TraceIdCheck(trace->ti));
@@ -154,6 +160,9 @@ Bool TraceCheck(Trace trace)
   CHECKL(TraceSetIsMember(trace->arena->busyTraces, trace));
   CHECKL(ZoneSetSub(trace->mayMove, trace->white));
   CHECKD_NOSIG(Ring, &trace->genRing);
+  for (rank = RankMIN; rank < RankLIMIT; ++rank)
+    CHECKD_NOSIG(Ring, TraceGreyRing(trace, rank));
+  CHECKD_NOSIG(Ring, TraceWhiteRing(trace));
   /* Use trace->state to check more invariants. */
   switch(trace->state) {
     case TraceINIT:
@@ -435,6 +444,9 @@ Res TraceCondemnEnd(double *mortalityReturn, Trace trace)
     RING_FOR(segNode, &gen->segRing, segNext) {
       GCSeg gcseg = RING_ELT(GCSeg, genRing, segNode);
       AVERC(GCSeg, gcseg);
+      /* <design/strategy#.freeze.condemn> */
+      if (SegFrozen(&gcseg->segStruct))
+        continue;
       res = TraceAddWhite(trace, &gcseg->segStruct);
       if (res != ResOK)
         goto failBegin;
@@ -442,6 +454,7 @@ Res TraceCondemnEnd(double *mortalityReturn, Trace trace)
     AVER(trace->condemned >= condemnedBefore);
     condemnedGen = trace->condemned - condemnedBefore;
     casualtySize += (Size)(condemnedGen * gen->mortality);
+    GenDescCondemnEnd(gen, trace);
   }
   ShieldRelease(trace->arena);
 
@@ -636,8 +649,8 @@ static Res traceFlip(Trace trace)
   /* Now that the mutator is black we must prevent it from reading */
   /* grey objects so that it can't obtain white pointers. */
   for(rank = RankMIN; rank < RankLIMIT; ++rank)
-    RING_FOR(node, ArenaGreyRing(arena, rank), nextNode) {
-      Seg seg = SegOfGreyRing(node);
+    RING_FOR(node, TraceGreyRing(trace, rank), nextNode) {
+      Seg seg = SegOfGreyRing(node, trace);
       SegFlip(seg, trace);
     }
 
@@ -692,6 +705,7 @@ Res TraceCreate(Trace *traceReturn, Arena arena, TraceStartWhy why)
 {
   TraceId ti;
   Trace trace;
+  Rank rank;
 
   AVER(traceReturn != NULL);
   AVERT(Arena, arena);
@@ -716,18 +730,22 @@ found:
   trace->fix = SegFix;
   trace->fixClosure = NULL;
   RingInit(&trace->genRing);
+  for (rank = RankMIN; rank < RankLIMIT; ++rank)
+    RingInit(TraceGreyRing(trace, rank));
+  RingInit(TraceWhiteRing(trace));
   STATISTIC(trace->preTraceArenaReserved = ArenaReserved(arena));
   trace->condemned = (Size)0;   /* nothing condemned yet */
   trace->notCondemned = (Size)0;
   trace->foundation = (Size)0;  /* nothing grey yet */
   trace->quantumWork = (Work)0; /* computed in TraceStart */
-  STATISTIC(trace->greySegCount = (Count)0);
+  trace->greySegCount = (Count)0;
   STATISTIC(trace->greySegMax = (Count)0);
   STATISTIC(trace->rootScanCount = (Count)0);
   trace->rootScanSize = (Size)0;
   STATISTIC(trace->rootCopiedSize = (Size)0);
   STATISTIC(trace->segScanCount = (Count)0);
   trace->segScanSize = (Size)0; /* see .work */
+  trace->reclaimWork = (Size)0; /* see .work */
   STATISTIC(trace->segCopiedSize = (Size)0);
   STATISTIC(trace->singleScanCount = (Count)0);
   STATISTIC(trace->singleScanSize = (Size)0);
@@ -780,6 +798,7 @@ found:
 static void traceDestroyCommon(Trace trace)
 {
   Ring node, nextNode;
+  Rank rank;
 
   RING_FOR(node, &trace->genRing, nextNode) {
     GenDesc gen = GenDescOfTraceRing(node, trace);
@@ -787,6 +806,16 @@ static void traceDestroyCommon(Trace trace)
   }
   RingFinish(&trace->genRing);
 
+  /* No segment can still be grey for a trace that is being destroyed. */
+  AVER(trace->greySegCount == 0);
+  for (rank = RankMIN; rank < RankLIMIT; ++rank)
+    RingFinish(TraceGreyRing(trace, rank));
+
+  /* No segment can still be white either: they have all been
+     reclaimed, or nothing was condemned. */
+  AVER(RingIsSingle(TraceWhiteRing(trace)));
+  RingFinish(TraceWhiteRing(trace));
+
   /* Ensure that address space is returned to the operating system for
    * traces that don't have any condemned objects (there might be
    * manually allocated objects that were freed). See job003999. */
@@ -855,49 +884,52 @@ void TraceDestroyFinished(Trace trace)
 }
 
 
-/* traceReclaim -- reclaim the remaining objects white for this trace */
+/* traceReclaim -- reclaim one segment white for this trace
+ *
+ * Reclaim the segment at the head of the trace's white ring, or
+ * finish the trace if there are none left.  Reclaiming one segment
+ * per step, like scanning one grey segment per step, means that the
+ * reclaim phase is spread over several polls instead of being one
+ * pause proportional to the size of the condemned set.  See
+ * <design/trace#.reclaim.incremental>.
+ */
 
 static void traceReclaim(Trace trace)
 {
   Arena arena;
-  Ring genNode, genNext;
+  Ring node;
 
   AVER(trace->state == TraceRECLAIM);
 
-
   arena = trace->arena;
-  EVENT2(TraceReclaim, trace, arena);
-  RING_FOR(genNode, &trace->genRing, genNext) {
-    Ring segNode, segNext;
-    GenDesc gen = GenDescOfTraceRing(genNode, trace);
-    AVERT(GenDesc, gen);
-    RING_FOR(segNode, &gen->segRing, segNext) {
-      GCSeg gcseg = RING_ELT(GCSeg, genRing, segNode);
-      Seg seg = &gcseg->segStruct;
-
-      /* There shouldn't be any grey stuff left for this trace. */
-      AVER_CRITICAL(!TraceSetIsMember(SegGrey(seg), trace));
-      if (TraceSetIsMember(SegWhite(seg), trace)) {
-        Addr base = SegBase(seg);
-        AVER_CRITICAL(PoolHasAttr(SegPool(seg), AttrGC));
-        STATISTIC(++trace->reclaimCount);
-        SegReclaim(seg, trace);
-
-        /* If the segment still exists, it should no longer be white. */
-        /* Note that the seg returned by this SegOfAddr may not be */
-        /* the same as the one above, but in that case it's new and */
-        /* still shouldn't be white for this trace. */
-
-        /* The code from the class-specific reclaim methods to */
-        /* unwhiten the segment could in fact be moved here.   */
-        {
-          Seg nonWhiteSeg = NULL;       /* prevents compiler warning */
-          AVER_CRITICAL(!SegOfAddr(&nonWhiteSeg, arena, base)
-                        || !TraceSetIsMember(SegWhite(nonWhiteSeg), trace));
-          UNUSED(nonWhiteSeg); /* <code/mpm.c#check.unused> */
-        }
-      }
+  node = RingNext(TraceWhiteRing(trace));
+  if (node != TraceWhiteRing(trace)) {
+    Seg seg = SegOfWhiteRing(node, trace);
+    Addr base = SegBase(seg);
+    Size size = SegSize(seg);
+
+    /* There shouldn't be any grey stuff left for this trace. */
+    AVER_CRITICAL(!TraceSetIsMember(SegGrey(seg), trace));
+    AVER_CRITICAL(TraceSetIsMember(SegWhite(seg), trace));
+    AVER_CRITICAL(PoolHasAttr(SegPool(seg), AttrGC));
+    STATISTIC(++trace->reclaimCount);
+    SegReclaim(seg, trace);
+    trace->reclaimWork += (Size)((double)size * TraceReclaimScanRATIO);
+
+    /* If the segment still exists, it should no longer be white. */
+    /* Note that the seg returned by this SegOfAddr may not be */
+    /* the same as the one above, but in that case it's new and */
+    /* still shouldn't be white for this trace. */
+
+    /* The code from the class-specific reclaim methods to */
+    /* unwhiten the segment could in fact be moved here.   */
+    {
+      Seg nonWhiteSeg = NULL;       /* prevents compiler warning */
+      AVER_CRITICAL(!SegOfAddr(&nonWhiteSeg, arena, base)
+                    || !TraceSetIsMember(SegWhite(nonWhiteSeg), trace));
+      UNUSED(nonWhiteSeg); /* <code/mpm.c#check.unused> */
     }
+    return;
   }
 
   trace->state = TraceFINISHED;
@@ -1031,7 +1063,6 @@ static Bool traceFindGrey(Seg *segReturn, Rank *rankReturn,
 {
   Rank rank;
   Trace trace;
-  Ring node, nextNode;
 
   AVER(segReturn != NULL);
   AVERT(TraceId, ti);
@@ -1045,32 +1076,36 @@ static Bool traceFindGrey(Seg *segReturn, Rank *rankReturn,
     /* then successively earlier ones.  Slight hack: We never    */
     /* expect to find any segments of RankAMBIG, so we use      */
     /* this as a terminating condition for the loop.            */
+    /* .grey.ring: Each trace has its own grey ring for each rank, */
+    /* containing exactly the segments that are grey for that trace, */
+    /* so the segment at the head of a non-empty ring is always the */
+    /* one to scan next. */
     for(rank = band; rank > RankAMBIG; --rank) {
-      RING_FOR(node, ArenaGreyRing(arena, rank), nextNode) {
-        Seg seg = SegOfGreyRing(node);
+      Ring ring = TraceGreyRing(trace, rank);
+      if(!RingIsSingle(ring)) {
+        Seg seg = SegOfGreyRing(RingNext(ring), trace);
 
         AVERT(Seg, seg);
-        AVER(SegGrey(seg) != TraceSetEMPTY);
+        AVER(TraceSetIsMember(SegGrey(seg), trace));
         AVER(RankSetIsMember(SegRankSet(seg), rank));
 
-        if(TraceSetIsMember(SegGrey(seg), trace)) {
-          /* .check.band.weak */
-          AVER(band != RankWEAK || rank == band);
-          if(rank != band) {
-            traceBandFirstStretchDone(trace);
-          } else {
-            /* .check.final.one-pass */
-            AVER(traceBandFirstStretch(trace));
-          }
-          *segReturn = seg;
-          *rankReturn = rank;
-          EVENT4(TraceFindGrey, arena, trace, seg, rank);
-          return TRUE;
+        /* .check.band.weak */
+        AVER(band != RankWEAK || rank == band);
+        if(rank != band) {
+          traceBandFirstStretchDone(trace);
+        } else {
+          /* .check.final.one-pass */
+          AVER(traceBandFirstStretch(trace));
         }
+        *segReturn = seg;
+        *rankReturn = rank;
+        EVENT5(TraceFindGrey, arena, trace, seg, rank,
+               trace->greySegCount);
+        return TRUE;
       }
     }
     /* .check.ambig.not */
-    AVER(RingIsSingle(ArenaGreyRing(arena, RankAMBIG)));
+    AVER(RingIsSingle(TraceGreyRing(trace, RankAMBIG)));
     if(!traceBandAdvance(trace)) {
       /* No grey segments for this trace. */
       return FALSE;
@@ -1150,15 +1185,13 @@ static Res traceScanSegRes(TraceSet ts, Rank rank, Arena arena, Seg seg)
     ShieldCover(arena, seg);
 
     traceSetUpdateCounts(ts, arena, ss, traceAccountingPhaseSegScan);
-    /* Count segments scanned pointlessly */
+    /* Count segments scanned pointlessly.  This must use the counts
+       in the scan state, not the totals accumulated in the traces,
+       which are almost always non-zero after the first scan. */
     STATISTIC({
       TraceId ti; Trace trace;
-      Count whiteSegRefCount = 0;
 
-      TRACE_SET_ITER(ti, trace, ts, arena)
-        whiteSegRefCount += trace->whiteSegRefCount;
-      TRACE_SET_ITER_END(ti, trace, ts, arena);
-      if(whiteSegRefCount == 0)
+      if(ss->whiteSegRefCount == 0)
         TRACE_SET_ITER(ti, trace, ts, arena)
           ++trace->pointlessScanCount;
         TRACE_SET_ITER_END(ti, trace, ts, arena);
@@ -1167,13 +1200,26 @@ static Res traceScanSegRes(TraceSet ts, Rank rank, Arena arena, Seg seg)
     /* Following is true whether or not scan was total. */
     /* <design/scan#.summary.subset>. */
     /* .verify.segsummary: were the seg contents, as found by this
-     * scan, consistent with the recorded SegSummary?
+     * scan, consistent with the recorded SegSummary?  With soft-dirty
+     * page tracking, the mutator may have written to the segment
+     * since the harvest at the start of this trace, without losing
+     * the summary: but then the page map must say so.  With a
+     * software barrier, the mutator marks the card after the store,
+     * so there is no such check:
+     * <design/write-barrier#.soft-dirty.verify>.
      */
-    AVER(RefSetSub(ScanStateUnfixedSummary(ss), SegSummary(seg))); /* <design/check/#.common> */
+    AVER(RefSetSub(ScanStateUnfixedSummary(ss), SegSummary(seg))
+         || PoolSoftwareBarrier(SegPool(seg))
+         || (ArenaSoftDirty(arena)
+             && ProtDirty(SegBase(seg), SegLimit(seg)))); /* <design/check/#.common> */
 
     /* Write barrier deferral -- see <design/write-barrier#.deferral>. */
-    /* Did the segment refer to the white set? */
-    if (ZoneSetInter(ScanStateUnfixedSummary(ss), white) == ZoneSetEMPTY) {
+    /* Did the segment refer to the white set?  If the pool found that
+       most of the segment did not, it can avoid rescanning that part
+       provided the barrier is raised: see
+       <design/write-barrier#.deferral.cards>. */
+    if (ZoneSetInter(ScanStateUnfixedSummary(ss), white) == ZoneSetEMPTY
+        || ss->boringSize >= SegSize(seg) / 2) {
       /* Boring scan.  One step closer to raising the write barrier. */
       if (seg->defer > 0)
         --seg->defer;
@@ -1183,8 +1229,10 @@ static Res traceScanSegRes(TraceSet ts, Rank rank, Arena arena, Seg seg)
         seg->defer = WB_DEFER_DELAY;
     }
 
-    /* Only apply the write barrier if it is not deferred. */
-    if (seg->defer == 0) {
+    /* Only apply the write barrier if it is not deferred.  An
+       unprotected barrier has no barrier hits to avoid, so it never
+       defers: <design/write-barrier#.soft-dirty.defer>. */
+    if (seg->defer == 0 || SegUnprotectedBarrier(seg)) {
       /* If we scanned every reference in the segment then we have a
          complete summary we can set. Otherwise, we just have
          information about more zones that the segment refers to. */
@@ -1195,6 +1243,15 @@ static Res traceScanSegRes(TraceSet ts, Rank rank, Arena arena, Seg seg)
     } else {
       summary = RefSetUNIV;
     }
+
+    /* Objects allocated from a buffer are initialized without the
+       software write barrier, so a buffered segment has no summary:
+       <design/write-barrier#.software.buffer>. */
+    if (PoolSoftwareBarrier(SegPool(seg))) {
+      Buffer buffer;
+      if (SegBuffer(&buffer, seg))
+        summary = RefSetUNIV;
+    }
     SegSetSummary(seg, summary);
 
     ScanStateFinish(ss);
@@ -1348,10 +1405,9 @@ mps_res_t _mps_fix2(mps_ss_t mps_ss, mps_addr_t *mps_ref_io)
    * check the rank in the latter case. See
    * <design/trace#.fix.tractofaddr.inline>
    *
-   * If compilers fail to do a good job of inlining ChunkOfAddr and
-   * TreeFind then it may become necessary to inline at least the
-   * comparison against the root of the tree. See
-   * <https://info.ravenbrook.com/mail/2014/06/11/13-32-08/0/>
+   * ChunkOfAddr usually finds the chunk in the arena's chunk map
+   * without searching the tree of chunks. See
+   * <design/trace#.fix.chunkmap>.
    */
   if (!ChunkOfAddr(&chunk, ss->arena, ref))
     /* Reference points outside MPS-managed address space: ignore. */
@@ -1401,15 +1457,100 @@ mps_res_t _mps_fix2(mps_ss_t mps_ss, mps_addr_t *mps_ref_io)
     return res;
   }
 
+  /* Only store a reference that has changed, so that scanning doesn't
+     dirty pages <design/write-barrier#.soft-dirty.collector>. */
+  if (ref != (Ref)*mps_ref_io)
+    *mps_ref_io = (mps_addr_t)ref;
+
 done:
   /* <design/trace#.fix.fixed.all> */
   ss->fixedSummary = RefSetAdd(ss->arena, ss->fixedSummary, ref);
+  return ResOK;
+}
+
+
+/* _mps_fix_defer -- defer the second stage of fixing a reference
+ *
+ * Queue the location of the reference in the scan state, and prefetch
+ * the page table entry and the object it refers to, so that the cache
+ * misses for several references can overlap.  The queue is flushed by
+ * ScanStateFlush when it is full, when the client calls
+ * mps_fix_flush, and when the client's scanning function returns.
+ * See <design/trace#.fix.defer>.
+ */
 
-  *mps_ref_io = (mps_addr_t)ref;
+mps_res_t _mps_fix_defer(mps_ss_t mps_ss, mps_addr_t *mps_ref_io)
+{
+  ScanState ss = PARENT(ScanStateStruct, ss_s, mps_ss);
+  Ref ref;
+  Chunk chunk;
+  Res res;
+
+  AVERT_CRITICAL(ScanState, ss);
+  AVER_CRITICAL(mps_ref_io != NULL);
+
+  if (ss->deferCount == NELEMS(ss->deferred)) {
+    res = ScanStateFlush(ss);
+    if (res != ResOK)
+      return res;
+  }
+
+  ref = (Ref)*mps_ref_io;
+  if (!ChunkOfAddr(&chunk, ss->arena, ref))
+    /* Nothing to prefetch, and nothing to gain from deferring. */
+    return _mps_fix2(mps_ss, mps_ref_io);
+
+  PREFETCH(&chunk->pageTable[INDEX_OF_ADDR(chunk, ref)]);
+  PREFETCH(ref);
+  ss->deferred[ss->deferCount] = mps_ref_io;
+  ++ss->deferCount;
   return ResOK;
 }
 
 
+/* ScanStateFlush -- fix all deferred references
+ *
+ * If fixing a reference fails, the remaining deferred references are
+ * discarded and the result is returned.  This is safe because a
+ * failed scan is always repeated.  <design/trace#.fix.defer.fail>
+ */
+
+Res ScanStateFlush(ScanState ss)
+{
+  Count i, count;
+  Res res;
+
+  AVERT_CRITICAL(ScanState, ss);
+
+  count = ss->deferCount;
+  ss->deferCount = 0;
+  for (i = 0; i < count; ++i) {
+    res = _mps_fix2(&ss->ss_s, ss->deferred[i]);
+    if (res != ResOK)
+      return res;
+  }
+  return ResOK;
+}
+
+
+/* ScanStateDiscard -- discard deferred references after a failed scan */
+
+void ScanStateDiscard(ScanState ss)
+{
+  AVERT(ScanState, ss);
+  ss->deferCount = 0;
+}
+
+
+/* mps_fix_flush -- fix all references deferred by MPS_FIX_DEFER */
+
+mps_res_t mps_fix_flush(mps_ss_t mps_ss)
+{
+  ScanState ss = PARENT(ScanStateStruct, ss_s, mps_ss);
+  return ScanStateFlush(ss);
+}
+
+
 /* traceScanSingleRefRes -- scan a single reference, with result code */
 
 static Res traceScanSingleRefRes(TraceSet ts, Rank rank, Arena arena,
@@ -1531,6 +1672,64 @@ static Res rootGrey(Root root, void *p)
 }
 
 
+/* traceDirtyRead -- read the soft-dirty state of every chunk
+ *
+ * Reading the page map for a whole chunk at once costs one read per
+ * chunk, rather than one per segment, while the mutator is held.  If
+ * the table for a chunk can't be allocated, its segments are looked
+ * up one by one instead.  See <design/write-barrier#.soft-dirty.harvest>.
+ */
+
+static void traceDirtyRead(Arena arena)
+{
+  Ring node, next;
+
+  RING_FOR(node, ArenaChunkRing(arena), next) {
+    Chunk chunk = RING_ELT(Chunk, arenaRing, node);
+    BT dirtyTable;
+    AVER(chunk->dirtyTable == NULL);
+    if (BTCreate(&dirtyTable, arena, chunk->pages) == ResOK) {
+      ProtDirtyRead(dirtyTable, chunk->base, chunk->limit,
+                    chunk->pageShift);
+      chunk->dirtyTable = dirtyTable;
+    }
+  }
+}
+
+
+/* traceDirtyFree -- free the tables made by traceDirtyRead */
+
+static void traceDirtyFree(Arena arena)
+{
+  Ring node, next;
+
+  RING_FOR(node, ArenaChunkRing(arena), next) {
+    Chunk chunk = RING_ELT(Chunk, arenaRing, node);
+    if (chunk->dirtyTable != NULL) {
+      BTDestroy(chunk->dirtyTable, arena, chunk->pages);
+      chunk->dirtyTable = NULL;
+    }
+  }
+}
+
+
+/* traceSegSoftDirty -- might the segment have been written? */
+
+static Bool traceSegSoftDirty(Arena arena, Seg seg)
+{
+  Chunk chunk;
+  Bool found;
+
+  found = ChunkOfAddr(&chunk, arena, SegBase(seg));
+  AVER(found);
+  if (chunk->dirtyTable == NULL)
+    return ProtDirty(SegBase(seg), SegLimit(seg));
+  return !BTIsResRange(chunk->dirtyTable,
+                       INDEX_OF_ADDR(chunk, SegBase(seg)),
+                       INDEX_OF_ADDR(chunk, SegLimit(seg)));
+}
+
+
 /* TraceStart -- start a trace whose white set has been established
  *
  * The main job of TraceStart is to set up the grey list for a trace.  The
@@ -1556,6 +1755,17 @@ Res TraceStart(Trace trace, double mortality, double finishingTime)
 
   arena = trace->arena;
 
+  /* With soft-dirty page tracking or software write barrier cards,
+     the mutator must not write to segments between collecting their
+     dirty state and the flip:
+     <design/write-barrier#.soft-dirty.harvest>.  The mutator is not
+     resumed until ShieldLeave, so holding it here keeps it suspended
+     until after traceFlip. */
+  if (ArenaSoftDirty(arena) || ArenaHasCards(arena))
+    ShieldHold(arena);
+  if (ArenaSoftDirty(arena))
+    traceDirtyRead(arena);
+
   /* From the already set up white set, derive a grey set. */
 
   /* @@@@ Instead of iterating over all the segments, we could */
@@ -1573,6 +1783,14 @@ Res TraceStart(Trace trace, double mortality, double finishingTime)
       /* This is indicated by the rankSet begin non-empty.  Such */
       /* segments may only belong to scannable pools. */
       if(SegRankSet(seg) != RankSetEMPTY) {
+        /* A segment written since the last trace started has lost its
+           summary, just as if it had taken a write barrier hit. */
+        if (SegSummary(seg) != RefSetUNIV
+            && ((ArenaSoftDirty(arena) && traceSegSoftDirty(arena, seg))
+                || (PoolSoftwareBarrier(SegPool(seg))
+                    && ArenaCardsDirty(arena, SegBase(seg), SegLimit(seg)))))
+          SegSetSummary(seg, RefSetUNIV);
+
         /* Turn the segment grey if there might be a reference in it */
         /* to the white set.  This is done by seeing if the summary */
         /* of references in the segment intersects with the */
@@ -1596,6 +1814,16 @@ Res TraceStart(Trace trace, double mortality, double finishingTime)
     } while (SegNext(&seg, arena, seg));
   }
 
+  if (ArenaSoftDirty(arena) || ArenaHasCards(arena)) {
+    if (ArenaSoftDirty(arena)) {
+      traceDirtyFree(arena);
+      ProtDirtyClear();
+    }
+    if (ArenaHasCards(arena))
+      ArenaCardsClear(arena);
+    ShieldRelease(arena);
+  }
+
   res = RootsIterate(ArenaGlobals(arena), rootGrey, (void *)trace);
   AVER(res == ResOK);
 
@@ -1636,7 +1864,9 @@ Res TraceStart(Trace trace, double mortality, double finishingTime)
  * <design/type#.work>.
  */
 
-#define traceWork(trace) ((Work)((trace)->segScanSize + (trace)->rootScanSize))
+#define traceWork(trace) \
+  ((Work)((trace)->segScanSize + (trace)->rootScanSize \
+          + (trace)->reclaimWork))
 
 
 /* TraceAdvance -- progress a trace by one step */
@@ -1667,6 +1897,7 @@ void TraceAdvance(Trace trace)
       AVER(res == ResOK);
     } else {
       trace->state = TraceRECLAIM;
+      EVENT2(TraceReclaim, trace, arena);
     }
     break;
   }
@@ -1684,6 +1915,45 @@ void TraceAdvance(Trace trace)
 }
 
 
+/* TraceReclaimSome -- reclaim some condemned segments on demand
+ *
+ * Reclaim up to count of the remaining white segments of the traces
+ * in the reclaim phase, so that the space they occupy can be reused
+ * before the arena fails an allocation or grows.  Does nothing unless
+ * all busy traces are in the reclaim phase, because the caller might
+ * be in the middle of scanning.  Returns TRUE if any segment was
+ * reclaimed.  See <design/trace#.reclaim.demand>.
+ */
+
+Bool TraceReclaimSome(Arena arena, Count count)
+{
+  TraceId ti;
+  Trace trace;
+  Count reclaimed = 0;
+
+  AVERT(Arena, arena);
+  AVER(count > 0);
+
+  TRACE_SET_ITER(ti, trace, arena->busyTraces, arena)
+    if (trace->state != TraceRECLAIM)
+      return FALSE;
+  TRACE_SET_ITER_END(ti, trace, arena->busyTraces, arena);
+
+  ArenaDeferPurge(arena); /* <design/trace#.reclaim.purge> */
+  TRACE_SET_ITER(ti, trace, arena->busyTraces, arena)
+    while (reclaimed < count && !RingIsSingle(TraceWhiteRing(trace))) {
+      Work oldWork = traceWork(trace);
+      traceReclaim(trace);
+      arena->tracedWork += traceWork(trace) - oldWork;
+      ++reclaimed;
+    }
+  TRACE_SET_ITER_END(ti, trace, arena->busyTraces, arena);
+  ArenaPurge(arena);
+
+  return reclaimed > 0;
+}
+
+
 /* TraceStartCollectAll: start a trace which condemns everything in
  * the arena.
  *
@@ -1832,6 +2102,7 @@ Res TraceDescribe(Trace trace, mps_lib_FILE *stream, Count depth)
                STATISTIC_WRITE("  rootCopiedSize $U\n",
                                (WriteFU)trace->rootCopiedSize)
                "  segScanSize $U\n", (WriteFU)trace->segScanSize,
+               "  reclaimWork $U\n", (WriteFU)trace->reclaimWork,
                STATISTIC_WRITE("  segCopiedSize $U\n",
                                (WriteFU)trace->segCopiedSize)
                "  forwardedSize $U\n", (WriteFU)trace->forwardedSize,
@@ -548,6 +548,7 @@ void ArenaPark(Globals globals)
   globals->clamped = TRUE;
   start = ClockNow();
 
+  ArenaDeferPurge(arena); /* <design/trace#.reclaim.purge> */
   while(arena->busyTraces != TraceSetEMPTY) {
     /* Advance all active traces. */
     TRACE_SET_ITER(ti, trace, arena->busyTraces, arena)
@@ -557,6 +558,7 @@ void ArenaPark(Globals globals)
       }
     TRACE_SET_ITER_END(ti, trace, arena->busyTraces, arena);
   }
+  ArenaPurge(arena);
 
   ArenaAccumulateTime(arena, start, ClockNow());
 
@@ -565,6 +567,69 @@ void ArenaPark(Globals globals)
 }
 
 
+/* ArenaFreeze -- make all existing objects immortal
+ *
+ * Park the arena and empty the buffers of automatically managed
+ * pools, then mark every segment in those pools as frozen, so that it
+ * will never be condemned. An unbuffered frozen segment can only
+ * refer to frozen objects, which are never white, so it is clean: its
+ * summary is made empty, which raises the write barrier and keeps it
+ * from being scanned until it is written to. See
+ * <design/strategy#.freeze>.
+ */
+
+void ArenaFreeze(Globals globals)
+{
+  Arena arena;
+  Seg seg;
+  Ring node, next;
+
+  AVERT(Globals, globals);
+  arena = GlobalsArena(globals);
+
+  ArenaPark(globals);
+
+  /* Empty the buffers, so that their segments can be clean and so
+     that no more objects are allocated in frozen segments
+     <design/strategy#.freeze.alloc>. */
+  RING_FOR(node, &globals->poolRing, next) {
+    Pool pool = RING_ELT(Pool, arenaRing, node);
+    if (PoolHasAttr(pool, AttrGC)) {
+      Ring nodeb, nextb;
+      RING_FOR(nodeb, &pool->bufferRing, nextb) {
+        Buffer buffer = RING_ELT(Buffer, poolRing, nodeb);
+        if (BufferIsReady(buffer))
+          BufferDetach(buffer, pool);
+      }
+    }
+  }
+
+  if (SegFirst(&seg, arena)) {
+    do {
+      if (PoolHasAttr(SegPool(seg), AttrGC)) {
+        seg->frozen = TRUE;
+        if (SegRankSet(seg) != RankSetEMPTY && !SegHasBuffer(seg)
+            && IsA(MutatorSeg, seg))
+        {
+          SegSetSummary(seg, RefSetEMPTY);
+          /* The summary stays universal if there is no barrier. */
+          seg->clean = SegSummary(seg) == RefSetEMPTY;
+        }
+      }
+    } while (SegNext(&seg, arena, seg));
+  }
+
+  RING_FOR(node, &arena->chainRing, next) {
+    Chain chain = RING_ELT(Chain, chainRing, node);
+    Index i;
+    AVERT(Chain, chain);
+    for (i = 0; i < chain->genCount; ++i)
+      GenDescFreeze(&chain->gens[i]);
+  }
+  GenDescFreeze(&arena->topGen);
+}
+
+
 /* arenaExpose -- discard all protection from MPS-managed memory
  *
  * This is called by ArenaPostmortem, which we expect only to be used
@@ -198,6 +198,7 @@ Res ChunkInit(Chunk chunk, Arena arena, Addr base, Addr limit, Size reserved,
   if (res != ResOK)
     goto failAllocTable;
   chunk->allocTable = p;
+  chunk->dirtyTable = NULL;
 
   pageTableSize = SizeAlignUp(pages * sizeof(PageUnion), chunk->pageSize);
   chunk->pageTablePages = pageTableSize >> pageShift;
@@ -313,21 +314,207 @@ TreeKey ChunkKey(Tree tree)
 }
 
 
+/* Chunk map
+ *
+ * .chunk-map: The arena keeps a table (arena->chunkMap) from addresses
+ * to chunks, so that ChunkOfAddr can usually find the chunk containing
+ * an address with one load from the arena and a bounds check, instead
+ * of searching the tree of chunks.  This is on the critical path via
+ * _mps_fix2.  See <design/trace#.fix.chunkmap>.
+ *
+ * .chunk-map.entry: The map covers the range of addresses starting at
+ * arena->chunkMapBase, divided into ChunkMapLENGTH granules of
+ * 2^arena->chunkMapShift bytes, one granule per entry.  If exactly one
+ * chunk overlaps a granule, its entry points to that chunk.  If two
+ * chunks do, as at the boundary between adjacent chunks, the entry
+ * points to both, and the base of the upper one decides between them.
+ * If no chunk does, the entry is empty.  If more than two chunks do,
+ * the entry is marked as shared and lookups fall back to searching
+ * the tree.  Addresses outside the range are not in any chunk.
+ *
+ * .chunk-map.size: The range is sized from the address space reserved
+ * by the arena: the shift is the smallest, but no less than
+ * ChunkMapSHIFT, for which the granules span every chunk.  So the map
+ * never wraps around, and an entry is only shared when there are chunks
+ * smaller than a granule.  When a chunk is inserted outside the
+ * range, or any chunk is removed, the range is recomputed and the map
+ * rebuilt.  Chunks are created and destroyed rarely, so this need not
+ * be fast.
+ *
+ * .chunk-map.sync: The map is only updated when chunks are inserted
+ * into or removed from the arena, and only read while holding the
+ * arena lock, so no further synchronization is needed.
+ */
+
+#define chunkMapIndex(arena, addr) \
+  (((Word)(addr) - (Word)(arena)->chunkMapBase) >> (arena)->chunkMapShift)
+
+static Bool chunkMapCovers(Arena arena, Chunk chunk)
+{
+  return chunkMapIndex(arena, chunk->base) < ChunkMapLENGTH
+    && chunkMapIndex(arena, AddrSub(chunk->limit, 1)) < ChunkMapLENGTH;
+}
+
+static void chunkMapAdd(Arena arena, Chunk chunk)
+{
+  Index i, last;
+
+  AVER(chunkMapCovers(arena, chunk));
+
+  i = chunkMapIndex(arena, chunk->base);
+  last = chunkMapIndex(arena, AddrSub(chunk->limit, 1));
+  for (; i <= last; ++i) {
+    ChunkMapEntry entry = &arena->chunkMap[i];
+    if (entry->shared) {
+      AVER(entry->chunk == NULL);
+      AVER(entry->upper == NULL);
+    } else if (entry->chunk == NULL) {
+      AVER(entry->upper == NULL);
+      entry->chunk = chunk;
+    } else if (entry->chunk == chunk || entry->upper == chunk) {
+      NOOP;
+    } else if (entry->upper == NULL) {
+      if (entry->chunk->base < chunk->base) {
+        entry->upper = chunk;
+      } else {
+        entry->upper = entry->chunk;
+        entry->chunk = chunk;
+      }
+    } else {
+      entry->chunk = NULL;
+      entry->upper = NULL;
+      entry->shared = TRUE;
+    }
+  }
+}
+
+
+/* chunkMapRebuild -- size the chunk map to the chunks and fill it
+ *
+ * All the chunks in the arena except "except" (which may be NULL) are
+ * entered in the map.  See .chunk-map.size.
+ */
+
+static void chunkMapRebuild(Arena arena, Chunk except)
+{
+  Ring node, next;
+  Word base = ~(Word)0, last = 0;
+  Shift shift = ChunkMapSHIFT;
+
+  RING_FOR(node, ArenaChunkRing(arena), next) {
+    Chunk chunk = RING_ELT(Chunk, arenaRing, node);
+    if (chunk != except) {
+      if ((Word)chunk->base < base)
+        base = (Word)chunk->base;
+      if ((Word)chunk->limit - 1 > last)
+        last = (Word)chunk->limit - 1;
+    }
+  }
+
+  ChunkMapInit(arena);
+  if (base > last) /* no chunks */
+    return;
+
+  while ((last >> shift) - (base >> shift) >= ChunkMapLENGTH)
+    ++shift;
+  arena->chunkMapBase = (Addr)((base >> shift) << shift);
+  arena->chunkMapShift = shift;
+
+  RING_FOR(node, ArenaChunkRing(arena), next) {
+    Chunk chunk = RING_ELT(Chunk, arenaRing, node);
+    if (chunk != except)
+      chunkMapAdd(arena, chunk);
+  }
+}
+
+
+/* ChunkMapInit -- initialize the arena's chunk map to empty */
+
+void ChunkMapInit(Arena arena)
+{
+  Index i;
+
+  AVER(arena != NULL); /* arena is not yet initialized */
+
+  arena->chunkMapBase = (Addr)0;
+  arena->chunkMapShift = ChunkMapSHIFT;
+  for (i = 0; i < ChunkMapLENGTH; ++i) {
+    arena->chunkMap[i].chunk = NULL;
+    arena->chunkMap[i].upper = NULL;
+    arena->chunkMap[i].shared = FALSE;
+  }
+}
+
+
+/* ChunkMapInsert -- add a new chunk to the arena's chunk map
+ *
+ * The chunk must already be on the arena's chunk ring, in case the map
+ * has to be rebuilt.
+ */
+
+void ChunkMapInsert(Arena arena, Chunk chunk)
+{
+  AVERT(Arena, arena);
+  AVERT(Chunk, chunk);
+
+  if (chunkMapCovers(arena, chunk))
+    chunkMapAdd(arena, chunk);
+  else
+    chunkMapRebuild(arena, NULL);
+}
+
+
+/* ChunkMapRemove -- remove a chunk from the arena's chunk map
+ *
+ * Entries that were shared may now be unshared, and the range may
+ * shrink, so rebuild the map from the remaining chunks.
+ */
+
+void ChunkMapRemove(Arena arena, Chunk chunk)
+{
+  AVERT(Arena, arena);
+  AVERT(Chunk, chunk);
+
+  chunkMapRebuild(arena, chunk);
+}
+
+
 /* ChunkOfAddr -- return the chunk which encloses an address */
 
 Bool ChunkOfAddr(Chunk *chunkReturn, Arena arena, Addr addr)
 {
+  ChunkMapEntry entry;
+  Chunk chunk;
   Tree tree;
+  Word index;
 
   AVER_CRITICAL(chunkReturn != NULL);
   AVERT_CRITICAL(Arena, arena);
   /* addr is arbitrary */
 
+  /* See .chunk-map.entry. */
+  index = chunkMapIndex(arena, addr);
+  if (index >= ChunkMapLENGTH)
+    return FALSE;
+  entry = &arena->chunkMap[index];
+  chunk = entry->chunk;
+  if (entry->upper != NULL && entry->upper->base <= addr)
+    chunk = entry->upper;
+  if (chunk != NULL) {
+    if (chunk->base <= addr && addr < chunk->limit) {
+      *chunkReturn = chunk;
+      return TRUE;
+    }
+    return FALSE;
+  }
+  if (!entry->shared)
+    return FALSE;
+
   if (TreeFind(&tree, ArenaChunkTree(arena), TreeKeyOfAddrVar(addr),
                ChunkCompare)
       == CompareEQUAL)
   {
-    Chunk chunk = ChunkOfTree(tree);
+    chunk = ChunkOfTree(tree);
     AVER_CRITICAL(chunk->base <= addr);
     AVER_CRITICAL(addr < chunk->limit);
     *chunkReturn = chunk;
@@ -139,6 +139,7 @@ typedef struct ChunkStruct {
   Index allocBase;      /* index of first page allocatable to clients */
   Index pages;          /* index of the page after the last allocatable page */
   BT allocTable;        /* page allocation table */
+  BT dirtyTable;        /* pages written, while harvesting, or NULL */
   Page pageTable;       /* the page table */
   Count pageTablePages; /* number of pages occupied by page table */
   Size reserved;        /* reserved address space for chunk (including overhead
@@ -163,9 +164,10 @@ extern Res ChunkInit(Chunk chunk, Arena arena, Addr base, Addr limit,
 extern void ChunkFinish(Chunk chunk);
 extern Compare ChunkCompare(Tree tree, TreeKey key);
 extern TreeKey ChunkKey(Tree tree);
-extern Bool ChunkCacheEntryCheck(ChunkCacheEntry entry);
-extern void ChunkCacheEntryInit(ChunkCacheEntry entry);
 extern Bool ChunkOfAddr(Chunk *chunkReturn, Arena arena, Addr addr);
+extern void ChunkMapInit(Arena arena);
+extern void ChunkMapInsert(Arena arena, Chunk chunk);
+extern void ChunkMapRemove(Arena arena, Chunk chunk);
 extern Res ChunkNodeDescribe(Tree node, mps_lib_FILE *stream);
 
 
@@ -23,6 +23,10 @@ Bool VMCheck(VM vm)
   CHECKL(ArenaGrainSizeCheck(vm->pageSize));
   CHECKL(AddrIsAligned(vm->base, vm->pageSize));
   CHECKL(AddrIsAligned(vm->limit, vm->pageSize));
+  CHECKL(SizeIsAligned(vm->hugePageSize, vm->pageSize));
+  CHECKL(AddrIsAligned(vm->base, vm->hugePageSize));
+  CHECKL(BoolCheck(vm->discard));
+  CHECKL(BoolCheck(vm->prefault));
   CHECKL(vm->block != NULL);
   CHECKL((Addr)vm->block <= vm->base);
   CHECKL(vm->mapped <= vm->reserved);
@@ -40,6 +44,16 @@ Size (VMPageSize)(VM vm)
 }
 
 
+/* VMHugePageSize -- return the huge page size cached in the VM */
+
+Size (VMHugePageSize)(VM vm)
+{
+  AVERT(VM, vm);
+
+  return VMHugePageSize(vm);
+}
+
+
 /* VMBase -- return the base address of the memory reserved */
 
 Addr (VMBase)(VM vm)
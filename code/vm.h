@@ -22,14 +22,18 @@
 typedef struct VMStruct {
   Sig sig;                      /* <design/sig> */
   Size pageSize;                /* operating system page size */
+  Size hugePageSize;            /* huge page size, or pageSize if none */
   void *block;                  /* unaligned base of mmap'd memory */
   Addr base, limit;             /* aligned boundaries of reserved space */
   Size reserved;                /* total reserved address space */
   Size mapped;                  /* total mapped memory */
+  Bool discard;                 /* unmap by discarding contents? */
+  Bool prefault;                /* fault pages in when mapping? */
 } VMStruct;
 
 
 #define VMPageSize(vm) RVALUE((vm)->pageSize)
+#define VMHugePageSize(vm) RVALUE((vm)->hugePageSize)
 #define VMBase(vm) RVALUE((vm)->base)
 #define VMLimit(vm) RVALUE((vm)->limit)
 #define VMReserved(vm) RVALUE((vm)->reserved)
@@ -37,6 +41,7 @@ typedef struct VMStruct {
 
 extern Size PageSize(void);
 extern Size (VMPageSize)(VM vm);
+extern Size (VMHugePageSize)(VM vm);
 extern Bool VMCheck(VM vm);
 extern Res VMParamFromArgs(void *params, size_t paramSize, ArgList args);
 extern Res VMInit(VM vmReturn, Size size, Size grainSize, void *params);
@@ -64,6 +64,9 @@ Res VMInit(VM vm, Size size, Size grainSize, void *params)
   (void)mps_lib_memset(vbase, VMJunkBYTE, reserved);
 
   vm->pageSize = pageSize;
+  vm->hugePageSize = pageSize;
+  vm->discard = FALSE;
+  vm->prefault = FALSE;
   vm->block = vbase;
   vm->base  = AddrAlignUp(vbase, grainSize);
   vm->limit = AddrAdd(vm->base, size);
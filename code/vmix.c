@@ -24,6 +24,21 @@
  * a definition of MAP_ANON requires a _BSD_SOURCE to be defined prior
  * to <sys/mman.h>; see config.h.
  *
+ * .huge: If MPS_KEY_ARENA_HUGE_PAGES is TRUE, reserved address
+ * space of at least VM_HUGE_PAGE_MIN is aligned to VM_HUGE_PAGE_SIZE and mapped memory is advised
+ * with MADV_HUGEPAGE, so that the operating system can back it with
+ * transparent huge pages.  This is only supported on Linux; elsewhere
+ * the keyword argument is ignored.  See <design/vm#.huge>.
+ *
+ * .discard: If MPS_KEY_ARENA_SPARE_DISCARD is TRUE, VMUnmap discards
+ * the contents of the pages with madvise instead of replacing the
+ * mapping, and VMMap makes them accessible again with mprotect, so
+ * that the address space stays mapped.  See <design/vm#.discard>.
+ *
+ * .prefault: If MPS_KEY_ARENA_PREFAULT is TRUE, VMMap faults in the
+ * pages it maps, so that the first write to each page doesn't take a
+ * page fault.  See <design/vm#.prefault>.
+ *
  * .assume.not-last: The implementation of VMInit assumes that
  * mmap() will not choose a region which contains the last page
  * in the address space, so that the limit of the mapped area
@@ -70,21 +85,88 @@ Size PageSize(void)
 }
 
 
+/* VMParamsStruct -- VM parameters */
+
+typedef struct VMParamsStruct {
+  BOOLFIELD(hugePages); /* use transparent huge pages? */
+  BOOLFIELD(discard);   /* unmap by discarding contents? */
+  BOOLFIELD(prefault);  /* fault pages in when mapping? */
+} VMParamsStruct, *VMParams;
+
+static const VMParamsStruct vmParamsDefaults = {
+  /* .hugePages = */ VM_HUGE_PAGES_DEFAULT,
+  /* .discard = */ VM_DISCARD_DEFAULT,
+  /* .prefault = */ VM_PREFAULT_DEFAULT,
+};
+
 Res VMParamFromArgs(void *params, size_t paramSize, ArgList args)
 {
+  VMParams vmParams;
+  ArgStruct arg;
   AVER(params != NULL);
   AVERT(ArgList, args);
+  AVER(paramSize >= sizeof(VMParamsStruct));
   UNUSED(paramSize);
+  vmParams = (VMParams)params;
+  (void)mps_lib_memcpy(vmParams, &vmParamsDefaults, sizeof(VMParamsStruct));
+  if (ArgPick(&arg, args, MPS_KEY_ARENA_HUGE_PAGES))
+    vmParams->hugePages = BOOLOF(arg.val.b);
+  if (ArgPick(&arg, args, MPS_KEY_ARENA_SPARE_DISCARD))
+    vmParams->discard = BOOLOF(arg.val.b);
+  if (ArgPick(&arg, args, MPS_KEY_ARENA_PREFAULT))
+    vmParams->prefault = BOOLOF(arg.val.b);
   return ResOK;
 }
 
 
+/* vmAdviseHuge -- ask for huge pages for a range of the VM
+ *
+ * Advising the whole range after each mapping keeps the flags of the
+ * kernel's mappings equal, so that it can merge them.
+ */
+
+static void vmAdviseHuge(VM vm, void *base, Size size)
+{
+  if (vm->hugePageSize > vm->pageSize) {
+#if defined(MADV_HUGEPAGE)
+    /* Failure just means that we don't get huge pages. */
+    (void)madvise(base, (size_t)size, MADV_HUGEPAGE);
+#else
+    UNUSED(base);
+    UNUSED(size);
+#endif
+  }
+}
+
+
+/* vmPrefault -- fault in a newly mapped range of the VM
+ *
+ * MADV_POPULATE_WRITE faults in the whole range in one system call,
+ * but is only supported by Linux 5.14 and later, so fall back to
+ * writing to each page.  This is done after any advice, so that the
+ * pages can be huge.  See .prefault.
+ */
+
+static void vmPrefault(VM vm, void *base, Size size)
+{
+  char *p, *limit;
+#if defined(MADV_POPULATE_WRITE)
+  if (madvise(base, (size_t)size, MADV_POPULATE_WRITE) == 0)
+    return;
+#endif
+  limit = (char *)base + size;
+  for (p = base; p < limit; p += vm->pageSize)
+    *(volatile char *)p = 0;
+}
+
+
 /* VMInit -- reserve some virtual address space, and create a VM structure */
 
 Res VMInit(VM vm, Size size, Size grainSize, void *params)
 {
-  Size pageSize, reserved;
+  Size pageSize, hugePageSize, align, reserved;
   void *vbase;
+  VMParams vmParams = params;
 
   AVER(vm != NULL);
   AVERT(ArenaGrainSize, grainSize);
@@ -100,8 +182,19 @@ Res VMInit(VM vm, Size size, Size grainSize, void *params)
   size = SizeRoundUp(size, grainSize);
   if (size < grainSize || size > (Size)(size_t)-1)
     return ResRESOURCE;
-  reserved = size + grainSize - pageSize;
-  if (reserved < grainSize || reserved > (Size)(size_t)-1)
+
+  /* See .huge. */
+  hugePageSize = pageSize;
+#if defined(MADV_HUGEPAGE)
+  if (vmParams->hugePages && VM_HUGE_PAGE_SIZE > pageSize
+      && size >= VM_HUGE_PAGE_MIN)
+    hugePageSize = VM_HUGE_PAGE_SIZE;
+#else
+  UNUSED(vmParams);
+#endif
+  align = grainSize > hugePageSize ? grainSize : hugePageSize;
+  reserved = size + align - pageSize;
+  if (reserved < align || reserved > (Size)(size_t)-1)
     return ResRESOURCE;
 
   /* See .assume.not-last. */
@@ -118,8 +211,11 @@ Res VMInit(VM vm, Size size, Size grainSize, void *params)
   }
 
   vm->pageSize = pageSize;
+  vm->hugePageSize = hugePageSize;
+  vm->discard = BOOLOF(vmParams->discard);
+  vm->prefault = BOOLOF(vmParams->prefault);
   vm->block = vbase;
-  vm->base = AddrAlignUp(vbase, grainSize);
+  vm->base = AddrAlignUp(vbase, align);
   vm->limit = AddrAdd(vm->base, size);
   AVER(vm->base < vm->limit);  /* .assume.not-last */
   AVER(vm->limit <= AddrAdd((Addr)vm->block, reserved));
@@ -129,6 +225,8 @@ Res VMInit(VM vm, Size size, Size grainSize, void *params)
   vm->sig = VMSig;
   AVERT(VM, vm);
 
+  vmAdviseHuge(vm, vm->block, reserved);
+
   EVENT3(VMInit, vm, VMBase(vm), VMLimit(vm));
   return ResOK;
 }
@@ -172,14 +270,27 @@ Res VMMap(VM vm, Addr base, Addr limit)
 
   size = AddrOffset(base, limit);
 
-  if(mmap((void *)base, (size_t)size,
-          PROT_READ | PROT_WRITE | PROT_EXEC,
-          MAP_ANON | MAP_PRIVATE | MAP_FIXED,
-          -1, 0)
-     == MAP_FAILED) {
-    AVER(errno == ENOMEM); /* .assume.mmap.err */
-    return ResMEMORY;
+  if (vm->discard) {
+    /* See .discard.  The range may have been discarded, or never
+       mapped, but either way it's a private anonymous mapping. */
+    if (mprotect((void *)base, (size_t)size,
+                 PROT_READ | PROT_WRITE | PROT_EXEC) != 0) {
+      AVER(errno == ENOMEM);
+      return ResMEMORY;
+    }
+  } else {
+    if(mmap((void *)base, (size_t)size,
+            PROT_READ | PROT_WRITE | PROT_EXEC,
+            MAP_ANON | MAP_PRIVATE | MAP_FIXED,
+            -1, 0)
+       == MAP_FAILED) {
+      AVER(errno == ENOMEM); /* .assume.mmap.err */
+      return ResMEMORY;
+    }
+    vmAdviseHuge(vm, (void *)base, size);
   }
+  if (vm->prefault)
+    vmPrefault(vm, (void *)base, size);
 
   vm->mapped += size;
   AVER(VMMapped(vm) <= VMReserved(vm));
@@ -206,11 +317,25 @@ void VMUnmap(VM vm, Addr base, Addr limit)
   size = AddrOffset(base, limit);
   AVER(size <= VMMapped(vm));
 
-  /* see <design/vmo1#.fun.unmap.offset> */
-  addr = mmap((void *)base, (size_t)size,
-              PROT_NONE, MAP_ANON | MAP_PRIVATE | MAP_FIXED,
-              -1, 0);
-  AVER(addr == (void *)base);
+  if (vm->discard) {
+    /* See .discard.  MADV_FREE lets the kernel reclaim the pages
+       lazily, but is only supported by Linux 4.5 and later, so fall
+       back to MADV_DONTNEED. */
+    int res = -1;
+#if defined(MADV_FREE)
+    res = madvise((void *)base, (size_t)size, MADV_FREE);
+#endif
+    if (res != 0)
+      res = madvise((void *)base, (size_t)size, MADV_DONTNEED);
+    AVER(res == 0);
+  } else {
+    /* see <design/vmo1#.fun.unmap.offset> */
+    addr = mmap((void *)base, (size_t)size,
+                PROT_NONE, MAP_ANON | MAP_PRIVATE | MAP_FIXED,
+                -1, 0);
+    AVER(addr == (void *)base);
+    vmAdviseHuge(vm, addr, size);
+  }
 
   vm->mapped -= size;
 
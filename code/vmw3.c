@@ -132,6 +132,9 @@ Res VMInit(VM vm, Size size, Size grainSize, void *params)
   AVER(AddrIsAligned(vbase, pageSize));
 
   vm->pageSize = pageSize;
+  vm->hugePageSize = pageSize;
+  vm->discard = FALSE;
+  vm->prefault = FALSE;
   vm->block = vbase;
   vm->base = AddrAlignUp(vbase, grainSize);
   vm->limit = AddrAdd(vm->base, size);
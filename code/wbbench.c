@@ -0,0 +1,319 @@
+/* wbbench.c -- write barrier benchmark
+ *
+ * $Id$
+ * Copyright (c) 2020 Ravenbrook Limited.  See end of file for license.
+ *
+ * This benchmark compares the implementations of the write barrier:
+ * memory protection (see <design/write-barrier>), soft-dirty page
+ * tracking (see <design/write-barrier#.soft-dirty>), and the software
+ * write barrier (see <design/write-barrier#.software>).  It makes a
+ * table of old objects, promotes them, and then stores references to
+ * newly allocated young objects into random slots of the old objects,
+ * so that each minor collection has to find the old-to-young
+ * references by way of the write barrier.
+ */
+
+#include "mps.c"
+#include "testlib.h"
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "mpm.h"
+
+#ifdef MPS_OS_W3
+#include "getopt.h"
+#else
+#include <getopt.h>
+#endif
+
+#include <stdio.h> /* fflush, fprintf, printf, stderr, stdout */
+#include <stdlib.h> /* exit, EXIT_FAILURE, EXIT_SUCCESS, free, malloc */
+#include <time.h> /* clock, CLOCKS_PER_SEC */
+
+#define RESMUST(expr) \
+  do { \
+    mps_res_t res = (expr); \
+    if (res != MPS_RES_OK) { \
+      fprintf(stderr, #expr " returned %d\n", res); \
+      exit(EXIT_FAILURE); \
+    } \
+  } while(0)
+
+static rnd_state_t seed = 0;      /* random number seed */
+static size_t arena_size = 256ul * 1024 * 1024; /* arena size */
+static size_t nold = 1ul << 14;   /* old objects */
+static size_t slots = 64;         /* slots in each old object */
+static size_t nursery = 1024;     /* nursery capacity (kB) */
+static unsigned long nstores = 1ul << 22; /* stores to time */
+
+
+/* store_refs -- time stores of young references into old objects */
+
+static void store_refs(mps_bool_t soft_dirty, mps_bool_t software_barrier,
+                       const char *name)
+{
+  mps_arena_t arena;
+  mps_fmt_t format;
+  mps_chain_t chain;
+  mps_pool_t pool;
+  mps_ap_t ap;
+  mps_root_t root;
+  mps_wb_t wb;
+  mps_word_t *refs;
+  mps_gen_param_s gens[2];
+  size_t i;
+  unsigned long k;
+  mps_word_t collections;
+  clock_t begin, store_time;
+  double seconds;
+  Ring node, next;
+  size_t segs = 0, summarized = 0;
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, arena_size);
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SOFT_DIRTY, soft_dirty);
+    RESMUST(mps_arena_create_k(&arena, mps_arena_class_vm(), args));
+  } MPS_ARGS_END(args);
+
+  gens[0].mps_capacity = nursery;
+  gens[0].mps_mortality = 0.9;
+  gens[1].mps_capacity = arena_size / 1024;
+  gens[1].mps_mortality = 0.1;
+  RESMUST(mps_chain_create(&chain, arena, NELEMS(gens), gens));
+
+  RESMUST(dylan_fmt(&format, arena));
+  RESMUST(dylan_make_wrappers());
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    MPS_ARGS_ADD(args, MPS_KEY_SOFTWARE_BARRIER, software_barrier);
+    RESMUST(mps_pool_create_k(&pool, arena, mps_class_amc(), args));
+  } MPS_ARGS_END(args);
+  RESMUST(mps_ap_create_k(&ap, pool, mps_args_none));
+
+  /* The root is scanned while the objects are being made, so it must
+     be initialized first.  The last entry holds the most recent young
+     object. */
+  refs = malloc((nold + 1) * sizeof refs[0]);
+  if (refs == NULL) {
+    fprintf(stderr, "Couldn't allocate root\n");
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0; i <= nold; ++i)
+    refs[i] = DYLAN_INT(0);
+  RESMUST(mps_root_create_area(&root, arena, mps_rank_exact(), 0,
+                               refs, refs + nold + 1, mps_scan_area, NULL));
+
+  /* Promote the old objects out of the nursery, so that references
+     from them to young objects are found by the write barrier. */
+  for (i = 0; i < nold; ++i)
+    RESMUST(make_dylan_vector(&refs[i], ap, slots));
+  RESMUST(mps_arena_collect(arena));
+  mps_arena_release(arena);
+  collections = mps_collections(arena);
+
+  wb = mps_arena_wb(arena);
+  begin = clock();
+  for (k = 0; k < nstores; ++k) {
+    mps_word_t old;
+    RESMUST(make_dylan_vector(&refs[nold], ap, 2));
+    old = refs[rnd() % nold];
+    if (software_barrier)
+      MPS_WRITE_BARRIER(wb,
+                        (mps_addr_t *)&DYLAN_VECTOR_SLOT(old, rnd() % slots),
+                        (mps_addr_t)refs[nold]);
+    else
+      DYLAN_VECTOR_SLOT(old, rnd() % slots) = refs[nold];
+  }
+  store_time = clock() - begin;
+  collections = mps_collections(arena) - collections;
+
+  seconds = (double)store_time / CLOCKS_PER_SEC;
+  printf("%s: %g (%lu stores, %lu collections, soft-dirty %s)\n",
+         name, seconds, nstores, (unsigned long)collections,
+         ArenaSoftDirty((Arena)arena) ? "active" : "unavailable");
+  if (nstores > 0)
+    printf("%s store: %g ns per store\n", name,
+           seconds * 1e9 / (double)nstores);
+
+  /* Count the segments whose summaries survived the last trace: if
+     the collector dirtied the pages it scanned, there would be none
+     with soft-dirty tracking <design/write-barrier#.soft-dirty.collector>. */
+  mps_arena_park(arena);
+  RING_FOR(node, PoolSegRing((Pool)pool), next) {
+    Seg seg = SegOfPoolRing(node);
+    ++segs;
+    if (SegSummary(seg) != RefSetUNIV)
+      ++summarized;
+  }
+  printf("%s: %lu of %lu segments summarized\n", name,
+         (unsigned long)summarized, (unsigned long)segs);
+
+  mps_root_destroy(root);
+  mps_ap_destroy(ap);
+  mps_pool_destroy(pool);
+  mps_fmt_destroy(format);
+  mps_chain_destroy(chain);
+  mps_arena_destroy(arena);
+  free(refs);
+}
+
+
+/* Command-line options definitions.  See getopt_long(3). */
+
+static struct option longopts[] = {
+  {"help",             no_argument,       NULL, 'h'},
+  {"arena-size",       required_argument, NULL, 'm'},
+  {"nold",             required_argument, NULL, 'n'},
+  {"slots",            required_argument, NULL, 'l'},
+  {"nursery",          required_argument, NULL, 'g'},
+  {"nstores",          required_argument, NULL, 's'},
+  {"seed",             required_argument, NULL, 'x'},
+  {NULL,               0,                 NULL, 0  }
+};
+
+
+static struct {
+  const char *name;
+  mps_bool_t soft_dirty;
+  mps_bool_t software_barrier;
+} barriers[] = {
+  {"prot", FALSE, FALSE},
+  {"soft", TRUE,  FALSE},
+  {"card", FALSE, TRUE},
+};
+
+
+/* Command-line driver */
+
+int main(int argc, char *argv[])
+{
+  int ch;
+  unsigned i;
+  mps_bool_t seed_specified = FALSE;
+
+  seed = rnd_seed();
+
+  while ((ch = getopt_long(argc, argv, "hm:n:l:g:s:x:",
+                           longopts, NULL)) != -1)
+    switch (ch) {
+    case 'm': {
+        char *p;
+        arena_size = (size_t)strtoul(optarg, &p, 10);
+        switch(toupper(*p)) {
+        case 'G': arena_size <<= 30; break;
+        case 'M': arena_size <<= 20; break;
+        case 'K': arena_size <<= 10; break;
+        case '\0': break;
+        default:
+          fprintf(stderr, "Bad arena size %s\n", optarg);
+          return EXIT_FAILURE;
+        }
+      }
+      break;
+    case 'n':
+      nold = (size_t)strtoul(optarg, NULL, 10);
+      break;
+    case 'l':
+      slots = (size_t)strtoul(optarg, NULL, 10);
+      break;
+    case 'g':
+      nursery = (size_t)strtoul(optarg, NULL, 10);
+      break;
+    case 's':
+      nstores = strtoul(optarg, NULL, 10);
+      break;
+    case 'x':
+      seed = strtoul(optarg, NULL, 10);
+      seed_specified = TRUE;
+      break;
+    default:
+      /* This is printed in parts to keep within the 509 character
+         limit for string literals in portable standard C. */
+      fprintf(stderr,
+              "Usage: %s [option...] [test...]\n"
+              "Options:\n"
+              "  -m n, --arena-size=n[KMG]?\n"
+              "    Size of the arena (default %lu)\n"
+              "  -n n, --nold=n\n"
+              "    Number of old objects (default %lu)\n"
+              "  -l n, --slots=n\n"
+              "    Number of slots in each old object (default %lu)\n",
+              argv[0],
+              (unsigned long)arena_size,
+              (unsigned long)nold,
+              (unsigned long)slots);
+      fprintf(stderr,
+              "  -g n, --nursery=n\n"
+              "    Nursery capacity in kB (default %lu)\n"
+              "  -s n, --nstores=n\n"
+              "    Time n stores of young objects (default %lu)\n"
+              "  -x n, --seed=n\n"
+              "    Random number seed (default from entropy)\n"
+              "Tests:\n"
+              "  prot  write barrier using memory protection\n"
+              "  soft  write barrier using soft-dirty page tracking\n"
+              "  card  software write barrier\n",
+              (unsigned long)nursery,
+              nstores);
+      return EXIT_FAILURE;
+    }
+  argc -= optind;
+  argv += optind;
+
+  if (nold == 0 || slots == 0) {
+    fprintf(stderr, "Need at least one old object with one slot\n");
+    return EXIT_FAILURE;
+  }
+
+  if (!seed_specified) {
+    printf("seed: %lu\n", seed);
+    (void)fflush(stdout);
+  }
+
+  while (argc > 0) {
+    for (i = 0; i < NELEMS(barriers); ++i)
+      if (strcmp(argv[0], barriers[i].name) == 0)
+        goto found;
+    fprintf(stderr, "unknown barrier test \"%s\"\n", argv[0]);
+    return EXIT_FAILURE;
+  found:
+    (void)mps_lib_assert_fail_install(assert_die);
+    rnd_state_set(seed);
+    store_refs(barriers[i].soft_dirty, barriers[i].software_barrier,
+               barriers[i].name);
+    --argc;
+    ++argv;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */